@@ -0,0 +1,117 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Allocations.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Plain static, must be usable before any other static constructor runs.
+auto gAllocationCounters = CaffeineTake::Benchmark::AllocationCounters();
+
+// Size is kept in front of each block so delete knows what is freed.
+// Header is as large as malloc alignment, blocks stay aligned.
+constexpr auto HeaderSize = alignof(std::max_align_t);
+
+auto CountedAlloc (std::size_t size) -> void*
+{
+    gAllocationCounters.Count.fetch_add(1, std::memory_order_relaxed);
+    gAllocationCounters.Bytes.fetch_add(size, std::memory_order_relaxed);
+
+    auto block = static_cast<std::byte*>(std::malloc(HeaderSize + size));
+    if (!block)
+    {
+        throw std::bad_alloc();
+    }
+
+    *reinterpret_cast<std::size_t*>(block) = size;
+
+    const auto live = gAllocationCounters.Live.fetch_add(size, std::memory_order_relaxed) + size;
+    auto       peak = gAllocationCounters.Peak.load(std::memory_order_relaxed);
+    while (live > peak && !gAllocationCounters.Peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+
+    return block + HeaderSize;
+}
+
+auto CountedFree (void* ptr) -> void
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    const auto block = static_cast<std::byte*>(ptr) - HeaderSize;
+    gAllocationCounters.Live.fetch_sub(*reinterpret_cast<std::size_t*>(block), std::memory_order_relaxed);
+
+    std::free(block);
+}
+
+} // namespace
+
+auto operator new (std::size_t size) -> void*
+{
+    return CountedAlloc(size);
+}
+
+auto operator new[] (std::size_t size) -> void*
+{
+    return CountedAlloc(size);
+}
+
+auto operator delete (void* ptr) noexcept -> void
+{
+    CountedFree(ptr);
+}
+
+auto operator delete[] (void* ptr) noexcept -> void
+{
+    CountedFree(ptr);
+}
+
+auto operator delete (void* ptr, std::size_t) noexcept -> void
+{
+    CountedFree(ptr);
+}
+
+auto operator delete[] (void* ptr, std::size_t) noexcept -> void
+{
+    CountedFree(ptr);
+}
+
+namespace CaffeineTake::Benchmark {
+
+auto GetAllocationCounters () -> AllocationCounters&
+{
+    return gAllocationCounters;
+}
+
+auto ResetPeak () -> std::uint64_t
+{
+    const auto live = gAllocationCounters.Live.load(std::memory_order_relaxed);
+    gAllocationCounters.Peak.store(live, std::memory_order_relaxed);
+    return live;
+}
+
+} // namespace CaffeineTake::Benchmark
@@ -0,0 +1,44 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace CaffeineTake::Benchmark {
+
+// Updated by replaced global operator new, all threads are counted. Linked
+// into benchmarks and tests both.
+struct AllocationCounters
+{
+    std::atomic<std::uint64_t> Count = 0;
+    std::atomic<std::uint64_t> Bytes = 0;
+    std::atomic<std::uint64_t> Live  = 0;   // allocated and not freed yet
+    std::atomic<std::uint64_t> Peak  = 0;   // highest Live since ResetPeak
+};
+
+auto GetAllocationCounters () -> AllocationCounters&;
+
+// Starts new peak from current live bytes and returns them, peak of a piece
+// of code is Peak - returned value after it runs.
+auto ResetPeak () -> std::uint64_t;
+
+} // namespace CaffeineTake::Benchmark
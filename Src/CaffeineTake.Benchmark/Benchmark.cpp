@@ -0,0 +1,267 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <string>
+#include <system_error>
+#include <utility>
+
+namespace CaffeineTake::Benchmark {
+
+#pragma region "State"
+
+auto State::StartTiming () -> void
+{
+    auto& counters = GetAllocationCounters();
+    mAllocs = counters.Count.load(std::memory_order_relaxed);
+    mBytes  = counters.Bytes.load(std::memory_order_relaxed);
+
+    ClobberMemory();
+    mBegin = Clock::now();
+}
+
+auto State::StopTiming () -> void
+{
+    mEnd = Clock::now();
+    ClobberMemory();
+
+    auto& counters = GetAllocationCounters();
+    mAllocs = counters.Count.load(std::memory_order_relaxed) - mAllocs;
+    mBytes  = counters.Bytes.load(std::memory_order_relaxed) - mBytes;
+}
+
+#pragma endregion
+
+#pragma region "Registry"
+
+auto GetBenchmarks () -> std::vector<BenchmarkInfo>&
+{
+    static auto benchmarks = std::vector<BenchmarkInfo>();
+    return benchmarks;
+}
+
+auto Register (std::string name, BenchmarkFn body) -> bool
+{
+    GetBenchmarks().push_back(BenchmarkInfo{ std::move(name), std::move(body) });
+    return true;
+}
+
+auto GetScratchDirectory () -> const std::filesystem::path&
+{
+    static const auto path = []
+    {
+        const auto name = "CaffeineTake.Benchmark." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        auto dir = std::filesystem::temp_directory_path() / name;
+        std::filesystem::create_directories(dir);
+        return dir;
+    }();
+
+    return path;
+}
+
+auto RemoveScratchDirectory () -> void
+{
+    auto ec = std::error_code();
+    std::filesystem::remove_all(GetScratchDirectory(), ec);
+}
+
+#pragma endregion
+
+#pragma region "Run"
+
+auto Run (const BenchmarkInfo& benchmark, const RunOptions& options) -> Result
+{
+    using namespace std::chrono;
+
+    constexpr auto MaxIterations = size_t{1'000'000'000};
+
+    const auto minTime = duration_cast<State::Clock::duration>(options.MinTime);
+
+    // Grow iteration count until one sample takes at least minTime,
+    // calibration runs double as warm up.
+    auto iterations = size_t{1};
+    while (true)
+    {
+        auto state = State(iterations);
+        benchmark.Body(state);
+
+        const auto elapsed = state.GetElapsed();
+        if (elapsed >= minTime || iterations >= MaxIterations)
+        {
+            break;
+        }
+
+        const auto ratio  = elapsed.count() > 0 ? 1.4 * minTime.count() / elapsed.count() : 10.0;
+        const auto factor = std::clamp(ratio, 2.0, 10.0);
+        iterations = std::min(MaxIterations, static_cast<size_t>(iterations * factor));
+    }
+
+    auto result = Result();
+    result.Name       = benchmark.Name;
+    result.Iterations = iterations;
+    result.Samples    = std::max(options.Samples, size_t{1});
+
+    auto perOp  = std::vector<double>();
+    auto allocs = std::uint64_t{0};
+    auto bytes  = std::uint64_t{0};
+    perOp.reserve(result.Samples);
+
+    for (auto i = size_t{0}; i < result.Samples; ++i)
+    {
+        auto state = State(iterations);
+        benchmark.Body(state);
+
+        perOp.push_back(static_cast<double>(duration_cast<nanoseconds>(state.GetElapsed()).count()) / iterations);
+        allocs += state.GetAllocations();
+        bytes  += state.GetAllocatedBytes();
+
+        for (const auto& [name, value] : state.GetCounters())
+        {
+            result.Counters[name] = value;
+        }
+    }
+
+    std::sort(perOp.begin(), perOp.end());
+
+    const auto count = static_cast<double>(perOp.size());
+    const auto mid   = perOp.size() / 2;
+
+    result.MedianNs = perOp.size() % 2 ? perOp[mid] : (perOp[mid - 1] + perOp[mid]) / 2.0;
+    result.MeanNs   = std::accumulate(perOp.begin(), perOp.end(), 0.0) / count;
+    result.MinNs    = perOp.front();
+    result.MaxNs    = perOp.back();
+
+    auto variance = 0.0;
+    for (const auto ns : perOp)
+    {
+        variance += (ns - result.MeanNs) * (ns - result.MeanNs);
+    }
+    result.StdDevNs = perOp.size() > 1 ? std::sqrt(variance / (count - 1.0)) : 0.0;
+
+    const auto totalIterations = static_cast<double>(iterations) * result.Samples;
+    result.AllocsPerOp = allocs / totalIterations;
+    result.BytesPerOp  = bytes  / totalIterations;
+
+    return result;
+}
+
+#pragma endregion
+
+#pragma region "JSON"
+
+auto WriteJson (const std::vector<Result>& results) -> std::string
+{
+    auto benchmarks = nlohmann::json::array();
+    for (const auto& result : results)
+    {
+        auto counters = nlohmann::json::object();
+        for (const auto& [name, value] : result.Counters)
+        {
+            counters[name] = value;
+        }
+
+        benchmarks.push_back({
+            { "name",          result.Name        },
+            { "iterations",    result.Iterations  },
+            { "samples",       result.Samples     },
+            { "median_ns",     result.MedianNs    },
+            { "mean_ns",       result.MeanNs      },
+            { "min_ns",        result.MinNs       },
+            { "max_ns",        result.MaxNs       },
+            { "stddev_ns",     result.StdDevNs    },
+            { "allocs_per_op", result.AllocsPerOp },
+            { "bytes_per_op",  result.BytesPerOp  },
+            { "counters",      counters           }
+        });
+    }
+
+    auto json = nlohmann::json{
+        { "context", {
+#if defined(__clang__)
+            { "compiler", "clang " __clang_version__ },
+#elif defined(__GNUC__)
+            { "compiler", "gcc " __VERSION__ },
+#elif defined(_MSC_VER)
+            { "compiler", "msvc " + std::to_string(_MSC_VER) },
+#endif
+#if defined(NDEBUG)
+            { "build", "release" },
+#else
+            { "build", "debug" },
+#endif
+            { "unit", "ns" }
+        }},
+        { "benchmarks", benchmarks }
+    };
+
+    return json.dump(2) + '\n';
+}
+
+auto ReadJson (const std::string& text, std::vector<Result>& results) -> bool
+{
+    const auto json = nlohmann::json::parse(text, nullptr, false);
+    if (json.is_discarded() || !json.contains("benchmarks") || !json["benchmarks"].is_array())
+    {
+        return false;
+    }
+
+    results.clear();
+    for (const auto& item : json["benchmarks"])
+    {
+        if (!item.contains("name") || !item.contains("median_ns"))
+        {
+            return false;
+        }
+
+        auto result = Result();
+        result.Name        = item["name"].get<std::string>();
+        result.Iterations  = item.value("iterations",    size_t{0});
+        result.Samples     = item.value("samples",       size_t{0});
+        result.MedianNs    = item["median_ns"].get<double>();
+        result.MeanNs      = item.value("mean_ns",       0.0);
+        result.MinNs       = item.value("min_ns",        0.0);
+        result.MaxNs       = item.value("max_ns",        0.0);
+        result.StdDevNs    = item.value("stddev_ns",     0.0);
+        result.AllocsPerOp = item.value("allocs_per_op", 0.0);
+        result.BytesPerOp  = item.value("bytes_per_op",  0.0);
+
+        if (item.contains("counters") && item["counters"].is_object())
+        {
+            for (const auto& [name, value] : item["counters"].items())
+            {
+                result.Counters[name] = value.get<double>();
+            }
+        }
+
+        results.push_back(std::move(result));
+    }
+
+    return true;
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake::Benchmark
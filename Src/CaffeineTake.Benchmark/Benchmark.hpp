@@ -0,0 +1,246 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Allocations.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CaffeineTake::Benchmark {
+
+#pragma region "DoNotOptimize"
+
+// Keep value (and computation producing it) from being optimized away.
+template <typename T>
+inline auto DoNotOptimize (T const& value) -> void
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile auto sink = static_cast<const void*>(nullptr);
+    sink = &value;
+#endif
+}
+
+inline auto ClobberMemory () -> void
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+#pragma endregion
+
+#pragma region "State"
+
+// Passed to benchmark body, only the range-for loop over it is timed:
+//
+//     BENCHMARK("Group/Name")
+//     {
+//         auto input = Setup();          // not timed
+//         for (auto _ : state)
+//         {
+//             DoNotOptimize(Work(input));
+//         }
+//     }
+class State final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    size_t                        mIterations = 0;
+    Clock::time_point             mBegin      = Clock::time_point();
+    Clock::time_point             mEnd        = Clock::time_point();
+    std::uint64_t                 mAllocs     = 0;
+    std::uint64_t                 mBytes      = 0;
+    std::map<std::string, double> mCounters   = std::map<std::string, double>();
+
+    auto StartTiming () -> void;
+    auto StopTiming  () -> void;
+
+public:
+    struct Sentinel
+    {
+    };
+
+    // Loop variable type, unused by design.
+    struct [[maybe_unused]] Value
+    {
+    };
+
+    class Iterator final
+    {
+        State* mState     = nullptr;
+        size_t mRemaining = 0;
+
+    public:
+        Iterator (State* state, size_t remaining)
+            : mState     (state)
+            , mRemaining (remaining)
+        {
+        }
+
+        auto operator* () const -> Value
+        {
+            return Value();
+        }
+
+        auto operator++ () -> Iterator&
+        {
+            mRemaining -= 1;
+            return *this;
+        }
+
+        auto operator!= (Sentinel) -> bool
+        {
+            if (mRemaining != 0)
+            {
+                return true;
+            }
+
+            mState->StopTiming();
+            return false;
+        }
+    };
+
+    explicit State (size_t iterations)
+        : mIterations (iterations)
+    {
+    }
+
+    auto begin () -> Iterator
+    {
+        StartTiming();
+        return Iterator(this, mIterations);
+    }
+
+    auto end () -> Sentinel
+    {
+        return Sentinel();
+    }
+
+    auto GetIterations () const -> size_t
+    {
+        return mIterations;
+    }
+
+    // Custom value reported with results, last sample wins.
+    auto SetCounter (const std::string& name, double value) -> void
+    {
+        mCounters[name] = value;
+    }
+
+    auto GetElapsed () const -> Clock::duration
+    {
+        return mEnd - mBegin;
+    }
+
+    auto GetAllocations () const -> std::uint64_t
+    {
+        return mAllocs;
+    }
+
+    auto GetAllocatedBytes () const -> std::uint64_t
+    {
+        return mBytes;
+    }
+
+    auto GetCounters () const -> const std::map<std::string, double>&
+    {
+        return mCounters;
+    }
+};
+
+#pragma endregion
+
+#pragma region "Registry"
+
+using BenchmarkFn = std::function<void (State&)>;
+
+struct BenchmarkInfo
+{
+    std::string Name = std::string();
+    BenchmarkFn Body = nullptr;
+};
+
+auto Register      (std::string name, BenchmarkFn body) -> bool;
+auto GetBenchmarks () -> std::vector<BenchmarkInfo>&;
+
+// Per run temporary directory for files benchmarks write, created on first
+// use and removed by RemoveScratchDirectory.
+auto GetScratchDirectory    () -> const std::filesystem::path&;
+auto RemoveScratchDirectory () -> void;
+
+#pragma endregion
+
+#pragma region "Results"
+
+struct Result
+{
+    std::string                   Name        = std::string();
+    size_t                        Iterations  = 0;    // per sample
+    size_t                        Samples     = 0;
+    double                        MedianNs    = 0.0;  // all times are per iteration
+    double                        MeanNs      = 0.0;
+    double                        MinNs       = 0.0;
+    double                        MaxNs       = 0.0;
+    double                        StdDevNs    = 0.0;
+    double                        AllocsPerOp = 0.0;
+    double                        BytesPerOp  = 0.0;
+    std::map<std::string, double> Counters    = std::map<std::string, double>();
+};
+
+struct RunOptions
+{
+    std::string               Filter     = std::string();   // substring of name, empty runs all
+    std::chrono::milliseconds MinTime    = std::chrono::milliseconds(20);   // per sample
+    size_t                    Samples    = 15;
+};
+
+auto Run (const BenchmarkInfo& benchmark, const RunOptions& options) -> Result;
+
+auto WriteJson (const std::vector<Result>& results) -> std::string;
+auto ReadJson  (const std::string& text, std::vector<Result>& results) -> bool;
+
+#pragma endregion
+
+} // namespace CaffeineTake::Benchmark
+
+#define BENCHMARK_CONCAT_IMPL(_a, _b) _a##_b
+#define BENCHMARK_CONCAT(_a, _b)      BENCHMARK_CONCAT_IMPL(_a, _b)
+
+#define BENCHMARK(_name)                                                                                            \
+    static auto BENCHMARK_CONCAT(_Benchmark_, __LINE__) (::CaffeineTake::Benchmark::State& state) -> void;         \
+    static const auto BENCHMARK_CONCAT(_BenchmarkRegistered_, __LINE__) =                                           \
+        ::CaffeineTake::Benchmark::Register(_name, &BENCHMARK_CONCAT(_Benchmark_, __LINE__));                       \
+    static auto BENCHMARK_CONCAT(_Benchmark_, __LINE__) (::CaffeineTake::Benchmark::State& state) -> void
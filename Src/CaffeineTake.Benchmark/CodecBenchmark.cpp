@@ -0,0 +1,169 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+#include "NlohmannSettings.hpp"
+
+#include "Settings.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <string>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+// Heavy user's settings, or with triggers grown to thousands.
+auto MakeSettings (size_t triggers) -> Settings
+{
+    auto settings = Settings();
+    settings.General.IconPack = CaffeineIcons::IconPack::Custom;
+    settings.General.IconColors.AutoMode_Active.CupFill = 0xFF1E90FF;
+
+    for (auto i = size_t{0}; i < triggers; ++i)
+    {
+        settings.Auto.TriggerProcess.Processes.push_back(L"C:\\Program Files\\Vendor " + std::to_wstring(i) + L"\\App" + std::to_wstring(i) + L".exe");
+        settings.Auto.TriggerWindow.Windows.push_back(L"glob:*Presentation " + std::to_wstring(i) + L"*");
+    }
+
+    for (auto i = 0; i < 16; ++i)
+    {
+        settings.Auto.TriggerUsb.UsbDevices.push_back(L"USB\\VID_046D&PID_C5" + std::to_wstring(10 + i));
+
+        auto bi = BluetoothIdentifier();
+        bi.ull = 0x001A7DDA7100ull + i;
+        settings.Auto.TriggerBluetooth.BluetoothDevices.push_back(bi);
+    }
+
+    const auto workDays = DaysOfWeek::Monday | DaysOfWeek::Tuesday | DaysOfWeek::Wednesday | DaysOfWeek::Thursday | DaysOfWeek::Friday;
+    settings.Auto.TriggerSchedule.ScheduleEntries.push_back(ScheduleEntry{ L"Work", workDays, { TimeRange{ 8 * 3600, 12 * 3600 }, TimeRange{ 13 * 3600, 17 * 3600 } } });
+
+    return settings;
+}
+
+auto WriteNlohmann (const Settings& settings) -> std::string
+{
+    return nlohmann::json(settings).dump(4);
+}
+
+// Text written, and whether both codecs wrote the same bytes.
+auto Write (State& state, size_t triggers, bool reflected) -> void
+{
+    const auto settings = MakeSettings(triggers);
+
+    for (auto _ : state)
+    {
+        DoNotOptimize(reflected ? settings.ToJson() : WriteNlohmann(settings));
+    }
+
+    const auto text = settings.ToJson();
+    state.SetCounter("file_bytes", static_cast<double>(text.size()));
+    state.SetCounter("identical",  text == WriteNlohmann(settings) ? 1.0 : 0.0);
+}
+
+auto Read (State& state, size_t triggers, bool reflected) -> void
+{
+    const auto original = MakeSettings(triggers);
+    const auto text     = original.ToJson();
+
+    auto loaded = Settings();
+    for (auto _ : state)
+    {
+        loaded = Settings();
+        if (reflected)
+        {
+            DoNotOptimize(loaded.FromJson(text));
+        }
+        else
+        {
+            nlohmann::json::parse(text).get_to(loaded);
+        }
+    }
+
+    state.SetCounter("diff_fields", static_cast<double>(original.Diff(loaded).size()));
+}
+
+} // namespace
+
+BENCHMARK("Codec/Settings/Write/Reflected")
+{
+    Write(state, 48, true);
+}
+
+BENCHMARK("Codec/Settings/Write/Nlohmann")
+{
+    Write(state, 48, false);
+}
+
+BENCHMARK("Codec/Settings/Read/Reflected")
+{
+    Read(state, 48, true);
+}
+
+BENCHMARK("Codec/Settings/Read/Nlohmann")
+{
+    Read(state, 48, false);
+}
+
+BENCHMARK("Codec/Settings/Write/Reflected/10000")
+{
+    Write(state, 10000, true);
+}
+
+BENCHMARK("Codec/Settings/Write/Nlohmann/10000")
+{
+    Write(state, 10000, false);
+}
+
+BENCHMARK("Codec/Settings/Read/Reflected/10000")
+{
+    Read(state, 10000, true);
+}
+
+BENCHMARK("Codec/Settings/Read/Nlohmann/10000")
+{
+    Read(state, 10000, false);
+}
+
+// Settings reload compares new snapshot with current one, field by field.
+BENCHMARK("Codec/Settings/Equal/Reflected")
+{
+    const auto a = MakeSettings(48);
+    const auto b = MakeSettings(48);
+
+    for (auto _ : state)
+    {
+        DoNotOptimize(a.Diff(b).empty());
+    }
+}
+
+// Same through DOM, what comparing without field tables takes.
+BENCHMARK("Codec/Settings/Equal/Nlohmann")
+{
+    const auto a = MakeSettings(48);
+    const auto b = MakeSettings(48);
+
+    for (auto _ : state)
+    {
+        DoNotOptimize(nlohmann::json(a) == nlohmann::json(b));
+    }
+}
@@ -0,0 +1,100 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+// Just enough of <Windows.h> for the non-UI core headers to compile on
+// other platforms. Nothing here is implemented, functions are declared only
+// so templates like ScanWindows parse, the benchmark never calls them.
+
+#if defined(_WIN32)
+#   error "Compat/Windows.h must not be on the include path on Windows"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(NULL)
+#   define NULL 0
+#endif
+
+#define TRUE  1
+#define FALSE 0
+
+#define MAX_PATH 260
+
+#define WINAPI
+#define CALLBACK
+
+using BOOL      = int;
+using BYTE      = unsigned char;
+using WORD      = unsigned short;
+using DWORD     = unsigned long;
+using UINT      = unsigned int;
+using LONG      = long;
+using ULONGLONG = unsigned long long;
+using LPARAM    = std::intptr_t;
+using WPARAM    = std::uintptr_t;
+using LRESULT   = std::intptr_t;
+using LPCWSTR   = const wchar_t*;
+using LPWSTR    = wchar_t*;
+using LPVOID    = void*;
+using HANDLE    = void*;
+
+struct HWND__;      using HWND      = HWND__*;
+struct HICON__;     using HICON     = HICON__*;
+struct HINSTANCE__; using HINSTANCE = HINSTANCE__*;
+using HMODULE = HINSTANCE;
+
+struct FILETIME
+{
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+};
+
+struct SYSTEMTIME
+{
+    WORD wYear;
+    WORD wMonth;
+    WORD wDayOfWeek;
+    WORD wDay;
+    WORD wHour;
+    WORD wMinute;
+    WORD wSecond;
+    WORD wMilliseconds;
+};
+
+#define DEFINE_ENUM_FLAG_OPERATORS(ENUMTYPE)                                                                                          \
+    inline constexpr ENUMTYPE operator|  (ENUMTYPE a, ENUMTYPE b) { return ENUMTYPE(static_cast<unsigned long long>(a) | static_cast<unsigned long long>(b)); } \
+    inline constexpr ENUMTYPE operator&  (ENUMTYPE a, ENUMTYPE b) { return ENUMTYPE(static_cast<unsigned long long>(a) & static_cast<unsigned long long>(b)); } \
+    inline constexpr ENUMTYPE operator^  (ENUMTYPE a, ENUMTYPE b) { return ENUMTYPE(static_cast<unsigned long long>(a) ^ static_cast<unsigned long long>(b)); } \
+    inline constexpr ENUMTYPE operator~  (ENUMTYPE a)             { return ENUMTYPE(~static_cast<unsigned long long>(a)); }                                   \
+    inline ENUMTYPE&          operator|= (ENUMTYPE& a, ENUMTYPE b) { return a = a | b; }                                                                   \
+    inline ENUMTYPE&          operator&= (ENUMTYPE& a, ENUMTYPE b) { return a = a & b; }                                                                   \
+    inline ENUMTYPE&          operator^= (ENUMTYPE& a, ENUMTYPE b) { return a = a ^ b; }
+
+using WNDENUMPROC = BOOL (*)(HWND, LPARAM);
+
+BOOL  EnumWindows              (WNDENUMPROC lpEnumFunc, LPARAM lParam);
+BOOL  IsWindowVisible          (HWND hWnd);
+BOOL  IsIconic                 (HWND hWnd);
+int   GetWindowTextLengthW     (HWND hWnd);
+int   GetWindowTextW           (HWND hWnd, LPWSTR lpString, int nMaxCount);
+DWORD GetWindowThreadProcessId (HWND hWnd, DWORD* lpdwProcessId);
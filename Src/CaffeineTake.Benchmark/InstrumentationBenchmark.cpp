@@ -0,0 +1,171 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+
+#include "Diagnostics.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "Tracing.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+// Logger is started by main, so these measure calling thread only.
+BENCHMARK("Logger/Info")
+{
+    auto value = std::uint64_t{0};
+    for (auto _ : state)
+    {
+        LOG_INFO("Scanner '{}' took {} us", "Process", value++);
+    }
+
+    state.SetCounter("dropped", static_cast<double>(AsyncLogger::Get().Stats().Dropped));
+}
+
+BENCHMARK("Logger/Info/Wide")
+{
+    const auto path = std::wstring(L"C:\\Users\\User\\AppData\\Roaming\\CaffeineTake\\Settings.json");
+    for (auto _ : state)
+    {
+        LOG_INFO(L"Loaded settings '{}'", path);
+    }
+}
+
+BENCHMARK("Logger/Debug/Filtered")
+{
+    auto value = std::uint64_t{0};
+    for (auto _ : state)
+    {
+        LOG_DEBUG("Scanner '{}' took {} us", "Process", value++);
+    }
+
+    DoNotOptimize(value);
+}
+
+// Long lines through small rotating files. Directory size must stay near
+// (MaxFiles + 1) * MaxFileSize set in main however much was written.
+BENCHMARK("Logger/Rotation")
+{
+    const auto line = std::string(200, 'x');
+    for (auto _ : state)
+    {
+        LOG_INFO("{}", line);
+    }
+
+    auto files = size_t{0};
+    auto bytes = std::uintmax_t{0};
+    auto ec    = std::error_code();
+    for (const auto& entry : std::filesystem::directory_iterator(GetScratchDirectory(), ec))
+    {
+        if (entry.path().extension() == ".log")
+        {
+            files += 1;
+            bytes += entry.file_size(ec);
+        }
+    }
+
+    state.SetCounter("log_files", static_cast<double>(files));
+    state.SetCounter("log_bytes", static_cast<double>(bytes));
+}
+
+BENCHMARK("Metrics/Histogram/Record")
+{
+    auto& histogram = MetricsRegistry::Get().Histogram("benchmark_record_seconds", "Benchmark histogram.");
+
+    auto value = std::uint64_t{1};
+    for (auto _ : state)
+    {
+        histogram.Record(std::chrono::nanoseconds(value));
+        value = value * 6364136223846793005ull + 1442695040888963407ull;
+        value >>= 30;
+    }
+}
+
+BENCHMARK("Metrics/ScopedLatency")
+{
+    auto& histogram = MetricsRegistry::Get().Histogram("benchmark_scope_seconds", "Benchmark histogram.");
+    for (auto _ : state)
+    {
+        const auto latency = ScopedLatency(histogram);
+    }
+}
+
+#if defined(FEATURE_CAFFEINETAKE_TRACING)
+
+BENCHMARK("Tracing/Span/Disabled")
+{
+    Tracer::Get().Stop();
+    for (auto _ : state)
+    {
+        TRACE_SCOPE("Benchmark", "bench");
+    }
+}
+
+// Events past MaxEventsPerThread are dropped and cost less, recording is
+// restarted before buffer fills.
+BENCHMARK("Tracing/Span/Enabled")
+{
+    auto count = size_t{0};
+
+    Tracer::Get().Start();
+    for (auto _ : state)
+    {
+        if (++count % Tracer::MaxEventsPerThread == 0)
+        {
+            Tracer::Get().Start();
+        }
+
+        TRACE_SCOPE("Benchmark", "bench");
+    }
+    Tracer::Get().Stop();
+}
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_TRACING)
+
+#if defined(FEATURE_CAFFEINETAKE_DIAGNOSTICS)
+
+// Outermost scope reads thread CPU clock twice, nested ones only count depth.
+BENCHMARK("Diagnostics/CpuScope")
+{
+    DIAG_THREAD("Benchmark");
+    for (auto _ : state)
+    {
+        DIAG_SCOPE(Subsystem::Scanner);
+    }
+}
+
+BENCHMARK("Diagnostics/CpuScope/Nested")
+{
+    DIAG_THREAD("Benchmark");
+    DIAG_SCOPE(Subsystem::Scanner);
+    for (auto _ : state)
+    {
+        DIAG_SCOPE(Subsystem::Scanner);
+    }
+}
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_DIAGNOSTICS)
@@ -0,0 +1,281 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+
+#include "Logger.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+struct Options
+{
+    RunOptions  Run       = RunOptions();
+    std::string JsonPath  = std::string();
+    std::string Baseline  = std::string();
+    double      Threshold = 10.0;   // in percent of baseline median
+    bool        List      = false;
+};
+
+auto PrintUsage () -> void
+{
+    std::fputs(
+        "Usage: CaffeineTake.Benchmark [options]\n"
+        "  --filter <text>        run benchmarks whose name contains text\n"
+        "  --list                 print benchmark names and exit\n"
+        "  --samples <n>          samples per benchmark (default 15)\n"
+        "  --min-time <ms>        minimal duration of one sample (default 20)\n"
+        "  --json <file>          write results as JSON\n"
+        "  --baseline <file>      compare with results of an earlier --json run\n"
+        "  --threshold <percent>  median slowdown reported as regression (default 10)\n"
+        "\n"
+        "Exit code is 2 when baseline comparison found a regression.\n",
+        stderr
+    );
+}
+
+auto ParseArgs (int argc, char** argv, Options& options) -> bool
+{
+    for (auto i = 1; i < argc; ++i)
+    {
+        const auto arg     = std::string_view(argv[i]);
+        const auto hasNext = i + 1 < argc;
+
+        if (arg == "--list")
+        {
+            options.List = true;
+        }
+        else if (arg == "--filter" && hasNext)
+        {
+            options.Run.Filter = argv[++i];
+        }
+        else if (arg == "--samples" && hasNext)
+        {
+            options.Run.Samples = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--min-time" && hasNext)
+        {
+            options.Run.MinTime = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--json" && hasNext)
+        {
+            options.JsonPath = argv[++i];
+        }
+        else if (arg == "--baseline" && hasNext)
+        {
+            options.Baseline = argv[++i];
+        }
+        else if (arg == "--threshold" && hasNext)
+        {
+            options.Threshold = std::strtod(argv[++i], nullptr);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+auto ReadFile (const std::string& path, std::string& text) -> bool
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+auto WriteFile (const std::string& path, const std::string& text) -> bool
+{
+    auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    return file && file.write(text.data(), text.size());
+}
+
+auto FormatTime (double ns) -> std::string
+{
+    char buffer[32];
+    if (ns < 1e3)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%.1f ns", ns);
+    }
+    else if (ns < 1e6)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%.2f us", ns / 1e3);
+    }
+    else
+    {
+        std::snprintf(buffer, sizeof(buffer), "%.2f ms", ns / 1e6);
+    }
+
+    return buffer;
+}
+
+auto PrintResult (const Result& result) -> void
+{
+    const auto spread = result.MedianNs > 0.0 ? 100.0 * result.StdDevNs / result.MedianNs : 0.0;
+
+    std::printf(
+        "%-48s %12s  +-%5.1f%%  %8.2f allocs/op  %10zu x %zu\n",
+        result.Name.c_str(),
+        FormatTime(result.MedianNs).c_str(),
+        spread,
+        result.AllocsPerOp,
+        result.Iterations,
+        result.Samples
+    );
+
+    for (const auto& [name, value] : result.Counters)
+    {
+        std::printf("    %-44s %12.6g\n", name.c_str(), value);
+    }
+
+    std::fflush(stdout);
+}
+
+// Median slower beyond threshold with even the fastest sample slower than
+// baseline median, or one more allocation per operation, is a regression.
+auto Compare (const std::vector<Result>& baseline, const std::vector<Result>& results, double threshold) -> size_t
+{
+    auto previous = std::unordered_map<std::string_view, const Result*>();
+    for (const auto& result : baseline)
+    {
+        previous[result.Name] = &result;
+    }
+
+    auto regressions = size_t{0};
+
+    std::printf("\n%-48s %12s %12s %9s %14s\n", "Benchmark", "Baseline", "Current", "Change", "Allocs/op");
+    for (const auto& result : results)
+    {
+        const auto it = previous.find(result.Name);
+        if (it == previous.end())
+        {
+            std::printf("%-48s %12s %12s %9s\n", result.Name.c_str(), "-", FormatTime(result.MedianNs).c_str(), "new");
+            continue;
+        }
+
+        const auto& old    = *it->second;
+        const auto  change = old.MedianNs > 0.0 ? 100.0 * (result.MedianNs - old.MedianNs) / old.MedianNs : 0.0;
+
+        const auto isSlower     = change > threshold && result.MinNs > old.MedianNs;
+        const auto isAllocating = result.AllocsPerOp >= old.AllocsPerOp + 0.5;
+
+        std::printf(
+            "%-48s %12s %12s %+8.1f%% %6.2f -> %-5.2f %s\n",
+            result.Name.c_str(),
+            FormatTime(old.MedianNs).c_str(),
+            FormatTime(result.MedianNs).c_str(),
+            change,
+            old.AllocsPerOp,
+            result.AllocsPerOp,
+            isSlower || isAllocating ? "REGRESSION" : ""
+        );
+
+        if (isSlower || isAllocating)
+        {
+            regressions += 1;
+        }
+    }
+
+    return regressions;
+}
+
+} // namespace
+
+auto main (int argc, char** argv) -> int
+{
+    auto options = Options();
+    if (!ParseArgs(argc, argv, options))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    auto baseline = std::vector<Result>();
+    if (!options.Baseline.empty())
+    {
+        auto text = std::string();
+        if (!ReadFile(options.Baseline, text) || !ReadJson(text, baseline))
+        {
+            std::fprintf(stderr, "Failed to read baseline '%s'\n", options.Baseline.c_str());
+            return 1;
+        }
+    }
+
+    // Log like the app does, into small files so rotation is exercised.
+    if (!options.List)
+    {
+        InitLogger(GetScratchDirectory() / "CaffeineTake.log", LogRotation{ 64 * 1024, 3, false });
+    }
+
+    auto results = std::vector<Result>();
+    for (const auto& benchmark : GetBenchmarks())
+    {
+        if (!options.Run.Filter.empty() && benchmark.Name.find(options.Run.Filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        if (options.List)
+        {
+            std::printf("%s\n", benchmark.Name.c_str());
+            continue;
+        }
+
+        results.push_back(Run(benchmark, options.Run));
+        PrintResult(results.back());
+    }
+
+    if (!options.List)
+    {
+        AsyncLogger::Get().Stop();
+        RemoveScratchDirectory();
+    }
+
+    if (!options.JsonPath.empty() && !WriteFile(options.JsonPath, WriteJson(results)))
+    {
+        std::fprintf(stderr, "Failed to write '%s'\n", options.JsonPath.c_str());
+        return 1;
+    }
+
+    if (!options.Baseline.empty() && Compare(baseline, results, options.Threshold) > 0)
+    {
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,345 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+#include "Reference.hpp"
+
+#include "ProcessSnapshot.hpp"
+#include "ProcessSource.hpp"
+#include "TitleMatcher.hpp"
+#include "TriggerMatcher.hpp"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+// Process list kept in memory, every path query counts as one OS call.
+class SyntheticProcessSource final : public ProcessSource
+{
+    std::deque<ProcessRecord>                    mRecords = std::deque<ProcessRecord>();
+    std::unordered_map<ProcessId, std::wstring>  mPaths   = std::unordered_map<ProcessId, std::wstring>();
+    ProcessId                                    mNextPid = 4;
+    ProcessStartKey                              mNextKey = 1;
+
+public:
+    explicit SyntheticProcessSource (size_t count)
+    {
+        for (auto i = size_t{0}; i < count; ++i)
+        {
+            Spawn();
+        }
+    }
+
+    auto Spawn () -> void
+    {
+        const auto pid = mNextPid;
+        mNextPid += 4;
+
+        mRecords.push_back(ProcessRecord{ pid, mNextKey++ });
+        mPaths[pid] = pid % 7 == 0
+            ? L"C:\\Program Files\\Vendor " + std::to_wstring(pid % 97) + L"\\App" + std::to_wstring(pid % 97) + L".exe"
+            : L"C:\\Windows\\System32\\svc" + std::to_wstring(pid) + L".exe";
+    }
+
+    // Replace count oldest processes with new ones.
+    auto Churn (size_t count) -> void
+    {
+        for (auto i = size_t{0}; i < count && !mRecords.empty(); ++i)
+        {
+            mPaths.erase(mRecords.front().Pid);
+            mRecords.pop_front();
+            Spawn();
+        }
+    }
+
+    auto Enumerate (std::vector<ProcessRecord>& list) -> bool override
+    {
+        mOsCalls += 1;
+        list.assign(mRecords.begin(), mRecords.end());
+        return true;
+    }
+
+    auto QueryImagePath (ProcessId pid, std::wstring& path) -> bool override
+    {
+        mOsCalls += 1;
+
+        const auto it = mPaths.find(pid);
+        if (it == mPaths.end())
+        {
+            return false;
+        }
+
+        path.assign(it->second);
+        return true;
+    }
+
+    auto GetPaths () const -> const std::unordered_map<ProcessId, std::wstring>&
+    {
+        return mPaths;
+    }
+};
+
+// Half full paths, half executable names. Paths below 97 match some of
+// SyntheticProcessSource processes.
+auto MakeProcessTriggers (size_t count = 48) -> std::vector<std::wstring>
+{
+    auto triggers = std::vector<std::wstring>();
+    for (auto i = size_t{0}; i < count; ++i)
+    {
+        triggers.push_back(i % 2
+            ? L"C:\\Program Files\\Vendor " + std::to_wstring(i) + L"\\App" + std::to_wstring(i) + L".exe"
+            : L"tool" + std::to_wstring(i) + L".exe"
+        );
+    }
+
+    return triggers;
+}
+
+// Half exact titles, half globs, regexes on top. Some of every kind match
+// MakeTitles windows.
+auto MakeWindowTriggers (size_t count, size_t regexes = 0) -> std::vector<std::wstring>
+{
+    auto triggers = std::vector<std::wstring>();
+    for (auto i = size_t{0}; i < count; ++i)
+    {
+        triggers.push_back(i % 2
+            ? L"glob:*Presentation " + std::to_wstring(i) + L" *"
+            : L"Meeting " + std::to_wstring(i)
+        );
+    }
+
+    for (auto i = size_t{0}; i < regexes; ++i)
+    {
+        triggers.push_back(L"regex:^Build #\\d+ - Job" + std::to_wstring(i) + L"$");
+    }
+
+    return triggers;
+}
+
+auto MakeTitles (size_t count) -> std::vector<std::wstring>
+{
+    auto titles = std::vector<std::wstring>();
+    for (auto i = size_t{0}; i < count; ++i)
+    {
+        switch (i % 5)
+        {
+        case 0:  titles.push_back(L"Document" + std::to_wstring(i) + L".txt - Notepad"); break;
+        case 1:  titles.push_back(L"Inbox (" + std::to_wstring(i) + L") - Mail"); break;
+        case 2:  titles.push_back(L"Quarterly Presentation " + std::to_wstring(i % 4000) + L" - Slides"); break;
+        case 3:  titles.push_back(L"Meeting " + std::to_wstring(i % 4000)); break;
+        default: titles.push_back(L"Build #" + std::to_wstring(1000 + i) + L" - Job" + std::to_wstring(i % 40)); break;
+        }
+    }
+
+    return titles;
+}
+
+// One scan of a steady process table, churn processes replaced before each.
+auto SnapshotScan (State& state, size_t processes, size_t churn) -> void
+{
+    auto  source   = std::make_unique<SyntheticProcessSource>(processes);
+    auto& table    = *source;
+    auto  snapshot = ProcessSnapshot(std::move(source));
+    auto  matcher  = TriggerMatcher();
+
+    matcher.Update(MakeProcessTriggers());
+    snapshot.Update();
+    snapshot.Classify(matcher, true);
+
+    for (auto _ : state)
+    {
+        table.Churn(churn);
+        snapshot.Update();
+        snapshot.Classify(matcher, false);
+        DoNotOptimize(snapshot.GetMatches().size());
+    }
+
+    state.SetCounter("os_calls_per_scan", static_cast<double>(snapshot.GetStats().OsCalls));
+    state.SetCounter("matches",           static_cast<double>(snapshot.GetMatches().size()));
+}
+
+auto ProcessPaths (size_t count) -> std::vector<std::wstring>
+{
+    const auto source = SyntheticProcessSource(count);
+
+    auto paths = std::vector<std::wstring>();
+    for (const auto& [pid, path] : source.GetPaths())
+    {
+        paths.push_back(path);
+    }
+
+    return paths;
+}
+
+// One process against trigger list, compiled sets or the loop they replaced.
+auto MatchProcesses (State& state, size_t triggerCount, bool reference) -> void
+{
+    const auto paths    = ProcessPaths(1024);
+    const auto triggers = MakeProcessTriggers(triggerCount);
+
+    auto matcher = TriggerMatcher();
+    matcher.Update(triggers);
+
+    auto index   = size_t{0};
+    auto matches = size_t{0};
+    for (auto _ : state)
+    {
+        const auto& path   = paths[index++ % paths.size()];
+        const auto  result = reference ? Reference::MatchProcess(triggers, path) : matcher.Match(path);
+
+        matches += result != TriggerMatch::None ? 1 : 0;
+        DoNotOptimize(result);
+    }
+
+    state.SetCounter("match_ratio", static_cast<double>(matches) / static_cast<double>(state.GetIterations()));
+}
+
+// Every window title against trigger list, what one window scan costs.
+// DFA cache is warmed by one scan before timing, as it is after first tick.
+auto ScanTitles (State& state, size_t triggerCount, size_t windowCount, size_t regexes, bool reference) -> void
+{
+    const auto titles   = MakeTitles(windowCount);
+    const auto triggers = MakeWindowTriggers(triggerCount, regexes);
+
+    auto matcher = TitleMatcher();
+    matcher.Update(triggers);
+
+    auto matches = size_t{0};
+    for (const auto& title : titles)
+    {
+        matches += matcher.Match(title) ? 1 : 0;
+    }
+
+    for (auto _ : state)
+    {
+        for (const auto& title : titles)
+        {
+            DoNotOptimize(reference ? Reference::MatchTitle(triggers, title) : matcher.Match(title));
+        }
+    }
+
+    const auto elapsed = std::chrono::duration<double, std::nano>(state.GetElapsed()).count();
+    state.SetCounter("ns_per_title", elapsed / static_cast<double>(state.GetIterations() * titles.size()));
+    state.SetCounter("matches",      static_cast<double>(matches));
+}
+
+} // namespace
+
+BENCHMARK("TriggerMatcher/Match/10")
+{
+    MatchProcesses(state, 10, false);
+}
+
+BENCHMARK("TriggerMatcher/Match/100")
+{
+    MatchProcesses(state, 100, false);
+}
+
+BENCHMARK("TriggerMatcher/Match/10000")
+{
+    MatchProcesses(state, 10000, false);
+}
+
+BENCHMARK("TriggerMatcher/Reference/10")
+{
+    MatchProcesses(state, 10, true);
+}
+
+BENCHMARK("TriggerMatcher/Reference/100")
+{
+    MatchProcesses(state, 100, true);
+}
+
+BENCHMARK("TriggerMatcher/Reference/10000")
+{
+    MatchProcesses(state, 10000, true);
+}
+
+// Every process queried and matched, what scanning cost before snapshots.
+BENCHMARK("ProcessSnapshot/Cold/1000")
+{
+    auto  source   = std::make_unique<SyntheticProcessSource>(1000);
+    auto  snapshot = ProcessSnapshot(std::move(source));
+    auto  matcher  = TriggerMatcher();
+    matcher.Update(MakeProcessTriggers());
+
+    for (auto _ : state)
+    {
+        snapshot.Clear();
+        snapshot.Update();
+        snapshot.Classify(matcher, true);
+        DoNotOptimize(snapshot.GetMatches().size());
+    }
+
+    state.SetCounter("os_calls_per_scan", static_cast<double>(snapshot.GetStats().OsCalls));
+}
+
+BENCHMARK("ProcessSnapshot/Steady/1000")
+{
+    SnapshotScan(state, 1000, 0);
+}
+
+BENCHMARK("ProcessSnapshot/Churn/1000")
+{
+    SnapshotScan(state, 1000, 20);
+}
+
+BENCHMARK("ProcessSnapshot/Steady/10000")
+{
+    SnapshotScan(state, 10000, 0);
+}
+
+BENCHMARK("TitleMatcher/Scan/32x256")
+{
+    ScanTitles(state, 32, 256, 0, false);
+}
+
+BENCHMARK("TitleMatcher/Scan/1000x1000")
+{
+    ScanTitles(state, 1000, 1000, 0, false);
+}
+
+BENCHMARK("TitleMatcher/Scan/3000x5000")
+{
+    ScanTitles(state, 3000, 5000, 0, false);
+}
+
+BENCHMARK("TitleMatcher/Scan/1000x1000/Regex8")
+{
+    ScanTitles(state, 1000, 1000, 8, false);
+}
+
+BENCHMARK("TitleMatcher/Reference/32x256")
+{
+    ScanTitles(state, 32, 256, 0, true);
+}
+
+BENCHMARK("TitleMatcher/Reference/1000x1000")
+{
+    ScanTitles(state, 1000, 1000, 0, true);
+}
@@ -0,0 +1,142 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Serializers.hpp"
+#include "Settings.hpp"
+#include "Utility.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <format>
+#include <string>
+
+#pragma region "Hand written nlohmann mapping"
+
+// Settings mapping as it was before field tables, one to_json/from_json
+// per type and nlohmann DOM in between. Codec benchmarks measure against it
+// and tests check SAX loader agrees with it.
+namespace nlohmann {
+
+template <>
+struct adl_serializer<std::wstring>
+{
+    static void to_json(json& j, const std::wstring& opt)
+    {
+        auto utf8 = CaffeineTake::UTF16ToUTF8(opt.c_str());
+        j = utf8 ? utf8.value() : "";
+    }
+
+    static void from_json(const json& j, std::wstring& opt)
+    {
+        auto utf16 = CaffeineTake::UTF8ToUTF16(j.get<std::string>());
+        opt = utf16 ? utf16.value() : L"";
+    }
+};
+
+} // namespace nlohmann
+
+namespace CaffeineTake {
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(TimeRange, Begin, End)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ScheduleEntry, Name, ActiveDays, ActiveHours)
+
+inline auto to_json (nlohmann::json& j, const CaffeineIcons::IconColors& ic) -> void
+{
+    j["CupBorder"]     = nlohmann::json(std::format("0x{:08x}", ic.CupBorder));
+    j["CupFill"]       = nlohmann::json(std::format("0x{:08x}", ic.CupFill));
+    j["Steam"]         = nlohmann::json(std::format("0x{:08x}", ic.Steam));
+    j["ModeIndicator"] = nlohmann::json(std::format("0x{:08x}", ic.ModeIndicator));
+}
+
+inline auto from_json (const nlohmann::json& j, CaffeineIcons::IconColors& ic) -> void
+{
+    ic.CupBorder     = std::stoul(j.at("CupBorder").get<std::string>(), nullptr, 16);
+    ic.CupFill       = std::stoul(j.at("CupFill").get<std::string>(), nullptr, 16);
+    ic.Steam         = std::stoul(j.at("Steam").get<std::string>(), nullptr, 16);
+    ic.ModeIndicator = std::stoul(j.at("ModeIndicator").get<std::string>(), nullptr, 16);
+}
+
+inline auto to_json (nlohmann::json& j, const BluetoothIdentifier& bi) -> void
+{
+    j = nlohmann::json(
+        std::format(
+            "{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}",
+            bi.bytes[5], bi.bytes[4], bi.bytes[3],
+            bi.bytes[2], bi.bytes[1], bi.bytes[0]
+        )
+    );
+}
+
+inline auto from_json (const nlohmann::json& j, BluetoothIdentifier& bi) -> void
+{
+    bi.ull = BluetoothIdentifierFromString(j.get<std::string>());
+}
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+    struct Settings::General::IconColorList,
+    StandardMode_Inactive,
+    StandardMode_Active,
+    AutoMode_Inactive,
+    AutoMode_Active,
+    TimerMode_Inactive,
+    TimerMode_Active
+)
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+    struct Settings::General,
+    LangId,
+    IconPack,
+    IconTheme,
+    UseNotifyIcon,
+    UseJumpLists,
+    UseDockMode,
+    AutoStart,
+    ShowNotifications,
+    PlayNotificationSound,
+    SoundPack,
+    IconColors,
+    PrepareIconColors
+)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Standard, Enabled, KeepScreenOn, WhenSessionLocked)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerProcess, Enabled, Processes, ScanInterval, MaxScanInterval)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerWindow, Enabled, Windows, ScanInterval, MaxScanInterval)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerUsb, Enabled, UsbDevices, ScanInterval, MaxScanInterval)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerBluetooth, Enabled, BluetoothDevices, ActiveTimeout, ScanInterval)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerSchedule, Enabled, ScheduleEntries)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+    struct Settings::Auto,
+    Enabled,
+    KeepScreenOn,
+    WhenSessionLocked,
+    ScanInterval,
+    TriggerProcess,
+    TriggerWindow,
+    TriggerUsb,
+    TriggerBluetooth,
+    TriggerSchedule
+)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Timer, Enabled, KeepScreenOn, WhenSessionLocked, Interval)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Settings, General, Standard, Auto, Timer)
+
+} // namespace CaffeineTake
+
+#pragma endregion
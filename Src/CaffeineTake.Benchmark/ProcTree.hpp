@@ -0,0 +1,124 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "ProcessSource.hpp"
+
+#if defined(__linux__)
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include <sys/stat.h>
+
+namespace CaffeineTake::Benchmark {
+
+// Directory tree shaped like /proc, for ProcProcessSource to walk in place
+// of the real one. Processes are numeric directories with an exe symlink
+// and a comm file, either may be left out as kernel threads and other
+// users' processes have them unreadable. Root also holds the non-process
+// entries /proc has.
+class ProcTree final
+{
+    std::filesystem::path mRoot;
+
+    auto Populate (const std::filesystem::path& dir, const std::string_view exe, const std::string_view comm) -> void
+    {
+        std::filesystem::create_directory(dir);
+
+        if (!exe.empty())
+        {
+            std::filesystem::create_symlink(std::string(exe), dir / "exe");
+        }
+
+        if (!comm.empty())
+        {
+            auto file = std::ofstream(dir / "comm", std::ios::binary);
+            file << comm << '\n';
+        }
+    }
+
+public:
+    explicit ProcTree (std::filesystem::path root)
+        : mRoot (std::move(root))
+    {
+        std::filesystem::remove_all(mRoot);
+        std::filesystem::create_directories(mRoot / "sys" / "kernel");
+        std::filesystem::create_directory(mRoot / "012");       // leading zero, not a PID
+        std::filesystem::create_directory(mRoot / "42abc");
+        std::filesystem::create_directory_symlink("1", mRoot / "self");
+
+        auto file = std::ofstream(mRoot / "meminfo", std::ios::binary);
+        file << "MemTotal: 1 kB\n";
+    }
+
+    ~ProcTree ()
+    {
+        auto ec = std::error_code();
+        std::filesystem::remove_all(mRoot, ec);
+    }
+
+    ProcTree            (const ProcTree&) = delete;
+    ProcTree& operator= (const ProcTree&) = delete;
+
+    auto GetRoot () const -> std::string
+    {
+        return mRoot.string();
+    }
+
+    // Empty exe or comm leaves it out.
+    auto Start (ProcessId pid, const std::string_view exe, const std::string_view comm) -> void
+    {
+        Populate(mRoot / std::to_string(pid), exe, comm);
+    }
+
+    auto Exit (ProcessId pid) -> void
+    {
+        std::filesystem::remove_all(mRoot / std::to_string(pid));
+    }
+
+    // New process under the same PID. New directory is made before the old
+    // one is gone, so its inode (the start key) is sure to differ.
+    auto Reuse (ProcessId pid, const std::string_view exe, const std::string_view comm) -> void
+    {
+        const auto next = mRoot / (std::to_string(pid) + ".next");
+        Populate(next, exe, comm);
+        Exit(pid);
+        std::filesystem::rename(next, mRoot / std::to_string(pid));
+    }
+
+    auto GetStartKey (ProcessId pid) const -> ProcessStartKey
+    {
+        struct stat info = {};
+        if (stat((mRoot / std::to_string(pid)).c_str(), &info) != 0)
+        {
+            return 0;
+        }
+
+        return static_cast<ProcessStartKey>(info.st_ino);
+    }
+};
+
+} // namespace CaffeineTake::Benchmark
+
+#endif // #if defined(__linux__)
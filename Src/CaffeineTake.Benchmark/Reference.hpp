@@ -0,0 +1,174 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Schedule.hpp"
+#include "TriggerMatcher.hpp"
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Implementations replaced by the optimized core, kept as they were, and
+// straightforward ones it is measured against. Benchmarks have a baseline
+// and tests an oracle.
+namespace CaffeineTake::Reference {
+
+// ProcessScanner before TriggerMatcher: every trigger compared with the
+// path and then with a file name built anew for each pair. The path was
+// taken by value once per process.
+inline auto MatchProcess (const std::vector<std::wstring>& triggers, const std::wstring_view processPath) -> TriggerMatch
+{
+    const auto path = std::wstring(processPath);
+    for (const auto& trigger : triggers)
+    {
+        if (trigger == path)
+        {
+            return TriggerMatch::Path;
+        }
+
+        const auto name = std::wstring(TriggerMatcher::FileName(path));
+        if (trigger == name)
+        {
+            return TriggerMatch::Name;
+        }
+    }
+
+    return TriggerMatch::None;
+}
+
+// Wildcard match of whole input, same syntax as GlobSet. Backtracks to last
+// star on mismatch.
+inline auto MatchGlob (const std::wstring_view pattern, const std::wstring_view input) -> bool
+{
+    struct Token
+    {
+        wchar_t Char;
+        bool    Literal;
+    };
+
+    auto tokens = std::vector<Token>();
+    for (auto i = size_t{0}; i < pattern.size(); ++i)
+    {
+        if (pattern[i] == L'\\')
+        {
+            // Trailing backslash escapes nothing and is dropped.
+            if (++i < pattern.size())
+            {
+                tokens.push_back(Token{ pattern[i], true });
+            }
+        }
+        else
+        {
+            tokens.push_back(Token{ pattern[i], false });
+        }
+    }
+
+    const auto isStar = [&](size_t p) { return !tokens[p].Literal && tokens[p].Char == L'*'; };
+
+    auto p     = size_t{0};
+    auto i     = size_t{0};
+    auto starP = std::optional<size_t>();
+    auto starI = size_t{0};
+
+    while (i < input.size())
+    {
+        if (p < tokens.size())
+        {
+            if (isStar(p))
+            {
+                starP = ++p;
+                starI = i;
+                continue;
+            }
+
+            const auto any = !tokens[p].Literal && tokens[p].Char == L'?';
+            if (any || tokens[p].Char == input[i])
+            {
+                ++p;
+                ++i;
+                continue;
+            }
+        }
+
+        if (!starP)
+        {
+            return false;
+        }
+
+        p = starP.value();
+        i = ++starI;
+    }
+
+    while (p < tokens.size() && isStar(p))
+    {
+        ++p;
+    }
+
+    return p == tokens.size();
+}
+
+// Window triggers without TitleMatcher: exact and "glob:" entries tried one
+// by one in list order.
+inline auto MatchTitle (const std::vector<std::wstring>& triggers, const std::wstring_view title) -> const std::wstring*
+{
+    constexpr auto GlobPrefix = std::wstring_view(L"glob:");
+
+    for (const auto& trigger : triggers)
+    {
+        const auto view = std::wstring_view(trigger);
+        if (view.starts_with(GlobPrefix) ? MatchGlob(view.substr(GlobPrefix.size()), title) : view == title)
+        {
+            return &trigger;
+        }
+    }
+
+    return nullptr;
+}
+
+// Schedule lookup before ScheduleEvaluator: every entry and range checked
+// against local time, end of range inclusive.
+inline auto CheckSchedule (const std::vector<ScheduleEntry>& schedule, const std::chrono::local_seconds localTime) -> bool
+{
+    const auto localDay      = std::chrono::floor<std::chrono::days>(localTime);
+    const auto timeSeconds   = static_cast<unsigned int>((localTime - localDay).count());
+    const auto timeDayOfWeek = static_cast<DaysOfWeek>(1u << (std::chrono::weekday(localDay).iso_encoding() - 1));
+
+    for (const auto& entry : schedule)
+    {
+        if ((entry.ActiveDays & timeDayOfWeek) == timeDayOfWeek)
+        {
+            for (const auto& tr : entry.ActiveHours)
+            {
+                if (tr.Begin <= timeSeconds && timeSeconds <= tr.End)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+} // namespace CaffeineTake::Reference
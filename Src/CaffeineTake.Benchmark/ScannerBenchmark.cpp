@@ -0,0 +1,387 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+#include "ProcTree.hpp"
+
+#include "Metrics.hpp"
+#include "ProcProcessSource.hpp"
+#include "Scanner.hpp"
+#include "Settings.hpp"
+#include "SyntheticWorkload.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+constexpr const char* KindNames[ScannerKindCount] = { "process", "window", "usb", "bluetooth" };
+
+// Heavy user trigger lists, only the synthetic trigger items ever hit.
+auto MakeScannerSettings (const SyntheticWorkloadOptions& options) -> SettingsPtr
+{
+    auto settings = std::make_shared<Settings>();
+    auto& autoMode = settings->Auto;
+
+    for (auto i = 0; i < 24; ++i)
+    {
+        autoMode.TriggerProcess.Processes.push_back(std::format(L"tool{}.exe", i));
+        autoMode.TriggerWindow.Windows.push_back(std::format(L"Meeting {}", i));
+        autoMode.TriggerUsb.UsbDevices.push_back(std::format(L"USB\\VID_BEEF&PID_{:04X}\\{}", i, i));
+
+        auto id = BluetoothIdentifier();
+        id.ull = 0xBEEF00000000ull + i;
+        autoMode.TriggerBluetooth.BluetoothDevices.push_back(id);
+    }
+
+    autoMode.TriggerProcess.Processes.push_back(options.TriggerProcess);
+    autoMode.TriggerWindow.Windows.push_back(options.TriggerWindow);
+    autoMode.TriggerUsb.UsbDevices.push_back(options.TriggerUsbDevice);
+
+    auto trigger = BluetoothIdentifier();
+    trigger.ull = options.TriggerBluetooth;
+    autoMode.TriggerBluetooth.BluetoothDevices.push_back(trigger);
+
+    return settings;
+}
+
+// One scan tick of every scanner, workload moves by tick interval before
+// each. Detection latency is in workload time, scanners see triggers only
+// at ticks, so it is bounded by interval unless a scan misses.
+auto ScanTicks (State& state, SyntheticWorkloadOptions options) -> void
+{
+    constexpr auto TickInterval = std::chrono::seconds(1);
+
+    options.ManualClock   = true;
+    options.TriggerPeriod = 10.0;
+
+    auto workload       = std::make_shared<SyntheticWorkload>(options);
+    const auto settings = MakeScannerSettings(options);
+
+    auto processScanner   = ProcessScanner(workload->CreateProcessSource());
+    auto windowScanner    = WindowScanner(workload->CreateWindowSource());
+    auto usbScanner       = UsbDeviceScanner(workload->CreateUsbDeviceSource());
+    auto bluetoothScanner = BluetoothScanner(workload->CreateBluetoothSource());
+
+    Scanner* scanners[] = { &processScanner, &windowScanner, &usbScanner, &bluetoothScanner };
+
+    const auto stop  = StopToken();
+    const auto pause = PauseToken();
+
+    // First process scan queries every process, keep it out of timing.
+    for (auto scanner : scanners)
+    {
+        scanner->Run(settings, stop, pause);
+    }
+
+    auto before = std::array<LatencyHistogram::Counts, ScannerKindCount>();
+    for (auto k = size_t{0}; k < ScannerKindCount; ++k)
+    {
+        SyntheticWorkload::GetDetectionHistogram(static_cast<ScannerKind>(k)).Read(before[k]);
+    }
+
+    auto hits = size_t{0};
+    for (auto _ : state)
+    {
+        workload->Advance(TickInterval);
+        for (auto scanner : scanners)
+        {
+            hits += scanner->Run(settings, stop, pause) ? 1 : 0;
+        }
+    }
+
+    DoNotOptimize(hits);
+
+    for (auto k = size_t{0}; k < ScannerKindCount; ++k)
+    {
+        auto after = LatencyHistogram::Counts();
+        SyntheticWorkload::GetDetectionHistogram(static_cast<ScannerKind>(k)).Read(after);
+
+        auto count = std::uint64_t{0};
+        for (auto b = size_t{0}; b < after.size(); ++b)
+        {
+            after[b] -= before[k][b];
+            count    += after[b];
+        }
+
+        const auto p99 = count > 0 ? LatencyHistogram::Quantile(after, 0.99) : 0;
+        state.SetCounter(std::format("detect_{}_p99_ms", KindNames[k]), static_cast<double>(p99) / 1e6);
+        state.SetCounter(std::format("detections_{}", KindNames[k]),    static_cast<double>(count));
+    }
+}
+
+// Stands in for a scanner stuck on slow system call, checks stop token as
+// real scanners do between items.
+class SlowScanner final : public Scanner
+{
+    std::chrono::microseconds mDuration = std::chrono::microseconds(0);
+    bool                      mResult   = false;
+
+public:
+    SlowScanner (std::chrono::microseconds duration, bool result)
+        : mDuration (duration)
+        , mResult   (result)
+    {
+    }
+
+    auto Run (SettingsPtr, const StopToken& stop, const PauseToken&) -> bool override
+    {
+        const auto end = std::chrono::steady_clock::now() + mDuration;
+        while (!stop && std::chrono::steady_clock::now() < end)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        return mResult && !stop;
+    }
+};
+
+// Scan tick with one fast scanner and three slow ones, time until the
+// result is applied. Fast scanner hitting ends
+// tick early and cancels the rest, otherwise slowest scanner or deadline
+// does. Own pool is what each mode switch cost before the pool was shared.
+auto SlowScanTicks (State& state, bool hit, std::chrono::milliseconds slow, std::chrono::milliseconds deadline, bool ownPool) -> void
+{
+    auto settings = std::make_shared<Settings>();
+    settings->Auto.ScanInterval = 1;
+
+    auto fast  = SlowScanner(std::chrono::microseconds(0), hit);
+    auto slow1 = SlowScanner(slow, false);
+    auto slow2 = SlowScanner(slow, false);
+    auto slow3 = SlowScanner(slow, false);
+
+    auto slots = std::array<ScannerSlot, 4>{
+        ScannerSlot("Process",   ScannerKind::Process,   fast),
+        ScannerSlot("Window",    ScannerKind::Window,    slow1),
+        ScannerSlot("Usb",       ScannerKind::Usb,       slow2),
+        ScannerSlot("Bluetooth", ScannerKind::Bluetooth, slow3),
+    };
+    ScannerSlot* active[] = { &slots[0], &slots[1], &slots[2], &slots[3] };
+
+    auto       scheduler = ScanScheduler();
+    const auto pause     = PauseToken();
+
+    // Round ends on scan pool, timer thread only waits here to measure it.
+    auto mutex  = std::mutex();
+    auto doneCV = std::condition_variable();
+    auto done   = false;
+    auto result = false;
+    auto tick   = ScanTick(
+        scheduler,
+        [&] (bool value)
+        {
+            auto lockGuard = std::lock_guard<std::mutex>(mutex);
+            result = value;
+            done   = true;
+            doneCV.notify_all();
+        }
+    );
+
+    auto ticks = std::vector<double>();
+    ticks.reserve(state.GetIterations());
+
+    for (auto _ : state)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        auto pool = WorkerPool();
+        if (ownPool)
+        {
+            pool.Start(4);
+        }
+
+        scheduler.Reset();
+        {
+            auto lockGuard = std::lock_guard<std::mutex>(mutex);
+            done = false;
+        }
+        tick.Begin(active, settings, pause);
+
+        // Next timer tick would expire it, here the deadline does.
+        auto waitLock = std::unique_lock<std::mutex>(mutex);
+        if (!doneCV.wait_until(waitLock, start + deadline, [&] { return done; }))
+        {
+            waitLock.unlock();
+            tick.Expire();
+            waitLock.lock();
+        }
+        DoNotOptimize(result);
+        waitLock.unlock();
+
+        ticks.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+        // Late scanners are cancelled by now, next tick must not skip them.
+        for (auto& slot : slots)
+        {
+            slot.WaitIdle();
+        }
+
+        pool.Stop();
+    }
+
+    std::sort(ticks.begin(), ticks.end());
+    state.SetCounter("tick_p50_us", ticks[ticks.size() / 2]);
+    state.SetCounter("tick_p99_us", ticks[ticks.size() * 99 / 100]);
+}
+
+auto Options (size_t processes, size_t windows, size_t devices, double churn) -> SyntheticWorkloadOptions
+{
+    auto options = SyntheticWorkloadOptions();
+    options.Processes        = processes;
+    options.Windows          = windows;
+    options.UsbDevices       = devices;
+    options.BluetoothDevices = devices;
+    options.ProcessChurn     = churn;
+    options.TitleChurn       = churn / 2;
+    options.DeviceFlaps      = churn / 40;
+    return options;
+}
+
+} // namespace
+
+BENCHMARK("Scanner/Tick/Processes/1000")
+{
+    ScanTicks(state, Options(1000, 300, 40, 20.0));
+}
+
+BENCHMARK("Scanner/Tick/Processes/10000")
+{
+    ScanTicks(state, Options(10000, 300, 40, 20.0));
+}
+
+BENCHMARK("Scanner/Tick/Processes/50000")
+{
+    ScanTicks(state, Options(50000, 300, 40, 20.0));
+}
+
+BENCHMARK("Scanner/Tick/Windows/3000")
+{
+    ScanTicks(state, Options(10000, 3000, 40, 20.0));
+}
+
+BENCHMARK("Scanner/Tick/Devices/400")
+{
+    ScanTicks(state, Options(10000, 300, 400, 20.0));
+}
+
+BENCHMARK("Scanner/Tick/Churn/400")
+{
+    ScanTicks(state, Options(10000, 300, 40, 400.0));
+}
+
+// Fast scanner hits, slow ones are cancelled or not started at all.
+BENCHMARK("Scanner/Tick/Slow/Hit")
+{
+    SlowScanTicks(state, true, std::chrono::milliseconds(20), std::chrono::milliseconds(100), false);
+}
+
+// Nothing hits, tick lasts as long as slowest scanner.
+BENCHMARK("Scanner/Tick/Slow/Miss")
+{
+    SlowScanTicks(state, false, std::chrono::milliseconds(5), std::chrono::milliseconds(100), false);
+}
+
+// Slow scanners outlive tick, deadline ends it.
+BENCHMARK("Scanner/Tick/Slow/Deadline")
+{
+    SlowScanTicks(state, false, std::chrono::milliseconds(50), std::chrono::milliseconds(10), false);
+}
+
+// Same as Hit with threads created and joined around the tick, as every
+// switch to auto mode did before.
+BENCHMARK("Scanner/Tick/Slow/Hit/OwnPool")
+{
+    SlowScanTicks(state, true, std::chrono::milliseconds(20), std::chrono::milliseconds(100), true);
+}
+
+#if defined(__linux__)
+
+// ProcessScanner over ProcProcessSource walking a /proc shaped tree of 20k
+// processes, one in ten without readable exe. Tree is built once and kept
+// for every sample. Steady state tick must not allocate, see
+// steady_allocs_per_tick.
+BENCHMARK("Scanner/Tick/ProcFs/20000")
+{
+    constexpr auto Processes = ProcessId{20000};
+
+    static auto tree = []
+    {
+        auto result = std::make_unique<ProcTree>(GetScratchDirectory() / "proc");
+        for (auto pid = ProcessId{1}; pid <= Processes; ++pid)
+        {
+            if (pid % 10 == 0)
+            {
+                result->Start(pid, "", "kworker/" + std::to_string(pid % 64));
+            }
+            else
+            {
+                result->Start(pid, "/usr/lib/app/service" + std::to_string(pid), "service");
+            }
+        }
+
+        return result;
+    }();
+
+    auto source      = std::make_unique<ProcProcessSource>(tree->GetRoot());
+    auto sourcePtr   = source.get();
+    auto scanner     = ProcessScanner(std::move(source));
+    auto settings    = std::make_shared<Settings>();
+    for (auto i = 0; i < 24; ++i)
+    {
+        settings->Auto.TriggerProcess.Processes.push_back(std::format(L"tool{}.exe", i));
+    }
+
+    const auto snapshot = SettingsPtr(settings);
+    const auto stop     = StopToken();
+    const auto pause    = PauseToken();
+
+    // First scan queries every process.
+    scanner.Run(snapshot, stop, pause);
+
+    auto& counters   = GetAllocationCounters();
+    const auto allocations = counters.Count.load();
+    const auto osCalls     = sourcePtr->GetOsCallCount();
+
+    auto hits = size_t{0};
+    for (auto _ : state)
+    {
+        hits += scanner.Run(snapshot, stop, pause) ? 1 : 0;
+    }
+
+    DoNotOptimize(hits);
+
+    const auto ticks = static_cast<double>(state.GetIterations());
+    state.SetCounter("steady_allocs_per_tick", static_cast<double>(counters.Count.load() - allocations) / ticks);
+    state.SetCounter("os_calls_per_tick",      static_cast<double>(sourcePtr->GetOsCallCount() - osCalls) / ticks);
+}
+
+#endif // #if defined(__linux__)
@@ -0,0 +1,118 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+
+#include "Schedule.hpp"
+
+#include <chrono>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+constexpr auto Hour = 3600u;
+
+// Office hours plus a handful of evening slots, which is about as large as
+// hand written schedules get.
+auto MakeSchedule () -> std::vector<ScheduleEntry>
+{
+    constexpr auto workDays = DaysOfWeek::Monday | DaysOfWeek::Tuesday | DaysOfWeek::Wednesday | DaysOfWeek::Thursday | DaysOfWeek::Friday;
+    constexpr auto weekend  = DaysOfWeek::Saturday | DaysOfWeek::Sunday;
+
+    auto schedule = std::vector<ScheduleEntry>();
+    schedule.push_back(ScheduleEntry{ L"Work",    workDays, { TimeRange{ 8 * Hour, 12 * Hour }, TimeRange{ 13 * Hour, 17 * Hour } } });
+    schedule.push_back(ScheduleEntry{ L"Weekend", weekend,  { TimeRange{ 10 * Hour, 14 * Hour } } });
+
+    for (auto i = 0u; i < 6; ++i)
+    {
+        schedule.push_back(ScheduleEntry{ L"Evening", DaysOfWeek(1u << i), { TimeRange{ (18 + i % 3) * Hour, (19 + i % 3) * Hour - 1 } } });
+    }
+
+    return schedule;
+}
+
+// Points spread over a week, not aligned to any boundary.
+auto MakeTimes () -> std::vector<std::chrono::system_clock::time_point>
+{
+    auto times = std::vector<std::chrono::system_clock::time_point>();
+    auto time  = std::chrono::system_clock::time_point(std::chrono::seconds(1'700'000'000));
+    for (auto i = 0; i < 1024; ++i)
+    {
+        times.push_back(time);
+        time += std::chrono::seconds(7 * 60 + 13);
+    }
+
+    return times;
+}
+
+} // namespace
+
+BENCHMARK("Schedule/CheckSchedule")
+{
+    const auto schedule = MakeSchedule();
+    const auto times    = MakeTimes();
+
+    auto index = size_t{0};
+    for (auto _ : state)
+    {
+        DoNotOptimize(Schedule::CheckSchedule(schedule, times[index++ % times.size()]));
+    }
+}
+
+BENCHMARK("Schedule/NextTransition")
+{
+    const auto schedule = MakeSchedule();
+    const auto times    = MakeTimes();
+
+    auto index = size_t{0};
+    for (auto _ : state)
+    {
+        DoNotOptimize(Schedule::NextTransition(schedule, times[index++ % times.size()]));
+    }
+}
+
+BENCHMARK("Schedule/Evaluator/IsActive")
+{
+    const auto evaluator = ScheduleEvaluator(MakeSchedule());
+    const auto times     = MakeTimes();
+
+    auto index = size_t{0};
+    for (auto _ : state)
+    {
+        DoNotOptimize(evaluator.IsActive(times[index++ % times.size()]));
+    }
+
+    state.SetCounter("intervals", static_cast<double>(evaluator.GetIntervalCount()));
+}
+
+BENCHMARK("Schedule/Evaluator/NextTransition")
+{
+    const auto evaluator = ScheduleEvaluator(MakeSchedule());
+    const auto times     = MakeTimes();
+
+    auto index = size_t{0};
+    for (auto _ : state)
+    {
+        DoNotOptimize(evaluator.NextTransition(times[index++ % times.size()]));
+    }
+}
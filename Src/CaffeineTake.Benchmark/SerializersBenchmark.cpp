@@ -0,0 +1,147 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+
+#include "CaffeineIcons.hpp"
+#include "JsonCodec.hpp"
+#include "Serializers.hpp"
+
+#include <array>
+#include <string_view>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+constexpr auto BluetoothIds = std::array<std::string_view, 4>{
+    "00:1a:7d:da:71:13",
+    "F4:5C:89:AB:01:FF",
+    "a0:b1:c2:d3:e4:f5",
+    "00:00:00:00:00:0g"     // malformed
+};
+
+constexpr auto Colors = std::array<std::string_view, 4>{
+    "0xffffffff",
+    "0xFF1E90FF",
+    "0x80000000",
+    "0x00c0ffee"
+};
+
+// Writer text only grows, start over now and then.
+constexpr auto WritesPerWriter = size_t{1024};
+
+auto StringValue (const std::string_view s) -> JsonValue
+{
+    auto value = JsonValue();
+    value.Type   = JsonValue::Kind::String;
+    value.String = s;
+    return value;
+}
+
+} // namespace
+
+BENCHMARK("Serializers/BluetoothIdentifier/Parse")
+{
+    auto index = size_t{0};
+    for (auto _ : state)
+    {
+        DoNotOptimize(BluetoothIdentifierFromString(BluetoothIds[index++ % BluetoothIds.size()]));
+    }
+}
+
+BENCHMARK("Serializers/BluetoothIdentifier/Write")
+{
+    auto bi = BluetoothIdentifier();
+    bi.ull = BluetoothIdentifierFromString(BluetoothIds[0]);
+
+    auto writer = JsonWriter();
+    auto count  = size_t{0};
+    for (auto _ : state)
+    {
+        if (++count % WritesPerWriter == 0)
+        {
+            writer = JsonWriter();
+        }
+
+        writer.Element();
+        JsonCodec<BluetoothIdentifier>::Write(writer, bi);
+    }
+
+    DoNotOptimize(writer.Text());
+}
+
+BENCHMARK("Serializers/HexColor/Read")
+{
+    auto values = std::array<JsonValue, Colors.size()>();
+    for (auto i = size_t{0}; i < Colors.size(); ++i)
+    {
+        values[i] = StringValue(Colors[i]);
+    }
+
+    auto color = HexColorCodec::Color();
+    auto index = size_t{0};
+    for (auto _ : state)
+    {
+        DoNotOptimize(HexColorCodec::Read(values[index++ % values.size()], color));
+        DoNotOptimize(color);
+    }
+}
+
+BENCHMARK("Serializers/HexColor/Write")
+{
+    auto writer = JsonWriter();
+    auto count  = size_t{0};
+    for (auto _ : state)
+    {
+        if (++count % WritesPerWriter == 0)
+        {
+            writer = JsonWriter();
+        }
+
+        writer.Element();
+        HexColorCodec::Write(writer, static_cast<HexColorCodec::Color>(count * 0x9E3779B9u));
+    }
+
+    DoNotOptimize(writer.Text());
+}
+
+BENCHMARK("Serializers/IconColors/Write")
+{
+    auto colors = CaffeineIcons::IconColors();
+    colors.CupFill = 0xFF1E90FF;
+    colors.Steam   = 0x80000000;
+
+    auto writer = JsonWriter();
+    auto count  = size_t{0};
+    for (auto _ : state)
+    {
+        if (++count % WritesPerWriter == 0)
+        {
+            writer = JsonWriter();
+        }
+
+        writer.Element();
+        WriteJson(writer, colors);
+    }
+
+    DoNotOptimize(writer.Text());
+}
@@ -0,0 +1,291 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+
+#include "Settings.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+// Settings of a heavy user, every list has a few dozen entries.
+auto MakeSettings () -> Settings
+{
+    auto settings = Settings();
+    settings.General.IconPack = CaffeineIcons::IconPack::Custom;
+    settings.General.IconColors.AutoMode_Active.CupFill = 0xFF1E90FF;
+
+    for (auto i = 0; i < 48; ++i)
+    {
+        settings.Auto.TriggerProcess.Processes.push_back(i % 2
+            ? L"C:\\Program Files\\Vendor " + std::to_wstring(i) + L"\\App" + std::to_wstring(i) + L".exe"
+            : L"tool" + std::to_wstring(i) + L".exe"
+        );
+    }
+
+    for (auto i = 0; i < 32; ++i)
+    {
+        switch (i % 3)
+        {
+        case 0:  settings.Auto.TriggerWindow.Windows.push_back(L"Meeting " + std::to_wstring(i)); break;
+        case 1:  settings.Auto.TriggerWindow.Windows.push_back(L"glob:*Presentation " + std::to_wstring(i) + L"*"); break;
+        default: settings.Auto.TriggerWindow.Windows.push_back(L"regex:^Build #\\d+ - Job" + std::to_wstring(i) + L"$"); break;
+        }
+    }
+
+    for (auto i = 0; i < 16; ++i)
+    {
+        settings.Auto.TriggerUsb.UsbDevices.push_back(L"USB\\VID_046D&PID_C5" + std::to_wstring(10 + i));
+
+        auto bi = BluetoothIdentifier();
+        bi.ull = 0x001A7DDA7100ull + i;
+        settings.Auto.TriggerBluetooth.BluetoothDevices.push_back(bi);
+    }
+
+    const auto workDays = DaysOfWeek::Monday | DaysOfWeek::Tuesday | DaysOfWeek::Wednesday | DaysOfWeek::Thursday | DaysOfWeek::Friday;
+    settings.Auto.TriggerSchedule.ScheduleEntries.push_back(ScheduleEntry{ L"Work", workDays, { TimeRange{ 8 * 3600, 12 * 3600 }, TimeRange{ 13 * 3600, 17 * 3600 } } });
+    settings.Auto.TriggerSchedule.ScheduleEntries.push_back(ScheduleEntry{ L"Weekend", DaysOfWeek::Saturday, { TimeRange{ 10 * 3600, 14 * 3600 } } });
+
+    return settings;
+}
+
+auto SettingsPath () -> std::filesystem::path
+{
+    return GetScratchDirectory() / "Settings.json";
+}
+
+auto CachePath () -> std::filesystem::path
+{
+    return GetScratchDirectory() / "Settings.cache";
+}
+
+// Trigger lists grown by scripts or imports, thousands of processes and
+// window titles.
+auto MakeLargeSettings (size_t triggers) -> Settings
+{
+    auto settings = MakeSettings();
+    for (auto i = size_t{0}; i < triggers; ++i)
+    {
+        settings.Auto.TriggerProcess.Processes.push_back(L"C:\\Tools\\Batch " + std::to_wstring(i) + L"\\worker" + std::to_wstring(i) + L".exe");
+        settings.Auto.TriggerWindow.Windows.push_back(L"glob:*Render Job " + std::to_wstring(i) + L" - *");
+    }
+
+    return settings;
+}
+
+// First start of the app, fresh settings object each time. Cached one is
+// every start after it, miss is start after settings were edited: parse
+// and refresh cache.
+auto ColdStart (State& state, size_t triggers, bool cached, bool refresh) -> void
+{
+    const auto path  = SettingsPath();
+    const auto cache = CachePath();
+    MakeLargeSettings(triggers).Save(path, cache);
+
+    for (auto _ : state)
+    {
+        auto settings = Settings();
+        if (cached)
+        {
+            DoNotOptimize(settings.Load(path, cache));
+        }
+        else
+        {
+            DoNotOptimize(settings.Load(path));
+        }
+
+        if (refresh)
+        {
+            DoNotOptimize(settings.StoreCache(path, cache));
+        }
+    }
+
+    state.SetCounter("file_bytes",  static_cast<double>(std::filesystem::file_size(path)));
+    state.SetCounter("cache_bytes", static_cast<double>(std::filesystem::file_size(cache)));
+}
+
+auto ReadText (const std::filesystem::path& path) -> std::string
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Parse throughput and highest heap use above what was live before, of
+// loading file with given number of triggers. Loaded settings stay in heap
+// after, settings_bytes, peak above them is what parsing costs. DOM was
+// extra on top of them.
+auto LoadTriggers (State& state, size_t triggers, bool dom) -> void
+{
+    const auto path = SettingsPath();
+    MakeLargeSettings(triggers / 2).Save(path);
+
+    const auto text     = ReadText(path);
+    auto       peak     = std::uint64_t{0};
+    auto       retained = std::uint64_t{0};
+
+    for (auto _ : state)
+    {
+        const auto before = ResetPeak();
+        if (dom)
+        {
+            // What loader built before filling settings from it.
+            DoNotOptimize(nlohmann::json::parse(text));
+        }
+        else
+        {
+            auto settings = Settings();
+            DoNotOptimize(settings.Load(path));
+            retained = GetAllocationCounters().Live.load() - before;
+        }
+        peak = std::max(peak, GetAllocationCounters().Peak.load() - before);
+    }
+
+    const auto seconds = std::chrono::duration<double>(state.GetElapsed()).count();
+    state.SetCounter("file_bytes", static_cast<double>(text.size()));
+    state.SetCounter("peak_bytes", static_cast<double>(peak));
+    state.SetCounter("mb_per_s",   static_cast<double>(text.size()) * state.GetIterations() / seconds / 1e6);
+    if (!dom)
+    {
+        state.SetCounter("settings_bytes", static_cast<double>(retained));
+    }
+}
+
+} // namespace
+
+// Text Save writes, without touching disk.
+BENCHMARK("Settings/Save/Serialize")
+{
+    const auto settings = MakeSettings();
+
+    auto size = size_t{0};
+    for (auto _ : state)
+    {
+        size = settings.ToJson().size();
+        DoNotOptimize(size);
+    }
+
+    state.SetCounter("file_bytes", static_cast<double>(size));
+}
+
+// Whole Save: temp file, fsync, rename and directory fsync. Disk flush is
+// most of it and varies with storage, compare with Serialize above.
+BENCHMARK("Settings/Save/Durable")
+{
+    const auto settings = MakeSettings();
+    const auto path     = SettingsPath();
+
+    for (auto _ : state)
+    {
+        DoNotOptimize(settings.Save(path));
+    }
+
+    state.SetCounter("file_bytes", static_cast<double>(std::filesystem::file_size(path)));
+}
+
+BENCHMARK("Settings/Load")
+{
+    const auto path = SettingsPath();
+    MakeSettings().Save(path);
+
+    auto settings = Settings();
+    for (auto _ : state)
+    {
+        DoNotOptimize(settings.Load(path));
+    }
+}
+
+// Binary cache hit, what every start after the first one does.
+BENCHMARK("Settings/Load/Cached")
+{
+    const auto path  = SettingsPath();
+    const auto cache = CachePath();
+    MakeSettings().Save(path, cache);
+
+    auto settings = Settings();
+    for (auto _ : state)
+    {
+        DoNotOptimize(settings.Load(path, cache));
+    }
+}
+
+// Written and loaded back in memory, loaded copy must not differ from the
+// original.
+BENCHMARK("Settings/RoundTrip")
+{
+    const auto original = MakeSettings();
+
+    auto loaded = Settings();
+    for (auto _ : state)
+    {
+        DoNotOptimize(loaded.FromJson(original.ToJson()));
+    }
+
+    state.SetCounter("diff_fields", static_cast<double>(original.Diff(loaded).size()));
+}
+
+BENCHMARK("Settings/ColdStart/Json/1000")
+{
+    ColdStart(state, 1000, false, false);
+}
+
+BENCHMARK("Settings/ColdStart/Cached/1000")
+{
+    ColdStart(state, 1000, true, false);
+}
+
+BENCHMARK("Settings/ColdStart/Json/20000")
+{
+    ColdStart(state, 20000, false, false);
+}
+
+BENCHMARK("Settings/ColdStart/Cached/20000")
+{
+    ColdStart(state, 20000, true, false);
+}
+
+// Cache write is synced to disk, which dominates at this size.
+BENCHMARK("Settings/ColdStart/Miss/20000")
+{
+    ColdStart(state, 20000, false, true);
+}
+
+// Streaming loader on 50k triggers, settings are the only thing it keeps.
+BENCHMARK("Settings/Load/Triggers/50000")
+{
+    LoadTriggers(state, 50000, false);
+}
+
+// DOM of the same file alone, lower bound of the loader it replaced.
+BENCHMARK("Settings/Load/Triggers/50000/Dom")
+{
+    LoadTriggers(state, 50000, true);
+}
@@ -0,0 +1,198 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "BinaryCache.hpp"
+#include "Persistence.hpp"
+#include "Settings.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace std::chrono_literals;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+auto MakeSettings (size_t triggers) -> Settings
+{
+    auto settings = Settings();
+    for (auto i = size_t{0}; i < triggers; ++i)
+    {
+        settings.Auto.TriggerProcess.Processes.push_back(L"tool" + std::to_wstring(i) + L".exe");
+        settings.Auto.TriggerWindow.Windows.push_back(L"glob:*Meeting " + std::to_wstring(i) + L"*");
+    }
+
+    return settings;
+}
+
+auto ReadFile (const fs::path& path) -> std::string
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+auto WriteFile (const fs::path& path, const std::string& data) -> void
+{
+    auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    file << data;
+}
+
+} // namespace
+
+TEST("BinaryCache/Hit")
+{
+    const auto dir      = Test::MakeScratchDirectory("BinaryCache.Hit");
+    const auto path     = dir / "Settings.json";
+    const auto cache    = dir / "Settings.bin";
+    const auto original = MakeSettings(100);
+
+    REQUIRE(original.Save(path));
+
+    // Parsed first, cache is left to caller.
+    auto stale  = false;
+    auto parsed = Settings();
+    REQUIRE(parsed.Load(path, cache, &stale));
+    CHECK(stale);
+    CHECK(!fs::exists(cache));
+
+    REQUIRE(parsed.StoreCache(path, cache));
+    CHECK(!fs::exists(fs::path(cache) += ".tmp"));
+
+    auto cached = Settings();
+    REQUIRE(cached.Load(path, cache, &stale));
+    CHECK(!stale);
+    CHECK(cached.Diff(original).empty());
+}
+
+// Different source content must not be served from cache.
+TEST("BinaryCache/SourceChanged")
+{
+    const auto dir   = Test::MakeScratchDirectory("BinaryCache.SourceChanged");
+    const auto path  = dir / "Settings.json";
+    const auto cache = dir / "Settings.bin";
+
+    REQUIRE(MakeSettings(10).Save(path, cache));
+
+    const auto changed = MakeSettings(11);
+    REQUIRE(changed.Save(path));
+
+    auto stale  = false;
+    auto loaded = Settings();
+    REQUIRE(loaded.Load(path, cache, &stale));
+    CHECK(stale);
+    CHECK(loaded.Diff(changed).empty());
+}
+
+// Same content with new modification time, e.g. copied back, is still a
+// hit through content hash.
+TEST("BinaryCache/Touched")
+{
+    const auto dir   = Test::MakeScratchDirectory("BinaryCache.Touched");
+    const auto path  = dir / "Settings.json";
+    const auto cache = dir / "Settings.bin";
+
+    REQUIRE(MakeSettings(10).Save(path, cache));
+    fs::last_write_time(path, fs::last_write_time(path) + 1h);
+
+    auto stale  = false;
+    auto loaded = Settings();
+    REQUIRE(loaded.Load(path, cache, &stale));
+    CHECK(!stale);
+}
+
+// Damaged or cut payload fails its hash, settings come from source.
+TEST("BinaryCache/Corrupted")
+{
+    const auto dir      = Test::MakeScratchDirectory("BinaryCache.Corrupted");
+    const auto path     = dir / "Settings.json";
+    const auto cache    = dir / "Settings.bin";
+    const auto original = MakeSettings(50);
+
+    REQUIRE(original.Save(path, cache));
+    const auto good = ReadFile(cache);
+
+    auto flipped = good;
+    flipped[flipped.size() - 3] ^= 0x5a;
+
+    for (const auto& data : { flipped, good.substr(0, good.size() / 2), std::string() })
+    {
+        WriteFile(cache, data);
+
+        auto stale  = false;
+        auto loaded = Settings();
+        REQUIRE(loaded.Load(path, cache, &stale));
+        CHECK(stale);
+        CHECK(loaded.Diff(original).empty());
+    }
+}
+
+// Writers from several threads go through one queue, last one wins and
+// cache is whole.
+TEST("BinaryCache/PersistQueue")
+{
+    const auto dir   = Test::MakeScratchDirectory("BinaryCache.PersistQueue");
+    const auto path  = dir / "Settings.json";
+    const auto cache = dir / "Settings.bin";
+
+    const auto original = MakeSettings(200);
+    REQUIRE(original.Save(path));
+
+    {
+        auto queue   = PersistQueue(0ms, 0ms);
+        auto threads = std::vector<std::thread>();
+        for (auto t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                for (auto i = 0; i < 20; ++i)
+                {
+                    queue.Schedule(std::format("Cache{}", t), [&]
+                    {
+                        return original.StoreCache(path, cache);
+                    });
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        queue.Flush();
+    }
+
+    CHECK(!fs::exists(fs::path(cache) += ".tmp"));
+
+    auto stale  = false;
+    auto loaded = Settings();
+    REQUIRE(loaded.Load(path, cache, &stale));
+    CHECK(!stale);
+    CHECK(loaded.Diff(original).empty());
+}
@@ -0,0 +1,117 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "FileWatcher.hpp"
+#include "Persistence.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace CaffeineTake;
+using namespace std::chrono_literals;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr auto Debounce = 50ms;
+
+auto Append (const fs::path& path, const std::string& line) -> void
+{
+    auto file = std::ofstream(path, std::ios::binary | std::ios::app);
+    file << line << '\n';
+}
+
+} // namespace
+
+// Log, rotated log, trace and atomic write temporaries share the directory
+// with settings, none of them is a settings change.
+TEST("FileWatcher/IgnoresSiblings")
+{
+    const auto dir      = Test::MakeScratchDirectory("FileWatcher.IgnoresSiblings");
+    const auto settings = dir / "Settings.json";
+    REQUIRE(WriteFileAtomic(settings, "{}"));
+
+    auto reloads = std::atomic<int>(0);
+    auto watcher = FileWatcher();
+    REQUIRE(watcher.Start(settings, [&reloads] { reloads += 1; }, Debounce));
+
+    const auto end = std::chrono::steady_clock::now() + 300ms;
+    for (auto i = 0; std::chrono::steady_clock::now() < end; ++i)
+    {
+        Append(dir / "CaffeineTake.log", "line " + std::to_string(i));
+        Append(dir / "CaffeineTake.1.log", "rotated");
+        Append(dir / "Trace.json", "{}");
+        REQUIRE(WriteFileAtomic(dir / "Mode.json", std::to_string(i)));
+        std::this_thread::sleep_for(5ms);
+    }
+
+    std::this_thread::sleep_for(Debounce * 4);
+    CHECK(reloads == 0);
+
+    // Replaced by rename, as settings writer does.
+    REQUIRE(WriteFileAtomic(settings, R"({ "General": {} })"));
+    std::this_thread::sleep_for(Debounce * 6);
+    CHECK(reloads == 1);
+
+    // Busy log keeps writing after settings change, reload still comes once.
+    Append(settings, " ");
+    for (auto i = 0; i < 20; ++i)
+    {
+        Append(dir / "CaffeineTake.log", "line");
+        std::this_thread::sleep_for(5ms);
+    }
+
+    std::this_thread::sleep_for(Debounce * 6);
+    CHECK(reloads == 2);
+
+    watcher.Stop();
+}
+
+// File written without pause is reported after at most MaxDebounceRounds
+// debounce periods, not when writer stops.
+TEST("FileWatcher/DebounceIsBounded")
+{
+    const auto dir      = Test::MakeScratchDirectory("FileWatcher.DebounceIsBounded");
+    const auto settings = dir / "Settings.json";
+    REQUIRE(WriteFileAtomic(settings, "{}"));
+
+    auto reloads = std::atomic<int>(0);
+    auto watcher = FileWatcher();
+    REQUIRE(watcher.Start(settings, [&reloads] { reloads += 1; }, Debounce));
+
+    const auto start = std::chrono::steady_clock::now();
+    while (reloads == 0 && std::chrono::steady_clock::now() - start < 5s)
+    {
+        Append(settings, " ");
+        std::this_thread::sleep_for(Debounce / 5);
+    }
+
+    CHECK(reloads > 0);
+    CHECK(std::chrono::steady_clock::now() - start < Debounce * (FileWatcher::MaxDebounceRounds + 4));
+
+    watcher.Stop();
+}
@@ -0,0 +1,259 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+#include "NlohmannSettings.hpp"
+
+#include "JsonSaxLoader.hpp"
+#include "Settings.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+using namespace CaffeineTake;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+auto ReadFile (const fs::path& path) -> std::string
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+auto WriteFile (const fs::path& path, const std::string_view text) -> bool
+{
+    auto file = std::ofstream(path, std::ios::binary);
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    return file.good();
+}
+
+// Heavy user's settings, non-ASCII text is written to file as UTF-8.
+auto MakeSettings () -> Settings
+{
+    auto settings = Settings();
+    settings.General.LangId   = L"pl";
+    settings.General.IconPack = CaffeineIcons::IconPack::Custom;
+    settings.General.IconColors.TimerMode_Active.Steam = 0x80FFFFFF;
+    settings.Timer.Interval   = 25 * 60 * 1000;
+
+    for (auto i = 0; i < 200; ++i)
+    {
+        settings.Auto.TriggerProcess.Processes.push_back(L"C:\\Program Files\\Caf\u00e9 " + std::to_wstring(i) + L"\\App.exe");
+        settings.Auto.TriggerWindow.Windows.push_back(L"glob:*\u0417\u0430\u043c\u0435\u0442\u043a\u0438 " + std::to_wstring(i) + L"*");
+    }
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        settings.Auto.TriggerUsb.UsbDevices.push_back(L"USB\\VID_046D&PID_C5" + std::to_wstring(20 + i));
+
+        auto bi = BluetoothIdentifier();
+        bi.ull = 0x001A7DDA7100ull + i;
+        settings.Auto.TriggerBluetooth.BluetoothDevices.push_back(bi);
+    }
+
+    const auto workDays = DaysOfWeek::Monday | DaysOfWeek::Tuesday | DaysOfWeek::Wednesday | DaysOfWeek::Thursday | DaysOfWeek::Friday;
+    settings.Auto.TriggerSchedule.ScheduleEntries.push_back(ScheduleEntry{ L"Work", workDays, { TimeRange{ 8 * 3600, 12 * 3600 }, TimeRange{ 13 * 3600, 17 * 3600 } } });
+    settings.Auto.TriggerSchedule.ScheduleEntries.push_back(ScheduleEntry{ L"", DaysOfWeek::Sunday, {} });
+
+    return settings;
+}
+
+// Not as WriteJson would put it: members out of order, unknown and
+// repeated ones, escapes, numbers given as floats and booleans.
+constexpr auto HandWritten = std::string_view(R"json({
+    "Timer": { "Interval": 90000.7, "WhenSessionLocked": true, "KeepScreenOn": false, "Enabled": true },
+    "Unknown": { "Nested": [1, { "a": null }, "x"], "Flag": false },
+    "Standard": { "Enabled": false, "KeepScreenOn": true, "WhenSessionLocked": true, "Extra": [] },
+    "General": {
+        "LangId": "de",
+        "IconPack": 2,
+        "IconTheme": 1,
+        "UseNotifyIcon": false,
+        "UseJumpLists": true,
+        "UseDockMode": true,
+        "AutoStart": true,
+        "ShowNotifications": true,
+        "PlayNotificationSound": true,
+        "SoundPack": 0,
+        "PrepareIconColors": false,
+        "LangId": "pl",
+        "IconColors": {
+            "TimerMode_Active":      { "CupBorder": "0xff000000", "CupFill": "0XFF1E90FF", "Steam": "80ffffff", "ModeIndicator": "0x00000000" },
+            "TimerMode_Inactive":    { "CupBorder": "0xff000001", "CupFill": "0xff000002", "Steam": "0xff000003", "ModeIndicator": "0xff000004" },
+            "AutoMode_Active":       { "ModeIndicator": "0x12345678", "Steam": "0x9abcdef0", "CupFill": "0x0000ffff", "CupBorder": "0xffff0000" },
+            "AutoMode_Inactive":     { "CupBorder": "0x11111111", "CupFill": "0x22222222", "Steam": "0x33333333", "ModeIndicator": "0x44444444" },
+            "StandardMode_Active":   { "CupBorder": "0x55555555", "CupFill": "0x66666666", "Steam": "0x77777777", "ModeIndicator": "0x88888888" },
+            "StandardMode_Inactive": { "CupBorder": "0x99999999", "CupFill": "0xaaaaaaaa", "Steam": "0xbbbbbbbb", "ModeIndicator": "0xcccccccc" }
+        }
+    },
+    "Auto": {
+        "ScanInterval": true,
+        "Enabled": false,
+        "KeepScreenOn": false,
+        "WhenSessionLocked": true,
+        "TriggerProcess": {
+            "Enabled": true,
+            "Processes": ["C:\\Program Files\\Caf\u00e9\\app.exe", "notepad.exe", "quote \" and \\ slash", "\ud83d\ude00.exe"],
+            "ScanInterval": 1500,
+            "MaxScanInterval": 30000
+        },
+        "TriggerWindow": {
+            "Enabled": false,
+            "Windows": ["glob:*Zoom*", "Za\u017c\u00f3\u0142\u0107 g\u0119\u015bl\u0105 ja\u017a\u0144", ""],
+            "ScanInterval": 0,
+            "MaxScanInterval": 2.5e3
+        },
+        "TriggerUsb": { "UsbDevices": ["USB\\VID_046D&PID_C52B"], "Enabled": true, "ScanInterval": 250, "MaxScanInterval": 16000 },
+        "TriggerBluetooth": {
+            "Enabled": true,
+            "BluetoothDevices": ["00:1a:7d:da:71:13", "F4:5C:89:AB:01:FF"],
+            "ActiveTimeout": 120000,
+            "ScanInterval": 5000
+        },
+        "TriggerSchedule": {
+            "Enabled": true,
+            "ScheduleEntries": [
+                { "Name": "Work", "ActiveDays": 31, "ActiveHours": [{ "Begin": 28800, "End": 43200 }, { "End": 61200, "Begin": 46800 }] },
+                { "ActiveHours": [], "ActiveDays": 96, "Name": "Weekend" }
+            ]
+        }
+    }
+})json");
+
+struct MalformedInput
+{
+    std::string_view Text;
+    std::string_view Message;   // part of it
+    size_t           Line;
+    size_t           Column;
+    size_t           Offset;
+};
+
+// Syntax errors point at offending character, the rest at start of value
+// or at closing brace of object with member missing.
+constexpr MalformedInput Malformed[] = {
+    {
+        "{\n    \"Auto\": {\n        \"TriggerProcess\": {\n            \"Processes\": [\"a.exe\", \"b.exe\",]\n        }\n    }\n}",
+        "unexpected ']'", 4, 44, 87
+    },
+    {
+        "{\n    \"General\": {\n        \"LangId\": \"\\uZZZZ\"\n    }\n}",
+        "must be followed by 4 hex digits", 3, 22, 40
+    },
+    {
+        "{\n    \"General\": {\n",
+        "unexpected end of input", 3, 1, 19
+    },
+    {
+        "{\n    \"Timer\": {\n        \"Interval\": 1e999\n    }\n}",
+        "number overflow", 3, 21, 37
+    },
+    {
+        "{\n    \"General\": {\n        \"LangId\": \"en\",\n        \"UseNotifyIcon\": \"yes\"\n    }\n}",
+        "Unexpected type of 'General.UseNotifyIcon'", 4, 26, 68
+    },
+    {
+        "{\n    \"Auto\": {\n        \"TriggerWindow\": {\n            \"Windows\": \"say \\\"hi\\\" \\\\\"\n        }\n    }\n}",
+        "Unexpected type of 'Auto.TriggerWindow.Windows'", 4, 24, 66
+    },
+    {
+        "{\n    \"General\": {\n        \"UseDockMode\": {}\n    }\n}",
+        "Unexpected type of 'General.UseDockMode'", 3, 24, 42
+    },
+    {
+        "{\n    \"Standard\": 1\n}",
+        "Unexpected type of 'Standard'", 2, 17, 18
+    },
+    {
+        "{\r\n    \"Standard\": 1\r\n}",
+        "Unexpected type of 'Standard'", 2, 17, 19
+    },
+    {
+        "{\n    \"General\": {\n        \"IconColors\": {\n            \"AutoMode_Active\": {\n                \"CupFill\": \"ZZ\"\n            }\n        }\n    }\n}",
+        "Invalid value of 'General.IconColors.AutoMode_Active.CupFill'", 5, 28, 103
+    },
+    {
+        "{\n    \"Timer\": {\n        \"Enabled\": true,\n        \"KeepScreenOn\": true,\n        \"WhenSessionLocked\": false\n    }\n}",
+        "Missing 'Timer.Interval'", 6, 5, 111
+    },
+};
+
+} // namespace
+
+// Same files through SAX loader and through DOM mapping it replaced,
+// compared field by field.
+TEST("JsonSaxLoader/MatchesDom")
+{
+    const auto dir = Test::MakeScratchDirectory("JsonSaxLoader.MatchesDom");
+
+    REQUIRE(Settings().Save(dir / "Default.json"));
+    REQUIRE(MakeSettings().Save(dir / "Heavy.json"));
+    REQUIRE(WriteFile(dir / "HandWritten.json", HandWritten));
+
+    for (const auto name : { "Default.json", "Heavy.json", "HandWritten.json" })
+    {
+        auto sax = Settings();
+        REQUIRE(sax.Load(dir / name));
+
+        auto dom = Settings();
+        nlohmann::json::parse(ReadFile(dir / name)).get_to(dom);
+
+        CHECK(sax.Diff(dom).empty());
+        CHECK(nlohmann::json(sax) == nlohmann::json(dom));
+    }
+
+    // Hand written file did reach the fields.
+    auto loaded = Settings();
+    REQUIRE(loaded.FromJson(HandWritten));
+    CHECK(loaded.General.LangId == L"pl");
+    CHECK(loaded.Timer.Interval == 90000);
+    CHECK(loaded.Auto.ScanInterval == 1);
+    CHECK(loaded.Auto.TriggerWindow.MaxScanInterval == 2500);
+    CHECK(loaded.Auto.TriggerProcess.Processes.size() == 4);
+    CHECK(loaded.Auto.TriggerProcess.Processes[0] == L"C:\\Program Files\\Caf\u00e9\\app.exe");
+    CHECK(loaded.Auto.TriggerProcess.Processes[2] == L"quote \" and \\ slash");
+    CHECK(loaded.Auto.TriggerSchedule.ScheduleEntries.size() == 2);
+}
+
+TEST("JsonSaxLoader/ErrorPosition")
+{
+    for (const auto& input : Malformed)
+    {
+        auto settings = Settings();
+        settings.Timer.Interval = 1234;
+
+        auto error = JsonLoadError();
+        CHECK(!settings.FromJson(input.Text, &error));
+        CHECK(error.Message.find(input.Message) != std::string::npos);
+        CHECK(error.Line   == input.Line);
+        CHECK(error.Column == input.Column);
+        CHECK(error.Offset == input.Offset);
+
+        // Left as they were.
+        CHECK(settings.Timer.Interval == 1234);
+    }
+}
@@ -0,0 +1,212 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "Logger.hpp"
+#include "RotatingLogSink.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Argument whose copy throws, like a string copy running out of memory.
+struct Bomb
+{
+    int Value = 0;
+
+    Bomb () = default;
+
+    Bomb (const Bomb&)
+    {
+        throw std::runtime_error("Bomb copied");
+    }
+};
+
+// Waits until writer thread catches up with every committed record.
+auto WaitForWriter (std::chrono::milliseconds timeout = 5000ms) -> bool
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true)
+    {
+        const auto stats = AsyncLogger::Get().Stats();
+        if (stats.Written >= stats.Enqueued)
+        {
+            return true;
+        }
+
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+
+        std::this_thread::sleep_for(1ms);
+    }
+}
+
+struct LogDirectoryUsage
+{
+    size_t         Files = 0;
+    std::uintmax_t Bytes = 0;
+};
+
+// Files may be renamed or removed while directory is read, those are skipped.
+auto GetLogDirectoryUsage (const std::filesystem::path& directory) -> LogDirectoryUsage
+{
+    auto usage = LogDirectoryUsage();
+    auto ec    = std::error_code();
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+    {
+        const auto size = entry.file_size(ec);
+        if (!ec)
+        {
+            usage.Files += 1;
+            usage.Bytes += size;
+        }
+    }
+
+    return usage;
+}
+
+} // namespace
+
+template <>
+struct spdlog::fmt_lib::formatter<Bomb> : spdlog::fmt_lib::formatter<int>
+{
+    auto format (const Bomb& bomb, auto& context) const
+    {
+        return spdlog::fmt_lib::formatter<int>::format(bomb.Value, context);
+    }
+};
+
+TEST("Logger/ThrowingArgument")
+{
+    REQUIRE(WaitForWriter());
+
+    // Large payload goes to heap, small one stays in ring.
+    const auto bomb  = Bomb();
+    const auto large = std::string(LogRecord::InlineSize, 'x');
+
+    auto thrown = 0;
+    for (auto i = 0; i < 2; ++i)
+    {
+        try
+        {
+            if (i == 0)
+            {
+                LOG_INFO("Inline {}", bomb);
+            }
+            else
+            {
+                LOG_INFO("Heap {} {} {}", large, large, bomb);
+            }
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown += 1;
+        }
+    }
+
+    CHECK(thrown == 2);
+
+    // Nothing is left reserved, so records after it are still written.
+    for (auto i = 0; i < 100; ++i)
+    {
+        LOG_INFO("After throwing argument {}", i);
+    }
+
+    CHECK(WaitForWriter());
+}
+
+// Several threads write as fast as they can through small files while disk
+// use is sampled. It must never go over (MaxFiles + 1) * MaxFileSize, also
+// after restart finds files of earlier run.
+TEST("RotatingLogSink/Stress")
+{
+    constexpr auto Threads        = 4;
+    constexpr auto LinesPerThread = 20000;
+
+    const auto directory = Test::MakeScratchDirectory("RotatingLogSinkStress");
+    const auto path      = directory / "Stress.log";
+    const auto rotation  = LogRotation{ 64 * 1024, 3, false };
+    const auto bound     = (rotation.MaxFiles + 1) * rotation.MaxFileSize;
+    const auto line      = std::string(200, 'x');
+
+    for (auto run = 0; run < 2; ++run)
+    {
+        auto sink = std::make_shared<RotatingLogSink>(path, rotation);
+        sink->set_pattern("[%Y-%m-%d %T.%e][%8l]{%5t} %v");
+
+        auto logger = spdlog::logger("Stress", sink);
+
+        auto isDone  = std::atomic<bool>(false);
+        auto samples = size_t{0};
+        auto peak    = std::uintmax_t{0};
+        auto monitor = std::thread([&]
+        {
+            while (!isDone.load())
+            {
+                const auto usage = GetLogDirectoryUsage(directory);
+                peak     = std::max(peak, usage.Bytes);
+                samples += 1;
+            }
+        });
+
+        auto writers = std::vector<std::thread>();
+        for (auto t = 0; t < Threads; ++t)
+        {
+            writers.emplace_back([&, t]
+            {
+                for (auto i = 0; i < LinesPerThread; ++i)
+                {
+                    logger.info("{} {} {}", t, i, line);
+                }
+            });
+        }
+
+        for (auto& writer : writers)
+        {
+            writer.join();
+        }
+
+        isDone = true;
+        monitor.join();
+        logger.flush();
+
+        const auto usage = GetLogDirectoryUsage(directory);
+
+        CHECK(samples > 0);
+        CHECK(peak <= bound);
+        CHECK(usage.Bytes <= bound);
+        CHECK(usage.Files == rotation.MaxFiles + 1);
+    }
+}
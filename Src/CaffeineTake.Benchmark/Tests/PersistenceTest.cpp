@@ -0,0 +1,176 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "Persistence.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#   include <signal.h>
+#   include <sys/wait.h>
+#   include <unistd.h>
+#endif
+
+using namespace CaffeineTake;
+using namespace std::chrono_literals;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+auto ReadFile (const fs::path& path) -> std::string
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+TEST("WriteFileAtomic/Replace")
+{
+    const auto dir  = Test::MakeScratchDirectory("WriteFileAtomic.Replace");
+    const auto path = dir / "Settings.json";
+
+    REQUIRE(WriteFileAtomic(path, "first"));
+    CHECK(ReadFile(path) == "first");
+
+    REQUIRE(WriteFileAtomic(path, "second, longer"));
+    CHECK(ReadFile(path) == "second, longer");
+
+    REQUIRE(WriteFileAtomic(path, ""));
+    CHECK(ReadFile(path).empty());
+    CHECK(!fs::exists(fs::path(path) += ".tmp"));
+}
+
+#if defined(__linux__)
+// Writer process killed at random points of its writes, file must always
+// hold one whole version.
+TEST("WriteFileAtomic/KillMidWrite")
+{
+    const auto dir  = Test::MakeScratchDirectory("WriteFileAtomic.KillMidWrite");
+    const auto path = dir / "Settings.json";
+
+    // Large enough that most kills land inside write or fsync.
+    const auto versionA = std::string(4 << 20, 'a');
+    const auto versionB = std::string(3 << 20, 'b');
+    REQUIRE(WriteFileAtomic(path, versionA));
+
+    auto random = std::mt19937(15);
+    auto delay  = std::uniform_int_distribution<int>(0, 30);
+
+    for (auto round = 0; round < 30; ++round)
+    {
+        const auto pid = ::fork();
+        REQUIRE(pid >= 0);
+
+        if (pid == 0)
+        {
+            for (auto i = 0; ; ++i)
+            {
+                WriteFileAtomic(path, i % 2 ? versionA : versionB);
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay(random)));
+        ::kill(pid, SIGKILL);
+
+        auto status = 0;
+        ::waitpid(pid, &status, 0);
+        CHECK(WIFSIGNALED(status));
+
+        const auto content = ReadFile(path);
+        CHECK(content == versionA || content == versionB);
+    }
+}
+#endif
+
+// Same key rescheduled before it runs is written once, with last value.
+TEST("PersistQueue/Coalesce")
+{
+    auto writes = std::atomic<int>(0);
+    auto value  = std::atomic<int>(-1);
+    {
+        auto queue = PersistQueue(50ms, 5000ms);
+        for (auto i = 0; i < 50; ++i)
+        {
+            queue.Schedule("Key", [&writes, &value, i]
+            {
+                writes += 1;
+                value   = i;
+                return true;
+            });
+        }
+
+        queue.Flush();
+    }
+
+    CHECK(writes == 1);
+    CHECK(value == 49);
+}
+
+// Rescheduling more often than debounce can't hold write back past max
+// delay.
+TEST("PersistQueue/MaxDelay")
+{
+    auto queue  = PersistQueue(100ms, 300ms);
+    auto writes = std::atomic<int>(0);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto first = std::chrono::steady_clock::duration();
+    while (std::chrono::steady_clock::now() - start < 1s)
+    {
+        queue.Schedule("Key", [&writes] { writes += 1; return true; });
+        if (writes > 0 && first == std::chrono::steady_clock::duration())
+        {
+            first = std::chrono::steady_clock::now() - start;
+        }
+
+        std::this_thread::sleep_for(20ms);
+    }
+
+    queue.Flush();
+
+    CHECK(writes >= 2);
+    CHECK(first > std::chrono::steady_clock::duration());
+    CHECK(first < 800ms);
+}
+
+// Keys are independent, and pending jobs run on destruction.
+TEST("PersistQueue/Destroy")
+{
+    auto writes = std::atomic<int>(0);
+    {
+        auto queue = PersistQueue(10s, 10s);
+        queue.Schedule("Settings",     [&writes] { writes += 1; return true; });
+        queue.Schedule("CaffeineMode", [&writes] { writes += 1; return true; });
+        CHECK(writes == 0);
+    }
+
+    CHECK(writes == 2);
+}
@@ -0,0 +1,212 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+#include "Allocations.hpp"
+#include "ProcTree.hpp"
+
+#if defined(__linux__)
+
+#include "ProcProcessSource.hpp"
+#include "ProcessSnapshot.hpp"
+#include "Scanner.hpp"
+#include "Settings.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+auto Pids (const std::vector<ProcessRecord>& records) -> std::vector<ProcessId>
+{
+    auto pids = std::vector<ProcessId>();
+    for (const auto& record : records)
+    {
+        pids.push_back(record.Pid);
+    }
+
+    std::sort(pids.begin(), pids.end());
+    return pids;
+}
+
+} // namespace
+
+// Only numeric directories are processes, start key is their inode.
+TEST("ProcProcessSource/Enumerate")
+{
+    auto tree = ProcTree(Test::MakeScratchDirectory("ProcProcessSource.Enumerate") / "proc");
+    tree.Start(1,    "/sbin/init",    "init");
+    tree.Start(42,   "/usr/bin/bash", "bash");
+    tree.Start(4000, "",              "kworker/0:1");
+
+    auto source  = ProcProcessSource(tree.GetRoot());
+    auto records = std::vector<ProcessRecord>();
+    REQUIRE(source.Enumerate(records));
+
+    CHECK((Pids(records) == std::vector<ProcessId>{ 1, 42, 4000 }));
+    for (const auto& record : records)
+    {
+        CHECK(record.StartKey != 0);
+        CHECK(record.StartKey == tree.GetStartKey(record.Pid));
+    }
+
+    // Rewound, not reopened, and same answer.
+    REQUIRE(source.Enumerate(records));
+    CHECK(records.size() == 3);
+}
+
+TEST("ProcProcessSource/MissingRoot")
+{
+    auto source  = ProcProcessSource((Test::MakeScratchDirectory("ProcProcessSource.MissingRoot") / "none").string());
+    auto records = std::vector<ProcessRecord>{ ProcessRecord{ 1, 1 } };
+    auto path    = std::wstring();
+
+    CHECK(!source.Enumerate(records));
+    CHECK(records.empty());
+    CHECK(!source.QueryImagePath(1, path));
+}
+
+TEST("ProcProcessSource/ImagePath")
+{
+    auto tree = ProcTree(Test::MakeScratchDirectory("ProcProcessSource.ImagePath") / "proc");
+    tree.Start(10, "/opt/Game/game.bin",           "game.bin");
+    tree.Start(11, "/usr/bin/updated (deleted)",   "updated");
+    tree.Start(12, "/home/user/\xc5\xbc\xc3\xb3\xc5\x82w", "zolw");
+
+    auto source = ProcProcessSource(tree.GetRoot());
+    auto path   = std::wstring();
+
+    REQUIRE(source.QueryImagePath(10, path));
+    CHECK(path == L"/opt/Game/game.bin");
+
+    // Replaced while running, suffix is not part of the path.
+    REQUIRE(source.QueryImagePath(11, path));
+    CHECK(path == L"/usr/bin/updated");
+
+    REQUIRE(source.QueryImagePath(12, path));
+    CHECK(path == L"/home/user/żółw");
+}
+
+// Exe link unreadable, name from comm still lets name triggers match.
+TEST("ProcProcessSource/CommFallback")
+{
+    auto tree = ProcTree(Test::MakeScratchDirectory("ProcProcessSource.CommFallback") / "proc");
+    tree.Start(2,  "", "kthreadd");
+    tree.Start(3,  "", "");
+    tree.Start(20, "/usr/bin/long-named-program", "long-named-prog");
+
+    auto source = ProcProcessSource(tree.GetRoot());
+    auto path   = std::wstring(L"previous");
+
+    REQUIRE(source.QueryImagePath(2, path));
+    CHECK(path == L"kthreadd");
+
+    // Neither exe nor comm, e.g. exited between listing and query.
+    CHECK(!source.QueryImagePath(3, path));
+    CHECK(!source.QueryImagePath(99, path));
+
+    // Exe wins when readable.
+    REQUIRE(source.QueryImagePath(20, path));
+    CHECK(path == L"/usr/bin/long-named-program");
+
+    auto matcher = TriggerMatcher();
+    matcher.Update({ L"kthreadd" });
+    REQUIRE(source.QueryImagePath(2, path));
+    CHECK(matcher.Match(path) != TriggerMatch::None);
+}
+
+// Same PID, new process: new start key, so snapshot queries it again.
+TEST("ProcProcessSource/PidReuse")
+{
+    auto tree = ProcTree(Test::MakeScratchDirectory("ProcProcessSource.PidReuse") / "proc");
+    tree.Start(7, "/usr/bin/editor", "editor");
+    tree.Start(8, "/usr/bin/shell",  "shell");
+
+    const auto before = tree.GetStartKey(7);
+
+    auto source   = std::make_unique<ProcProcessSource>(tree.GetRoot());
+    auto snapshot = ProcessSnapshot(std::move(source));
+    auto matcher  = TriggerMatcher();
+    matcher.Update({ L"game.exe", L"/opt/Game/game" });
+
+    REQUIRE(snapshot.Update());
+    snapshot.Classify(matcher, false);
+    CHECK(snapshot.GetMatches().empty());
+
+    tree.Reuse(7, "/opt/Game/game", "game");
+    CHECK(tree.GetStartKey(7) != before);
+
+    REQUIRE(snapshot.Update());
+    snapshot.Classify(matcher, false);
+    CHECK(snapshot.GetStats().Added == 1);
+    CHECK(snapshot.GetMatches().contains(7));
+
+    const auto entry = snapshot.Find(7);
+    REQUIRE(entry != nullptr);
+    CHECK(entry->ImagePath == L"/opt/Game/game");
+}
+
+// Steady state scans of unchanged tree touch the heap neither in the source
+// nor in the scanner on top of it.
+TEST("ProcProcessSource/NoAllocations")
+{
+    auto tree = ProcTree(Test::MakeScratchDirectory("ProcProcessSource.NoAllocations") / "proc");
+    for (auto pid = ProcessId{1}; pid <= 2000; ++pid)
+    {
+        if (pid % 10 == 0)
+        {
+            tree.Start(pid, "", "kworker/" + std::to_string(pid));
+        }
+        else
+        {
+            tree.Start(pid, "/usr/lib/app/service" + std::to_string(pid), "service");
+        }
+    }
+
+    auto scanner  = ProcessScanner(std::make_unique<ProcProcessSource>(tree.GetRoot()));
+    auto settings = std::make_shared<CaffeineTake::Settings>();
+    settings->Auto.TriggerProcess.Processes = { L"game.exe", L"/opt/Game/game" };
+
+    const auto stop     = StopToken();
+    const auto pause    = PauseToken();
+    const auto snapshot = SettingsPtr(settings);
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        CHECK(!scanner.Run(snapshot, stop, pause));
+    }
+
+    auto& counters = GetAllocationCounters();
+    const auto allocations = counters.Count.load();
+
+    for (auto i = 0; i < 20; ++i)
+    {
+        CHECK(!scanner.Run(snapshot, stop, pause));
+    }
+
+    CHECK(counters.Count.load() - allocations == 0);
+}
+
+#endif // #if defined(__linux__)
@@ -0,0 +1,278 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "ProcessSnapshot.hpp"
+#include "TriggerMatcher.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace CaffeineTake;
+
+namespace {
+
+// Process table driven by the test. Every call counts as one OS call,
+// queries can be made to fail per PID and enumeration as a whole.
+class MockProcessSource final : public ProcessSource
+{
+    struct Process
+    {
+        ProcessStartKey StartKey = 0;
+        std::wstring    Path     = std::wstring();
+        bool            Denied   = false;
+    };
+
+    std::map<ProcessId, Process> mProcesses = std::map<ProcessId, Process>();
+
+public:
+    bool          FailEnumerate = false;
+    std::uint64_t Queries       = 0;
+
+    auto Start (ProcessId pid, ProcessStartKey key, std::wstring path, bool denied = false) -> void
+    {
+        mProcesses[pid] = Process{ key, std::move(path), denied };
+    }
+
+    auto Exit (ProcessId pid) -> void
+    {
+        mProcesses.erase(pid);
+    }
+
+    auto Enumerate (std::vector<ProcessRecord>& list) -> bool override
+    {
+        mOsCalls += 1;
+        list.clear();
+
+        if (FailEnumerate)
+        {
+            return false;
+        }
+
+        for (const auto& [pid, process] : mProcesses)
+        {
+            list.push_back(ProcessRecord{ pid, process.StartKey });
+        }
+
+        return true;
+    }
+
+    auto QueryImagePath (ProcessId pid, std::wstring& path) -> bool override
+    {
+        mOsCalls += 1;
+        Queries  += 1;
+
+        const auto it = mProcesses.find(pid);
+        if (it == mProcesses.end() || it->second.Denied)
+        {
+            return false;
+        }
+
+        path.assign(it->second.Path);
+        return true;
+    }
+};
+
+struct Fixture
+{
+    MockProcessSource* Source   = nullptr; // owned by Snapshot
+    ProcessSnapshot    Snapshot = ProcessSnapshot(nullptr);
+    TriggerMatcher     Matcher  = TriggerMatcher();
+
+    Fixture ()
+    {
+        auto source = std::make_unique<MockProcessSource>();
+        Source   = source.get();
+        Snapshot = ProcessSnapshot(std::move(source));
+        Matcher.Update({ L"notepad.exe", L"C:\\Games\\Game.exe" });
+    }
+
+    auto Scan (bool all = false) -> bool
+    {
+        if (!Snapshot.Update())
+        {
+            return false;
+        }
+
+        Snapshot.Classify(Matcher, all);
+        return true;
+    }
+};
+
+} // namespace
+
+TEST("ProcessSnapshot/QueriesOnlyNewProcesses")
+{
+    auto f = Fixture();
+    f.Source->Start(4, 100, L"C:\\Windows\\explorer.exe");
+    f.Source->Start(8, 101, L"C:\\Windows\\notepad.exe");
+    f.Source->Start(12, 102, L"C:\\Games\\Game.exe");
+
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.GetStats().Processes == 3);
+    CHECK(f.Snapshot.GetStats().Added == 3);
+    CHECK(f.Snapshot.GetStats().OsCalls == 4);
+    CHECK(f.Snapshot.GetMatches().size() == 2);
+    CHECK(f.Snapshot.Find(8)->Verdict == TriggerMatch::Name);
+    CHECK(f.Snapshot.Find(12)->Verdict == TriggerMatch::Path);
+
+    // Nothing changed, only the enumeration.
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.GetStats().Added == 0);
+    CHECK(f.Snapshot.GetStats().OsCalls == 1);
+    CHECK(f.Source->Queries == 3);
+    CHECK(f.Snapshot.GetMatches().size() == 2);
+
+    f.Source->Start(16, 103, L"C:\\Tools\\tool.exe");
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.GetAdded() == std::vector<ProcessId>{ 16 });
+    CHECK(f.Snapshot.GetStats().OsCalls == 2);
+    CHECK(f.Snapshot.GetMatches().size() == 2);
+}
+
+TEST("ProcessSnapshot/Exit")
+{
+    auto f = Fixture();
+    f.Source->Start(4, 100, L"C:\\Windows\\explorer.exe");
+    f.Source->Start(8, 101, L"C:\\Windows\\notepad.exe");
+    REQUIRE(f.Scan());
+    REQUIRE(f.Snapshot.GetMatches().count(8) == 1);
+
+    f.Source->Exit(8);
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.GetStats().Removed == 1);
+    CHECK(f.Snapshot.GetStats().Processes == 1);
+    CHECK(f.Snapshot.Find(8) == nullptr);
+    CHECK(f.Snapshot.GetMatches().empty());
+}
+
+// Same PID, other start key: another process, path must be queried again
+// and old verdict must not stick.
+TEST("ProcessSnapshot/PidReuse")
+{
+    auto f = Fixture();
+    f.Source->Start(8, 101, L"C:\\Windows\\notepad.exe");
+    REQUIRE(f.Scan());
+    REQUIRE(f.Snapshot.GetMatches().count(8) == 1);
+
+    f.Source->Start(8, 202, L"C:\\Windows\\calc.exe");
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.GetAdded() == std::vector<ProcessId>{ 8 });
+    CHECK(f.Snapshot.GetStats().Removed == 0);
+    CHECK(f.Snapshot.Find(8)->ImagePath == L"C:\\Windows\\calc.exe");
+    CHECK(f.Snapshot.Find(8)->Verdict == TriggerMatch::None);
+    CHECK(f.Snapshot.GetMatches().empty());
+
+    f.Source->Start(8, 303, L"C:\\Games\\Game.exe");
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.Find(8)->Verdict == TriggerMatch::Path);
+    CHECK(f.Snapshot.GetMatches().count(8) == 1);
+}
+
+// Protected processes cannot be opened, they stay in the table with empty
+// path and are not asked about again.
+TEST("ProcessSnapshot/QueryFailure")
+{
+    auto f = Fixture();
+    f.Source->Start(4, 100, L"C:\\Windows\\notepad.exe", true);
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.GetStats().Processes == 1);
+    CHECK(f.Snapshot.Find(4)->ImagePath.empty());
+    CHECK(f.Snapshot.GetMatches().empty());
+
+    REQUIRE(f.Scan());
+    CHECK(f.Source->Queries == 1);
+}
+
+// Failed enumeration keeps what we knew, next good one continues from it.
+TEST("ProcessSnapshot/EnumerateFailure")
+{
+    auto f = Fixture();
+    f.Source->Start(8, 101, L"C:\\Windows\\notepad.exe");
+    REQUIRE(f.Scan());
+
+    f.Source->FailEnumerate = true;
+    CHECK(!f.Scan());
+    CHECK(f.Snapshot.GetStats().OsCalls == 1);
+    CHECK(f.Snapshot.Find(8) != nullptr);
+    CHECK(f.Snapshot.GetMatches().count(8) == 1);
+
+    f.Source->FailEnumerate = false;
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.GetStats().Added == 0);
+    CHECK(f.Source->Queries == 1);
+}
+
+// Trigger list change reclassifies every process without querying any.
+TEST("ProcessSnapshot/ReclassifyAll")
+{
+    auto f = Fixture();
+    f.Source->Start(4, 100, L"C:\\Windows\\explorer.exe");
+    f.Source->Start(8, 101, L"C:\\Windows\\notepad.exe");
+    REQUIRE(f.Scan());
+
+    f.Matcher.Update({ L"explorer.exe" });
+    REQUIRE(f.Scan(true));
+    CHECK(f.Source->Queries == 2);
+    CHECK(f.Snapshot.GetMatches().size() == 1);
+    CHECK(f.Snapshot.GetMatches().count(4) == 1);
+}
+
+// Cancelled scan updates without classifying, processes it added still get
+// their verdict from the next one.
+TEST("ProcessSnapshot/SkippedClassify")
+{
+    auto f = Fixture();
+    f.Source->Start(4, 100, L"C:\\Windows\\explorer.exe");
+    REQUIRE(f.Scan());
+
+    f.Source->Start(8, 101, L"C:\\Windows\\notepad.exe");
+    REQUIRE(f.Snapshot.Update());
+
+    f.Source->Start(12, 102, L"C:\\Games\\Game.exe");
+    REQUIRE(f.Scan());
+    CHECK(f.Source->Queries == 3);
+    CHECK(f.Snapshot.GetMatches().size() == 2);
+    CHECK(f.Snapshot.GetMatches().count(8) == 1);
+    CHECK(f.Snapshot.GetMatches().count(12) == 1);
+
+    // Back to classifying only new processes.
+    f.Source->Start(16, 103, L"C:\\Windows\\notepad.exe");
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.GetMatches().size() == 3);
+}
+
+TEST("ProcessSnapshot/Clear")
+{
+    auto f = Fixture();
+    f.Source->Start(8, 101, L"C:\\Windows\\notepad.exe");
+    REQUIRE(f.Scan());
+
+    f.Snapshot.Clear();
+    CHECK(f.Snapshot.GetEntries().empty());
+    CHECK(f.Snapshot.GetMatches().empty());
+
+    REQUIRE(f.Scan());
+    CHECK(f.Snapshot.GetStats().Added == 1);
+    CHECK(f.Source->Queries == 2);
+}
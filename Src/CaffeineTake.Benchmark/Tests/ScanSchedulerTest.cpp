@@ -0,0 +1,117 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "ScanScheduler.hpp"
+#include "Scanner.hpp"
+#include "Settings.hpp"
+
+#include <chrono>
+
+using namespace CaffeineTake;
+using namespace std::chrono_literals;
+
+namespace {
+
+const auto Cadence = ScanCadence{ 1000ms, 8000ms };
+
+} // namespace
+
+TEST("ScanScheduler/Backoff")
+{
+    auto scheduler = ScanScheduler();
+    auto now       = ScanScheduler::Clock::time_point() + 1h;
+
+    CHECK(scheduler.IsDue(ScannerKind::Usb, now));
+
+    // Misses double interval up to the limit.
+    for (const auto expected : { 1000ms, 2000ms, 4000ms, 8000ms, 8000ms })
+    {
+        scheduler.Report(ScannerKind::Usb, Cadence, false, false, now);
+        CHECK(scheduler.GetInterval(ScannerKind::Usb) == expected);
+        CHECK(!scheduler.IsDue(ScannerKind::Usb, now + expected - 1ms));
+        CHECK(scheduler.IsDue(ScannerKind::Usb, now + expected));
+        now += expected;
+    }
+
+    // Hit and first miss after it go back to base interval.
+    scheduler.Report(ScannerKind::Usb, Cadence, true, false, now);
+    CHECK(scheduler.GetInterval(ScannerKind::Usb) == 1000ms);
+    scheduler.Report(ScannerKind::Usb, Cadence, false, false, now);
+    CHECK(scheduler.GetInterval(ScannerKind::Usb) == 1000ms);
+    scheduler.Report(ScannerKind::Usb, Cadence, false, false, now);
+    CHECK(scheduler.GetInterval(ScannerKind::Usb) == 2000ms);
+
+    // Cancelled run keeps pace.
+    scheduler.Report(ScannerKind::Usb, Cadence, false, true, now);
+    CHECK(scheduler.GetInterval(ScannerKind::Usb) == 2000ms);
+    CHECK(!scheduler.IsDue(ScannerKind::Usb, now + 1999ms));
+
+    // Other scanners are not affected.
+    CHECK(scheduler.IsDue(ScannerKind::Process, now));
+}
+
+TEST("ScanScheduler/WakeReset")
+{
+    auto scheduler = ScanScheduler();
+    auto now       = ScanScheduler::Clock::time_point() + 1h;
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        scheduler.Report(ScannerKind::Usb,     Cadence, false, false, now);
+        scheduler.Report(ScannerKind::Process, Cadence, false, false, now);
+    }
+
+    scheduler.Wake(ScannerKind::Usb);
+    CHECK(scheduler.IsDue(ScannerKind::Usb, now));
+    CHECK(!scheduler.IsDue(ScannerKind::Process, now));
+
+    scheduler.Report(ScannerKind::Usb, Cadence, false, false, now);
+    CHECK(scheduler.GetInterval(ScannerKind::Usb) == 1000ms);
+
+    scheduler.Reset();
+    CHECK(scheduler.IsDue(ScannerKind::Process, now));
+}
+
+TEST("ScanScheduler/Cadence")
+{
+    auto settings = Settings();
+    settings.Auto.ScanInterval                  = 2000;
+    settings.Auto.TriggerProcess.ScanInterval    = 0;
+    settings.Auto.TriggerProcess.MaxScanInterval = 0;
+    settings.Auto.TriggerUsb.ScanInterval        = 500;
+    settings.Auto.TriggerUsb.MaxScanInterval     = 16000;
+    settings.Auto.TriggerBluetooth.ScanInterval  = 0;
+
+    const auto process = GetScanCadence(settings, ScannerKind::Process);
+    CHECK(process.Interval == 2000ms);
+    CHECK(process.MaxInterval == 2000ms);
+
+    const auto usb = GetScanCadence(settings, ScannerKind::Usb);
+    CHECK(usb.Interval == 500ms);
+    CHECK(usb.MaxInterval == 16000ms);
+
+    // Nothing wakes Bluetooth scanner when paired device connects, it
+    // must not back off.
+    const auto bluetooth = GetScanCadence(settings, ScannerKind::Bluetooth);
+    CHECK(bluetooth.Interval == 2000ms);
+    CHECK(bluetooth.MaxInterval == 2000ms);
+}
@@ -0,0 +1,439 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+#include "Allocations.hpp"
+
+#include "ScanScheduler.hpp"
+#include "Scanner.hpp"
+#include "Settings.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace std::chrono_literals;
+
+namespace {
+
+class FakeScanner final : public Scanner
+{
+public:
+    std::atomic<bool> Result = false;
+    std::atomic<bool> Block  = false;   // run until cancelled
+    std::atomic<bool> Stuck  = false;   // run until cleared, deaf to cancel
+    std::atomic<int>  Runs   = 0;
+
+    auto Run (SettingsPtr, const StopToken& stop, const PauseToken&) -> bool override
+    {
+        Runs += 1;
+
+        while ((Block && !stop) || Stuck)
+        {
+            std::this_thread::sleep_for(100us);
+        }
+
+        return Result;
+    }
+};
+
+// Fixed process table, nothing starts or exits between scans.
+class ScriptedProcessSource final : public ProcessSource
+{
+public:
+    std::vector<std::pair<ProcessRecord, std::wstring>> Processes = {};
+
+    auto Enumerate (std::vector<ProcessRecord>& list) -> bool override
+    {
+        mOsCalls += 1;
+        list.clear();
+
+        for (const auto& [record, path] : Processes)
+        {
+            list.push_back(record);
+        }
+
+        return true;
+    }
+
+    auto QueryImagePath (ProcessId pid, std::wstring& path) -> bool override
+    {
+        mOsCalls += 1;
+
+        for (const auto& [record, imagePath] : Processes)
+        {
+            if (record.Pid == pid)
+            {
+                path.assign(imagePath);
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+// Fixed list of windows, visited in order.
+class ScriptedWindowSource final : public WindowSource
+{
+public:
+    std::vector<std::pair<ProcessId, std::wstring>> Windows = {};
+
+    auto Enumerate (const Visitor& visitor) -> bool override
+    {
+        mOsCalls += 1;
+
+        for (const auto& [pid, title] : Windows)
+        {
+            mOsCalls += 1;
+
+            const auto result = visitor(pid, title);
+            if (result != ScanResult::Continue)
+            {
+                return result == ScanResult::Success;
+            }
+        }
+
+        return false;
+    }
+};
+
+struct Fixture
+{
+    SettingsPtr                Settings  = nullptr;
+    ScanScheduler              Scheduler = ScanScheduler();
+    std::array<FakeScanner, 3> Scanners   = {};
+    std::array<ScannerSlot, 3> Slots      = {
+        ScannerSlot("Process", ScannerKind::Process, Scanners[0]),
+        ScannerSlot("Window",  ScannerKind::Window,  Scanners[1]),
+        ScannerSlot("Usb",     ScannerKind::Usb,     Scanners[2]),
+    };
+    std::array<ScannerSlot*, 3> Active   = { &Slots[0], &Slots[1], &Slots[2] };
+    const PauseToken            Pause    = PauseToken();
+    std::mutex                  Mutex;
+    std::condition_variable     DoneCV;
+    int                         Reports  = 0;
+    bool                        Result   = false;
+
+    // Captures only this, callback fits std::function without allocating.
+    ScanTick                    Tick     = ScanTick(Scheduler, [this] (bool result) { OnDone(result); });
+
+    Fixture ()
+    {
+        auto settings = std::make_shared<CaffeineTake::Settings>();
+        settings->Auto.ScanInterval = 1;
+        Settings = std::move(settings);
+    }
+
+    auto OnDone (bool result) -> void
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(Mutex);
+        Reports += 1;
+        Result   = result;
+        DoneCV.notify_all();
+    }
+
+    // Every scanner due, as after Reset or long enough idle.
+    auto Begin () -> void
+    {
+        Scheduler.Reset();
+        Tick.Begin(Active, Settings, Pause);
+    }
+
+    // Begins round and waits for its result, expiring it after deadline as
+    // next timer tick would.
+    auto Run (std::chrono::milliseconds deadline = 10000ms) -> bool
+    {
+        auto reports = 0;
+        {
+            auto lockGuard = std::lock_guard<std::mutex>(Mutex);
+            reports = Reports;
+        }
+
+        Begin();
+
+        auto waitLock = std::unique_lock<std::mutex>(Mutex);
+        if (!DoneCV.wait_for(waitLock, deadline, [&] { return Reports != reports; }))
+        {
+            waitLock.unlock();
+            Tick.Expire();
+            waitLock.lock();
+        }
+
+        CHECK(Reports == reports + 1);
+        return Result;
+    }
+
+    auto WaitIdle () -> void
+    {
+        for (auto& slot : Slots)
+        {
+            slot.WaitIdle();
+        }
+    }
+};
+
+} // namespace
+
+TEST("ScanTick/AllMiss")
+{
+    auto f = Fixture();
+    CHECK(!f.Run());
+
+    f.WaitIdle();
+    for (auto& scanner : f.Scanners)
+    {
+        CHECK(scanner.Runs == 1);
+    }
+}
+
+// First hit ends tick and cancels the rest, cancelled miss doesn't
+// overwrite last result.
+TEST("ScanTick/FirstHit")
+{
+    auto f = Fixture();
+    f.Scanners[0].Result = true;
+    f.Scanners[1].Block  = true;
+    f.Scanners[2].Block  = true;
+
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(f.Run());
+    CHECK(std::chrono::steady_clock::now() - start < 5s);
+
+    f.WaitIdle();
+    CHECK(f.Slots[0].LastResult);
+    CHECK(!f.Slots[1].LastResult);
+    CHECK(!f.Slots[2].LastResult);
+}
+
+// Scanner that outlives its tick is skipped by the next one, then reports
+// through LastResult only.
+TEST("ScanTick/Late")
+{
+    auto f = Fixture();
+    f.Scanners[1].Stuck = true;
+
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(!f.Run(20ms));
+    CHECK(std::chrono::steady_clock::now() - start >= 20ms);
+    CHECK(f.Slots[1].Busy);
+
+    CHECK(!f.Run());
+    CHECK(f.Scanners[0].Runs == 2);
+    CHECK(f.Scanners[1].Runs == 1);
+
+    // Finishes into a tick long gone.
+    f.Scanners[1].Result = true;
+    f.Scanners[1].Stuck  = false;
+    f.Slots[1].WaitIdle();
+    CHECK(f.Slots[1].LastResult);
+
+    CHECK(f.Run());
+    CHECK(f.Scanners[1].Runs == 2);
+}
+
+// Cancel reaches the scanner and drops the round, nothing is reported.
+TEST("ScanTick/Stop")
+{
+    auto f = Fixture();
+    f.Scanners[0].Block = true;
+
+    f.Begin();
+    while (f.Scanners[0].Runs == 0)
+    {
+        std::this_thread::sleep_for(100us);
+    }
+
+    f.Tick.Cancel();
+    f.Slots[0].WaitIdle();
+    f.Tick.Expire();
+
+    CHECK(!f.Slots[0].LastResult);
+
+    auto lockGuard = std::lock_guard<std::mutex>(f.Mutex);
+    CHECK(f.Reports == 0);
+}
+
+// Round ends from the last scanner returning, no thread waits for it.
+TEST("ScanTick/Begin")
+{
+    auto f = Fixture();
+    f.Scanners[2].Block = true;
+
+    f.Begin();
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(f.Mutex);
+        CHECK(f.Reports == 0);
+    }
+
+    f.Scanners[2].Result = true;
+    f.Scanners[2].Block  = false;
+    f.WaitIdle();
+
+    auto waitLock = std::unique_lock<std::mutex>(f.Mutex);
+    CHECK(f.DoneCV.wait_for(waitLock, 5s, [&] { return f.Reports == 1; }));
+    CHECK(f.Result);
+}
+
+// Done callback that waits on the thread cancelling the tick, as AutoMode's
+// sends to main thread while main thread stops the mode, must not deadlock.
+TEST("ScanTick/CancelDuringReport")
+{
+    auto scanner = FakeScanner();
+    scanner.Result = true;
+
+    auto slot      = ScannerSlot("Process", ScannerKind::Process, scanner);
+    auto active    = std::array<ScannerSlot*, 1>{ &slot };
+    auto scheduler = ScanScheduler();
+    auto pause     = PauseToken();
+    auto settings  = std::make_shared<CaffeineTake::Settings>();
+    settings->Auto.ScanInterval = 1;
+
+    auto mutex    = std::mutex();
+    auto cv       = std::condition_variable();
+    auto entered  = false;
+    auto served   = false;
+    auto returned = false;
+    auto timedOut = false;
+
+    auto tick = ScanTick(
+        scheduler,
+        [&] (bool)
+        {
+            auto waitLock = std::unique_lock<std::mutex>(mutex);
+            entered = true;
+            cv.notify_all();
+
+            timedOut = !cv.wait_for(waitLock, 5s, [&] { return served; });
+            returned = true;
+            cv.notify_all();
+        }
+    );
+
+    // Stands for main thread, it serves the callback only after Cancel.
+    auto mainThread = std::thread(
+        [&]
+        {
+            {
+                auto waitLock = std::unique_lock<std::mutex>(mutex);
+                cv.wait(waitLock, [&] { return entered; });
+            }
+
+            tick.Cancel();
+
+            auto lockGuard = std::lock_guard<std::mutex>(mutex);
+            served = true;
+            cv.notify_all();
+        }
+    );
+
+    scheduler.Reset();
+    tick.Begin(active, settings, pause);
+    mainThread.join();
+
+    auto waitLock = std::unique_lock<std::mutex>(mutex);
+    cv.wait(waitLock, [&] { return returned; });
+    CHECK(!timedOut);
+}
+
+// Slots, their tasks and the pool queue are reused, steady state tick
+// doesn't touch the heap on any thread.
+TEST("ScanTick/NoAllocations")
+{
+    auto f = Fixture();
+    for (auto i = 0; i < 3; ++i)
+    {
+        f.Run();
+        f.WaitIdle();
+    }
+
+    auto& counters = Benchmark::GetAllocationCounters();
+    const auto before = counters.Count.load();
+
+    for (auto i = 0; i < 100; ++i)
+    {
+        f.Run();
+        f.WaitIdle();
+    }
+
+    CHECK(counters.Count.load() - before == 0);
+}
+
+// Same for the real process and window scanners, source visitors and
+// matchers included, once their caches are warm.
+TEST("ScanTick/NoAllocationsRealScanners")
+{
+    auto processSource = std::make_unique<ScriptedProcessSource>();
+    for (auto pid = ProcessId{4}; pid < 400; pid += 4)
+    {
+        processSource->Processes.emplace_back(
+            ProcessRecord{ pid, pid * 1000ull },
+            L"C:\\Program Files\\Vendor\\Service" + std::to_wstring(pid) + L".exe"
+        );
+    }
+
+    auto windowSource = std::make_unique<ScriptedWindowSource>();
+    for (auto pid = ProcessId{4}; pid < 400; pid += 8)
+    {
+        windowSource->Windows.emplace_back(pid, L"Untitled - Document " + std::to_wstring(pid));
+    }
+
+    auto processScanner = ProcessScanner(std::move(processSource));
+    auto windowScanner  = WindowScanner(std::move(windowSource));
+    auto processSlot    = ScannerSlot("Process", ScannerKind::Process, processScanner);
+    auto windowSlot     = ScannerSlot("Window",  ScannerKind::Window,  windowScanner);
+
+    auto f = Fixture();
+    f.Active = { &processSlot, &windowSlot, &f.Slots[2] };
+
+    auto settings = std::make_shared<CaffeineTake::Settings>(*f.Settings);
+    settings->Auto.TriggerProcess.Processes = { L"game.exe", L"C:\\Games\\Other.exe" };
+    settings->Auto.TriggerWindow.Windows    = { L"Game", L"glob:*Launcher*", L"glob:Movie ?" };
+    f.Settings = std::move(settings);
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        CHECK(!f.Run());
+        f.WaitIdle();
+        processSlot.WaitIdle();
+        windowSlot.WaitIdle();
+    }
+
+    auto& counters = Benchmark::GetAllocationCounters();
+    const auto before = counters.Count.load();
+
+    for (auto i = 0; i < 100; ++i)
+    {
+        CHECK(!f.Run());
+        f.WaitIdle();
+        processSlot.WaitIdle();
+        windowSlot.WaitIdle();
+    }
+
+    CHECK(counters.Count.load() - before == 0);
+}
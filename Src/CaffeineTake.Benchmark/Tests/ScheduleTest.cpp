@@ -0,0 +1,377 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+#include "Reference.hpp"
+
+#include "LocalClock.hpp"
+#include "Schedule.hpp"
+#include "ThreadTimer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr auto Day  = ScheduleEvaluator::SecondsPerDay;
+constexpr auto Week = ScheduleEvaluator::SecondsPerWeek;
+
+// 1970-01-05 was a Monday, second of week 0.
+const auto Monday = std::chrono::local_seconds(std::chrono::days(4));
+
+constexpr auto Sunday = static_cast<DaysOfWeek>(0x40);
+
+// In 2024 New York clocks went 2:00 -> 3:00 on March 10 at 7:00 UTC and
+// 2:00 -> 1:00 on November 3 at 6:00 UTC.
+const auto SpringForward = std::chrono::sys_days(std::chrono::year(2024) / std::chrono::March / 10) + std::chrono::hours(7);
+const auto FallBack      = std::chrono::sys_days(std::chrono::year(2024) / std::chrono::November / 3) + std::chrono::hours(6);
+
+auto NewYork () -> const std::chrono::time_zone*
+{
+    return std::chrono::locate_zone("America/New_York");
+}
+
+// Result of every second in window, walked backwards to find where it next
+// flips, against NextTransition() from each minute in it. Transitions past
+// window end are only checked to be past it.
+auto CountWalkMismatches (const ScheduleEvaluator& evaluator, std::chrono::sys_seconds begin, std::chrono::hours length) -> int
+{
+    const auto count = static_cast<size_t>(std::chrono::seconds(length).count());
+    const auto end   = begin + std::chrono::seconds(count);
+
+    auto active = std::vector<bool>(count + 1);
+    for (auto i = size_t{0}; i <= count; ++i)
+    {
+        active[i] = evaluator.IsActive(begin + std::chrono::seconds(i));
+    }
+
+    // Next flip after each second, 0 if none in window.
+    auto flip = std::vector<size_t>(count + 1, 0);
+    for (auto i = count; i-- > 0; )
+    {
+        flip[i] = active[i + 1] != active[i] ? i + 1 : flip[i + 1];
+    }
+
+    auto mismatches = 0;
+    for (auto i = size_t{0}; i < count; i += 60)
+    {
+        const auto next = evaluator.NextTransition(begin + std::chrono::seconds(i));
+        if (flip[i] != 0)
+        {
+            mismatches += next != begin + std::chrono::seconds(flip[i]);
+        }
+        else
+        {
+            mismatches += next && next.value() <= end;
+        }
+    }
+
+    return mismatches;
+}
+
+template <typename Predicate>
+auto WaitUntil (Predicate predicate, std::chrono::milliseconds timeout = 5000ms) -> bool
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!predicate())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+
+        std::this_thread::sleep_for(1ms);
+    }
+
+    return true;
+}
+
+// Ranges often touch day edges and each other, where merging goes wrong.
+auto MakeSchedule (std::mt19937& random, size_t entries) -> std::vector<ScheduleEntry>
+{
+    auto second = std::uniform_int_distribution<unsigned int>(0, Day - 1);
+    auto days   = std::uniform_int_distribution<unsigned int>(0, 0x7f);
+    auto ranges = std::uniform_int_distribution<int>(0, 4);
+    auto edge   = std::uniform_int_distribution<int>(0, 3);
+
+    auto schedule = std::vector<ScheduleEntry>();
+    for (auto i = size_t{0}; i < entries; ++i)
+    {
+        auto entry = ScheduleEntry{ L"Random", static_cast<DaysOfWeek>(days(random)), {} };
+
+        const auto count = ranges(random);
+        for (auto j = 0; j < count; ++j)
+        {
+            auto begin = second(random);
+            auto end   = second(random);
+            if (begin > end)
+            {
+                std::swap(begin, end);
+            }
+
+            switch (edge(random))
+            {
+                case 0: begin = 0;       break;
+                case 1: end   = Day - 1; break;
+                default:                 break;
+            }
+
+            entry.ActiveHours.push_back(TimeRange{ begin, end });
+        }
+
+        schedule.push_back(std::move(entry));
+    }
+
+    return schedule;
+}
+
+} // namespace
+
+// Every second of a week, compiled intervals against the lookup they
+// replaced.
+TEST("ScheduleEvaluator/MatchesReference")
+{
+    auto random = std::mt19937(10);
+
+    for (const auto entries : { 0, 1, 2, 5, 20, 300 })
+    {
+        const auto schedule  = MakeSchedule(random, entries);
+        const auto evaluator = ScheduleEvaluator(schedule);
+
+        auto mismatches = 0;
+        for (auto second = std::uint32_t{0}; second < Week; ++second)
+        {
+            const auto expected = Reference::CheckSchedule(schedule, Monday + std::chrono::seconds(second));
+            if (evaluator.IsActive(second) != expected)
+            {
+                mismatches += 1;
+            }
+        }
+
+        CHECK(mismatches == 0);
+    }
+}
+
+// Same through time points and local time zone, against the linear scan
+// Schedule::CheckSchedule still does.
+TEST("ScheduleEvaluator/MatchesCheckSchedule")
+{
+    auto random = std::mt19937(11);
+
+    const auto schedule  = MakeSchedule(random, 20);
+    const auto evaluator = ScheduleEvaluator(schedule);
+
+    const auto start = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+
+    auto mismatches = 0;
+    for (auto second = std::uint32_t{0}; second < Week; ++second)
+    {
+        const auto time = start + std::chrono::seconds(second);
+        if (evaluator.IsActive(time) != Schedule::CheckSchedule(schedule, time))
+        {
+            mismatches += 1;
+        }
+    }
+
+    CHECK(mismatches == 0);
+}
+
+// Next transition is the first second at which result flips, found here by
+// walking forward.
+TEST("ScheduleEvaluator/NextTransition")
+{
+    auto random = std::mt19937(12);
+    auto offset = std::uniform_int_distribution<std::uint32_t>(0, Week - 1);
+
+    const auto start = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+
+    for (const auto entries : { 0, 1, 3, 8 })
+    {
+        const auto schedule  = MakeSchedule(random, entries);
+        const auto evaluator = ScheduleEvaluator(schedule);
+
+        for (auto i = 0; i < 20; ++i)
+        {
+            const auto time   = start + std::chrono::seconds(offset(random));
+            const auto active = evaluator.IsActive(time);
+
+            auto expected = std::optional<std::chrono::system_clock::time_point>();
+            for (auto second = 1u; second <= Week; ++second)
+            {
+                if (evaluator.IsActive(time + std::chrono::seconds(second)) != active)
+                {
+                    expected = time + std::chrono::seconds(second);
+                    break;
+                }
+            }
+
+            const auto next = evaluator.NextTransition(time);
+            CHECK(next.has_value() == expected.has_value());
+            if (next && expected)
+            {
+                CHECK(next.value() == expected.value());
+            }
+        }
+    }
+}
+
+TEST("ScheduleEvaluator/Update")
+{
+    auto random = std::mt19937(13);
+
+    const auto schedule  = MakeSchedule(random, 5);
+    auto       evaluator = ScheduleEvaluator();
+
+    CHECK(!evaluator.IsActive(std::uint32_t{0}));
+    CHECK(evaluator.Update(schedule));
+    CHECK(!evaluator.Update(schedule));
+
+    auto changed = schedule;
+    changed.push_back(ScheduleEntry{ L"All", static_cast<DaysOfWeek>(0x7f), { TimeRange{ 0, Day - 1 } } });
+    CHECK(evaluator.Update(changed));
+    CHECK(evaluator.IsActive(Week - 1));
+    CHECK(evaluator.GetIntervalCount() == 1);
+}
+
+// Local time skipped by spring forward maps to the shift itself, range
+// beginning or ending in the gap flips there.
+TEST("ScheduleEvaluator/SpringForward")
+{
+    using namespace std::chrono;
+
+    auto clock = LocalClock(NewYork());
+
+    const auto begins = ScheduleEvaluator({ ScheduleEntry{ L"Gap", Sunday, { TimeRange{ 9000, 17999 } } } }, clock);
+    CHECK(!begins.IsActive(SpringForward - 1s));
+    CHECK(begins.IsActive(SpringForward));
+    CHECK(begins.NextTransition(SpringForward - 2h) == SpringForward);
+    CHECK(begins.NextTransition(SpringForward) == SpringForward + 2h);   // 5:00 EDT
+    CHECK(CountWalkMismatches(begins, SpringForward - 6h, 12h) == 0);
+
+    const auto ends = ScheduleEvaluator({ ScheduleEntry{ L"Night", Sunday, { TimeRange{ 3600, 7199 } } } }, clock);
+    CHECK(ends.NextTransition(SpringForward - 2h) == SpringForward - 1h);   // 1:00 EST
+    CHECK(ends.NextTransition(SpringForward - 1h) == SpringForward);
+    CHECK(!ends.IsActive(SpringForward));
+    CHECK(CountWalkMismatches(ends, SpringForward - 6h, 12h) == 0);
+}
+
+// Local time repeated by fall back is in schedule both times, earliest
+// occurrence comes first and the shift flips result when repeated hour
+// starts inside a range.
+TEST("ScheduleEvaluator/FallBack")
+{
+    using namespace std::chrono;
+
+    auto clock = LocalClock(NewYork());
+
+    const auto repeated = ScheduleEvaluator({ ScheduleEntry{ L"Twice", Sunday, { TimeRange{ 5400, 6299 } } } }, clock);
+    CHECK(repeated.NextTransition(FallBack - 2h) == FallBack - 30min);   // 1:30 EDT
+    CHECK(repeated.NextTransition(FallBack - 30min) == FallBack - 15min);
+    CHECK(repeated.NextTransition(FallBack - 15min) == FallBack + 30min);   // 1:30 EST
+    CHECK(repeated.NextTransition(FallBack + 30min) == FallBack + 45min);
+    CHECK(repeated.IsActive(FallBack + 30min));
+    CHECK(CountWalkMismatches(repeated, FallBack - 6h, 12h) == 0);
+
+    const auto shift = ScheduleEvaluator({ ScheduleEntry{ L"Shift", Sunday, { TimeRange{ 1800, 4499 } } } }, clock);
+    CHECK(shift.NextTransition(FallBack - 30min) == FallBack);
+    CHECK(!shift.IsActive(FallBack - 1s));
+    CHECK(shift.IsActive(FallBack));
+    CHECK(CountWalkMismatches(shift, FallBack - 6h, 12h) == 0);
+}
+
+// Timer sleeps until next transition, up to a day. Reloaded settings wake
+// it, as AutoMode::OnSettingsChange does, and it is re-armed at transition
+// of the new schedule.
+TEST("ScheduleEvaluator/ReloadRearmsTimer")
+{
+    using namespace std::chrono;
+
+    auto clock     = LocalClock(locate_zone("UTC"));
+    auto evaluator = ScheduleEvaluator(clock);
+    auto mutex     = std::mutex();
+    auto published = std::make_shared<const std::vector<ScheduleEntry>>();
+    auto compiled  = std::shared_ptr<const std::vector<ScheduleEntry>>();
+    auto runs      = std::atomic<int>(0);
+    auto active    = std::atomic<bool>(false);
+    auto timer     = std::unique_ptr<ThreadTimer>();
+
+    // Same steps as AutoMode::ScheduleTimerProc.
+    timer = std::make_unique<ThreadTimer>(
+        [&] (const StopToken&, const PauseToken&)
+        {
+            auto snapshot = std::shared_ptr<const std::vector<ScheduleEntry>>();
+            {
+                auto lock = std::lock_guard<std::mutex>(mutex);
+                snapshot = published;
+            }
+
+            if (snapshot != compiled)
+            {
+                compiled = snapshot;
+                evaluator.Update(*snapshot);
+            }
+
+            const auto now = system_clock::now();
+            active = evaluator.IsActive(now);
+            timer->SetNextInterval(evaluator.SleepTime(now, hours(24)));
+            runs += 1;
+            return true;
+        },
+        ThreadTimer::Interval(1000),
+        false,
+        true
+    );
+
+    REQUIRE(timer->Start());
+    REQUIRE(WaitUntil([&] { return runs == 1; }));
+    CHECK(!active);
+
+    // New snapshot with schedule turning on two seconds from now.
+    const auto second = (ScheduleEvaluator::SecondOfWeek(floor<seconds>(clock.LocalNow())) + 2) % Week;
+    const auto begin  = second % Day;
+    {
+        auto lock = std::lock_guard<std::mutex>(mutex);
+        published = std::make_shared<const std::vector<ScheduleEntry>>(std::vector<ScheduleEntry>{
+            ScheduleEntry{
+                L"Soon",
+                static_cast<DaysOfWeek>(1u << (second / Day)),
+                { TimeRange{ begin, std::min(begin + 60, Day - 1) } }
+            }
+        });
+    }
+
+    timer->Wake();
+    CHECK(WaitUntil([&] { return runs >= 2; }));
+    CHECK(WaitUntil([&] { return active.load(); }, 10000ms));
+    CHECK(runs >= 3);
+
+    timer->Stop();
+}
@@ -0,0 +1,41 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "Serializers.hpp"
+
+using namespace CaffeineTake;
+
+TEST("Serializers/BluetoothIdentifier")
+{
+    CHECK(BluetoothIdentifierFromString("00:1a:7d:da:71:13") == 0x001A7DDA7113ull);
+    CHECK(BluetoothIdentifierFromString("F4:5C:89:AB:01:FF") == 0xF45C89AB01FFull);
+    CHECK(BluetoothIdentifierFromString("00:00:00:00:00:0g") == 0);
+}
+
+TEST("Serializers/BluetoothIdentifier/Assign")
+{
+    auto bi = BluetoothIdentifier();
+    auto& result = (bi = 0xF45C89AB01FFull);
+
+    CHECK(&result == &bi);
+    CHECK(bi == 0xF45C89AB01FFull);
+}
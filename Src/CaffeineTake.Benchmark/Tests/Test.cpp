@@ -0,0 +1,172 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "Logger.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Test;
+
+namespace {
+
+auto gFailures = std::atomic<size_t>(0);
+auto gOutput   = std::mutex();
+
+auto GetRunDirectory () -> const std::filesystem::path&
+{
+    static const auto path = []
+    {
+        const auto name = "CaffeineTake.Tests." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        auto dir = std::filesystem::temp_directory_path() / name;
+        std::filesystem::create_directories(dir);
+        return dir;
+    }();
+
+    return path;
+}
+
+auto PrintUsage () -> void
+{
+    std::fputs(
+        "Usage: CaffeineTake.Tests [options]\n"
+        "  --filter <text>  run tests whose name contains text\n"
+        "  --list           print test names and exit\n"
+        "\n"
+        "Exit code is 1 when any test failed.\n",
+        stderr
+    );
+}
+
+} // namespace
+
+namespace CaffeineTake::Test {
+
+auto GetTests () -> std::vector<TestInfo>&
+{
+    static auto tests = std::vector<TestInfo>();
+    return tests;
+}
+
+auto Register (std::string name, TestFn body) -> bool
+{
+    GetTests().push_back(TestInfo{ std::move(name), std::move(body) });
+    return true;
+}
+
+auto ReportFailure (const char* expression, const char* file, int line) -> void
+{
+    gFailures.fetch_add(1, std::memory_order_relaxed);
+
+    auto lock = std::lock_guard<std::mutex>(gOutput);
+    std::fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", file, line, expression);
+}
+
+auto MakeScratchDirectory (std::string_view name) -> std::filesystem::path
+{
+    auto dir = GetRunDirectory() / name;
+    auto ec  = std::error_code();
+    std::filesystem::remove_all(dir, ec);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+} // namespace CaffeineTake::Test
+
+auto main (int argc, char** argv) -> int
+{
+    auto filter = std::string_view();
+    auto list   = false;
+    for (auto i = 1; i < argc; ++i)
+    {
+        const auto arg = std::string_view(argv[i]);
+        if (arg == "--list")
+        {
+            list = true;
+        }
+        else if (arg == "--filter" && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (!list)
+    {
+        InitLogger(GetRunDirectory() / "CaffeineTake.log", LogRotation{ 64 * 1024, 3, false });
+    }
+
+    auto failed = size_t{0};
+    auto ran    = size_t{0};
+    for (const auto& test : GetTests())
+    {
+        if (!filter.empty() && test.Name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        if (list)
+        {
+            std::printf("%s\n", test.Name.c_str());
+            continue;
+        }
+
+        const auto before = gFailures.load(std::memory_order_relaxed);
+        const auto begin  = std::chrono::steady_clock::now();
+
+        test.Body();
+
+        const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        const auto ok = gFailures.load(std::memory_order_relaxed) == before;
+
+        std::printf("[%s] %-56s %10.1f ms\n", ok ? "  OK  " : " FAIL ", test.Name.c_str(), ms);
+        std::fflush(stdout);
+
+        ran    += 1;
+        failed += ok ? 0 : 1;
+    }
+
+    if (list)
+    {
+        return 0;
+    }
+
+    AsyncLogger::Get().Stop();
+
+    auto ec = std::error_code();
+    std::filesystem::remove_all(GetRunDirectory(), ec);
+
+    std::printf("\n%zu of %zu tests passed\n", ran - failed, ran);
+
+    return failed == 0 ? 0 : 1;
+}
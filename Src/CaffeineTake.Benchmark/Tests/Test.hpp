@@ -0,0 +1,79 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CaffeineTake::Test {
+
+// Test body runs once, failed checks are recorded and the body goes on
+// (CHECK) or returns (REQUIRE):
+//
+//     TEST("Group/Name")
+//     {
+//         auto value = Setup();
+//         REQUIRE(value.has_value());
+//         CHECK(value.value() == 42);
+//     }
+using TestFn = std::function<void ()>;
+
+struct TestInfo
+{
+    std::string Name = std::string();
+    TestFn      Body = nullptr;
+};
+
+auto Register (std::string name, TestFn body) -> bool;
+auto GetTests () -> std::vector<TestInfo>&;
+
+// Marks running test failed, may be called from any thread.
+auto ReportFailure (const char* expression, const char* file, int line) -> void;
+
+inline auto Check (bool passed, const char* expression, const char* file, int line) -> bool
+{
+    if (!passed)
+    {
+        ReportFailure(expression, file, line);
+    }
+
+    return passed;
+}
+
+// Empty directory for files test writes, removed after the run.
+auto MakeScratchDirectory (std::string_view name) -> std::filesystem::path;
+
+} // namespace CaffeineTake::Test
+
+#define TEST_CONCAT_IMPL(_a, _b) _a##_b
+#define TEST_CONCAT(_a, _b)      TEST_CONCAT_IMPL(_a, _b)
+
+#define TEST(_name)                                                                             \
+    static auto TEST_CONCAT(_Test_, __LINE__) () -> void;                                       \
+    static const auto TEST_CONCAT(_TestRegistered_, __LINE__) =                                 \
+        ::CaffeineTake::Test::Register(_name, &TEST_CONCAT(_Test_, __LINE__));                  \
+    static auto TEST_CONCAT(_Test_, __LINE__) () -> void
+
+#define CHECK(_expr)   ::CaffeineTake::Test::Check(static_cast<bool>(_expr), #_expr, __FILE__, __LINE__)
+#define REQUIRE(_expr) do { if (!CHECK(_expr)) { return; } } while (0)
@@ -0,0 +1,249 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "ThreadTimer.hpp"
+#include "TimerService.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace CaffeineTake;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Waits until count reaches value, false on timeout.
+auto WaitFor (std::atomic<int>& count, int value, std::chrono::milliseconds timeout = 5000ms) -> bool
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (count < value)
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+
+        std::this_thread::sleep_for(1ms);
+    }
+
+    return true;
+}
+
+} // namespace
+
+TEST("TimerService/Order")
+{
+    auto& service = TimerService::Get();
+
+    auto mutex = std::mutex();
+    auto order = std::vector<int>();
+    auto ran   = std::atomic<int>(0);
+
+    // Scheduled in reverse, run by due time.
+    const auto now = TimerService::Clock::now();
+    for (auto i = 0; i < 5; ++i)
+    {
+        service.Schedule(
+            now + (5 - i) * 20ms,
+            [&, i]
+            {
+                {
+                    auto lockGuard = std::lock_guard<std::mutex>(mutex);
+                    order.push_back(i);
+                }
+                ran += 1;
+            }
+        );
+    }
+
+    REQUIRE(WaitFor(ran, 5));
+
+    auto lockGuard = std::lock_guard<std::mutex>(mutex);
+    CHECK((order == std::vector<int>{ 4, 3, 2, 1, 0 }));
+}
+
+TEST("TimerService/Cancel")
+{
+    auto& service = TimerService::Get();
+
+    auto ran = std::atomic<int>(0);
+    const auto id = service.Schedule(TimerService::Clock::now() + 20ms, [&ran] { ran += 1; });
+
+    CHECK(service.Cancel(id));
+    CHECK(!service.Cancel(id));
+
+    std::this_thread::sleep_for(60ms);
+    CHECK(ran == 0);
+
+    // Already handed to the pool.
+    const auto due = service.Schedule(TimerService::Clock::now(), [&ran] { ran += 1; });
+    REQUIRE(WaitFor(ran, 1));
+    CHECK(!service.Cancel(due));
+}
+
+// Timers rescheduled far ahead leave cancelled deadlines behind, heap must
+// not grow with them.
+TEST("TimerService/CancelCompaction")
+{
+    auto& service = TimerService::Get();
+
+    const auto before = service.GetDeadlineCount();
+    for (auto i = 0; i < 10000; ++i)
+    {
+        const auto id = service.Schedule(TimerService::Clock::now() + 1h, [] {});
+        CHECK(service.Cancel(id));
+    }
+
+    // Dead entries are dropped once they outnumber live ones.
+    CHECK(service.GetDeadlineCount() <= 2 * before + 1);
+}
+
+TEST("ThreadTimer/Periodic")
+{
+    auto runs     = std::atomic<int>(0);
+    auto inside   = std::atomic<bool>(false);
+    auto overlaps = std::atomic<int>(0);
+
+    auto timer = ThreadTimer(
+        [&] (const StopToken&, const PauseToken&)
+        {
+            if (inside.exchange(true))
+            {
+                overlaps += 1;
+            }
+
+            std::this_thread::sleep_for(2ms);
+            runs  += 1;
+            inside = false;
+            return true;
+        },
+        ThreadTimer::Interval(1)
+    );
+
+    REQUIRE(timer.Start());
+    CHECK(WaitFor(runs, 10));
+    timer.Stop();
+
+    // No callback after Stop returns.
+    const auto stopped = runs.load();
+    std::this_thread::sleep_for(20ms);
+    CHECK(runs == stopped);
+    CHECK(overlaps == 0);
+    CHECK(timer.IsStopped());
+}
+
+TEST("ThreadTimer/Wake")
+{
+    auto runs  = std::atomic<int>(0);
+    auto timer = ThreadTimer(
+        [&runs] (const StopToken&, const PauseToken&)
+        {
+            runs += 1;
+            return true;
+        },
+        ThreadTimer::Interval(3600 * 1000)
+    );
+
+    REQUIRE(timer.Start());
+    std::this_thread::sleep_for(10ms);
+    CHECK(runs == 0);
+
+    timer.Wake();
+    CHECK(WaitFor(runs, 1));
+
+    timer.Wake();
+    CHECK(WaitFor(runs, 2));
+    timer.Stop();
+}
+
+// Hot reload lowers interval of a running timer, after Wake it runs at the
+// new one instead of waiting out the old.
+TEST("ThreadTimer/SetIntervalWhileRunning")
+{
+    auto runs  = std::atomic<int>(0);
+    auto timer = ThreadTimer(
+        [&runs] (const StopToken&, const PauseToken&)
+        {
+            runs += 1;
+            return true;
+        },
+        ThreadTimer::Interval(3600 * 1000)
+    );
+
+    REQUIRE(timer.Start());
+    CHECK(!timer.SetInterval(ThreadTimer::Interval(0)));
+    CHECK(timer.SetInterval(ThreadTimer::Interval(1)));
+
+    timer.Wake();
+    CHECK(WaitFor(runs, 5));
+    timer.Stop();
+}
+
+TEST("ThreadTimer/ReturnFalse")
+{
+    auto runs  = std::atomic<int>(0);
+    auto timer = ThreadTimer(
+        [&runs] (const StopToken&, const PauseToken&)
+        {
+            runs += 1;
+            return false;
+        },
+        ThreadTimer::Interval(1),
+        false,
+        true
+    );
+
+    REQUIRE(timer.Start());
+    REQUIRE(WaitFor(runs, 1));
+
+    std::this_thread::sleep_for(20ms);
+    CHECK(runs == 1);
+    CHECK(timer.IsStopped());
+}
+
+// Stop from inside callback doesn't wait on itself.
+TEST("ThreadTimer/StopFromCallback")
+{
+    auto runs  = std::atomic<int>(0);
+    auto timer = std::unique_ptr<ThreadTimer>();
+
+    timer = std::make_unique<ThreadTimer>(
+        [&] (const StopToken&, const PauseToken&)
+        {
+            runs += 1;
+            timer->Stop();
+            return true;
+        },
+        ThreadTimer::Interval(1)
+    );
+
+    REQUIRE(timer->Start());
+    REQUIRE(WaitFor(runs, 1));
+
+    std::this_thread::sleep_for(20ms);
+    CHECK(runs == 1);
+    timer.reset();
+}
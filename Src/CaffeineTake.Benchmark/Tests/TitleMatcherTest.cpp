@@ -0,0 +1,161 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+#include "Reference.hpp"
+
+#include "TitleMatcher.hpp"
+
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace CaffeineTake;
+
+namespace {
+
+// Short strings over an alphabet heavy in glob syntax, so stars, escapes
+// and their mixes are all hit.
+auto RandomString (std::mt19937& random, size_t maxLength) -> std::wstring
+{
+    static constexpr wchar_t Alphabet[] = { L'a', L'b', L'*', L'?', L'\\' };
+
+    auto length = std::uniform_int_distribution<size_t>(0, maxLength)(random);
+    auto pick   = std::uniform_int_distribution<size_t>(0, std::size(Alphabet) - 1);
+
+    auto result = std::wstring();
+    while (length-- > 0)
+    {
+        result.push_back(Alphabet[pick(random)]);
+    }
+
+    return result;
+}
+
+} // namespace
+
+// Lowest index of a matching pattern, as trying them one by one gives.
+TEST("GlobSet/MatchesReference")
+{
+    auto random = std::mt19937(7);
+
+    for (auto round = 0; round < 200; ++round)
+    {
+        auto patterns = std::vector<std::wstring>();
+        auto globs    = GlobSet();
+        for (auto i = 0; i < 8; ++i)
+        {
+            patterns.push_back(RandomString(random, 6));
+            globs.Add(patterns.back());
+        }
+
+        for (auto i = 0; i < 50; ++i)
+        {
+            const auto input = RandomString(random, 8);
+
+            auto expected = std::optional<size_t>();
+            for (auto p = size_t{0}; p < patterns.size() && !expected; ++p)
+            {
+                if (Reference::MatchGlob(patterns[p], input))
+                {
+                    expected = p;
+                }
+            }
+
+            CHECK(globs.Match(input) == expected);
+        }
+    }
+}
+
+TEST("GlobSet/Syntax")
+{
+    const auto match = [](std::wstring_view pattern, std::wstring_view input)
+    {
+        auto globs = GlobSet();
+        globs.Add(pattern);
+        return globs.Match(input).has_value();
+    };
+
+    CHECK(match(L"*", L""));
+    CHECK(match(L"a*b", L"ab"));
+    CHECK(match(L"a*b", L"axxb"));
+    CHECK(!match(L"a*b", L"axxbc"));
+    CHECK(match(L"a?c", L"abc"));
+    CHECK(!match(L"a?c", L"ac"));
+    CHECK(match(L"a\\*", L"a*"));
+    CHECK(!match(L"a\\*", L"ab"));
+    CHECK(match(L"a\\?", L"a?"));
+    CHECK(match(L"a\\\\", L"a\\"));
+    CHECK(match(L"a\\", L"a"));
+    CHECK(!match(L"", L"a"));
+}
+
+// Thousands of patterns fill the DFA cache past its limit, answers must not
+// change when it is flushed.
+TEST("GlobSet/CacheFlush")
+{
+    auto patterns = std::vector<std::wstring>();
+    auto globs    = GlobSet();
+    for (auto i = 0; i < 3000; ++i)
+    {
+        patterns.push_back(L"*Presentation " + std::to_wstring(i) + L" *");
+        globs.Add(patterns.back());
+    }
+
+    for (auto pass = 0; pass < 2; ++pass)
+    {
+        for (auto i = 0; i < 5000; ++i)
+        {
+            const auto title = L"Quarterly Presentation " + std::to_wstring(i) + L" - Slides";
+            const auto index = globs.Match(title);
+            CHECK(i < 3000 ? index == static_cast<size_t>(i) : !index);
+        }
+    }
+}
+
+TEST("TitleMatcher/Kinds")
+{
+    auto matcher = TitleMatcher();
+    CHECK(matcher.Update({ L"Meeting", L"glob:*- Slides", L"regex:Build #\\d+", L"regex:(", L"" }));
+    CHECK(!matcher.Update({ L"Meeting", L"glob:*- Slides", L"regex:Build #\\d+", L"regex:(", L"" }));
+
+    const auto exact = matcher.Match(L"Meeting");
+    REQUIRE(exact != nullptr);
+    CHECK(*exact == L"Meeting");
+
+    // Exact match is whole title.
+    CHECK(matcher.Match(L"Meeting 2") == nullptr);
+
+    const auto glob = matcher.Match(L"Plan - Slides");
+    REQUIRE(glob != nullptr);
+    CHECK(*glob == L"glob:*- Slides");
+
+    // Regex is searched anywhere, invalid one is skipped.
+    const auto regex = matcher.Match(L"Running Build #1234 now");
+    REQUIRE(regex != nullptr);
+    CHECK(*regex == L"regex:Build #\\d+");
+
+    CHECK(matcher.Match(L"") == nullptr);
+    CHECK(matcher.Match(L"Inbox - Mail") == nullptr);
+
+    CHECK(matcher.Update({}));
+    CHECK(matcher.IsEmpty());
+}
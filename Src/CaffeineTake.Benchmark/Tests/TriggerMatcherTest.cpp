@@ -0,0 +1,127 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+#include "Reference.hpp"
+
+#include "TriggerMatcher.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace CaffeineTake;
+
+namespace {
+
+auto MakeTriggers (size_t count) -> std::vector<std::wstring>
+{
+    auto triggers = std::vector<std::wstring>{ L"", L"notepad.exe", L"C:/Tools/Slash.exe" };
+    for (auto i = size_t{0}; i < count; ++i)
+    {
+        triggers.push_back(i % 2
+            ? L"C:\\Program Files\\Vendor " + std::to_wstring(i) + L"\\App" + std::to_wstring(i) + L".exe"
+            : L"tool" + std::to_wstring(i) + L".exe"
+        );
+    }
+
+    return triggers;
+}
+
+// Full paths only, as enumeration gives. The old loop took a bare name
+// equal to a name trigger for a path match.
+auto MakePaths () -> std::vector<std::wstring>
+{
+    auto paths = std::vector<std::wstring>{
+        L"C:\\Windows\\notepad.exe",
+        L"C:\\Tools\\Slash.exe",        // other separator than trigger
+        L"C:/Tools/Slash.exe",
+        L"D:\\Games\\tool4.exe",
+        L"C:\\Program Files\\Vendor 4\\App4.exe",
+        L"C:\\Program Files\\Vendor 5\\App5.exe",
+        L"C:\\Program Files\\Vendor 5\\App5.exe.bak",
+        L"C:\\tool6.exe\\other.exe",
+    };
+
+    for (auto i = 0; i < 2000; i += 7)
+    {
+        paths.push_back(L"C:\\Program Files\\Vendor " + std::to_wstring(i) + L"\\App" + std::to_wstring(i) + L".exe");
+        paths.push_back(L"C:\\Bin\\tool" + std::to_wstring(i) + L".exe");
+    }
+
+    return paths;
+}
+
+} // namespace
+
+// Same verdict as the loop it replaced, for every trigger list size. The
+// loop stops at first trigger matching either way, so a process matching
+// one trigger by name and a later one by path is Name there and Path here.
+TEST("TriggerMatcher/MatchesReference")
+{
+    const auto paths = MakePaths();
+    for (const auto count : { size_t{10}, size_t{100}, size_t{10000} })
+    {
+        const auto triggers = MakeTriggers(count);
+
+        auto matcher = TriggerMatcher();
+        matcher.Update(triggers);
+
+        for (const auto& path : paths)
+        {
+            const auto expected = Reference::MatchProcess(triggers, path);
+            const auto actual   = matcher.Match(path);
+
+            CHECK((expected == TriggerMatch::None) == (actual == TriggerMatch::None));
+            CHECK(expected != TriggerMatch::Path || actual == TriggerMatch::Path);
+            CHECK(actual != TriggerMatch::Name || expected == TriggerMatch::Name);
+        }
+    }
+}
+
+TEST("TriggerMatcher/Update")
+{
+    auto matcher = TriggerMatcher();
+    CHECK(matcher.IsEmpty());
+    CHECK(matcher.Match(L"C:\\Windows\\notepad.exe") == TriggerMatch::None);
+
+    CHECK(matcher.Update({ L"notepad.exe" }));
+    CHECK(!matcher.Update({ L"notepad.exe" }));
+    CHECK(matcher.Match(L"C:\\Windows\\notepad.exe") == TriggerMatch::Name);
+
+    CHECK(matcher.Update({ L"C:\\Windows\\notepad.exe" }));
+    CHECK(matcher.Match(L"C:\\Windows\\notepad.exe") == TriggerMatch::Path);
+    CHECK(matcher.Match(L"D:\\notepad.exe") == TriggerMatch::None);
+
+    CHECK(matcher.Update({}));
+    CHECK(matcher.IsEmpty());
+}
+
+#if defined(_WIN32)
+
+TEST("TriggerMatcher/CaseInsensitive")
+{
+    auto matcher = TriggerMatcher();
+    matcher.Update({ L"NotePad.EXE", L"C:\\Program Files\\App\\App.exe" });
+
+    CHECK(matcher.Match(L"c:\\windows\\NOTEPAD.exe") == TriggerMatch::Name);
+    CHECK(matcher.Match(L"C:\\PROGRAM FILES\\app\\app.EXE") == TriggerMatch::Path);
+}
+
+#endif
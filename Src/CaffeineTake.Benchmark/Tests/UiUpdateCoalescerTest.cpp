@@ -0,0 +1,188 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "CaffeineState.hpp"
+#include "UiUpdateCoalescer.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+using namespace CaffeineTake;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Clock = UiUpdateCoalescer::Clock;
+
+// CaffeineApp's execution state path without the window: UpdateExecutionState
+// applies state at once and requests refresh, main thread flushes when timer
+// it scheduled fires, refresh notifies only about state not announced yet.
+struct App
+{
+    CaffeineState                 State      = CaffeineState::Inactive;
+    CaffeineState                 Shown      = CaffeineState::Inactive;
+    std::uint64_t                 Refreshes  = 0;
+    std::uint64_t                 Balloons   = 0;
+    std::uint64_t                 Sounds     = 0;
+    UiNotifyFilter<CaffeineState> Notified   = UiNotifyFilter<CaffeineState>();
+    UiUpdateCoalescer             UiUpdates  = UiUpdateCoalescer([this] { UpdateUi(); });
+    Clock::time_point             FlushAt    = Clock::time_point::max();   // scheduled timer, none if max
+
+    auto UpdateExecutionState (CaffeineState state, Clock::time_point now) -> void
+    {
+        if (State == state)
+        {
+            return;
+        }
+
+        State = state;
+
+        if (UiUpdates.Request(now))
+        {
+            FlushAt = UiUpdates.GetDue();
+        }
+    }
+
+    // Timer message reaching main thread.
+    auto Tick (Clock::time_point now) -> void
+    {
+        if (now < FlushAt)
+        {
+            return;
+        }
+
+        FlushAt = Clock::time_point::max();
+        if (!UiUpdates.Flush(now) && UiUpdates.IsPending())
+        {
+            FlushAt = UiUpdates.GetDue();
+        }
+    }
+
+    auto UpdateUi () -> void
+    {
+        Refreshes += 1;
+        Shown      = State;
+
+        if (Notified.Notify(State))
+        {
+            Balloons += 1;
+            Sounds   += 1;
+        }
+    }
+};
+
+auto Toggle (CaffeineState state) -> CaffeineState
+{
+    return state == CaffeineState::Active ? CaffeineState::Inactive : CaffeineState::Active;
+}
+
+} // namespace
+
+// Trigger flapping 1000 times a second for a second, UI work stays at one
+// refresh per window and ends on the last state.
+TEST("UiUpdateCoalescer/Toggle1000Hz")
+{
+    auto app = App();
+    auto now = Clock::time_point() + 1s;
+
+    // Settle on Inactive first, as at startup.
+    app.UiUpdates.Request(now);
+    app.FlushAt = app.UiUpdates.GetDue();
+    now += 1s;
+    app.Tick(now);
+
+    const auto refreshes = app.Refreshes;
+    const auto start     = now;
+
+    for (auto i = 0; i < 1000; ++i)
+    {
+        now += 1ms;
+        app.UpdateExecutionState(Toggle(app.State), now);
+        app.Tick(now);
+    }
+
+    // Burst is over, let last window end.
+    now += UiUpdateCoalescer::DefaultWindow;
+    app.Tick(now);
+
+    const auto windows = (now - start) / UiUpdateCoalescer::DefaultWindow;
+    CHECK(app.Refreshes - refreshes <= static_cast<std::uint64_t>(windows) + 1);
+    CHECK(app.Refreshes - refreshes > 0);
+    CHECK(!app.UiUpdates.IsPending());
+    CHECK(app.Shown == app.State);
+}
+
+// Odd number of toggles, last state requested is the one shown.
+TEST("UiUpdateCoalescer/LastStateShown")
+{
+    auto app = App();
+    auto now = Clock::time_point() + 1s;
+
+    for (auto i = 0; i < 7; ++i)
+    {
+        now += 1ms;
+        app.UpdateExecutionState(Toggle(app.State), now);
+        app.Tick(now);
+    }
+
+    CHECK(app.State == CaffeineState::Active);
+
+    now += UiUpdateCoalescer::DefaultWindow;
+    app.Tick(now);
+
+    CHECK(app.Refreshes == 1);
+    CHECK(app.Shown == CaffeineState::Active);
+    CHECK(app.Balloons == 1);
+    CHECK(app.Sounds == 1);
+}
+
+// Burst inside one window that ends where it started refreshes the icon but
+// doesn't announce anything.
+TEST("UiUpdateCoalescer/SilentRoundTrip")
+{
+    auto app = App();
+    auto now = Clock::time_point() + 1s;
+
+    app.UpdateExecutionState(CaffeineState::Active, now);
+    now += UiUpdateCoalescer::DefaultWindow;
+    app.Tick(now);
+
+    CHECK(app.Balloons == 1);
+    CHECK(app.Sounds == 1);
+
+    for (auto i = 0; i < 10; ++i)
+    {
+        now += 1ms;
+        app.UpdateExecutionState(Toggle(app.State), now);
+        app.Tick(now);
+    }
+
+    CHECK(app.State == CaffeineState::Active);
+
+    now += UiUpdateCoalescer::DefaultWindow;
+    app.Tick(now);
+
+    CHECK(app.Refreshes == 2);
+    CHECK(app.Shown == CaffeineState::Active);
+    CHECK(app.Balloons == 1);
+    CHECK(app.Sounds == 1);
+}
@@ -0,0 +1,54 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.hpp"
+
+#include "Utility.hpp"
+
+#include <string>
+
+using namespace CaffeineTake;
+
+TEST("Unicode/RoundTrip")
+{
+    const auto text = std::string("Za\xC5\xBC\xC3\xB3\xC5\x82\xC4\x87 \xE2\x80\x94 \xE6\x97\xA5\xE6\x9C\xAC \xF0\x9F\x98\x80 - Notepad");
+
+    const auto wide = UTF8ToUTF16(text);
+    REQUIRE(wide.has_value());
+
+    const auto back = UTF16ToUTF8(wide.value());
+    REQUIRE(back.has_value());
+    CHECK(back.value() == text);
+
+    // Reusing out buffer gives same result as fresh one.
+    auto out = std::wstring(L"previous content");
+    CHECK(UTF8ToUTF16(text, out));
+    CHECK(out == wide.value());
+}
+
+// Empty input is an error, malformed sequences become U+FFFD like on Windows.
+TEST("Unicode/Invalid")
+{
+    CHECK(!UTF8ToUTF16("").has_value());
+
+    const auto wide = UTF8ToUTF16("\xC3\x28");
+    REQUIRE(wide.has_value());
+    CHECK(wide.value() == std::wstring(L"\xFFFD("));
+}
@@ -0,0 +1,115 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+
+#include "ThreadTimer.hpp"
+#include "TimerService.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+auto Idle (const StopToken&, const PauseToken&) -> bool
+{
+    return true;
+}
+
+} // namespace
+
+// Timer that never fires while running, cost of arming and disarming it.
+BENCHMARK("ThreadTimer/StartStop")
+{
+    auto timer = ThreadTimer(Idle, ThreadTimer::Interval(1000));
+    for (auto _ : state)
+    {
+        timer.Start();
+        timer.Stop();
+    }
+}
+
+// Callback runs right after Start, Stop waits for it, so this includes
+// handing work to the timer thread and back.
+BENCHMARK("ThreadTimer/StartStop/Immediate")
+{
+    auto fired = std::atomic<std::uint32_t>(0);
+    auto timer = ThreadTimer(
+        [&fired](const StopToken&, const PauseToken&)
+        {
+            fired.fetch_add(1, std::memory_order_release);
+            fired.notify_one();
+            return true;
+        },
+        ThreadTimer::Interval(1000),
+        false,
+        true
+    );
+
+    for (auto _ : state)
+    {
+        const auto before = fired.load(std::memory_order_acquire);
+        timer.Start();
+        fired.wait(before, std::memory_order_acquire);
+        timer.Stop();
+    }
+}
+
+// From Wake() until callback runs on worker thread.
+BENCHMARK("ThreadTimer/WakeLatency")
+{
+    auto fired = std::atomic<std::uint32_t>(0);
+    auto timer = ThreadTimer(
+        [&fired](const StopToken&, const PauseToken&)
+        {
+            fired.fetch_add(1, std::memory_order_release);
+            fired.notify_one();
+            return true;
+        },
+        ThreadTimer::Interval(1000)
+    );
+    timer.Start();
+
+    for (auto _ : state)
+    {
+        const auto before = fired.load(std::memory_order_acquire);
+        timer.Wake();
+        fired.wait(before, std::memory_order_acquire);
+    }
+
+    timer.Stop();
+}
+
+// Cancelled deadlines are dropped once they outnumber live ones, cost of
+// compaction is spread over the cancels.
+BENCHMARK("TimerService/ScheduleCancel")
+{
+    auto& service = TimerService::Get();
+
+    for (auto _ : state)
+    {
+        const auto id = service.Schedule(TimerService::Clock::now() + std::chrono::milliseconds(100), [] {});
+        DoNotOptimize(service.Cancel(id));
+    }
+}
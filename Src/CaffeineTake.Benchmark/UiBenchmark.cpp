@@ -0,0 +1,65 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+#include "Benchmark.hpp"
+
+#include "UiUpdateCoalescer.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+// Trigger toggling 1000 times a second on simulated clock, flush timer
+// firing when due as it does on main thread. One iteration is one toggle.
+// Bound and final state are checked by UiUpdateCoalescer tests.
+BENCHMARK("UI/Coalescer/Toggle1000Hz")
+{
+    using Clock = UiUpdateCoalescer::Clock;
+
+    constexpr auto Step = std::chrono::milliseconds(1);
+
+    auto isActive = false;
+    auto isShown  = false;
+    auto coalescer = UiUpdateCoalescer(
+        [&]
+        {
+            isShown = isActive;
+        }
+    );
+
+    auto now = Clock::time_point();
+    for (auto _ : state)
+    {
+        now     += Step;
+        isActive = !isActive;
+        coalescer.Request(now);
+        coalescer.Flush(now);
+    }
+
+    // Burst is over, let last window end.
+    coalescer.Flush(coalescer.GetDue());
+
+    const auto seconds = std::chrono::duration<double>(Step * state.GetIterations()).count();
+    const auto bound   = std::chrono::seconds(1) / std::chrono::duration<double>(UiUpdateCoalescer::DefaultWindow);
+
+    state.SetCounter("ui_updates_per_second", static_cast<double>(coalescer.GetApplied()) / seconds);
+    state.SetCounter("ui_updates_bound", bound);
+}
@@ -0,0 +1,94 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Benchmark.hpp"
+
+#include "Utility.hpp"
+
+#include <string>
+
+using namespace CaffeineTake;
+using namespace CaffeineTake::Benchmark;
+
+namespace {
+
+// Typical trigger entry, pure ASCII.
+const auto AsciiText = std::string("C:\\Program Files\\Mozilla Firefox\\firefox.exe");
+
+// Window title with two, three and four byte sequences.
+const auto MixedText = std::string("Zażółć gęślą jaźń \xE2\x80\x94 \xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E \xF0\x9F\x98\x80 - Notepad");
+
+} // namespace
+
+BENCHMARK("Unicode/UTF8ToUTF16/Ascii")
+{
+    for (auto _ : state)
+    {
+        DoNotOptimize(UTF8ToUTF16(AsciiText));
+    }
+}
+
+BENCHMARK("Unicode/UTF8ToUTF16/Mixed")
+{
+    for (auto _ : state)
+    {
+        DoNotOptimize(UTF8ToUTF16(MixedText));
+    }
+}
+
+BENCHMARK("Unicode/UTF8ToUTF16/Mixed/Reuse")
+{
+    auto out = std::wstring();
+    for (auto _ : state)
+    {
+        DoNotOptimize(UTF8ToUTF16(MixedText, out));
+        DoNotOptimize(out);
+    }
+}
+
+BENCHMARK("Unicode/UTF16ToUTF8/Ascii")
+{
+    const auto wide = UTF8ToUTF16(AsciiText).value();
+    for (auto _ : state)
+    {
+        DoNotOptimize(UTF16ToUTF8(wide));
+    }
+}
+
+BENCHMARK("Unicode/UTF16ToUTF8/Mixed")
+{
+    const auto wide = UTF8ToUTF16(MixedText).value();
+    for (auto _ : state)
+    {
+        DoNotOptimize(UTF16ToUTF8(wide));
+    }
+}
+
+BENCHMARK("Unicode/UTF16ToUTF8/Mixed/Reuse")
+{
+    const auto wide = UTF8ToUTF16(MixedText).value();
+
+    auto out = std::string();
+    for (auto _ : state)
+    {
+        DoNotOptimize(UTF16ToUTF8(wide, out));
+        DoNotOptimize(out);
+    }
+}
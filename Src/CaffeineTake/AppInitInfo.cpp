@@ -91,6 +91,7 @@ auto GetAppInitInfo (HINSTANCE hInstance, CommandLineArgs args) -> std::optional
         .InstanceHandle = hInstance ? hInstance : GetModuleHandleW(NULL),
         .ExecutablePath = exe,
         .DataDirectory  = root,
+        .CacheDirectory = root / "Cache",
         .SettingsPath   = settings,
         .LogFilePath    = root / CAFFEINE_TAKE_LOG_FILENAME,
         .IsPortable     = isPortable,
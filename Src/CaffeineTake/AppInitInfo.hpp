@@ -39,6 +39,7 @@ struct AppInitInfo
     HINSTANCE       InstanceHandle;
     fs::path        ExecutablePath;
     fs::path        DataDirectory;
+    fs::path        CacheDirectory;
     fs::path        SettingsPath;
     fs::path        LogFilePath;
     bool            IsPortable;
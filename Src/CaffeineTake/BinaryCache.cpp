@@ -0,0 +1,355 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "BinaryCache.hpp"
+
+#include "Logger.hpp"
+#include "Persistence.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#if defined(__linux__)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace CaffeineTake {
+
+namespace {
+
+constexpr auto CacheMagic         = std::uint32_t{0x43424354}; // "TCBC"
+constexpr auto CacheFormatVersion = std::uint32_t{1};
+
+struct CacheHeader
+{
+    std::uint32_t Magic         = CacheMagic;
+    std::uint32_t FormatVersion = CacheFormatVersion;
+    std::uint32_t Schema        = 0;
+    std::uint32_t Reserved      = 0;
+    std::uint64_t SourceSize    = 0;
+    std::int64_t  SourceTime    = 0;
+    std::uint64_t SourceHash    = 0;
+    std::uint64_t PayloadSize   = 0;
+    std::uint64_t PayloadHash   = 0;
+};
+
+struct SourceInfo
+{
+    std::uint64_t Size = 0;
+    std::int64_t  Time = 0;
+};
+
+auto GetSourceInfo (const std::filesystem::path& path) -> std::optional<SourceInfo>
+{
+    auto ec = std::error_code();
+
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+    {
+        return std::nullopt;
+    }
+
+    const auto time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        return std::nullopt;
+    }
+
+    return SourceInfo{
+        .Size = static_cast<std::uint64_t>(size),
+        .Time = static_cast<std::int64_t>(time.time_since_epoch().count())
+    };
+}
+
+auto HashFile (const std::filesystem::path& path) -> std::optional<std::uint64_t>
+{
+    auto file = MappedFile();
+    if (!file.Open(path))
+    {
+        return std::nullopt;
+    }
+
+    return BinaryCache::Hash(file.Data(), file.Size());
+}
+
+} // namespace
+
+#pragma region "MappedFile"
+
+#if defined(_WIN32)
+
+auto MappedFile::Open (const std::filesystem::path& path) -> bool
+{
+    Close();
+
+    mFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    auto size = LARGE_INTEGER{};
+    if (!GetFileSizeEx(mFile, &size))
+    {
+        Close();
+        return false;
+    }
+
+    // Empty file can't be mapped, but it is valid.
+    if (size.QuadPart == 0)
+    {
+        return true;
+    }
+
+    mMapping = CreateFileMappingW(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping == NULL)
+    {
+        Close();
+        return false;
+    }
+
+    mData = static_cast<const std::byte*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (mData == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    mSize = static_cast<size_t>(size.QuadPart);
+
+    return true;
+}
+
+auto MappedFile::Close () -> void
+{
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+    }
+
+    if (mMapping != NULL)
+    {
+        CloseHandle(mMapping);
+    }
+
+    if (mFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mFile);
+    }
+
+    mData    = nullptr;
+    mSize    = 0;
+    mMapping = NULL;
+    mFile    = INVALID_HANDLE_VALUE;
+}
+
+#elif defined(__linux__)
+
+auto MappedFile::Open (const std::filesystem::path& path) -> bool
+{
+    Close();
+
+    const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st = {};
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // Empty file can't be mapped, but it is valid.
+    if (st.st_size > 0)
+    {
+        const auto data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+
+        mData = static_cast<const std::byte*>(data);
+        mSize = static_cast<size_t>(st.st_size);
+    }
+
+    // Mapping stays valid after close.
+    close(fd);
+
+    return true;
+}
+
+auto MappedFile::Close () -> void
+{
+    if (mData)
+    {
+        munmap(const_cast<std::byte*>(mData), mSize);
+    }
+
+    mData = nullptr;
+    mSize = 0;
+}
+
+#endif
+
+#pragma endregion
+
+#pragma region "BinaryCache"
+
+auto BinaryCache::Hash (const std::byte* data, const size_t size) -> std::uint64_t
+{
+    // FNV-1a over 64-bit words, byte at a time is too slow for large caches.
+    constexpr auto Prime = std::uint64_t{1099511628211ull};
+
+    auto hash = std::uint64_t{14695981039346656037ull} ^ size;
+    auto i    = size_t{0};
+
+    for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
+    {
+        auto word = std::uint64_t{0};
+        std::memcpy(&word, data + i, sizeof(word));
+
+        hash = (hash ^ word) * Prime;
+    }
+
+    for (; i < size; ++i)
+    {
+        hash = (hash ^ static_cast<std::uint64_t>(data[i])) * Prime;
+    }
+
+    // Spread high bits down, multiply only moves bits up.
+    return hash ^ (hash >> 32);
+}
+
+auto BinaryCache::Load (
+    const std::filesystem::path& cachePath,
+    const std::filesystem::path& sourcePath,
+    const std::uint32_t          schema,
+    const ReadFn&                read
+) -> bool
+{
+    const auto source = GetSourceInfo(sourcePath);
+    if (!source)
+    {
+        return false;
+    }
+
+    auto file = MappedFile();
+    if (!file.Open(cachePath))
+    {
+        return false;
+    }
+
+    auto header = CacheHeader();
+    if (file.Size() < sizeof(header))
+    {
+        return false;
+    }
+
+    std::memcpy(&header, file.Data(), sizeof(header));
+
+    if (header.Magic != CacheMagic || header.FormatVersion != CacheFormatVersion || header.Schema != schema)
+    {
+        LOG_DEBUG(L"Cache '{}' has different version", cachePath.wstring());
+        return false;
+    }
+
+    if (header.SourceSize != source->Size)
+    {
+        return false;
+    }
+
+    // Same size but different time, could still be same content.
+    if (header.SourceTime != source->Time)
+    {
+        const auto hash = HashFile(sourcePath);
+        if (!hash || hash.value() != header.SourceHash)
+        {
+            return false;
+        }
+    }
+
+    const auto payload = file.Data() + sizeof(header);
+    const auto size    = file.Size() - sizeof(header);
+
+    if (header.PayloadSize != size || header.PayloadHash != Hash(payload, size))
+    {
+        LOG_WARNING(L"Cache '{}' is corrupted", cachePath.wstring());
+        return false;
+    }
+
+    auto reader = BinaryReader(payload, size);
+    return read(reader) && reader.IsOk() && reader.IsEnd();
+}
+
+auto BinaryCache::Store (
+    const std::filesystem::path& cachePath,
+    const std::filesystem::path& sourcePath,
+    const std::uint32_t          schema,
+    const BinaryWriter&          payload
+) -> bool
+{
+    const auto source = GetSourceInfo(sourcePath);
+    const auto hash   = HashFile(sourcePath);
+    if (!source || !hash)
+    {
+        return false;
+    }
+
+    const auto& data = payload.Data();
+
+    auto header = CacheHeader();
+    header.Schema      = schema;
+    header.SourceSize  = source->Size;
+    header.SourceTime  = source->Time;
+    header.SourceHash  = hash.value();
+    header.PayloadSize = data.size();
+    header.PayloadHash = Hash(data.data(), data.size());
+
+    auto ec = std::error_code();
+    std::filesystem::create_directories(cachePath.parent_path(), ec);
+
+    // Readers never see partial cache, and after crash it is old or new.
+    auto buffer = std::string();
+    buffer.reserve(sizeof(header) + data.size());
+    buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    buffer.append(reinterpret_cast<const char*>(data.data()), data.size());
+
+    if (!WriteFileAtomic(cachePath, buffer))
+    {
+        LOG_WARNING(L"Failed to write cache '{}'", cachePath.wstring());
+        return false;
+    }
+
+    return true;
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
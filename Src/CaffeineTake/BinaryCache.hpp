@@ -0,0 +1,320 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Reflection.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#endif
+
+namespace CaffeineTake {
+
+#pragma region "BinaryWriter"
+
+class BinaryWriter final
+{
+    std::vector<std::byte> mBuffer = std::vector<std::byte>();
+
+public:
+    auto WriteBytes (const void* data, const size_t size) -> void
+    {
+        const auto bytes = static_cast<const std::byte*>(data);
+        mBuffer.insert(mBuffer.end(), bytes, bytes + size);
+    }
+
+    auto Data () const -> const std::vector<std::byte>&
+    {
+        return mBuffer;
+    }
+};
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T> && (!Reflected<T>)
+auto WriteBinary (BinaryWriter& writer, const T& value) -> void
+{
+    writer.WriteBytes(&value, sizeof(T));
+}
+
+inline auto WriteBinary (BinaryWriter& writer, const std::wstring& str) -> void
+{
+    WriteBinary(writer, static_cast<std::uint32_t>(str.size()));
+    writer.WriteBytes(str.data(), str.size() * sizeof(wchar_t));
+}
+
+template <typename T>
+auto WriteBinary (BinaryWriter& writer, const std::vector<T>& values) -> void
+{
+    WriteBinary(writer, static_cast<std::uint32_t>(values.size()));
+    for (const auto& value : values)
+    {
+        WriteBinary(writer, value);
+    }
+}
+
+#pragma endregion
+
+#pragma region "BinaryReader"
+
+// Reads from borrowed memory, every read is bounds checked. After first
+// failed read all following reads fail too, so result can be checked once.
+class BinaryReader final
+{
+    const std::byte* mPos    = nullptr;
+    const std::byte* mEnd    = nullptr;
+    bool             mFailed = false;
+
+public:
+    BinaryReader (const std::byte* data, const size_t size)
+        : mPos (data)
+        , mEnd (data + size)
+    {
+    }
+
+    auto ReadBytes (void* data, const size_t size) -> bool
+    {
+        if (mFailed || static_cast<size_t>(mEnd - mPos) < size)
+        {
+            mFailed = true;
+            return false;
+        }
+
+        std::memcpy(data, mPos, size);
+        mPos += size;
+
+        return true;
+    }
+
+    auto IsOk () const -> bool
+    {
+        return !mFailed;
+    }
+
+    auto IsEnd () const -> bool
+    {
+        return mPos == mEnd;
+    }
+};
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T> && (!Reflected<T>)
+auto ReadBinary (BinaryReader& reader, T& value) -> bool
+{
+    return reader.ReadBytes(&value, sizeof(T));
+}
+
+inline auto ReadBinary (BinaryReader& reader, std::wstring& str) -> bool
+{
+    auto size = std::uint32_t{0};
+    if (!ReadBinary(reader, size))
+    {
+        return false;
+    }
+
+    str.resize(size);
+    return reader.ReadBytes(str.data(), size * sizeof(wchar_t));
+}
+
+template <typename T>
+auto ReadBinary (BinaryReader& reader, std::vector<T>& values) -> bool
+{
+    auto size = std::uint32_t{0};
+    if (!ReadBinary(reader, size))
+    {
+        return false;
+    }
+
+    values.clear();
+    values.reserve(size);
+
+    for (auto i = std::uint32_t{0}; i < size; ++i)
+    {
+        if (!ReadBinary(reader, values.emplace_back()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#pragma endregion
+
+#pragma region "Reflected"
+
+// Fields in declaration order, no names or tags.
+template <Reflected T>
+auto WriteBinary (BinaryWriter& writer, const T& value) -> void
+{
+    ForEachField<T>([&writer, &value](const auto& field)
+    {
+        WriteBinary(writer, value.*field.Pointer);
+    });
+}
+
+template <Reflected T>
+auto ReadBinary (BinaryReader& reader, T& value) -> bool
+{
+    auto ok = true;
+    ForEachField<T>([&reader, &value, &ok](const auto& field)
+    {
+        ok = ok && ReadBinary(reader, value.*field.Pointer);
+    });
+    return ok;
+}
+
+// Hash of binary layout, changes whenever field is added, removed, renamed,
+// reordered or changes type. Used as cache schema so stale caches are
+// rejected without manual version bumps.
+template <typename T>
+constexpr auto BinarySchemaOf (std::uint32_t hash) -> std::uint32_t
+{
+    const auto mix = [&hash](std::uint32_t value)
+    {
+        hash = (hash ^ value) * 16777619u;
+    };
+
+    if constexpr (Reflected<T>)
+    {
+        mix('{');
+        ForEachField<T>([&hash, &mix](const auto& field)
+        {
+            using Member = typename std::remove_cvref_t<decltype(field)>::MemberType;
+
+            for (const auto c : field.Name)
+            {
+                mix(static_cast<unsigned char>(c));
+            }
+
+            hash = BinarySchemaOf<Member>(hash);
+        });
+        mix('}');
+    }
+    else if constexpr (IsVector<T>::value)
+    {
+        mix('[');
+        hash = BinarySchemaOf<typename T::value_type>(hash);
+    }
+    else if constexpr (std::is_same_v<T, std::wstring>)
+    {
+        mix('s');
+    }
+    else
+    {
+        mix('t');
+        mix(static_cast<std::uint32_t>(sizeof(T)));
+    }
+
+    return hash;
+}
+
+template <typename T>
+constexpr auto BinarySchema = BinarySchemaOf<T>(2166136261u);
+
+#pragma endregion
+
+#pragma region "MappedFile"
+
+// Whole file mapped read-only.
+class MappedFile final
+{
+    const std::byte* mData = nullptr;
+    size_t           mSize = 0;
+
+#if defined(_WIN32)
+    HANDLE mFile    = INVALID_HANDLE_VALUE;
+    HANDLE mMapping = NULL;
+#endif
+
+public:
+    MappedFile () = default;
+
+    MappedFile            (const MappedFile& rhs) = delete;
+    MappedFile& operator= (const MappedFile& rhs) = delete;
+
+    ~MappedFile ()
+    {
+        Close();
+    }
+
+    auto Open  (const std::filesystem::path& path) -> bool;
+    auto Close () -> void;
+
+    auto Data () const -> const std::byte*
+    {
+        return mData;
+    }
+
+    auto Size () const -> size_t
+    {
+        return mSize;
+    }
+};
+
+#pragma endregion
+
+#pragma region "BinaryCache"
+
+// Deserialized form of a source file stored next to it. Cache is used when
+// source has same size and modification time as when it was stored, or
+// same size and content hash (file copied or touched). Schema must be
+// bumped whenever serialized layout changes.
+namespace BinaryCache {
+
+using ReadFn = std::function<bool (BinaryReader&)>;
+
+// Calls read with payload of valid cache. Returns false if there is no
+// valid cache or read failed.
+auto Load (
+    const std::filesystem::path& cachePath,
+    const std::filesystem::path& sourcePath,
+    const std::uint32_t          schema,
+    const ReadFn&                read
+) -> bool;
+
+// Payload keyed by source as it is on disk now, written with
+// WriteFileAtomic. Stores to same cache must not run concurrently, app
+// runs all of them on its PersistQueue.
+auto Store (
+    const std::filesystem::path& cachePath,
+    const std::filesystem::path& sourcePath,
+    const std::uint32_t          schema,
+    const BinaryWriter&          payload
+) -> bool;
+
+auto Hash (const std::byte* data, const size_t size) -> std::uint64_t;
+
+} // namespace BinaryCache
+
+#pragma endregion
+
+} // namespace CaffeineTake
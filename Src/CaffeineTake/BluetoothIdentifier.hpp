@@ -20,9 +20,15 @@
 
 #pragma once
 
+#include "Config.hpp"
+
 #include <format>
 #include <string>
 
+#if defined(FEATURE_CAFFEINETAKE_LOGGER)
+#   include <spdlog/fmt/xchar.h>
+#endif
+
 namespace CaffeineTake {
 
 struct BluetoothIdentifier
@@ -41,6 +47,7 @@ struct BluetoothIdentifier
     auto operator= (unsigned long long ull) -> BluetoothIdentifier&
     {
         this->ull = ull;
+        return *this;
     }
 
     auto operator== (const BluetoothIdentifier& other) const
@@ -83,3 +90,25 @@ struct BluetoothIdentifier
 };
 
 } // namespace CaffeineTake
+
+#if defined(FEATURE_CAFFEINETAKE_LOGGER)
+// Lets identifier be passed to logger as is, it's formatted on writer
+// thread only when message is written.
+template <>
+struct spdlog::fmt_lib::formatter<CaffeineTake::BluetoothIdentifier, wchar_t>
+{
+    constexpr auto parse (auto& context)
+    {
+        return context.begin();
+    }
+
+    auto format (const CaffeineTake::BluetoothIdentifier& id, auto& context) const
+    {
+        return spdlog::fmt_lib::format_to(
+            context.out(),
+            L"{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}",
+            id.bytes[5], id.bytes[4], id.bytes[3], id.bytes[2], id.bytes[1], id.bytes[0]
+        );
+    }
+};
+#endif
@@ -24,13 +24,17 @@
 #include "CaffeineIcons.hpp"
 #include "CaffeineSounds.hpp"
 #include "Dialogs/AboutDialog.hpp"
+#include "Diagnostics.hpp"
 #include "Dialogs/CaffeineSettings.hpp"
 #include "JumpList.hpp"
 #include "Lang.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
 #include "Resource.hpp"
 #include "Settings.hpp"
 #include "Tasks.hpp"
+#include "TimerService.hpp"
+#include "Tracing.hpp"
 #include "Utility.hpp"
 #include "Version.hpp"
 
@@ -38,6 +42,7 @@
 #include <fstream>
 
 #include <commctrl.h>
+#include <Dbt.h>
 #include <Psapi.h>
 #include <shellapi.h>
 #include <ShlObj.h>
@@ -48,6 +53,46 @@
 
 using namespace std;
 
+namespace {
+    auto& ExecutionStateTime = CaffeineTake::MetricsRegistry::Get().Histogram(
+        "caffeinetake_update_execution_state_seconds",
+        "Time of execution state update."
+    );
+
+    auto& UiUpdateTime = CaffeineTake::MetricsRegistry::Get().Histogram(
+        "caffeinetake_ui_update_seconds",
+        "Time of icon, tip, jump list and notification refresh."
+    );
+
+    auto& UiUpdateRequests = CaffeineTake::MetricsRegistry::Get().Counter(
+        "caffeinetake_ui_update_requests_total",
+        "UI refreshes requested, coalesced into caffeinetake_ui_update_seconds count."
+    );
+
+    auto& ExecutionStateChanges = CaffeineTake::MetricsRegistry::Get().Counter(
+        "caffeinetake_execution_state_changes_total",
+        "Successful SetThreadExecutionState calls."
+    );
+
+    auto& ModeChanges = CaffeineTake::MetricsRegistry::Get().Counter(
+        "caffeinetake_mode_changes_total",
+        "Caffeine mode switches."
+    );
+
+    [[maybe_unused]] auto ModeToTraceArg (CaffeineTake::CaffeineMode mode) -> const char*
+    {
+        switch (mode)
+        {
+        case CaffeineTake::CaffeineMode::Disabled: return "Disabled";
+        case CaffeineTake::CaffeineMode::Standard: return "Standard";
+        case CaffeineTake::CaffeineMode::Auto:     return "Auto";
+        case CaffeineTake::CaffeineMode::Timer:    return "Timer";
+        }
+
+        return "Invalid";
+    }
+}
+
 namespace CaffeineTake {
 
 // Window Title and Class Name.
@@ -56,9 +101,12 @@ constexpr auto CAFFEINE_TAKE_CLASS_NAME   = L"CaffeineTake_InvisibleWindow";
 
 CaffeineApp::CaffeineApp (const AppInitInfo& info)
     : mSettings           (std::make_shared<Settings>())
+    , mSettingsWriteTime  (fs::file_time_type())
     , mLang               (std::make_shared<Lang>())
     , mExecutablePath     (info.ExecutablePath)
     , mSettingsFilePath   (info.SettingsPath)
+    , mSettingsCachePath  (info.CacheDirectory / "Settings.bin")
+    , mCacheDirectory     (info.CacheDirectory)
     , mCustomIconsPath    (info.DataDirectory / "Icons" / "")
     , mCustomSoundsPath   (info.DataDirectory / "Sounds" / "")
     , mLangDirectory      (info.DataDirectory / "Lang" / "")
@@ -66,7 +114,6 @@ CaffeineApp::CaffeineApp (const AppInitInfo& info)
     , mInitialized        (false)
     , mShuttingDown       (false)
     , mIsStopping         (false)
-    , mUpdatedByES        (false)
     , mSessionState       (SessionState::Unlocked)
     , mNotifyIcon         ()
     , mThemeInfo          (mni::ThemeInfo::Detect())
@@ -75,6 +122,8 @@ CaffeineApp::CaffeineApp (const AppInitInfo& info)
     , mCaffeineState      (CaffeineState::Inactive)
     , mCaffeineMode       (CaffeineMode::Disabled)
     , mKeepScreenOn       (false)
+    , mUiUpdates          (std::bind(&CaffeineApp::UpdateUi, this))
+    , mNotified           ()
     , mAppSO              (this)
     , mDisabledMode       (mAppSO)
     , mStandardMode       (mAppSO)
@@ -173,12 +222,13 @@ auto CaffeineApp::Init (const AppInitInfo& info) -> bool
         const auto w = (16 * mDpi) / 96;
         const auto h = (16 * mDpi) / 96;
 
-        mIcons->Load(mSettings->General.IconPack, mThemeInfo.IsDark() ? CaffeineIcons::SystemTheme::Light : CaffeineIcons::SystemTheme::Dark, w, h, mSettings);
+        const auto settings = GetSettings();
+        mIcons->Load(settings->General.IconPack, mThemeInfo.IsDark() ? CaffeineIcons::SystemTheme::Light : CaffeineIcons::SystemTheme::Dark, w, h, settings);
     }
 
     // Load sounds.
     {
-        mSounds->Load(mSettings->General.SoundPack);
+        mSounds->Load(GetSettings()->General.SoundPack);
     }
 
     // Load language.
@@ -203,6 +253,27 @@ auto CaffeineApp::Init (const AppInitInfo& info) -> bool
         UpdateAppIcon();
     }
 
+#if defined(FEATURE_CAFFEINETAKE_SETTINGS)
+    // Pick up settings edited outside of app.
+    {
+        if (!mSettingsWatcher.Start(mSettingsFilePath, std::bind(&CaffeineApp::OnSettingsFileChange, this)))
+        {
+            LOG_WARNING("Settings file watcher not started, changes on disk will need restart");
+        }
+    }
+#endif
+
+    TRACE_THREAD_NAME("Main");
+    DIAG_THREAD("Main");
+
+    // Metrics for 'CaffeineTake.exe /metrics'.
+    {
+        if (!mMetricsServer.Start())
+        {
+            LOG_WARNING("Metrics server not started");
+        }
+    }
+
     mInitialized = true;
     LOG_INFO("Initialization finished");
 
@@ -229,6 +300,9 @@ auto CaffeineApp::OnCreate() -> void
 auto CaffeineApp::OnDestroy() -> void
 {
     LOG_INFO("Shutting down application");
+    mSettingsWatcher.Stop();
+    mMetricsServer.Stop();
+    mPersistQueue.Flush();
 #if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION)
     WTSUnRegisterSessionNotification(mNotifyIcon.Handle());
 #endif
@@ -236,6 +310,7 @@ auto CaffeineApp::OnDestroy() -> void
 
 auto CaffeineApp::OnClick(int x, int y) -> void
 {
+    DIAG_SCOPE(Subsystem::UI);
     LOG_TRACE("NotifyIcon::OnClick");
     ToggleCaffeineMode();
 }
@@ -327,6 +402,7 @@ auto CaffeineApp::OnContextMenuOpen() -> void
 
 auto CaffeineApp::OnContextMenuSelect(int selectedItem) -> void
 {
+    DIAG_SCOPE(Subsystem::UI);
     LOG_TRACE("NotifyIcon::OnContextMenuSelect(selectedItem={})", selectedItem);
 
     switch (selectedItem)
@@ -381,7 +457,8 @@ auto CaffeineApp::OnThemeChange(mni::ThemeInfo ti) -> void
 
     // Load proper icons.
     // TODO pick right icons for high contrast
-    mIcons->Load(mSettings->General.IconPack, mThemeInfo.IsDark() ? CaffeineIcons::SystemTheme::Light : CaffeineIcons::SystemTheme::Dark, w, h, mSettings);
+    const auto settings = GetSettings();
+    mIcons->Load(settings->General.IconPack, mThemeInfo.IsDark() ? CaffeineIcons::SystemTheme::Light : CaffeineIcons::SystemTheme::Dark, w, h, settings);
 
     UpdateIcon();
     UpdateAppIcon();
@@ -398,13 +475,15 @@ auto CaffeineApp::OnDpiChange(int dpi) -> void
 
     // TODO pick right icons for high contrast
     // it can be specific icon override
-    mIcons->Load(mSettings->General.IconPack, mThemeInfo.IsDark() ? CaffeineIcons::SystemTheme::Light : CaffeineIcons::SystemTheme::Dark, w, h, mSettings);
+    const auto settings = GetSettings();
+    mIcons->Load(settings->General.IconPack, mThemeInfo.IsDark() ? CaffeineIcons::SystemTheme::Light : CaffeineIcons::SystemTheme::Dark, w, h, settings);
 
     UpdateIcon();
 }
 
 auto CaffeineApp::OnCustomMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) -> void
 {
+    DIAG_SCOPE(Subsystem::UI);
     LOG_TRACE("NotifyIcon::OnCustomMessage(uMsg={})", uMsg);
     switch (uMsg)
     {
@@ -423,11 +502,23 @@ auto CaffeineApp::OnCustomMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) -> vo
         LOG_INFO("Received message from jumplist {}", static_cast<unsigned int>(wParam));
         ProcessTask(static_cast<unsigned int>(wParam));
         break;
+
+    case WM_CAFFEINE_TAKE_SETTINGS_CHANGED:
+        OnSettingsChange();
+        break;
+
+    case WM_CAFFEINE_TAKE_UPDATE_UI:
+        if (!mUiUpdates.Flush() && mUiUpdates.IsPending())
+        {
+            ScheduleUiUpdate();
+        }
+        break;
     }
 }
 
 auto CaffeineApp::OnSystemMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) -> bool
 {
+    DIAG_SCOPE(Subsystem::UI);
     LOG_TRACE("NotifyIcon::OnSystemMessage(uMsg={})", uMsg);
     switch (uMsg)
     {
@@ -447,6 +538,29 @@ auto CaffeineApp::OnSystemMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) -> bo
             return true;
         }
 
+        break;
+
+    case WM_DEVICECHANGE:
+        if (wParam == DBT_DEVNODES_CHANGED)
+        {
+            LOG_DEBUG("Device change event");
+            mAutoMode.OnDeviceChange();
+        }
+
+        break;
+
+    case WM_TIMECHANGE:
+        LOG_INFO("System time change event");
+        mAutoMode.OnTimeChange();
+        break;
+
+    case WM_POWERBROADCAST:
+        if (wParam == PBT_APMRESUMEAUTOMATIC)
+        {
+            LOG_INFO("Resume from sleep event");
+            mAutoMode.OnTimeChange();
+        }
+
         break;
     }
 
@@ -509,6 +623,8 @@ auto CaffeineApp::ToggleCaffeineMode() -> void
 
 auto CaffeineApp::SetCaffeineMode(CaffeineMode mode) -> void
 {
+    TRACE_SCOPE("SetCaffeineMode", "mode", ModeToTraceArg(mode));
+
     auto nextMode = static_cast<Mode*>(nullptr);
     switch (mode)
     {
@@ -557,7 +673,6 @@ auto CaffeineApp::SetCaffeineMode(CaffeineMode mode) -> void
     mIsStopping = true;
     StopMode();
     mIsStopping = false;
-    mUpdatedByES = false;
 
     // Start new one.
     mCaffeineMode = mode;
@@ -567,15 +682,9 @@ auto CaffeineApp::SetCaffeineMode(CaffeineMode mode) -> void
         LOG_INFO(L"Setting CaffeineMode to {}", mModePtr->GetName());
     }
     StartMode();
+    ModeChanges.Add();
 
-    if (!mUpdatedByES)
-    {
-        UpdateIcon();
-        UpdateTip();
-        UpdateJumpList();
-        ShowNotificationBalloon();
-        PlayNotificationSound();
-    }
+    RequestUiUpdate();
 
     if (!mShuttingDown)
     {
@@ -585,6 +694,8 @@ auto CaffeineApp::SetCaffeineMode(CaffeineMode mode) -> void
 
 auto CaffeineApp::StartMode () -> void
 {
+    TRACE_SCOPE("StartMode", "mode");
+
     if (mModePtr)
     {
         mModePtr->Start();
@@ -593,6 +704,8 @@ auto CaffeineApp::StartMode () -> void
 
 auto CaffeineApp::StopMode () -> void
 {
+    TRACE_SCOPE("StopMode", "mode");
+
     if (mModePtr)
     {
         mModePtr->Stop();
@@ -635,37 +748,42 @@ auto CaffeineApp::LoadMode () -> bool
     return result;
 }
 
-auto CaffeineApp::SaveMode () -> bool
+auto CaffeineApp::SaveMode () -> void
 {
-    auto subKey   = std::format(L"Software\\{}", CAFFEINE_TAKE_PROGRAM_NAME);
-    auto data     = static_cast<DWORD>(mCaffeineMode);
-    auto dataSize = DWORD{sizeof(data)};
-    auto status   = ::RegSetKeyValueW(
-        HKEY_CURRENT_USER,
-        subKey.c_str(),
-        L"CaffeineMode",
-        REG_DWORD,
-        reinterpret_cast<LPCWSTR>(&data),
-        dataSize
-    );
-
-    auto result = true;
-
-    if (status != ERROR_SUCCESS)
-    {
-        LOG_ERROR("Failed to save CaffeineMode to registry");
-        result = false;
-    }
-    else
+    // Jump lists can switch mode in quick succession, only last one is written.
+    const auto mode = mCaffeineMode;
+    mPersistQueue.Schedule("CaffeineMode", [mode]
     {
+        auto subKey   = std::format(L"Software\\{}", CAFFEINE_TAKE_PROGRAM_NAME);
+        auto data     = static_cast<DWORD>(mode);
+        auto dataSize = DWORD{sizeof(data)};
+        auto status   = ::RegSetKeyValueW(
+            HKEY_CURRENT_USER,
+            subKey.c_str(),
+            L"CaffeineMode",
+            REG_DWORD,
+            reinterpret_cast<LPCWSTR>(&data),
+            dataSize
+        );
+
+        if (status != ERROR_SUCCESS)
+        {
+            LOG_ERROR("Failed to save CaffeineMode to registry");
+            return false;
+        }
+
         LOG_INFO("Saved CaffeineMode to registry");
-    }
-    
-    return result;
+        return true;
+    });
 }
 
 auto CaffeineApp::UpdateExecutionState(CaffeineState state) -> void
 {
+    const auto measure = ScopedLatency(ExecutionStateTime);
+    TRACE_SCOPE("UpdateExecutionState", "state", state == CaffeineState::Active ? "Active" : "Inactive");
+
+    const auto settings = GetSettings();
+
     auto keepScreenOn      = false;
     auto whenSessionLocked = false;
 
@@ -675,16 +793,16 @@ auto CaffeineApp::UpdateExecutionState(CaffeineState state) -> void
         break;
 
     case CaffeineMode::Standard:
-        keepScreenOn      = mSettings->Standard.KeepScreenOn;
-        whenSessionLocked = mSettings->Standard.WhenSessionLocked;
+        keepScreenOn      = settings->Standard.KeepScreenOn;
+        whenSessionLocked = settings->Standard.WhenSessionLocked;
         break;
     case CaffeineMode::Auto:
-        keepScreenOn      = mSettings->Auto.KeepScreenOn;
-        whenSessionLocked = mSettings->Auto.WhenSessionLocked;
+        keepScreenOn      = settings->Auto.KeepScreenOn;
+        whenSessionLocked = settings->Auto.WhenSessionLocked;
         break;
     case CaffeineMode::Timer:
-        keepScreenOn      = mSettings->Timer.KeepScreenOn;
-        whenSessionLocked = mSettings->Timer.WhenSessionLocked;
+        keepScreenOn      = settings->Timer.KeepScreenOn;
+        whenSessionLocked = settings->Timer.WhenSessionLocked;
         break;
     }
 
@@ -711,7 +829,7 @@ auto CaffeineApp::UpdateExecutionState(CaffeineState state) -> void
 
     if (!needUpdate)
     {
-        LOG_DEBUG("No need to update execution state, continuing");
+        LOG_DEBUG_LIMITED(5, "No need to update execution state, continuing");
         return;
     }
 
@@ -730,21 +848,23 @@ auto CaffeineApp::UpdateExecutionState(CaffeineState state) -> void
         }
     }
 
-    if (!SetThreadExecutionState(flags))
+    auto updated = false;
+    {
+        TRACE_SCOPE("SetThreadExecutionState", "state");
+        updated = SetThreadExecutionState(flags) != 0;
+    }
+
+    if (!updated)
     {
         LOG_ERROR("Failed to update execution state");
         return;
     }
 
-    LOG_INFO("Updated execution state, State: {}, Display: {}", static_cast<int>(mCaffeineState), mKeepScreenOn);
+    ExecutionStateChanges.Add();
 
-    mUpdatedByES = true;
+    LOG_INFO("Updated execution state, State: {}, Display: {}", static_cast<int>(mCaffeineState), mKeepScreenOn);
 
-    UpdateIcon();
-    UpdateTip();
-    UpdateJumpList();
-    ShowNotificationBalloon();
-    PlayNotificationSound();
+    RequestUiUpdate();
 }
 
 auto CaffeineApp::RefreshExecutionState () -> void
@@ -752,8 +872,55 @@ auto CaffeineApp::RefreshExecutionState () -> void
     UpdateExecutionState(mCaffeineState);
 }
 
+auto CaffeineApp::RequestUiUpdate () -> void
+{
+    if (mShuttingDown)
+    {
+        return;
+    }
+
+    UiUpdateRequests.Add();
+
+    if (mUiUpdates.Request())
+    {
+        ScheduleUiUpdate();
+    }
+}
+
+auto CaffeineApp::ScheduleUiUpdate () -> void
+{
+    // Flush must run on main thread, timer only wakes it up.
+    const auto hWnd = mNotifyIcon.Handle();
+    TimerService::Get().Schedule(
+        mUiUpdates.GetDue(),
+        [hWnd]
+        {
+            PostMessageW(hWnd, WM_CAFFEINE_TAKE_UPDATE_UI, 0, 0);
+        }
+    );
+}
+
+auto CaffeineApp::UpdateUi () -> void
+{
+    const auto measure = ScopedLatency(UiUpdateTime);
+    TRACE_SCOPE("UpdateUi", "ui");
+
+    UpdateIcon();
+    UpdateTip();
+    UpdateJumpList();
+
+    // Burst that ended where it started is not worth a balloon or sound.
+    if (mNotified.Notify(NotifiedState{ mCaffeineMode, mCaffeineState, mKeepScreenOn }))
+    {
+        ShowNotificationBalloon();
+        PlayNotificationSound();
+    }
+}
+
 auto CaffeineApp::UpdateIcon() -> bool
 {
+    TRACE_SCOPE("UpdateIcon", "ui");
+
     auto icon = mModePtr->GetIcon(mCaffeineState);
 
     // No need to update.
@@ -774,6 +941,8 @@ auto CaffeineApp::UpdateIcon() -> bool
 
 auto CaffeineApp::UpdateTip() -> bool
 {
+    TRACE_SCOPE("UpdateTip", "ui");
+
     auto tip = mModePtr->GetTip(mCaffeineState);
 
     // No need to update.
@@ -823,6 +992,8 @@ auto CaffeineApp::UpdateAppIcon() -> void
 
 auto CaffeineApp::UpdateJumpList () -> bool
 {
+    TRACE_SCOPE("UpdateJumpList", "ui");
+
 #if !defined(FEATURE_CAFFEINETAKE_JUMPLISTS)
     // TODO it would be got to clear lists
     return true;
@@ -943,7 +1114,9 @@ auto CaffeineApp::UpdateJumpList () -> bool
 
 auto CaffeineApp::ShowNotificationBalloon () -> void
 {
-    if (mSettings->General.ShowNotifications && !mIsStopping)
+    TRACE_SCOPE("ShowNotificationBalloon", "ui");
+
+    if (GetSettings()->General.ShowNotifications && !mIsStopping)
     {
         auto title = L"";
         auto text  = L"";
@@ -992,8 +1165,10 @@ auto CaffeineApp::ShowNotificationBalloon () -> void
 
 auto CaffeineApp::PlayNotificationSound () -> void
 {
+    TRACE_SCOPE("PlayNotificationSound", "ui");
+
     // TODO respect quiet mode
-    if (mSettings->General.PlayNotificationSound)
+    if (GetSettings()->General.PlayNotificationSound)
     {
         switch (mCaffeineState)
         {
@@ -1038,42 +1213,184 @@ auto CaffeineApp::ProcessTask (unsigned int msg) -> bool
     case TASK_EXIT.MessageId:
         mNotifyIcon.Quit();
         break;
+    case TASK_TOGGLE_TRACE.MessageId:
+        ToggleTrace();
+        break;
     }
 
     return modeChanged;
 }
 
+auto CaffeineApp::ToggleTrace () -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_TRACING)
+    auto& tracer = Tracer::Get();
+    if (!tracer.IsRecording())
+    {
+        tracer.Start();
+        return;
+    }
+
+    tracer.Stop();
+
+    const auto path = mSettingsFilePath.parent_path() / "CaffeineTake.trace.json";
+    if (!tracer.Save(path))
+    {
+        LOG_ERROR(L"Failed to write trace to '{}'", path.wstring());
+    }
+#else
+    LOG_WARNING("Tracing is not available in this build");
+#endif
+}
+
+auto CaffeineApp::GetSettings () const -> SettingsPtr
+{
+    return mSettings.load(std::memory_order_acquire);
+}
+
+auto CaffeineApp::PublishSettings (SettingsPtr settings) -> void
+{
+    mSettings.store(std::move(settings), std::memory_order_release);
+}
+
 auto CaffeineApp::LoadSettings () -> void
 {
-    if (!mSettings->Load(mSettingsFilePath))
+    // Before parsing, so cache isn't stored for file that changed meanwhile.
+    auto ec = std::error_code();
+    const auto writeTime = fs::last_write_time(mSettingsFilePath, ec);
+
+    auto settings   = std::make_shared<Settings>();
+    auto cacheStale = false;
+    if (!settings->Load(mSettingsFilePath, mSettingsCachePath, &cacheStale))
     {
         LOG_ERROR(L"Failed to load settings, using default values");
-        mSettings = std::make_shared<Settings>();
+        settings = std::make_shared<Settings>();
     }
+    else if (cacheStale)
+    {
+        StoreSettingsCache(settings, writeTime);
+    }
+
+    mSettingsWriteTime = writeTime;
+
+    PublishSettings(std::move(settings));
+}
+
+auto CaffeineApp::StoreSettingsCache (SettingsPtr settings, fs::file_time_type writeTime) -> void
+{
+    // Same writer thread as saves, so cache file never has two writers.
+    mPersistQueue.Schedule("SettingsCache", [this, settings = std::move(settings), writeTime]
+    {
+        // Changed since parsed, cache is refreshed by whoever changed it.
+        auto ec = std::error_code();
+        if (fs::last_write_time(mSettingsFilePath, ec) != writeTime || ec)
+        {
+            return true;
+        }
+
+        return settings->StoreCache(mSettingsFilePath, mSettingsCachePath);
+    });
 }
 
 auto CaffeineApp::SaveSettings () -> void
 {
-    if (!mSettings->Save(mSettingsFilePath))
+    // Snapshot is immutable, writer thread serializes it as is.
+    mPersistQueue.Schedule("Settings", [this, settings = GetSettings()]
+    {
+        if (!settings->Save(mSettingsFilePath, mSettingsCachePath))
+        {
+            return false;
+        }
+
+        // Don't reload our own write.
+        auto ec = std::error_code();
+        mSettingsWriteTime = fs::last_write_time(mSettingsFilePath, ec);
+
+        return true;
+    });
+}
+
+auto CaffeineApp::OnSettingsFileChange () -> void
+{
+    auto ec = std::error_code();
+    const auto writeTime = fs::last_write_time(mSettingsFilePath, ec);
+    if (ec || writeTime == mSettingsWriteTime.load())
+    {
+        return;
+    }
+
+    // Parsing happens here, readers keep using old snapshot until swap.
+    auto settings   = std::make_shared<Settings>();
+    auto cacheStale = false;
+    if (!settings->Load(mSettingsFilePath, mSettingsCachePath, &cacheStale))
     {
-        LOG_ERROR(L"Failed to save settings");
+        // Possibly caught in middle of write, keep current settings and wait for next change.
+        LOG_WARNING(L"Failed to reload settings, keeping current ones");
+        return;
     }
+
+    if (cacheStale)
+    {
+        StoreSettingsCache(settings, writeTime);
+    }
+
+    mSettingsWriteTime = writeTime;
+
+    // File touched without changing anything (e.g. saved again in editor).
+    const auto changed = settings->Diff(*GetSettings());
+    if (changed.empty())
+    {
+        return;
+    }
+
+    for (const auto& field : changed)
+    {
+        LOG_INFO("Setting '{}' changed on disk", field);
+    }
+
+    PublishSettings(std::move(settings));
+
+    LOG_INFO(L"Settings changed on disk, reloaded");
+
+    // Rest must be done on main thread. Post, main thread may be waiting for watcher to stop.
+    PostMessageW(mNotifyIcon.Handle(), WM_CAFFEINE_TAKE_SETTINGS_CHANGED, 0, 0);
+}
+
+auto CaffeineApp::OnSettingsChange () -> void
+{
+    mAutoMode.OnSettingsChange();
+
+    // Settings change don't trigger caffeine state to change,
+    // but display settings might change so we need to update.
+    RefreshExecutionState();
 }
 
 auto CaffeineApp::LoadLang () -> void
 {
-    const auto langPath = mLangDirectory / (mSettings->General.LangId + L".json");
-    if (!mLang->Load(langPath))
+    const auto langId   = GetSettings()->General.LangId;
+    const auto langPath   = mLangDirectory / (langId + L".json");
+    const auto cachePath  = mCacheDirectory / (L"Lang." + langId + L".bin");
+    auto       cacheStale = false;
+    if (!mLang->Load(langPath, cachePath, &cacheStale))
     {
         mLang = std::make_shared<Lang>();
         LOG_ERROR(L"Failed to load lang file, using default language '{}'", mLang->LangId);
     }
     else
     {
-        mLang->LangId = mSettings->General.LangId;
+        mLang->LangId = langId;
         // TODO get name from langid
         //mLang->LangName = 
         LOG_INFO(L"Loaded language: '{}' ({})", mLang->LangId, mLang->LangName);
+
+        if (cacheStale)
+        {
+            // Copy, language may be reloaded before writer gets to it.
+            mPersistQueue.Schedule("LangCache", [lang = *mLang, langPath, cachePath]
+            {
+                return lang.StoreCache(langPath, cachePath);
+            });
+        }
     }
 }
 
@@ -1082,19 +1399,23 @@ auto CaffeineApp::ShowSettingsDialog () -> bool
 #if defined(FEATURE_CAFFEINETAKE_SETTINGS_DIALOG)
     SINGLE_INSTANCE_GUARD();
     
-    auto caffeineSettings = CaffeineSettings(mSettings);
+    auto caffeineSettings = CaffeineSettings(GetSettings());
     if (caffeineSettings.Show(mNotifyIcon.Handle()))
     {
         const auto& newSettings = caffeineSettings.Result();
 
-        mSettings->Standard = newSettings.Standard;
-        mSettings->Auto     = newSettings.Auto;
-
-        // TODO in future settings change might change auto mode refresh interval, so update timer settings        
+        // Dialog edits only part of settings, copy just that so rest of
+        // Auto (triggers, schedule, scan intervals) is kept.
+        auto settings = std::make_shared<Settings>(*GetSettings());
+        settings->Standard.KeepScreenOn            = newSettings.Standard.KeepScreenOn;
+        settings->Standard.WhenSessionLocked       = newSettings.Standard.WhenSessionLocked;
+        settings->Auto.KeepScreenOn                = newSettings.Auto.KeepScreenOn;
+        settings->Auto.WhenSessionLocked           = newSettings.Auto.WhenSessionLocked;
+        settings->Auto.TriggerProcess.Processes    = newSettings.Auto.TriggerProcess.Processes;
+        settings->Auto.TriggerWindow.Windows       = newSettings.Auto.TriggerWindow.Windows;
 
-        // Settings change don't trigger caffeine state to change,
-        // but display settings might change so we need to update.
-        RefreshExecutionState();
+        PublishSettings(std::move(settings));
+        OnSettingsChange();
 
         SaveSettings();
     }
@@ -1124,7 +1445,7 @@ auto CaffeineApp::IsModeAvailable (CaffeineMode mode) -> bool
         break;
 
     case CaffeineMode::Standard:
-        if (mSettings->Standard.Enabled)
+        if (GetSettings()->Standard.Enabled)
         {
             available = true;
         }
@@ -1132,7 +1453,7 @@ auto CaffeineApp::IsModeAvailable (CaffeineMode mode) -> bool
 
     case CaffeineMode::Auto:
 #if defined(FEATURE_CAFFEINETAKE_AUTO_MODE)
-        if (mSettings->Auto.Enabled)
+        if (GetSettings()->Auto.Enabled)
         {
             available = true;
         }
@@ -1143,7 +1464,7 @@ auto CaffeineApp::IsModeAvailable (CaffeineMode mode) -> bool
 
     case CaffeineMode::Timer:
 #if defined(FEATURE_CAFFEINETAKE_TIMER_MODE)
-        if (mSettings->Timer.Enabled)
+        if (GetSettings()->Timer.Enabled)
         {
             available = true;
         }
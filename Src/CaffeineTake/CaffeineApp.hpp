@@ -26,7 +26,11 @@
 #include "CaffeineAppSO.hpp"
 #include "CaffeineMode.hpp"
 #include "CaffeineState.hpp"
+#include "FileWatcher.hpp"
 #include "ForwardDeclaration.hpp"
+#include "Metrics.hpp"
+#include "Persistence.hpp"
+#include "UiUpdateCoalescer.hpp"
 
 #if defined(FEATURE_CAFFEINETAKE_IMMERSIVE_CONTEXT_MENU)
 #   include <mni/ImmersiveNotifyIcon.hpp>
@@ -34,6 +38,7 @@
 #   include <mni/ClassicNotifyIcon.hpp>
 #endif
 
+#include <atomic>
 #include <filesystem>
 #include <memory>
 #include <mutex>
@@ -53,6 +58,8 @@ namespace CaffeineTake {
 // Custom messages.
 constexpr auto WM_CAFFEINE_TAKE_UPDATE_EXECUTION_STATE  = (MNI_USER_MESSAGE_ID + 0);
 constexpr auto WM_CAFFEINE_TAKE_SECOND_INSTANCE_MESSAGE = (MNI_USER_MESSAGE_ID + 1);
+constexpr auto WM_CAFFEINE_TAKE_SETTINGS_CHANGED        = (MNI_USER_MESSAGE_ID + 2);
+constexpr auto WM_CAFFEINE_TAKE_UPDATE_UI               = (MNI_USER_MESSAGE_ID + 3);
 
 // Forward declaration of shared object.
 class CaffeineAppSO;
@@ -71,16 +78,22 @@ class CaffeineApp final
     bool               mInitialized;
     bool               mShuttingDown;
     bool               mIsStopping;
-    bool               mUpdatedByES;
     SessionState       mSessionState;
     fs::path           mExecutablePath;
     fs::path           mSettingsFilePath;
+    fs::path           mSettingsCachePath;
+    fs::path           mCacheDirectory;
     fs::path           mCustomIconsPath;
     fs::path           mCustomSoundsPath;
     fs::path           mLangDirectory;
     int                mDpi;
 
-    SettingsPtr        mSettings;
+    // Immutable snapshot, readers load it without locking. To change
+    // settings copy current snapshot, modify copy and publish it.
+    std::atomic<SettingsPtr>           mSettings;
+    std::atomic<fs::file_time_type>    mSettingsWriteTime;
+    FileWatcher                        mSettingsWatcher;
+
     LangPtr            mLang;
     CaffeineIconsPtr   mIcons;
     CaffeineSoundsPtr  mSounds;
@@ -91,6 +104,29 @@ class CaffeineApp final
     AutoMode           mAutoMode;
     TimerMode          mTimerMode;
 
+    // What notification balloon and sound announce.
+    struct NotifiedState
+    {
+        CaffeineMode  Mode;
+        CaffeineState State;
+        bool          KeepScreenOn;
+
+        auto operator== (const NotifiedState& rhs) const -> bool = default;
+    };
+
+    // Icon, tip, jump list and notification refresh, at most once per frame
+    // window however often state changes. Refresh that ends on state user
+    // was last notified about stays silent.
+    UiUpdateCoalescer                 mUiUpdates;
+    UiNotifyFilter<NotifiedState>     mNotified;
+
+    // Serves metrics to 'CaffeineTake.exe /metrics'.
+    MetricsServer      mMetricsServer;
+
+    // Settings and mode writes, coalesced and done off UI thread. Declared
+    // last so pending writes land before anything they use is destroyed.
+    PersistQueue       mPersistQueue;
+
     auto OnCreate            ()                     -> void;
     auto OnDestroy           ()                     -> void;
     auto OnClick             (int x, int y)         -> void;
@@ -113,11 +149,15 @@ class CaffeineApp final
     auto StopMode  () -> void;
 
     auto LoadMode () -> bool;
-    auto SaveMode () -> bool;
+    auto SaveMode () -> void;
 
-    // Main update method. This change ui/es.
+    // Main update method. Applies es right away, ui follows coalesced.
     auto UpdateExecutionState  (CaffeineState state) -> void;
     auto RefreshExecutionState () -> void;
+
+    auto RequestUiUpdate  () -> void;
+    auto ScheduleUiUpdate () -> void;
+    auto UpdateUi         () -> void;
     
     auto UpdateIcon     () -> bool;
     auto UpdateTip      () -> bool;
@@ -129,8 +169,19 @@ class CaffeineApp final
 
     auto ProcessTask (unsigned int msg) -> bool;
 
-    auto LoadSettings () -> void;
-    auto SaveSettings () -> void;
+    // Starts trace recording, or stops it and writes trace next to settings.
+    auto ToggleTrace () -> void;
+
+    auto GetSettings     () const -> SettingsPtr;
+    auto PublishSettings (SettingsPtr settings) -> void;
+
+    auto LoadSettings       () -> void;
+    auto SaveSettings       () -> void;
+    auto StoreSettingsCache (SettingsPtr settings, fs::file_time_type writeTime) -> void;
+
+    // Called on watcher thread, reloads settings edited outside of app.
+    auto OnSettingsFileChange () -> void;
+    auto OnSettingsChange     () -> void;
 
     auto LoadLang     () -> void;
 
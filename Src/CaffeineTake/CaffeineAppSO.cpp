@@ -44,7 +44,7 @@ auto CaffeineAppSO::GetSettings () const -> SettingsPtr
 {
     if (mApp)
     {
-        return mApp->mSettings;
+        return mApp->GetSettings();
     }
 
     return nullptr;
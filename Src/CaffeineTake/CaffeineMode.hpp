@@ -106,18 +106,42 @@ class AutoMode : public Mode
     UsbDeviceScanner   mUsbScanner;
     BluetoothScanner   mBluetoothScanner;
 
+    ScannerSlot        mProcessSlot;
+    ScannerSlot        mWindowSlot;
+    ScannerSlot        mUsbSlot;
+    ScannerSlot        mBluetoothSlot;
+    ScanScheduler      mScanScheduler;
+    ScanTick           mScanTick;
+    ScheduleEvaluator  mScheduleEvaluator;
+    SettingsPtr        mScheduleSettings;   // snapshot mScheduleEvaluator was updated from
+
     ThreadTimer        mScannerTimer;
     ThreadTimer        mScheduleTimer;
 
     auto ScannerTimerProc  (const StopToken& stop, const PauseToken& pause) -> bool;
+    auto StartScanners     (SettingsPtr settings, const PauseToken& pause) -> void;
+    auto OnScanResult      (bool result) -> void;
     auto ScheduleTimerProc (const StopToken& stop, const PauseToken& pause) -> bool;
 
+    // Scanner timer period from current settings, fastest scanner cadence.
+    auto UpdateScannerInterval () -> void;
+
 public:
     AutoMode (CaffeineAppSO app);
 
     auto Start () -> bool override;
     auto Stop  () -> bool override;
 
+    // Device arrival or removal, USB and Bluetooth scanners are run on next tick.
+    auto OnDeviceChange   () -> void;
+
+    // System time, time zone or power state change, schedule is rechecked.
+    auto OnTimeChange     () -> void;
+
+    // Schedule is rechecked, scanner interval recomputed and scanners run
+    // right away.
+    auto OnSettingsChange () -> void;
+
     auto GetIcon (CaffeineState state) const -> const HICON override;
     auto GetTip  (CaffeineState state) const -> const std::wstring& override;
 
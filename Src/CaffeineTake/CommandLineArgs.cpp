@@ -38,6 +38,15 @@ auto CheckArg (const std::wstring_view text, CommandLineArgs& args) -> void
     else if (text == TASK_SHOW_ABOUT_DIALOG)    { args.Task = TASK_SHOW_ABOUT_DIALOG; }
     else if (text == TASK_SHOW_SETTINGS_DIALOG) { args.Task = TASK_SHOW_SETTINGS_DIALOG; }
     else if (text == TASK_EXIT)                 { args.Task = TASK_EXIT; }
+    else if (text == TASK_TOGGLE_TRACE)         { args.Task = TASK_TOGGLE_TRACE; }
+    else if (text == L"/metrics")               { args.Metrics = true; }
+    else if (text == L"--metrics")              { args.Metrics = true; }
+    else if (text == L"/diag")                  { args.Diagnostics = true; }
+    else if (text == L"--diag")                 { args.Diagnostics = true; }
+    else if (text == L"/synthetic")             { args.Synthetic = L""; }
+    else if (text == L"--synthetic")            { args.Synthetic = L""; }
+    else if (text.starts_with(L"/synthetic:"))  { args.Synthetic = std::wstring(text.substr(11)); }
+    else if (text.starts_with(L"--synthetic=")) { args.Synthetic = std::wstring(text.substr(12)); }
 }
 
 auto ParseCommandLine (const std::wstring_view cmdline) -> CommandLineArgs
@@ -49,7 +58,7 @@ auto ParseCommandLine (const std::wstring_view cmdline) -> CommandLineArgs
     {
         if (cmdline.at(i) == L' ')
         {
-            auto text = std::wstring_view(cmdline.data(), i - last);
+            auto text = std::wstring_view(cmdline.data() + last, i - last);
             last = i + 1;
 
             CheckArg(text, args);
@@ -58,7 +67,7 @@ auto ParseCommandLine (const std::wstring_view cmdline) -> CommandLineArgs
 
     if (auto count = cmdline.size() - last; count > 0)
     {
-        auto text = std::wstring_view(cmdline.data(), count);
+        auto text = std::wstring_view(cmdline.data() + last, count);
         CheckArg(text, args);
     }
 
@@ -22,13 +22,18 @@
 
 #include "Tasks.hpp"
 
+#include <optional>
+#include <string>
 #include <string_view>
 
 namespace CaffeineTake {
 
 struct CommandLineArgs
 {
-    Task Task = Task::Invalid();
+    Task                        Task        = Task::Invalid();
+    bool                        Metrics     = false;          // print metrics of running instance and exit
+    bool                        Diagnostics = false;          // print CPU usage report of running instance and exit
+    std::optional<std::wstring> Synthetic   = std::nullopt;   // synthetic workload spec, scanners look at it instead of system
 };
 
 auto ParseCommandLine (const std::wstring_view cmdline) -> CommandLineArgs;
@@ -42,6 +42,9 @@
 #define ENABLE_FEATURE_LOCKSCREEN_DETECTION
 #define ENABLE_FEATURE_NOTIFICATION_BALLOON
 #define ENABLE_FEATURE_NOTIFICATION_SOUND
+#define ENABLE_FEATURE_TRACING
+//#define ENABLE_FEATURE_SYNTHETIC_WORKLOAD   // benchmarks and profiling only
+#define ENABLE_FEATURE_DIAGNOSTICS
 
 // ============================ //
 // Don't modify anything below! //
@@ -67,6 +70,9 @@ enum class Feature
     LockscreenDetection,
     NotificationBalloon,
     NotificationSound,
+    Tracing,
+    SyntheticWorkload,
+    Diagnostics,
 };
 
 constexpr auto IsFeatureAvailable (const Feature f) -> bool;
@@ -129,6 +135,8 @@ constexpr auto FeatureToString    (const Feature f) -> const wchar_t*;
 #   define FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION
 #   define FEATURE_CAFFEINETAKE_NOTIFICATION_BALLOON
 #   define FEATURE_CAFFEINETAKE_NOTIFICATION_SOUND
+#   define FEATURE_CAFFEINETAKE_TRACING
+#   define FEATURE_CAFFEINETAKE_DIAGNOSTICS
 #endif
 
 // ========================== //
@@ -155,6 +163,8 @@ constexpr auto FeatureToString    (const Feature f) -> const wchar_t*;
 #   define FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION
 #   define FEATURE_CAFFEINETAKE_NOTIFICATION_BALLOON
 #   define FEATURE_CAFFEINETAKE_NOTIFICATION_SOUND
+#   define FEATURE_CAFFEINETAKE_TRACING
+#   define FEATURE_CAFFEINETAKE_DIAGNOSTICS
 #endif
 
 // ========================== //
@@ -250,8 +260,30 @@ constexpr auto FeatureToString    (const Feature f) -> const wchar_t*;
 #   define FEATURE_CAFFEINETAKE_NOTIFICATION_SOUND
 #endif
 
+// Tracing.
+#if defined(ENABLE_FEATURE_TRACING)
+#   define FEATURE_CAFFEINETAKE_TRACING
+#endif
+
+// Synthetic workload.
+#if defined(ENABLE_FEATURE_SYNTHETIC_WORKLOAD)
+#   define FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD
+#endif
+
+// CPU accounting.
+#if defined(ENABLE_FEATURE_DIAGNOSTICS)
+#   define FEATURE_CAFFEINETAKE_DIAGNOSTICS
+#endif
+
 #endif // #if FEATURE_SET == FEATURE_SET_CUSTOM
 
+// Synthetic workload is not part of any feature set, shipped builds must
+// always look at the real system. Benchmarks and profiling builds define
+// CAFFEINETAKE_ENABLE_SYNTHETIC_WORKLOAD from build system.
+#if defined(CAFFEINETAKE_ENABLE_SYNTHETIC_WORKLOAD) && !defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
+#   define FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD
+#endif
+
 // ====== //
 // Undefs //
 // ====== //
@@ -274,6 +306,9 @@ constexpr auto FeatureToString    (const Feature f) -> const wchar_t*;
 #undef ENABLE_FEATURE_LOCKSCREEN_DETECTION
 #undef ENABLE_FEATURE_NOTIFICATION_BALLOON
 #undef ENABLE_FEATURE_NOTIFICATION_SOUND
+#undef ENABLE_FEATURE_TRACING
+#undef ENABLE_FEATURE_SYNTHETIC_WORKLOAD
+#undef ENABLE_FEATURE_DIAGNOSTICS
 
 // ========= //
 // Functions //
@@ -389,6 +424,24 @@ case Feature::CustomSounds:
         return true;
 #else
         return false;
+#endif
+    case Feature::Tracing:
+#if defined(FEATURE_CAFFEINETAKE_TRACING)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::SyntheticWorkload:
+#if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::Diagnostics:
+#if defined(FEATURE_CAFFEINETAKE_DIAGNOSTICS)
+        return true;
+#else
+        return false;
 #endif
     }
 
@@ -417,6 +470,9 @@ constexpr auto FeatureToString  (const Feature f) -> const wchar_t*
     case Feature::LockscreenDetection:          return L"LockscreenDetection";
     case Feature::NotificationBalloon:          return L"NotificationBalloon";
     case Feature::NotificationSound:            return L"NotificationSound";
+    case Feature::Tracing:                      return L"Tracing";
+    case Feature::SyntheticWorkload:            return L"SyntheticWorkload";
+    case Feature::Diagnostics:                  return L"Diagnostics";
     }
     return L"Invalid Feature";
 }
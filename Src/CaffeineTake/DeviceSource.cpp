@@ -0,0 +1,316 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "DeviceSource.hpp"
+
+#include "Logger.hpp"
+#include "SyntheticWorkload.hpp"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#   include <initguid.h>
+#   if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+#       include <SetupAPI.h>
+#       include <usbiodef.h>
+#   endif
+#   if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+#       include <bluetoothapis.h>
+#   endif
+#endif
+
+namespace CaffeineTake {
+
+#if defined(_WIN32)
+
+namespace {
+
+#pragma region "WindowsUsbDeviceSource"
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+
+class WindowsUsbDeviceSource final : public UsbDeviceSource
+{
+    std::vector<wchar_t> mBuffer = std::vector<wchar_t>(1024);
+
+public:
+    auto Enumerate (const Visitor& visitor) -> bool override
+    {
+        // Get list of USB devices that are present in the system.
+        auto deviceInfoSet = SetupDiGetClassDevsW(&GUID_DEVINTERFACE_USB_DEVICE, NULL, NULL, DIGCF_DEVICEINTERFACE | DIGCF_PRESENT);
+        mOsCalls += 1;
+        if (deviceInfoSet == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        auto deviceInfoData = SP_DEVINFO_DATA{};
+        ZeroMemory(&deviceInfoData, sizeof(SP_DEVINFO_DATA));
+        deviceInfoData.cbSize = sizeof(SP_DEVINFO_DATA);
+
+        auto result = ScanResult::Continue;
+        for (auto deviceIndex = DWORD{0}; result == ScanResult::Continue; ++deviceIndex)
+        {
+            mOsCalls += 1;
+            if (!SetupDiEnumDeviceInfo(deviceInfoSet, deviceIndex, &deviceInfoData))
+            {
+                const auto error = GetLastError();
+                if (error != ERROR_NO_MORE_ITEMS)
+                {
+                    LOG_ERROR_LIMITED(5, "SetupDiEnumDeviceInfo() failed with error: {}", error);
+                }
+
+                break;
+            }
+
+            // Get device id, buffer is grown only when id doesn't fit.
+            auto requiredSize = DWORD{0};
+            auto success      = SetupDiGetDeviceInstanceIdW(deviceInfoSet, &deviceInfoData, mBuffer.data(), static_cast<DWORD>(mBuffer.size()), &requiredSize);
+            mOsCalls += 1;
+            if (!success && GetLastError() == ERROR_INSUFFICIENT_BUFFER)
+            {
+                mBuffer.resize(requiredSize);
+                success = SetupDiGetDeviceInstanceIdW(deviceInfoSet, &deviceInfoData, mBuffer.data(), static_cast<DWORD>(mBuffer.size()), &requiredSize);
+                mOsCalls += 1;
+            }
+
+            if (!success)
+            {
+                LOG_ERROR_LIMITED(5, "SetupDiGetDeviceInstanceIdW() failed with error: {}", GetLastError());
+                break;
+            }
+
+            result = visitor(std::wstring_view(mBuffer.data()));
+        }
+
+        // Cleanup.
+        SetupDiDestroyDeviceInfoList(deviceInfoSet);
+        mOsCalls += 1;
+
+        return result == ScanResult::Success;
+    }
+};
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+
+#pragma endregion
+
+#pragma region "WindowsBluetoothSource"
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+
+class WindowsBluetoothSource final : public BluetoothSource
+{
+    HMODULE mLibBluetoothApis = NULL;
+
+    static auto SystemTimeToLocalTime (const SYSTEMTIME& st) -> LocalClock::LocalTimePoint
+    {
+        // stLastSeen is already in local time, take it as is instead of
+        // round-tripping through UTC and time zone.
+        auto ft = FILETIME{};
+
+        if (SystemTimeToFileTime(&st, &ft))
+        {
+            return LocalClock::LocalTimePoint(FILETIME_to_system_clock(ft).time_since_epoch());
+        }
+
+        return LocalClock::LocalTimePoint();
+    }
+
+public:
+    ~WindowsBluetoothSource ()
+    {
+        if (mLibBluetoothApis)
+        {
+            FreeLibrary(mLibBluetoothApis);
+        }
+    }
+
+    auto HasRadio () -> bool override
+    {
+        auto params = BLUETOOTH_FIND_RADIO_PARAMS{
+            .dwSize = sizeof(BLUETOOTH_FIND_RADIO_PARAMS)
+        };
+
+        auto radio      = INVALID_HANDLE_VALUE;
+        auto hRadioFind = BluetoothFindFirstRadio(&params, &radio);
+        mOsCalls += hRadioFind ? 2 : 1;
+        if (!hRadioFind)
+        {
+            return false;
+        }
+
+        BluetoothFindRadioClose(hRadioFind);
+
+        // For some reason system keeps loading/unloading this library.
+        // Load manually to keep at least one reference.
+        if (!mLibBluetoothApis)
+        {
+            mLibBluetoothApis = LoadLibraryW(L"bluetoothapis.dll");
+        }
+
+        return true;
+    }
+
+    auto Inquiry () -> bool override
+    {
+        auto deviceInfo = BLUETOOTH_DEVICE_INFO{};
+        ZeroMemory(&deviceInfo, sizeof(deviceInfo));
+        deviceInfo.dwSize = sizeof(deviceInfo);
+
+        auto searchParams = BLUETOOTH_DEVICE_SEARCH_PARAMS{
+            .dwSize               = sizeof(BLUETOOTH_DEVICE_SEARCH_PARAMS),
+            .fReturnAuthenticated = TRUE,
+            .fReturnRemembered    = TRUE,
+            .fReturnUnknown       = TRUE,
+            .fReturnConnected     = TRUE,
+            .fIssueInquiry        = TRUE,
+            .cTimeoutMultiplier   = 1,    // n*1.28s
+            .hRadio               = NULL  // use all radios, for inquiry
+        };
+
+        auto deviceFind = BluetoothFindFirstDevice(&searchParams, &deviceInfo);
+        mOsCalls += deviceFind ? 2 : 1;
+        if (deviceFind == NULL)
+        {
+            auto error = GetLastError();
+            if (error != ERROR_NO_MORE_ITEMS)
+            {
+                LOG_ERROR_LIMITED(5, "IssueDeviceInquiry() failed with error {}", error);
+                return false;
+            }
+
+            LOG_DEBUG_LIMITED(5, "IssueDeviceInquiry() no more items");
+        }
+        else
+        {
+            BluetoothFindDeviceClose(deviceFind);
+        }
+
+        return true;
+    }
+
+    auto Enumerate (const Visitor& visitor) -> bool override
+    {
+        auto deviceInfo = BLUETOOTH_DEVICE_INFO{};
+        ZeroMemory(&deviceInfo, sizeof(deviceInfo));
+        deviceInfo.dwSize = sizeof(deviceInfo);
+
+        auto searchParams = BLUETOOTH_DEVICE_SEARCH_PARAMS{
+            .dwSize               = sizeof(BLUETOOTH_DEVICE_SEARCH_PARAMS),
+            .fReturnAuthenticated = TRUE,
+            .fReturnRemembered    = TRUE,
+            .fReturnUnknown       = TRUE,
+            .fReturnConnected     = TRUE,
+            .fIssueInquiry        = FALSE,
+            .cTimeoutMultiplier   = 0,
+            .hRadio               = NULL  // use all radios, for inquiry
+        };
+
+        auto deviceFind = BluetoothFindFirstDevice(&searchParams, &deviceInfo);
+        mOsCalls += 1;
+        if (deviceFind == NULL)
+        {
+            auto error = GetLastError();
+            if (error != ERROR_NO_MORE_ITEMS)
+            {
+                LOG_ERROR_LIMITED(5, "BluetoothFindFirstDevice() failed with error {}", error);
+            }
+            else
+            {
+                LOG_DEBUG_LIMITED(5, "BluetoothFindFirstDevice() no more items");
+            }
+
+            return false;
+        }
+
+        auto result = ScanResult::Continue;
+        do
+        {
+            auto device = BluetoothDeviceRecord();
+            device.Address.ull = deviceInfo.Address.ullLong;
+            device.Connected   = deviceInfo.fConnected;
+            device.LastSeen    = SystemTimeToLocalTime(deviceInfo.stLastSeen);
+            device.Name        = std::wstring_view(deviceInfo.szName);
+
+            result = visitor(device);
+            if (result != ScanResult::Continue)
+            {
+                break;
+            }
+
+            mOsCalls += 1;
+        } while (BluetoothFindNextDevice(deviceFind, &deviceInfo));
+
+        BluetoothFindDeviceClose(deviceFind);
+        mOsCalls += 1;
+
+        return result == ScanResult::Success;
+    }
+};
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+
+#pragma endregion
+
+} // namespace
+
+#endif // #if defined(_WIN32)
+
+auto CreateUsbDeviceSource () -> UsbDeviceSourcePtr
+{
+#if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
+    if (auto workload = SyntheticWorkload::GetInstalled())
+    {
+        return workload->CreateUsbDeviceSource();
+    }
+#endif
+
+#if defined(_WIN32) && defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    return std::make_unique<WindowsUsbDeviceSource>();
+#else
+    return nullptr;
+#endif
+}
+
+auto CreateBluetoothSource () -> BluetoothSourcePtr
+{
+#if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
+    if (auto workload = SyntheticWorkload::GetInstalled())
+    {
+        return workload->CreateBluetoothSource();
+    }
+#endif
+
+#if defined(_WIN32) && defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    return std::make_unique<WindowsBluetoothSource>();
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace CaffeineTake
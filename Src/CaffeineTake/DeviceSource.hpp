@@ -0,0 +1,106 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "BluetoothIdentifier.hpp"
+#include "LocalClock.hpp"
+#include "Utility.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace CaffeineTake {
+
+#pragma region "UsbDeviceSource"
+
+// Present USB devices, as UsbDeviceScanner sees them.
+class UsbDeviceSource
+{
+protected:
+    std::uint64_t mOsCalls = 0;
+
+public:
+    // Instance id view is valid only during the call.
+    using Visitor = FunctionRef<ScanResult (std::wstring_view instanceId)>;
+
+    virtual ~UsbDeviceSource () {}
+
+    // Visit devices until visitor returns other than Continue. Returns true
+    // if it returned Success.
+    virtual auto Enumerate (const Visitor& visitor) -> bool = 0;
+
+    auto GetOsCallCount () const -> std::uint64_t
+    {
+        return mOsCalls;
+    }
+};
+
+using UsbDeviceSourcePtr = std::unique_ptr<UsbDeviceSource>;
+
+#pragma endregion
+
+#pragma region "BluetoothSource"
+
+struct BluetoothDeviceRecord
+{
+    BluetoothIdentifier         Address   = BluetoothIdentifier();
+    bool                        Connected = false;
+    LocalClock::LocalTimePoint  LastSeen  = LocalClock::LocalTimePoint();   // system reports it in local time
+    std::wstring_view           Name      = std::wstring_view();
+};
+
+// Remembered and discovered Bluetooth devices, as BluetoothScanner sees them.
+class BluetoothSource
+{
+protected:
+    std::uint64_t mOsCalls = 0;
+
+public:
+    // Record is valid only during the call.
+    using Visitor = FunctionRef<ScanResult (const BluetoothDeviceRecord& device)>;
+
+    virtual ~BluetoothSource () {}
+
+    virtual auto HasRadio () -> bool = 0;
+
+    // Blocking inquiry, refreshes last seen time of devices in range.
+    virtual auto Inquiry () -> bool = 0;
+
+    // Visit devices known to system without inquiry, until visitor returns
+    // other than Continue. Returns true if it returned Success.
+    virtual auto Enumerate (const Visitor& visitor) -> bool = 0;
+
+    auto GetOsCallCount () const -> std::uint64_t
+    {
+        return mOsCalls;
+    }
+};
+
+using BluetoothSourcePtr = std::unique_ptr<BluetoothSource>;
+
+#pragma endregion
+
+// Synthetic workload when one is installed, nullptr where devices can't be listed.
+auto CreateUsbDeviceSource () -> UsbDeviceSourcePtr;
+auto CreateBluetoothSource () -> BluetoothSourcePtr;
+
+} // namespace CaffeineTake
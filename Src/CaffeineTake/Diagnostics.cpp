@@ -0,0 +1,472 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "Diagnostics.hpp"
+
+#if defined(FEATURE_CAFFEINETAKE_DIAGNOSTICS)
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#elif defined(__linux__)
+#   include <pthread.h>
+#   include <time.h>
+#   include <unistd.h>
+#endif
+
+namespace CaffeineTake {
+
+namespace {
+
+#if defined(_WIN32)
+    auto FileTimeTo100ns (const FILETIME& ft) -> std::int64_t
+    {
+        return static_cast<std::int64_t>(static_cast<std::uint64_t>(ft.dwHighDateTime) << 32 | ft.dwLowDateTime);
+    }
+
+    auto ThreadTimes (HANDLE thread) -> std::int64_t
+    {
+        auto creation = FILETIME();
+        auto exit     = FILETIME();
+        auto kernel   = FILETIME();
+        auto user     = FILETIME();
+        if (!::GetThreadTimes(thread, &creation, &exit, &kernel, &user))
+        {
+            return 0;
+        }
+
+        return (FileTimeTo100ns(kernel) + FileTimeTo100ns(user)) * 100;
+    }
+#elif defined(__linux__)
+    auto ClockNs (clockid_t clock) -> std::int64_t
+    {
+        auto ts = timespec();
+        if (::clock_gettime(clock, &ts) != 0)
+        {
+            return 0;
+        }
+
+        return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    }
+#endif
+
+    auto CurrentThreadId () -> std::uint64_t
+    {
+#if defined(_WIN32)
+        return ::GetCurrentThreadId();
+#else
+        return static_cast<std::uint64_t>(::gettid());
+#endif
+    }
+
+    const auto StartTime = std::chrono::steady_clock::now();
+
+    thread_local auto tScopeDepth    = 0;
+    thread_local auto tThreadWakeups = static_cast<MetricCounter*>(nullptr);
+}
+
+#pragma region "Subsystem"
+
+auto SubsystemToString (Subsystem subsystem) -> const char*
+{
+    switch (subsystem)
+    {
+    case Subsystem::Scanner:   return "Scanner";
+    case Subsystem::Schedule:  return "Schedule";
+    case Subsystem::TimerMode: return "TimerMode";
+    case Subsystem::UI:        return "UI";
+    case Subsystem::Logger:    return "Logger";
+    case Subsystem::Service:   return "Service";
+    default:                   return "Invalid";
+    }
+}
+
+auto ThreadCpuTime () -> std::chrono::nanoseconds
+{
+#if defined(_WIN32)
+    return std::chrono::nanoseconds(ThreadTimes(::GetCurrentThread()));
+#elif defined(__linux__)
+    return std::chrono::nanoseconds(ClockNs(CLOCK_THREAD_CPUTIME_ID));
+#else
+    return std::chrono::nanoseconds(0);
+#endif
+}
+
+#pragma endregion
+
+#pragma region "CpuAccounting"
+
+struct CpuAccounting::ThreadGuard
+{
+    ThreadEntryPtr Entry = nullptr;
+
+    ~ThreadGuard ()
+    {
+        if (Entry)
+        {
+            CpuAccounting::Unregister(*Entry);
+        }
+    }
+};
+
+CpuAccounting::CpuAccounting ()
+{
+    auto& registry = MetricsRegistry::Get();
+
+    for (auto i = size_t{0}; i < SubsystemCount; ++i)
+    {
+        const auto labels = std::format("subsystem=\"{}\"", SubsystemToString(static_cast<Subsystem>(i)));
+
+        mWakeups[i] = &registry.Counter(
+            "caffeinetake_subsystem_wakeups_total",
+            "Units of work done by subsystem.",
+            labels
+        );
+
+        registry.Gauge(
+            "caffeinetake_subsystem_cpu_seconds",
+            "CPU time charged to subsystem.",
+            [this, i] { return static_cast<double>(mCpuNs[i].load(std::memory_order_relaxed)) / 1e9; },
+            labels
+        );
+    }
+
+    registry.Gauge(
+        "caffeinetake_uptime_seconds",
+        "Time since start of the process.",
+        [] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count(); }
+    );
+}
+
+auto CpuAccounting::Get () -> CpuAccounting&
+{
+    static auto instance = CpuAccounting();
+    return instance;
+}
+
+auto CpuAccounting::ReadThreadCpu (ThreadEntry& entry) -> std::int64_t
+{
+    auto lockGuard = std::lock_guard<std::mutex>(entry.Mutex);
+    if (!entry.IsAlive)
+    {
+        return entry.FinalNs;
+    }
+
+#if defined(_WIN32)
+    return ThreadTimes(reinterpret_cast<HANDLE>(entry.Clock));
+#elif defined(__linux__)
+    return ClockNs(static_cast<clockid_t>(entry.Clock));
+#else
+    return 0;
+#endif
+}
+
+// Runs on the exiting thread, its clock is still valid.
+auto CpuAccounting::Unregister (ThreadEntry& entry) -> void
+{
+    const auto cpu = ThreadCpuTime().count();
+
+    auto lockGuard = std::lock_guard<std::mutex>(entry.Mutex);
+    entry.FinalNs = cpu;
+    entry.IsAlive = false;
+
+#if defined(_WIN32)
+    ::CloseHandle(reinterpret_cast<HANDLE>(entry.Clock));
+#endif
+    entry.Clock = 0;
+
+    tThreadWakeups = nullptr;
+}
+
+auto CpuAccounting::RegisterThread (const char* name) -> void
+{
+    thread_local auto guard = ThreadGuard();
+    if (guard.Entry)
+    {
+        return;
+    }
+
+    auto entry = std::make_shared<ThreadEntry>();
+    entry->Tid = CurrentThreadId();
+
+#if defined(_WIN32)
+    const auto handle = ::OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, ::GetCurrentThreadId());
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    entry->Clock = reinterpret_cast<std::intptr_t>(handle);
+#elif defined(__linux__)
+    auto clock = clockid_t();
+    if (::pthread_getcpuclockid(::pthread_self(), &clock) != 0)
+    {
+        return;
+    }
+
+    entry->Clock = static_cast<std::intptr_t>(clock);
+#else
+    return;
+#endif
+
+    auto&      registry = MetricsRegistry::Get();
+    const auto labels   = std::format("thread=\"{}\",tid=\"{}\"", name, entry->Tid);
+
+    tThreadWakeups = &registry.Counter(
+        "caffeinetake_thread_wakeups_total",
+        "Units of work done by thread.",
+        labels
+    );
+
+    registry.Gauge(
+        "caffeinetake_thread_cpu_seconds",
+        "CPU time of thread.",
+        [entry] { return static_cast<double>(ReadThreadCpu(*entry)) / 1e9; },
+        labels
+    );
+
+    guard.Entry = std::move(entry);
+}
+
+auto CpuAccounting::Charge (Subsystem subsystem, std::chrono::nanoseconds cpu) -> void
+{
+    const auto i = static_cast<size_t>(subsystem);
+
+    mCpuNs[i].fetch_add(cpu.count(), std::memory_order_relaxed);
+    mWakeups[i]->Add();
+}
+
+#pragma endregion
+
+#pragma region "CpuScope"
+
+CpuScope::CpuScope (Subsystem subsystem, LatencyHistogram* histogram)
+    : mSubsystem (subsystem)
+    , mHistogram (histogram)
+    , mIsOuter   (tScopeDepth++ == 0)
+{
+    if (mIsOuter || mHistogram)
+    {
+        mStart = ThreadCpuTime();
+    }
+}
+
+CpuScope::~CpuScope ()
+{
+    tScopeDepth -= 1;
+
+    if (mStart.count() < 0)
+    {
+        return;
+    }
+
+    const auto cpu = ThreadCpuTime() - mStart;
+
+    if (mHistogram)
+    {
+        mHistogram->Record(cpu);
+    }
+
+    if (mIsOuter)
+    {
+        CpuAccounting::Get().Charge(mSubsystem, cpu);
+        if (tThreadWakeups)
+        {
+            tThreadWakeups->Add();
+        }
+    }
+}
+
+#pragma endregion
+
+#pragma region "FormatDiagnostics"
+
+namespace {
+
+struct Sample
+{
+    std::string_view                              Name;
+    std::map<std::string_view, std::string_view>  Labels;
+    double                                        Value;
+};
+
+// Only what registry writes: name{key="value",...} value
+auto ParseMetrics (std::string_view text) -> std::vector<Sample>
+{
+    auto samples = std::vector<Sample>();
+
+    while (!text.empty())
+    {
+        const auto eol  = text.find('\n');
+        const auto line = text.substr(0, eol);
+        text = eol == std::string_view::npos ? std::string_view() : text.substr(eol + 1);
+
+        const auto space = line.rfind(' ');
+        if (line.empty() || line.front() == '#' || space == std::string_view::npos)
+        {
+            continue;
+        }
+
+        auto sample = Sample();
+        auto series = line.substr(0, space);
+        auto value  = line.substr(space + 1);
+
+        const auto brace = series.find('{');
+        sample.Name = series.substr(0, brace);
+
+        if (brace != std::string_view::npos)
+        {
+            auto labels = series.substr(brace + 1, series.size() - brace - 2);
+            while (!labels.empty())
+            {
+                const auto equals = labels.find("=\"");
+                const auto quote  = labels.find('"', equals + 2);
+                if (equals == std::string_view::npos || quote == std::string_view::npos)
+                {
+                    break;
+                }
+
+                sample.Labels[labels.substr(0, equals)] = labels.substr(equals + 2, quote - equals - 2);
+                labels = labels.substr(std::min(quote + 2, labels.size()));
+            }
+        }
+
+        sample.Value = std::strtod(std::string(value).c_str(), nullptr);
+
+        samples.push_back(std::move(sample));
+    }
+
+    return samples;
+}
+
+auto Find (const std::vector<Sample>& samples, std::string_view name, std::string_view key = {}, std::string_view label = {}) -> double
+{
+    for (const auto& sample : samples)
+    {
+        if (sample.Name != name)
+        {
+            continue;
+        }
+
+        if (key.empty())
+        {
+            return sample.Value;
+        }
+
+        if (const auto it = sample.Labels.find(key); it != sample.Labels.end() && it->second == label)
+        {
+            return sample.Value;
+        }
+    }
+
+    return 0.0;
+}
+
+auto Percent (double part, double whole) -> double
+{
+    return whole > 0.0 ? 100.0 * part / whole : 0.0;
+}
+
+} // namespace
+
+auto FormatDiagnostics (std::string_view metrics) -> std::string
+{
+    const auto samples = ParseMetrics(metrics);
+    const auto uptime  = Find(samples, "caffeinetake_uptime_seconds");
+    const auto cpu     = Find(samples, "process_cpu_seconds_total");
+    const auto minutes = uptime / 60.0;
+
+    auto out = std::string();
+
+    out += std::format(
+        "Uptime {:.0f} s, process CPU {:.3f} s, {:.4f}% of one core\n\n",
+        uptime, cpu, Percent(cpu, uptime)
+    );
+
+    // Subsystems, whatever wasn't charged to any is shown as unattributed.
+    out += std::format("{:<14}{:>12}{:>9}{:>12}{:>13}\n", "Subsystem", "CPU [s]", "Share", "Wakeups", "Wakeups/min");
+
+    auto charged = 0.0;
+    for (auto i = size_t{0}; i < SubsystemCount; ++i)
+    {
+        const auto name    = SubsystemToString(static_cast<Subsystem>(i));
+        const auto time    = Find(samples, "caffeinetake_subsystem_cpu_seconds", "subsystem", name);
+        const auto wakeups = Find(samples, "caffeinetake_subsystem_wakeups_total", "subsystem", name);
+
+        charged += time;
+        out += std::format(
+            "{:<14}{:>12.3f}{:>8.1f}%{:>12.0f}{:>13.2f}\n",
+            name, time, Percent(time, cpu), wakeups, minutes > 0.0 ? wakeups / minutes : 0.0
+        );
+    }
+
+    out += std::format("{:<14}{:>12.3f}{:>8.1f}%\n\n", "Unattributed", std::max(cpu - charged, 0.0), Percent(std::max(cpu - charged, 0.0), cpu));
+
+    // Threads.
+    out += std::format("{:<14}{:>10}{:>12}{:>12}{:>13}\n", "Thread", "TID", "CPU [s]", "Wakeups", "Wakeups/min");
+    for (const auto& sample : samples)
+    {
+        if (sample.Name != "caffeinetake_thread_cpu_seconds")
+        {
+            continue;
+        }
+
+        const auto name    = sample.Labels.contains("thread") ? sample.Labels.at("thread") : std::string_view("?");
+        const auto tid     = sample.Labels.contains("tid")    ? sample.Labels.at("tid")    : std::string_view("?");
+        const auto wakeups = Find(samples, "caffeinetake_thread_wakeups_total", "tid", tid);
+
+        out += std::format(
+            "{:<14}{:>10}{:>12.3f}{:>12.0f}{:>13.2f}\n",
+            name, tid, sample.Value, wakeups, minutes > 0.0 ? wakeups / minutes : 0.0
+        );
+    }
+
+    // Scanners, average cost of single run.
+    out += std::format("\n{:<14}{:>10}{:>16}{:>16}\n", "Scanner", "Runs", "Avg CPU [ms]", "Avg wall [ms]");
+    for (const auto name : { "Process", "Window", "Usb", "Bluetooth" })
+    {
+        const auto runs    = Find(samples, "caffeinetake_scanner_cpu_seconds_count", "scanner", name);
+        const auto cpuSum  = Find(samples, "caffeinetake_scanner_cpu_seconds_sum",   "scanner", name);
+        const auto wall    = Find(samples, "caffeinetake_scanner_run_seconds_count", "scanner", name);
+        const auto wallSum = Find(samples, "caffeinetake_scanner_run_seconds_sum",   "scanner", name);
+
+        out += std::format(
+            "{:<14}{:>10.0f}{:>16.3f}{:>16.3f}\n",
+            name, runs, runs > 0.0 ? 1e3 * cpuSum / runs : 0.0, wall > 0.0 ? 1e3 * wallSum / wall : 0.0
+        );
+    }
+
+    return out;
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_DIAGNOSTICS)
@@ -0,0 +1,141 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Config.hpp"
+
+#if defined(FEATURE_CAFFEINETAKE_DIAGNOSTICS)
+
+#include "Metrics.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace CaffeineTake {
+
+enum class Subsystem : unsigned char
+{
+    Scanner,
+    Schedule,
+    TimerMode,
+    UI,
+    Logger,
+    Service,    // timer service, persistence, file watcher, metrics server
+    Count
+};
+
+constexpr auto SubsystemCount = static_cast<size_t>(Subsystem::Count);
+
+auto SubsystemToString (Subsystem subsystem) -> const char*;
+
+// CPU time consumed by calling thread so far. Windows updates thread times
+// on clock interrupt, so short spans read as zero or one whole quantum,
+// sums over many spans are still right.
+auto ThreadCpuTime () -> std::chrono::nanoseconds;
+
+// Cumulative CPU time and wakeups per thread and per subsystem, exported
+// through metrics registry so 'CaffeineTake.exe --diag' can read them from
+// running instance.
+//
+// Threads register once, their CPU clock is then read at export time and
+// cost nothing in between. Subsystems are charged by CpuScope, only the
+// outermost scope on a thread counts, so wakeup is one unit of work.
+class CpuAccounting final
+{
+    struct ThreadEntry
+    {
+        std::mutex     Mutex;
+        std::uint64_t  Tid      = 0;
+        std::intptr_t  Clock    = 0;         // thread handle or clockid_t
+        bool           IsAlive  = true;
+        std::int64_t   FinalNs  = 0;         // CPU time at exit
+    };
+
+    using ThreadEntryPtr = std::shared_ptr<ThreadEntry>;
+
+    // Thread local, unregisters thread when it exits.
+    struct ThreadGuard;
+
+    std::array<std::atomic<std::int64_t>, SubsystemCount> mCpuNs   = {};
+    std::array<MetricCounter*, SubsystemCount>            mWakeups = {};
+
+    static auto ReadThreadCpu (ThreadEntry& entry) -> std::int64_t;
+    static auto Unregister    (ThreadEntry& entry) -> void;
+
+    CpuAccounting ();
+
+    CpuAccounting            (const CpuAccounting& rhs) = delete;
+    CpuAccounting& operator= (const CpuAccounting& rhs) = delete;
+
+public:
+    static auto Get () -> CpuAccounting&;
+
+    // Calling thread is tracked until it exits. Name must have static
+    // storage duration, same name on many threads is fine.
+    auto RegisterThread (const char* name) -> void;
+
+    auto Charge (Subsystem subsystem, std::chrono::nanoseconds cpu) -> void;
+};
+
+// Charges CPU time of calling thread from construction to end of scope to
+// subsystem and counts a wakeup, unless it's nested in another scope.
+// Histogram, if given, gets the time even when nested.
+class CpuScope final
+{
+    Subsystem                mSubsystem;
+    LatencyHistogram*        mHistogram;
+    std::chrono::nanoseconds mStart     = std::chrono::nanoseconds(-1);
+    bool                     mIsOuter   = false;
+
+public:
+    explicit CpuScope (Subsystem subsystem, LatencyHistogram* histogram = nullptr);
+    ~CpuScope ();
+
+    CpuScope            (const CpuScope& rhs) = delete;
+    CpuScope& operator= (const CpuScope& rhs) = delete;
+};
+
+// Human readable report out of metrics text read from running instance.
+auto FormatDiagnostics (std::string_view metrics) -> std::string;
+
+} // namespace CaffeineTake
+
+#define CAFFEINETAKE_DIAG_CONCAT_(a, b) a##b
+#define CAFFEINETAKE_DIAG_CONCAT(a, b)  CAFFEINETAKE_DIAG_CONCAT_(a, b)
+
+// Diagnostics macros.
+#define DIAG_THREAD(name)  ::CaffeineTake::CpuAccounting::Get().RegisterThread(name)
+#define DIAG_SCOPE(...)    const auto CAFFEINETAKE_DIAG_CONCAT(_cpuScope, __LINE__) = ::CaffeineTake::CpuScope(__VA_ARGS__)
+
+#else
+
+// Diagnostics macros.
+#define DIAG_THREAD(...) do{}while(0)
+#define DIAG_SCOPE(...)  do{}while(0)
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_DIAGNOSTICS)
@@ -45,7 +45,7 @@ class CaffeineSettings final : public Dialog<Settings>
 {
     // Construction order is important.
     // Settings -> IconCache -> RunningProcesses -> ItemList
-    std::shared_ptr<Settings>           mCurrentSettings;
+    SettingsPtr                         mCurrentSettings;
     std::shared_ptr<IconCache>          mIconCache;
     std::shared_ptr<RunningProcessList> mRunningProcesses;
     std::shared_ptr<ItemList>           mItems;
@@ -82,7 +82,7 @@ class CaffeineSettings final : public Dialog<Settings>
     CaffeineSettings& operator= (const CaffeineSettings&) = delete;
 
 public:
-    CaffeineSettings (std::shared_ptr<Settings> currentSettings)
+    CaffeineSettings (SettingsPtr currentSettings)
         : Dialog            (IDD_SETTINGS)
         , mCurrentSettings  (currentSettings)
         , mIconCache        (std::make_shared<IconCache>())
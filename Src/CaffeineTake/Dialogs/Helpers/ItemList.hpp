@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "ForwardDeclaration.hpp"
 #include "ItemType.hpp"
 #include "RunningProcess.hpp"
 #include "Settings.hpp"
@@ -49,7 +50,7 @@ class ItemList
     std::vector<Item> mItems;
 
 public:
-    ItemList (std::shared_ptr<Settings> settings, std::shared_ptr<RunningProcessList> processList)
+    ItemList (SettingsPtr settings, std::shared_ptr<RunningProcessList> processList)
     {
         if (settings)
         {
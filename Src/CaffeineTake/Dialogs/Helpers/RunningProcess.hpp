@@ -21,6 +21,7 @@
 #pragma once
 
 #include "IconCache.hpp"
+#include "ProcessSnapshot.hpp"
 #include "Utility.hpp"
 
 #include <string>
@@ -49,6 +50,7 @@ class RunningProcessList
 {
     std::vector<std::pair<int, ProcessInfo>> mRunningProcesses;
     std::shared_ptr<IconCache>               mIconCache;
+    ProcessSnapshot                          mSnapshot;
 
 public:
     RunningProcessList (std::shared_ptr<IconCache> iconCache)
@@ -65,21 +67,25 @@ public:
     {
         mRunningProcesses.clear();
 
-        // Load list of running processes.
-        ScanProcesses(
-            [&](HANDLE handle, DWORD pid, fs::path path)
+        // Load list of running processes. Snapshot is kept between refreshes
+        // so only processes started since last one are queried.
+        mSnapshot.Update();
+        for (const auto& [pid, entry] : mSnapshot.GetEntries())
+        {
+            if (entry.ImagePath.empty())
             {
-                auto icon = mIconCache->Insert(path);
-                mRunningProcesses.push_back(
-                    std::make_pair(
-                        pid,
-                        ProcessInfo(path.wstring(), path.filename().wstring(), std::wstring(), icon)
-                    )
-                );
-
-                return ScanResult::Continue;
+                continue;
             }
-        );
+
+            const auto path = fs::path(entry.ImagePath);
+            const auto icon = mIconCache->Insert(path);
+            mRunningProcesses.push_back(
+                std::make_pair(
+                    static_cast<int>(pid),
+                    ProcessInfo(path.wstring(), path.filename().wstring(), std::wstring(), icon)
+                )
+            );
+        }
 
         // Load window titles.
         ScanWindows(
@@ -0,0 +1,382 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "FileWatcher.hpp"
+
+#include "Diagnostics.hpp"
+#include "Logger.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__linux__)
+#   include <cerrno>
+#   include <poll.h>
+#   include <sys/eventfd.h>
+#   include <sys/inotify.h>
+#   include <unistd.h>
+#endif
+
+namespace CaffeineTake {
+
+auto FileWatcher::Start (
+    const std::filesystem::path&    path,
+    Callback                        callback,
+    const std::chrono::milliseconds debounce
+) -> bool
+{
+    Stop();
+
+    mPath     = path;
+    mCallback = std::move(callback);
+    mDebounce = debounce;
+
+    const auto directory = mPath.parent_path();
+
+#if defined(_WIN32)
+    mDirectory = CreateFileW(
+        directory.c_str(),
+        FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+        NULL
+    );
+    if (mDirectory == INVALID_HANDLE_VALUE)
+    {
+        LOG_ERROR(L"Failed to watch directory '{}', error {}", directory.wstring(), GetLastError());
+        Close();
+        return false;
+    }
+
+    mOverlapped        = OVERLAPPED();
+    mOverlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    mStopEvent         = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (mOverlapped.hEvent == NULL || mStopEvent == NULL)
+    {
+        LOG_ERROR("Failed to create event, error {}", GetLastError());
+        Close();
+        return false;
+    }
+
+    if (!Read())
+    {
+        Close();
+        return false;
+    }
+#elif defined(__linux__)
+    mNotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mNotifyFd < 0 || inotify_add_watch(mNotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        LOG_ERROR("Failed to watch directory '{}', error {}", directory.string(), errno);
+        Close();
+        return false;
+    }
+
+    mStopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mStopFd < 0)
+    {
+        LOG_ERROR("Failed to create stop event, error {}", errno);
+        Close();
+        return false;
+    }
+#else
+    return false;
+#endif
+
+    mThread = std::thread(&FileWatcher::Watch, this);
+
+    return true;
+}
+
+auto FileWatcher::Stop () -> void
+{
+    if (!mThread.joinable())
+    {
+        return;
+    }
+
+#if defined(_WIN32)
+    SetEvent(mStopEvent);
+#elif defined(__linux__)
+    const auto one = std::uint64_t{1};
+    [[maybe_unused]] const auto written = write(mStopFd, &one, sizeof(one));
+#endif
+
+    mThread.join();
+    Close();
+}
+
+auto FileWatcher::Watch () -> void
+{
+    DIAG_THREAD("FileWatcher");
+
+    while (WaitFor(std::chrono::milliseconds::max()) == WaitResult::Changed)
+    {
+        DIAG_SCOPE(Subsystem::Service);
+
+        // Writers often touch file several times, wait until they are done,
+        // but not forever if they never are.
+        auto result = WaitResult::Changed;
+        for (auto round = 0; result == WaitResult::Changed && round < MaxDebounceRounds; ++round)
+        {
+            result = WaitFor(mDebounce);
+        }
+
+        if (result == WaitResult::Stopped)
+        {
+            break;
+        }
+
+        mCallback();
+    }
+}
+
+#if defined(_WIN32)
+
+auto FileWatcher::Read () -> bool
+{
+    ResetEvent(mOverlapped.hEvent);
+
+    const auto queued = ReadDirectoryChangesW(
+        mDirectory,
+        mBuffer.data(),
+        static_cast<DWORD>(mBuffer.size() * sizeof(DWORD)),
+        FALSE,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+        NULL,
+        &mOverlapped,
+        NULL
+    );
+    if (!queued)
+    {
+        LOG_ERROR("ReadDirectoryChangesW() failed with error {}", GetLastError());
+        mIsReading = false;
+        return false;
+    }
+
+    mIsReading = true;
+    return true;
+}
+
+auto FileWatcher::WaitFor (const std::chrono::milliseconds timeout) -> WaitResult
+{
+    const auto infinite = timeout == std::chrono::milliseconds::max();
+    const auto deadline = std::chrono::steady_clock::now() + (infinite ? std::chrono::milliseconds(0) : timeout);
+    const auto fileName = mPath.filename().wstring();
+    const auto handles  = std::array<HANDLE, 2>{ mStopEvent, mOverlapped.hEvent };
+
+    while (true)
+    {
+        auto ms = INFINITE;
+        if (!infinite)
+        {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            ms = left.count() > 0 ? static_cast<DWORD>(left.count()) : 0;
+        }
+
+        switch (WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, ms))
+        {
+        case WAIT_OBJECT_0 + 1:
+            break;
+
+        case WAIT_TIMEOUT:
+            return WaitResult::Timeout;
+
+        default:
+            return WaitResult::Stopped;
+        }
+
+        auto bytes = DWORD{0};
+        mIsReading = false;
+        if (!GetOverlappedResult(mDirectory, &mOverlapped, &bytes, FALSE))
+        {
+            LOG_ERROR("GetOverlappedResult() failed with error {}", GetLastError());
+            return WaitResult::Stopped;
+        }
+
+        // Zero bytes means buffer overflowed and names were lost, assume our
+        // file was among them. Otherwise only entries naming it count.
+        auto changed = bytes == 0;
+        for (auto offset = DWORD{0}; !changed && offset < bytes;)
+        {
+            const auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(
+                reinterpret_cast<const BYTE*>(mBuffer.data()) + offset
+            );
+            const auto name = std::wstring_view(info->FileName, info->FileNameLength / sizeof(wchar_t));
+
+            changed = CompareStringOrdinal(
+                name.data(), static_cast<int>(name.size()),
+                fileName.data(), static_cast<int>(fileName.size()),
+                TRUE
+            ) == CSTR_EQUAL;
+
+            if (info->NextEntryOffset == 0)
+            {
+                break;
+            }
+
+            offset += info->NextEntryOffset;
+        }
+
+        if (!Read())
+        {
+            return WaitResult::Stopped;
+        }
+
+        if (changed)
+        {
+            return WaitResult::Changed;
+        }
+    }
+}
+
+auto FileWatcher::Close () -> void
+{
+    if (mDirectory != INVALID_HANDLE_VALUE)
+    {
+        // Buffer must outlive read in flight.
+        if (mIsReading)
+        {
+            auto bytes = DWORD{0};
+            CancelIoEx(mDirectory, &mOverlapped);
+            GetOverlappedResult(mDirectory, &mOverlapped, &bytes, TRUE);
+            mIsReading = false;
+        }
+
+        CloseHandle(mDirectory);
+        mDirectory = INVALID_HANDLE_VALUE;
+    }
+
+    if (mOverlapped.hEvent != NULL)
+    {
+        CloseHandle(mOverlapped.hEvent);
+        mOverlapped.hEvent = NULL;
+    }
+
+    if (mStopEvent != NULL)
+    {
+        CloseHandle(mStopEvent);
+        mStopEvent = NULL;
+    }
+}
+
+#elif defined(__linux__)
+
+auto FileWatcher::WaitFor (const std::chrono::milliseconds timeout) -> WaitResult
+{
+    const auto ms       = timeout == std::chrono::milliseconds::max() ? -1 : static_cast<int>(timeout.count());
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms < 0 ? 0 : ms);
+    const auto fileName = mPath.filename();
+
+    auto fds = std::array<pollfd, 2>{
+        pollfd{ .fd = mStopFd,   .events = POLLIN, .revents = 0 },
+        pollfd{ .fd = mNotifyFd, .events = POLLIN, .revents = 0 }
+    };
+
+    while (true)
+    {
+        auto remaining = ms;
+        if (ms >= 0)
+        {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            remaining = left.count() > 0 ? static_cast<int>(left.count()) : 0;
+        }
+
+        const auto ready = poll(fds.data(), fds.size(), remaining);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            LOG_ERROR("poll() failed with error {}", errno);
+            return WaitResult::Stopped;
+        }
+
+        if (ready == 0)
+        {
+            return WaitResult::Timeout;
+        }
+
+        if (fds[0].revents)
+        {
+            return WaitResult::Stopped;
+        }
+
+        // Drain events, only ones naming our file count as change.
+        alignas(inotify_event) char buffer[4096];
+        auto changed = false;
+        auto length  = ssize_t{0};
+
+        while ((length = read(mNotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (auto offset = ssize_t{0}; offset < length;)
+            {
+                const auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0 && fileName == event->name)
+                {
+                    changed = true;
+                }
+
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        if (changed)
+        {
+            return WaitResult::Changed;
+        }
+    }
+}
+
+auto FileWatcher::Close () -> void
+{
+    if (mNotifyFd >= 0)
+    {
+        close(mNotifyFd);
+        mNotifyFd = -1;
+    }
+
+    if (mStopFd >= 0)
+    {
+        close(mStopFd);
+        mStopFd = -1;
+    }
+}
+
+#else
+
+auto FileWatcher::WaitFor (const std::chrono::milliseconds) -> WaitResult
+{
+    return WaitResult::Stopped;
+}
+
+auto FileWatcher::Close () -> void
+{
+}
+
+#endif
+
+} // namespace CaffeineTake
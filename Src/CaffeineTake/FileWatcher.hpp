@@ -0,0 +1,110 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#endif
+
+namespace CaffeineTake {
+
+// Watches one file on its own thread and calls back after it was changed
+// and stayed quiet for debounce time. Directory is watched rather than file
+// itself, so files replaced by rename (editors, config management) are
+// still seen. Changes to other files in the directory (logs, temporary files
+// of atomic writes) are filtered out by name. Debounce is restarted by every
+// change, but at most MaxDebounceRounds times, so a file written without
+// pause is still reported.
+class FileWatcher final
+{
+public:
+    using Callback = std::function<void ()>;
+
+    static constexpr auto MaxDebounceRounds = 8;
+
+private:
+    std::filesystem::path     mPath     = std::filesystem::path();
+    Callback                  mCallback = nullptr;
+    std::chrono::milliseconds mDebounce = std::chrono::milliseconds(250);
+    std::thread               mThread;
+
+#if defined(_WIN32)
+    HANDLE             mDirectory  = INVALID_HANDLE_VALUE;
+    HANDLE             mStopEvent  = NULL;
+    OVERLAPPED         mOverlapped = OVERLAPPED();
+    bool               mIsReading  = false;
+    std::vector<DWORD> mBuffer     = std::vector<DWORD>(16 * 1024 / sizeof(DWORD)); // DWORD aligned, as API requires
+
+    // Queue next ReadDirectoryChangesW.
+    auto Read () -> bool;
+#elif defined(__linux__)
+    int    mNotifyFd     = -1;
+    int    mStopFd       = -1;
+#endif
+
+    enum class WaitResult
+    {
+        Changed,
+        Timeout,
+        Stopped
+    };
+
+    auto Watch () -> void;
+
+    // Timeout of milliseconds::max() waits forever.
+    auto WaitFor (const std::chrono::milliseconds timeout) -> WaitResult;
+
+    auto Close () -> void;
+
+public:
+    FileWatcher () = default;
+
+    FileWatcher            (const FileWatcher& rhs) = delete;
+    FileWatcher& operator= (const FileWatcher& rhs) = delete;
+
+    ~FileWatcher ()
+    {
+        Stop();
+    }
+
+    auto Start (
+        const std::filesystem::path&    path,
+        Callback                        callback,
+        const std::chrono::milliseconds debounce = std::chrono::milliseconds(250)
+    ) -> bool;
+
+    auto Stop () -> void;
+
+    auto IsRunning () const -> bool
+    {
+        return mThread.joinable();
+    }
+};
+
+} // namespace CaffeineTake
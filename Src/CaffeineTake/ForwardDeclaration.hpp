@@ -25,7 +25,7 @@
 namespace CaffeineTake {
 
 class Settings;
-using SettingsPtr = std::shared_ptr<Settings>;
+using SettingsPtr = std::shared_ptr<const Settings>;
 
 class Lang;
 using LangPtr = std::shared_ptr<Lang>;
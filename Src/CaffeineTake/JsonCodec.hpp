@@ -0,0 +1,378 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Reflection.hpp"
+#include "Utility.hpp"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace CaffeineTake {
+
+// Scalar or container start as seen by codecs. String view is valid only
+// during the call.
+struct JsonValue
+{
+    enum class Kind : unsigned char
+    {
+        Null,
+        Bool,
+        Integer,
+        Unsigned,
+        Float,
+        String,
+        Object,
+        Array
+    };
+
+    Kind             Type     = Kind::Null;
+    bool             Bool     = false;
+    std::int64_t     Integer  = 0;
+    std::uint64_t    Unsigned = 0;
+    double           Float    = 0.0;
+    std::string_view String   = std::string_view();
+
+    auto IsNumber () const -> bool
+    {
+        return Type == Kind::Integer || Type == Kind::Unsigned || Type == Kind::Float;
+    }
+
+    // Same conversion as nlohmann get<T>() for numbers.
+    template <typename T>
+    auto As () const -> T
+    {
+        switch (Type)
+        {
+        case Kind::Integer:  return static_cast<T>(Integer);
+        case Kind::Unsigned: return static_cast<T>(Unsigned);
+        case Kind::Float:    return static_cast<T>(Float);
+        case Kind::Bool:     return static_cast<T>(Bool);
+        default:             return T();
+        }
+    }
+};
+
+// What value is accepted, checked before codec is called. Follows nlohmann
+// get<T>() rules so files load same as before.
+enum class JsonFieldType : unsigned char
+{
+    Bool,     // true/false only
+    Integer,  // number, or bool as 0/1
+    Enum,     // number only
+    String,
+    Object,
+    Array
+};
+
+#pragma region "JsonWriter"
+
+// Produces same text as nlohmann dump(4), as long as members come sorted
+// by name: four space indent, empty containers on one line, non-ASCII
+// kept as UTF-8.
+class JsonWriter final
+{
+    std::string mText    = std::string();
+    std::string mScratch = std::string();
+    size_t      mDepth   = 0;
+    bool        mFirst   = true;
+
+    auto NewLine () -> void
+    {
+        mText += '\n';
+        mText.append(mDepth * 4, ' ');
+    }
+
+    auto BeginItem () -> void
+    {
+        if (!mFirst)
+        {
+            mText += ',';
+        }
+
+        NewLine();
+        mFirst = false;
+    }
+
+    auto Begin (const char c) -> void
+    {
+        mText  += c;
+        mDepth += 1;
+        mFirst  = true;
+    }
+
+    auto End (const char c) -> void
+    {
+        mDepth -= 1;
+        if (!mFirst)
+        {
+            NewLine();
+        }
+
+        mText  += c;
+        mFirst  = false;
+    }
+
+    template <typename T>
+    auto Number (const T value) -> void
+    {
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        mText.append(buffer, result.ptr);
+    }
+
+public:
+    auto BeginObject () -> void { Begin('{'); }
+    auto EndObject   () -> void { End('}'); }
+    auto BeginArray  () -> void { Begin('['); }
+    auto EndArray    () -> void { End(']'); }
+
+    auto Key (const std::string_view key) -> void
+    {
+        BeginItem();
+        String(key);
+        mText += ": ";
+    }
+
+    auto Element () -> void
+    {
+        BeginItem();
+    }
+
+    auto Bool (const bool value) -> void
+    {
+        mText += value ? "true" : "false";
+    }
+
+    auto Integer (const std::int64_t value) -> void
+    {
+        Number(value);
+    }
+
+    auto Unsigned (const std::uint64_t value) -> void
+    {
+        Number(value);
+    }
+
+    // Value must be valid UTF-8.
+    auto String (const std::string_view value) -> void
+    {
+        constexpr auto hex = std::string_view("0123456789abcdef");
+
+        mText += '"';
+
+        auto begin = size_t{0};
+        for (auto i = size_t{0}; i < value.size(); ++i)
+        {
+            const auto c = static_cast<unsigned char>(value[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+            {
+                continue;
+            }
+
+            mText.append(value.data() + begin, i - begin);
+            begin = i + 1;
+
+            switch (c)
+            {
+            case '"':  mText += "\\\""; break;
+            case '\\': mText += "\\\\"; break;
+            case '\b': mText += "\\b";  break;
+            case '\f': mText += "\\f";  break;
+            case '\n': mText += "\\n";  break;
+            case '\r': mText += "\\r";  break;
+            case '\t': mText += "\\t";  break;
+            default:
+                mText += "\\u00";
+                mText += hex[c >> 4];
+                mText += hex[c & 0x0F];
+                break;
+            }
+        }
+
+        mText.append(value.data() + begin, value.size() - begin);
+        mText += '"';
+    }
+
+    // Unconvertible string is written empty, same as wstring serializer did.
+    auto WString (const std::wstring_view value) -> void
+    {
+        if (!UTF16ToUTF8(value, mScratch))
+        {
+            mScratch.clear();
+        }
+
+        String(mScratch);
+    }
+
+    auto Text () const -> const std::string&
+    {
+        return mText;
+    }
+};
+
+#pragma endregion
+
+#pragma region "JsonCodec"
+
+// JSON form of leaf types, Write emits value and Read converts value that
+// already passed Type check. Specialize for custom types, or pass codec in
+// REFLECT_CODEC for single field.
+template <typename T>
+struct JsonCodec;
+
+template <>
+struct JsonCodec<bool>
+{
+    static constexpr auto Type = JsonFieldType::Bool;
+
+    static auto Write (JsonWriter& writer, const bool value) -> void
+    {
+        writer.Bool(value);
+    }
+
+    static auto Read (const JsonValue& json, bool& value) -> bool
+    {
+        value = json.Bool;
+        return true;
+    }
+};
+
+template <typename T>
+    requires std::is_integral_v<T> && (!std::is_same_v<T, bool>)
+struct JsonCodec<T>
+{
+    static constexpr auto Type = JsonFieldType::Integer;
+
+    static auto Write (JsonWriter& writer, const T value) -> void
+    {
+        if constexpr (std::is_signed_v<T>)
+        {
+            writer.Integer(value);
+        }
+        else
+        {
+            writer.Unsigned(value);
+        }
+    }
+
+    static auto Read (const JsonValue& json, T& value) -> bool
+    {
+        value = json.As<T>();
+        return true;
+    }
+};
+
+template <typename T>
+    requires std::is_enum_v<T>
+struct JsonCodec<T>
+{
+    using Underlying = std::underlying_type_t<T>;
+
+    static constexpr auto Type = JsonFieldType::Enum;
+
+    static auto Write (JsonWriter& writer, const T value) -> void
+    {
+        JsonCodec<Underlying>::Write(writer, static_cast<Underlying>(value));
+    }
+
+    static auto Read (const JsonValue& json, T& value) -> bool
+    {
+        value = static_cast<T>(json.As<Underlying>());
+        return true;
+    }
+};
+
+template <>
+struct JsonCodec<std::wstring>
+{
+    static constexpr auto Type = JsonFieldType::String;
+
+    static auto Write (JsonWriter& writer, const std::wstring& value) -> void
+    {
+        writer.WString(value);
+    }
+
+    // Invalid UTF-8 gives empty string, same as wstring serializer did.
+    static auto Read (const JsonValue& json, std::wstring& value) -> bool
+    {
+        UTF8ToUTF16(json.String, value);
+        return true;
+    }
+};
+
+template <typename T, typename Codec>
+using JsonCodecOf = std::conditional_t<std::is_same_v<Codec, DefaultCodec>, JsonCodec<T>, Codec>;
+
+#pragma endregion
+
+#pragma region "WriteJson"
+
+template <typename T, typename Codec = DefaultCodec>
+auto WriteJson (JsonWriter& writer, const T& value) -> void;
+
+template <Reflected T, size_t I>
+auto WriteJsonField (JsonWriter& writer, const T& value) -> void
+{
+    using Field = FieldType<T, I>;
+    constexpr auto& field = std::get<I>(Reflect<T>::Fields);
+
+    writer.Key(field.Name);
+    WriteJson<typename Field::MemberType, typename Field::CodecType>(writer, value.*field.Pointer);
+}
+
+template <typename T, typename Codec>
+auto WriteJson (JsonWriter& writer, const T& value) -> void
+{
+    if constexpr (std::is_same_v<Codec, DefaultCodec> && Reflected<T>)
+    {
+        // Order is resolved at compile time, no lookups here.
+        writer.BeginObject();
+        [&writer, &value]<size_t... Ks>(std::index_sequence<Ks...>)
+        {
+            (WriteJsonField<T, SortedFields<T>[Ks]>(writer, value), ...);
+        }(std::make_index_sequence<FieldCount<T>>());
+        writer.EndObject();
+    }
+    else if constexpr (std::is_same_v<Codec, DefaultCodec> && IsVector<T>::value)
+    {
+        writer.BeginArray();
+        for (const auto& element : value)
+        {
+            writer.Element();
+            WriteJson(writer, element);
+        }
+        writer.EndArray();
+    }
+    else
+    {
+        JsonCodecOf<T, Codec>::Write(writer, value);
+    }
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
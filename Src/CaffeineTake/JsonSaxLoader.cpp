@@ -0,0 +1,458 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "JsonSaxLoader.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace CaffeineTake {
+
+namespace {
+
+auto Accepts (const JsonFieldType type, const JsonValue& value) -> bool
+{
+    switch (type)
+    {
+    case JsonFieldType::Bool:    return value.Type == JsonValue::Kind::Bool;
+    case JsonFieldType::Integer: return value.IsNumber() || value.Type == JsonValue::Kind::Bool;
+    case JsonFieldType::Enum:    return value.IsNumber();
+    case JsonFieldType::String:  return value.Type == JsonValue::Kind::String;
+    case JsonFieldType::Object:  return value.Type == JsonValue::Kind::Object;
+    case JsonFieldType::Array:   return value.Type == JsonValue::Kind::Array;
+    }
+
+    return false;
+}
+
+// Tracks how far parser has read, for error positions.
+struct TrackingIterator
+{
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = char;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const char*;
+    using reference         = const char&;
+
+    const char*  Ptr  = nullptr;
+    const char** Last = nullptr;
+
+    auto operator* () const -> reference
+    {
+        return *Ptr;
+    }
+
+    auto operator++ () -> TrackingIterator&
+    {
+        ++Ptr;
+        *Last = Ptr;
+        return *this;
+    }
+
+    auto operator++ (int) -> TrackingIterator
+    {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    auto operator== (const TrackingIterator& rhs) const -> bool
+    {
+        return Ptr == rhs.Ptr;
+    }
+};
+
+} // namespace
+
+// nlohmann SAX interface.
+struct JsonSaxLoader::Handler
+{
+    JsonSaxLoader& Loader;
+
+    using number_integer_t  = nlohmann::json::number_integer_t;
+    using number_unsigned_t = nlohmann::json::number_unsigned_t;
+    using number_float_t    = nlohmann::json::number_float_t;
+    using string_t          = nlohmann::json::string_t;
+    using binary_t          = nlohmann::json::binary_t;
+
+    auto null () -> bool
+    {
+        return Loader.Scalar(JsonValue{ .Type = JsonValue::Kind::Null });
+    }
+
+    auto boolean (bool val) -> bool
+    {
+        return Loader.Scalar(JsonValue{ .Type = JsonValue::Kind::Bool, .Bool = val });
+    }
+
+    auto number_integer (number_integer_t val) -> bool
+    {
+        return Loader.Scalar(JsonValue{ .Type = JsonValue::Kind::Integer, .Integer = val });
+    }
+
+    auto number_unsigned (number_unsigned_t val) -> bool
+    {
+        return Loader.Scalar(JsonValue{ .Type = JsonValue::Kind::Unsigned, .Unsigned = val });
+    }
+
+    auto number_float (number_float_t val, const string_t&) -> bool
+    {
+        return Loader.Scalar(JsonValue{ .Type = JsonValue::Kind::Float, .Float = val });
+    }
+
+    auto string (string_t& val) -> bool
+    {
+        return Loader.Scalar(JsonValue{ .Type = JsonValue::Kind::String, .String = val });
+    }
+
+    auto binary (binary_t&) -> bool
+    {
+        return Loader.Scalar(JsonValue{ .Type = JsonValue::Kind::Null });
+    }
+
+    auto start_object (std::size_t) -> bool
+    {
+        return Loader.Start(JsonValue::Kind::Object);
+    }
+
+    auto key (string_t& val) -> bool
+    {
+        return Loader.Key(val);
+    }
+
+    auto end_object () -> bool
+    {
+        return Loader.End();
+    }
+
+    auto start_array (std::size_t) -> bool
+    {
+        return Loader.Start(JsonValue::Kind::Array);
+    }
+
+    auto end_array () -> bool
+    {
+        return Loader.End();
+    }
+
+    auto parse_error (std::size_t position, const std::string&, const nlohmann::detail::exception& ex) -> bool
+    {
+        // Number out of range is reported at its last digit.
+        if (ex.id == 406)
+        {
+            return Loader.Fail(ex.what(), Loader.TokenStart(JsonValue::Kind::Float));
+        }
+
+        return Loader.Fail(ex.what(), position > 0 ? position - 1 : 0);
+    }
+};
+
+auto JsonSaxLoader::Fail (std::string message, size_t offset) -> bool
+{
+    mError.Message = std::move(message);
+    mError.Offset  = offset;
+    mError.Line    = 1;
+    mError.Column  = 1;
+
+    for (auto i = size_t{0}; i < offset && i < mInput.size(); ++i)
+    {
+        if (mInput[i] == '\n')
+        {
+            mError.Line  += 1;
+            mError.Column = 1;
+        }
+        else
+        {
+            mError.Column += 1;
+        }
+    }
+
+    return false;
+}
+
+auto JsonSaxLoader::TokenStart (const JsonValue::Kind kind) const -> size_t
+{
+    auto end = static_cast<size_t>(mLast - mInput.data());
+
+    const auto isNumber = [](const char c)
+    {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    };
+
+    switch (kind)
+    {
+    case JsonValue::Kind::String:
+        // Opening quote is first one back not escaped, backslashes before
+        // it come in pairs.
+        for (auto i = end > 0 ? end - 1 : 0; i-- > 0; )
+        {
+            if (mInput[i] != '"')
+            {
+                continue;
+            }
+
+            auto slashes = size_t{0};
+            while (slashes < i && mInput[i - slashes - 1] == '\\')
+            {
+                slashes += 1;
+            }
+
+            if (slashes % 2 == 0)
+            {
+                return i;
+            }
+        }
+        return 0;
+
+    case JsonValue::Kind::Integer:
+    case JsonValue::Kind::Unsigned:
+    case JsonValue::Kind::Float:
+        // Character after number was read too, unless input ended.
+        if (end > 0 && !isNumber(mInput[end - 1]))
+        {
+            end -= 1;
+        }
+        while (end > 0 && isNumber(mInput[end - 1]))
+        {
+            end -= 1;
+        }
+        return end;
+
+    case JsonValue::Kind::Null:
+    case JsonValue::Kind::Bool:
+        while (end > 0 && mInput[end - 1] >= 'a' && mInput[end - 1] <= 'z')
+        {
+            end -= 1;
+        }
+        return end;
+
+    case JsonValue::Kind::Object:
+    case JsonValue::Kind::Array:
+        break;
+    }
+
+    // Opening or closing bracket.
+    return end > 0 ? end - 1 : 0;
+}
+
+auto JsonSaxLoader::PathOf (const std::string_view name, const bool isElement) const -> std::string
+{
+    auto path = std::string();
+
+    const auto append = [&path](const std::string_view part, const bool element)
+    {
+        if (element)
+        {
+            path += "[]";
+        }
+        else if (!part.empty())
+        {
+            if (!path.empty())
+            {
+                path += '.';
+            }
+            path += part;
+        }
+    };
+
+    for (const auto& frame : mFrames)
+    {
+        append(frame.Name, frame.IsElement);
+    }
+
+    append(name, isElement);
+
+    return path.empty() ? std::string("<root>") : path;
+}
+
+auto JsonSaxLoader::NextTarget (std::string_view& name, bool& isElement) -> JsonTarget
+{
+    name      = std::string_view();
+    isElement = false;
+
+    if (mFrames.empty())
+    {
+        return std::exchange(mRoot, JsonTarget());
+    }
+
+    const auto& frame = mFrames.back();
+    if (frame.Target.Ops->Type == JsonFieldType::Array)
+    {
+        isElement = true;
+        return frame.Target.Ops->Append(frame.Target.Object);
+    }
+
+    name = mNextName;
+    return std::exchange(mNext, JsonTarget());
+}
+
+auto JsonSaxLoader::Scalar (const JsonValue& value) -> bool
+{
+    if (mSkipDepth > 0)
+    {
+        return true;
+    }
+
+    auto name      = std::string_view();
+    auto isElement = false;
+    const auto target = NextTarget(name, isElement);
+    if (!target.Object)
+    {
+        return true;
+    }
+
+    if (!Accepts(target.Ops->Type, value))
+    {
+        return Fail("Unexpected type of '" + PathOf(name, isElement) + "'", TokenStart(value.Type));
+    }
+
+    if (!target.Ops->Set(target.Object, value))
+    {
+        return Fail("Invalid value of '" + PathOf(name, isElement) + "'", TokenStart(value.Type));
+    }
+
+    return true;
+}
+
+auto JsonSaxLoader::Start (const JsonValue::Kind kind) -> bool
+{
+    if (mSkipDepth > 0)
+    {
+        mSkipDepth += 1;
+        return true;
+    }
+
+    auto name      = std::string_view();
+    auto isElement = false;
+    const auto target = NextTarget(name, isElement);
+    if (!target.Object)
+    {
+        mSkipDepth = 1;
+        return true;
+    }
+
+    if (!Accepts(target.Ops->Type, JsonValue{ .Type = kind }))
+    {
+        return Fail("Unexpected type of '" + PathOf(name, isElement) + "'", TokenStart(kind));
+    }
+
+    // Arrays are replaced as a whole, like nlohmann get_to() did.
+    if (kind == JsonValue::Kind::Array)
+    {
+        target.Ops->Clear(target.Object);
+    }
+
+    mFrames.push_back(Frame{ .Target = target, .Name = name, .IsElement = isElement });
+
+    return true;
+}
+
+auto JsonSaxLoader::End () -> bool
+{
+    if (mSkipDepth > 0)
+    {
+        mSkipDepth -= 1;
+        return true;
+    }
+
+    const auto& frame = mFrames.back();
+    const auto* ops   = frame.Target.Ops;
+
+    if (ops->Type == JsonFieldType::Object)
+    {
+        const auto missing = ops->Required & ~frame.Seen;
+        if (missing != 0)
+        {
+            const auto field = static_cast<size_t>(std::countr_zero(missing));
+            return Fail("Missing '" + PathOf(ops->Names[field], false) + "'", TokenStart(JsonValue::Kind::Object));
+        }
+    }
+
+    mFrames.pop_back();
+
+    return true;
+}
+
+auto JsonSaxLoader::Key (const std::string_view key) -> bool
+{
+    if (mSkipDepth > 0)
+    {
+        return true;
+    }
+
+    auto&       frame = mFrames.back();
+    const auto* ops   = frame.Target.Ops;
+
+    // Files we write have members in sorted order, so expected one is
+    // checked first and binary search is fallback.
+    auto position = frame.Hint;
+    if (position >= ops->Count || ops->Names[ops->Sorted[position]] != key)
+    {
+        const auto begin = ops->Sorted;
+        const auto end   = ops->Sorted + ops->Count;
+        const auto it    = std::lower_bound(begin, end, key, [ops](const size_t field, const std::string_view k)
+        {
+            return ops->Names[field] < k;
+        });
+
+        position = static_cast<size_t>(it - begin);
+        if (it == end || ops->Names[*it] != key)
+        {
+            mNext = JsonTarget();
+            return true;
+        }
+    }
+
+    const auto field = ops->Sorted[position];
+
+    frame.Hint  = position + 1;
+    frame.Seen |= std::uint64_t{1} << field;
+
+    mNext     = ops->Members[field](frame.Target.Object);
+    mNextName = ops->Names[field];
+
+    return true;
+}
+
+auto JsonSaxLoader::Load (const std::string_view input, const JsonTarget root, const bool ignoreComments) -> bool
+{
+    mInput     = input;
+    mLast      = input.data();
+    mRoot      = root;
+    mNext      = JsonTarget();
+    mNextName  = std::string_view();
+    mSkipDepth = 0;
+    mError     = JsonLoadError();
+    mFrames.clear();
+
+    auto handler = Handler{ *this };
+    auto begin   = TrackingIterator{ input.data(), &mLast };
+    auto end     = TrackingIterator{ input.data() + input.size(), &mLast };
+
+    return nlohmann::json::sax_parse(
+        begin, end, &handler, nlohmann::json::input_format_t::json, true, ignoreComments
+    );
+}
+
+} // namespace CaffeineTake
@@ -0,0 +1,210 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "JsonCodec.hpp"
+#include "Reflection.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace CaffeineTake {
+
+struct JsonTarget;
+
+using JsonMemberFn = JsonTarget (*)(void* object);
+
+// How to read one C++ type, generated from field tables and codecs. Loader
+// works only through these, so it isn't a template itself.
+struct JsonTypeOps
+{
+    JsonFieldType Type = JsonFieldType::Object;
+
+    // Leaf types.
+    bool (*Set) (void* target, const JsonValue& value) = nullptr;
+
+    // Reflected structs, names in declaration order.
+    const std::string_view* Names    = nullptr;
+    const size_t*           Sorted   = nullptr;
+    const JsonMemberFn*     Members  = nullptr;
+    size_t                  Count    = 0;
+    std::uint64_t           Required = 0;
+
+    // Vectors.
+    void       (*Clear)  (void* vector) = nullptr;
+    JsonTarget (*Append) (void* vector) = nullptr;
+};
+
+struct JsonTarget
+{
+    void*              Object = nullptr;
+    const JsonTypeOps* Ops    = nullptr;
+};
+
+#pragma region "JsonTypeOps"
+
+template <typename T, typename Codec = DefaultCodec>
+constexpr auto MakeJsonOps () -> JsonTypeOps;
+
+template <typename T, typename Codec = DefaultCodec>
+inline constexpr auto JsonOps = MakeJsonOps<T, Codec>();
+
+template <Reflected T, size_t I>
+auto JsonMember (void* object) -> JsonTarget
+{
+    using Field = FieldType<T, I>;
+    constexpr auto& field = std::get<I>(Reflect<T>::Fields);
+
+    return JsonTarget{
+        &(static_cast<T*>(object)->*field.Pointer),
+        &JsonOps<typename Field::MemberType, typename Field::CodecType>
+    };
+}
+
+template <Reflected T>
+constexpr auto JsonMembers = []<size_t... Is>(std::index_sequence<Is...>)
+{
+    return std::array<JsonMemberFn, sizeof...(Is)>{ &JsonMember<T, Is>... };
+}(std::make_index_sequence<FieldCount<T>>());
+
+template <typename T, typename Codec>
+auto JsonSet (void* target, const JsonValue& value) -> bool
+{
+    return JsonCodecOf<T, Codec>::Read(value, *static_cast<T*>(target));
+}
+
+template <typename T>
+auto JsonClear (void* vector) -> void
+{
+    static_cast<T*>(vector)->clear();
+}
+
+template <typename T>
+auto JsonAppend (void* vector) -> JsonTarget
+{
+    auto& element = static_cast<T*>(vector)->emplace_back();
+    return JsonTarget{ &element, &JsonOps<typename T::value_type> };
+}
+
+template <typename T, typename Codec>
+constexpr auto MakeJsonOps () -> JsonTypeOps
+{
+    auto ops = JsonTypeOps();
+
+    if constexpr (std::is_same_v<Codec, DefaultCodec> && Reflected<T>)
+    {
+        ops.Type     = JsonFieldType::Object;
+        ops.Names    = FieldNames<T>.data();
+        ops.Sorted   = SortedFields<T>.data();
+        ops.Members  = JsonMembers<T>.data();
+        ops.Count    = FieldCount<T>;
+        ops.Required = RequiredFields<T>;
+    }
+    else if constexpr (std::is_same_v<Codec, DefaultCodec> && IsVector<T>::value)
+    {
+        ops.Type   = JsonFieldType::Array;
+        ops.Clear  = &JsonClear<T>;
+        ops.Append = &JsonAppend<T>;
+    }
+    else
+    {
+        ops.Type = JsonCodecOf<T, Codec>::Type;
+        ops.Set  = &JsonSet<T, Codec>;
+    }
+
+    return ops;
+}
+
+#pragma endregion
+
+struct JsonLoadError
+{
+    std::string Message = std::string();
+    size_t      Offset  = 0;   // of offending character, or start of offending value
+    size_t      Line    = 0;   // 1-based
+    size_t      Column  = 0;   // 1-based, in bytes
+};
+
+// Streaming loader, values are stored into target while parsing, no DOM is
+// built. Members are matched against sorted names of their struct, a file
+// written by WriteJson hits on first compare. Unknown members are skipped,
+// missing required ones fail the load.
+class JsonSaxLoader final
+{
+    struct Frame
+    {
+        JsonTarget       Target    = JsonTarget();
+        std::string_view Name      = std::string_view();
+        bool             IsElement = false;
+        std::uint64_t    Seen      = 0;    // objects, bit per field
+        size_t           Hint      = 0;    // objects, next sorted field expected
+    };
+
+    struct Handler;
+
+    std::string_view   mInput     = std::string_view();
+    const char*        mLast      = nullptr;
+    std::vector<Frame> mFrames    = std::vector<Frame>();
+    JsonTarget         mRoot      = JsonTarget();
+    JsonTarget         mNext      = JsonTarget();
+    std::string_view   mNextName  = std::string_view();
+    size_t             mSkipDepth = 0;
+    JsonLoadError      mError     = JsonLoadError();
+
+    auto Fail (std::string message, size_t offset) -> bool;
+
+    // Offset of first character of token parser has just read, value of
+    // given kind or bracket of object or array.
+    auto TokenStart (const JsonValue::Kind kind) const -> size_t;
+
+    auto PathOf (const std::string_view name, const bool isElement) const -> std::string;
+
+    // Target next value goes to, empty if it should be skipped.
+    auto NextTarget (std::string_view& name, bool& isElement) -> JsonTarget;
+
+    auto Scalar (const JsonValue& value) -> bool;
+    auto Start  (const JsonValue::Kind kind) -> bool;
+    auto End    () -> bool;
+    auto Key    (const std::string_view key) -> bool;
+
+    auto Load (const std::string_view input, const JsonTarget root, const bool ignoreComments) -> bool;
+
+public:
+    // On failure target is partially filled.
+    template <Reflected T>
+    auto Load (const std::string_view input, T& target, const bool ignoreComments = true) -> bool
+    {
+        return Load(input, JsonTarget{ &target, &JsonOps<T> }, ignoreComments);
+    }
+
+    auto Error () const -> const JsonLoadError&
+    {
+        return mError;
+    }
+};
+
+} // namespace CaffeineTake
@@ -23,90 +23,128 @@
 #include "Lang.hpp"
 
 #if defined(FEATURE_CAFFEINETAKE_MULTILANG)
+#   include "BinaryCache.hpp"
+#   include "JsonCodec.hpp"
+#   include "JsonSaxLoader.hpp"
 #   include "Logger.hpp"
-#   include "Serializers.hpp"
-#   include <nlohmann/json.hpp>
-#   include <fstream>
+#   include "Persistence.hpp"
+#   include "Reflection.hpp"
+#   include <string_view>
+#   include <utility>
 #endif
 
 namespace CaffeineTake {
 
 #if defined(FEATURE_CAFFEINETAKE_MULTILANG)
 
-inline auto to_json (nlohmann::json& j, const Lang& lang)
-{
-}
-
-#define LOAD_LANG_STR(_str) lang.##_str = j.value<std::wstring>(#_str, def.##_str)
-
-inline auto from_json (const nlohmann::json& j, Lang& lang)
-{
-    static auto def = Lang();
-
-    LOAD_LANG_STR(ContextMenu_DisableCaffeine);
-    LOAD_LANG_STR(ContextMenu_EnableStandard );
-    LOAD_LANG_STR(ContextMenu_EnableAuto     );
-    LOAD_LANG_STR(ContextMenu_EnableTimer    );
-    LOAD_LANG_STR(ContextMenu_Settings       );
-    LOAD_LANG_STR(ContextMenu_About          );
-    LOAD_LANG_STR(ContextMenu_Exit           );
-
-    LOAD_LANG_STR(Tip_DisabledInactive       );
-    LOAD_LANG_STR(Tip_DisabledActive         );
-    LOAD_LANG_STR(Tip_StandardInactive       );
-    LOAD_LANG_STR(Tip_StandardActive         );
-    LOAD_LANG_STR(Tip_AutoInactive           );
-    LOAD_LANG_STR(Tip_AutoActive             );
-    LOAD_LANG_STR(Tip_TimerInactive          );
-    LOAD_LANG_STR(Tip_TimerActive            );
-
-    LOAD_LANG_STR(Task_DisableCaffeine       );
-    LOAD_LANG_STR(Task_EnableStandardMode    );
-    LOAD_LANG_STR(Task_EnableAutoMode        );
-    LOAD_LANG_STR(Task_EnableTimerMode       );
-    LOAD_LANG_STR(Task_Settings              );
-    LOAD_LANG_STR(Task_About                 );
-    LOAD_LANG_STR(Task_Exit                  );
-}
-
-#undef LOAD_LANG_STR
+// LangId and LangName are set manually, everything else is optional and
+// missing strings keep English defaults.
+REFLECT(
+    Lang,
+    REFLECT_OPTIONAL(ContextMenu_DisableCaffeine),
+    REFLECT_OPTIONAL(ContextMenu_EnableStandard),
+    REFLECT_OPTIONAL(ContextMenu_EnableAuto),
+    REFLECT_OPTIONAL(ContextMenu_EnableTimer),
+    REFLECT_OPTIONAL(ContextMenu_Settings),
+    REFLECT_OPTIONAL(ContextMenu_About),
+    REFLECT_OPTIONAL(ContextMenu_Exit),
+
+    REFLECT_OPTIONAL(Tip_DisabledInactive),
+    REFLECT_OPTIONAL(Tip_DisabledActive),
+    REFLECT_OPTIONAL(Tip_StandardInactive),
+    REFLECT_OPTIONAL(Tip_StandardActive),
+    REFLECT_OPTIONAL(Tip_AutoInactive),
+    REFLECT_OPTIONAL(Tip_AutoActive),
+    REFLECT_OPTIONAL(Tip_TimerInactive),
+    REFLECT_OPTIONAL(Tip_TimerActive),
+
+    REFLECT_OPTIONAL(Task_DisableCaffeine),
+    REFLECT_OPTIONAL(Task_EnableStandardMode),
+    REFLECT_OPTIONAL(Task_EnableAutoMode),
+    REFLECT_OPTIONAL(Task_EnableTimerMode),
+    REFLECT_OPTIONAL(Task_Settings),
+    REFLECT_OPTIONAL(Task_About),
+    REFLECT_OPTIONAL(Task_Exit)
+);
+
+constexpr auto LangCacheSchema = BinarySchema<Lang>;
 
 #endif
 
-auto Lang::Load (const fs::path& path) -> bool
+auto Lang::Load (const fs::path& path, const fs::path& cachePath, bool* cacheStale) -> bool
 {
 #if defined(FEATURE_CAFFEINETAKE_MULTILANG)
+    if (cacheStale)
+    {
+        *cacheStale = false;
+    }
+
+    // Use cache if it was made from this very file.
+    if (!cachePath.empty())
+    {
+        auto cached = Lang();
+        const auto loaded = BinaryCache::Load(cachePath, path, LangCacheSchema, [&cached](BinaryReader& reader)
+        {
+            return ReadBinary(reader, cached);
+        });
+
+        if (loaded)
+        {
+            *this = std::move(cached);
+            LOG_INFO(L"Loaded language '{}' from cache", path.wstring());
+            return true;
+        }
+    }
+
     // NOTE: Language file should be in UTF-8
     // Open lang file for read.
-    auto file = std::ifstream(path);
-    if (!file)
+    auto file = MappedFile();
+    if (!file.Open(path))
     {
         LOG_ERROR(L"Failed to open lang file '{}' for reading", path.wstring());
         return false;
     }
 
     // Deserialize.
-    auto json = nlohmann::json::parse(file, nullptr, false, true);
-    if (json.is_discarded())
+    const auto input  = std::string_view(reinterpret_cast<const char*>(file.Data()), file.Size());
+    auto       loaded = Lang();
+    auto       loader = JsonSaxLoader();
+
+    if (!loader.Load(input, loaded))
     {
-        LOG_ERROR(L"Failed to parse lang '{}'", path.wstring());
+        const auto& error = loader.Error();
+        LOG_ERROR(L"Failed to load language file '{}'", path.wstring());
+        LOG_ERROR("{} (line {}, column {})", error.Message, error.Line, error.Column);
         return false;
     }
-    
-    try
+
+    *this = std::move(loaded);
+
+    LOG_INFO(L"Loaded language '{}'", path.wstring());
+
+    if (cacheStale)
     {
-        json.get_to<Lang>(*this);
+        *cacheStale = !cachePath.empty();
     }
-    catch (nlohmann::json::exception& e)
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto Lang::StoreCache (const fs::path& path, const fs::path& cachePath) const -> bool
+{
+#if defined(FEATURE_CAFFEINETAKE_MULTILANG)
+    auto writer = BinaryWriter();
+    WriteBinary(writer, *this);
+
+    if (!BinaryCache::Store(cachePath, path, LangCacheSchema, writer))
     {
-        LOG_ERROR(L"Failed to deserialize language file '{}'", path.wstring());
-        LOG_DEBUG("what() {}", e.what());
+        LOG_WARNING(L"Failed to store language cache '{}'", cachePath.wstring());
         return false;
     }
 
-    LOG_DEBUG("{}", json.dump(4));
-    LOG_INFO(L"Loaded language '{}'", path.wstring());
-
     return true;
 #else
     return false;
@@ -116,7 +154,16 @@ auto Lang::Load (const fs::path& path) -> bool
 auto Lang::Save (const fs::path& path) -> bool
 {
 #if defined(FEATURE_CAFFEINETAKE_MULTILANG)
-    return false;
+    auto writer = JsonWriter();
+    WriteJson(writer, *this);
+
+    if (!WriteFileAtomic(path, writer.Text()))
+    {
+        LOG_ERROR(L"Failed to write lang file '{}'", path.wstring());
+        return false;
+    }
+
+    return true;
 #else
     return true;
 #endif
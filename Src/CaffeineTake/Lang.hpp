@@ -62,8 +62,14 @@ public:
     std::wstring Task_About                  = L"About";
     std::wstring Task_Exit                   = L"Exit";          
 
-    auto Load (const fs::path& path) -> bool;
+    // With cachePath, binary cache is used instead of parsing when it
+    // matches the file. Parsing doesn't touch the cache, cacheStale is set
+    // then and StoreCache should follow.
+    auto Load (const fs::path& path, const fs::path& cachePath = fs::path(), bool* cacheStale = nullptr) -> bool;
     auto Save (const fs::path& path) -> bool;
+
+    // Cache of this language keyed by path as it is on disk now.
+    auto StoreCache (const fs::path& path, const fs::path& cachePath) const -> bool;
 };
 
 } // namespace CaffeineTake
@@ -0,0 +1,81 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "LocalClock.hpp"
+
+namespace CaffeineTake {
+
+auto LocalClock::Get () -> LocalClock&
+{
+    static auto instance = LocalClock();
+    return instance;
+}
+
+auto LocalClock::RefreshLocked (SystemTimePoint time) -> void
+{
+    if (!mZone)
+    {
+        mZone = mFixedZone ? mFixedZone : std::chrono::current_zone();
+    }
+
+    const auto info = mZone->get_info(time);
+
+    mBegin  = info.begin;
+    mEnd    = info.end;
+    mOffset = info.offset;
+}
+
+auto LocalClock::Zone (SystemTimePoint time) -> const std::chrono::time_zone*
+{
+    auto lock = std::lock_guard<std::mutex>(mClockMutex);
+
+    if (!mZone || time < mBegin || time >= mEnd)
+    {
+        RefreshLocked(time);
+    }
+
+    return mZone;
+}
+
+auto LocalClock::ToLocal (SystemTimePoint time) -> LocalTimePoint
+{
+    auto lock = std::lock_guard<std::mutex>(mClockMutex);
+
+    // Outside cached range, a transition passed or time went backwards.
+    if (!mZone || time < mBegin || time >= mEnd)
+    {
+        RefreshLocked(time);
+    }
+
+    return LocalTimePoint(time.time_since_epoch() + mOffset);
+}
+
+auto LocalClock::Invalidate () -> void
+{
+    auto lock = std::lock_guard<std::mutex>(mClockMutex);
+
+    mZone   = nullptr;
+    mBegin  = std::chrono::sys_seconds();
+    mEnd    = std::chrono::sys_seconds();
+    mOffset = std::chrono::seconds();
+}
+
+} // namespace CaffeineTake
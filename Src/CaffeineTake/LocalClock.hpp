@@ -0,0 +1,79 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+namespace CaffeineTake {
+
+// Wall clock converted to local time without a tzdb lookup per call. Zone and
+// its UTC offset are cached until next known transition (DST change), after
+// that or after Invalidate() they are looked up again.
+// Get() follows system time zone, tests construct one with a fixed zone.
+// For measuring intervals use SteadyNow(), it doesn't jump with wall clock.
+class LocalClock final
+{
+public:
+    using SteadyClock     = std::chrono::steady_clock;
+    using SteadyTimePoint = SteadyClock::time_point;
+    using SystemTimePoint = std::chrono::system_clock::time_point;
+    using LocalTimePoint  = std::chrono::local_time<std::chrono::system_clock::duration>;
+
+private:
+    mutable std::mutex             mClockMutex;
+    const std::chrono::time_zone*  mFixedZone = nullptr;   // system zone if null
+    const std::chrono::time_zone*  mZone      = nullptr;
+    std::chrono::sys_seconds       mBegin     = std::chrono::sys_seconds();
+    std::chrono::sys_seconds       mEnd       = std::chrono::sys_seconds();
+    std::chrono::seconds           mOffset    = std::chrono::seconds();
+
+    auto RefreshLocked (SystemTimePoint time) -> void;
+
+    LocalClock            (const LocalClock& rhs) = delete;
+    LocalClock& operator= (const LocalClock& rhs) = delete;
+
+public:
+    explicit LocalClock (const std::chrono::time_zone* zone = nullptr)
+        : mFixedZone (zone)
+    {
+    }
+
+    static auto Get () -> LocalClock&;
+
+    auto Zone    (SystemTimePoint time = std::chrono::system_clock::now()) -> const std::chrono::time_zone*;
+    auto ToLocal (SystemTimePoint time) -> LocalTimePoint;
+
+    auto LocalNow () -> LocalTimePoint
+    {
+        return ToLocal(std::chrono::system_clock::now());
+    }
+
+    // Drop cached zone, call when system time or time zone was changed.
+    auto Invalidate () -> void;
+
+    static auto SteadyNow () -> SteadyTimePoint
+    {
+        return SteadyClock::now();
+    }
+};
+
+} // namespace CaffeineTake
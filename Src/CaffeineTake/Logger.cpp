@@ -23,39 +23,338 @@
 
 #if defined(FEATURE_CAFFEINETAKE_LOGGER)
 
+#include "Diagnostics.hpp"
+#include "RotatingLogSink.hpp"
+#include "Utility.hpp"
+
 #include <spdlog/spdlog.h>
-#include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/msvc_sink.h>
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 
 namespace {
     namespace fs = std::filesystem;
+
+    constexpr auto LoggerName = "file_logger";
 }
 
 namespace CaffeineTake {
 
-auto InitLogger (const fs::path& logFilePath) -> bool
+auto LogWideToUtf8 (const std::wstring_view wide, std::string& out) -> void
+{
+    UTF16ToUTF8(wide, out);
+}
+
+#pragma region "AsyncLogger"
+
+AsyncLogger::AsyncLogger ()
+    : mSlots (std::make_unique<Slot[]>(Capacity))
+{
+    for (auto i = size_t{0}; i < Capacity; ++i)
+    {
+        mSlots[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+AsyncLogger::~AsyncLogger ()
+{
+    Stop();
+
+    // Never started or logged after stop, only free captured arguments.
+    auto wide = std::wstring();
+    while (HasPending())
+    {
+        auto& slot = mSlots[mDequeuePos & (Capacity - 1)];
+        slot.Record.Consume(slot.Record, nullptr, wide);
+        slot.Sequence.store(mDequeuePos + Capacity, std::memory_order_release);
+        ++mDequeuePos;
+    }
+}
+
+auto AsyncLogger::Get () -> AsyncLogger&
+{
+    static auto instance = AsyncLogger();
+    return instance;
+}
+
+auto AsyncLogger::Start (
+    std::vector<spdlog::sink_ptr> sinks,
+    LogLevel                      level,
+    LogLevel                      flushLevel,
+    std::chrono::milliseconds     flushInterval
+) -> void
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    if (mIsRunning)
+    {
+        return;
+    }
+
+    mSinks         = std::move(sinks);
+    mFlushInterval = flushInterval;
+    mIsRunning     = true;
+    mIsDone        = false;
+    mLevel.store(level, std::memory_order_relaxed);
+    mFlushLevel.store(flushLevel, std::memory_order_relaxed);
+
+    mThread = std::thread(&AsyncLogger::Service, this);
+}
+
+auto AsyncLogger::Stop () -> void
+{
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+        if (!mIsRunning)
+        {
+            return;
+        }
+
+        mIsDone = true;
+    }
+
+    mConditionVar.notify_one();
+
+    if (mThread.joinable())
+    {
+        mThread.join();
+    }
+
+    // Records committed while writer was finishing.
+    auto text     = std::string();
+    auto wide     = std::wstring();
+    auto isUrgent = false;
+    Drain(text, wide, isUrgent);
+    Flush();
+
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    mIsRunning = false;
+}
+
+auto AsyncLogger::Reserve (size_t& position) -> LogRecord*
+{
+    auto pos = mEnqueuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto&      slot     = mSlots[pos & (Capacity - 1)];
+        const auto sequence = slot.Sequence.load(std::memory_order_acquire);
+        const auto diff     = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+
+        if (diff == 0)
+        {
+            if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                position = pos;
+                return &slot.Record;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Writer is a full ring behind.
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+        {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+auto AsyncLogger::Commit (size_t position) -> void
+{
+    auto&      slot     = mSlots[position & (Capacity - 1)];
+    const auto isUrgent = slot.Record.Level >= mFlushLevel.load(std::memory_order_relaxed);
+
+    slot.Sequence.store(position + 1, std::memory_order_release);
+    mEnqueued.fetch_add(1, std::memory_order_relaxed);
+
+    // Pairs with fence in Service, either writer sees the record before it
+    // goes to sleep or we see it is sleeping. Besides that writer is woken
+    // for records that must be flushed now and every quarter of ring.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (isUrgent
+     || mIsWaiting.load(std::memory_order_relaxed)
+     || (position & (Capacity / 4 - 1)) == 0)
+    {
+        {
+            auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+        }
+
+        mConditionVar.notify_one();
+    }
+}
+
+auto AsyncLogger::Stats () const -> LogStats
+{
+    auto stats = LogStats();
+    stats.Enqueued = mEnqueued.load(std::memory_order_relaxed);
+    stats.Dropped  = mDropped.load(std::memory_order_relaxed);
+    stats.Written  = mWritten.load(std::memory_order_relaxed);
+    stats.Flushes  = mFlushes.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+auto AsyncLogger::Service () -> void
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto text       = std::string();
+    auto wide       = std::wstring();
+    auto isDirty    = false;
+    auto dirtySince = Clock::time_point();
+
+    DIAG_THREAD("Logger");
+
+    auto waitLock = std::unique_lock<std::mutex>(mMutex);
+    while (true)
+    {
+        DIAG_SCOPE(Subsystem::Logger);
+
+        waitLock.unlock();
+
+        auto isUrgent = false;
+        if (Drain(text, wide, isUrgent) > 0 && !isDirty)
+        {
+            isDirty    = true;
+            dirtySince = Clock::now();
+        }
+
+        // Batch is flushed at once, right away if it has warning or error
+        // in it, otherwise when it gets old enough.
+        if (isDirty && (isUrgent || Clock::now() - dirtySince >= mFlushInterval))
+        {
+            Flush();
+            isDirty = false;
+        }
+
+        waitLock.lock();
+        if (mIsDone)
+        {
+            break;
+        }
+
+        if (isDirty)
+        {
+            mConditionVar.wait_until(waitLock, dirtySince + mFlushInterval);
+            continue;
+        }
+
+        // Nothing to flush, sleep until next record.
+        mIsWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        mConditionVar.wait(waitLock, [this] { return mIsDone || HasPending(); });
+        mIsWaiting.store(false, std::memory_order_relaxed);
+    }
+}
+
+auto AsyncLogger::Drain (std::string& text, std::wstring& wide, bool& isUrgent) -> size_t
+{
+    const auto flushLevel = mFlushLevel.load(std::memory_order_relaxed);
+
+    auto count = size_t{0};
+    while (HasPending())
+    {
+        auto& slot   = mSlots[mDequeuePos & (Capacity - 1)];
+        auto& record = slot.Record;
+
+        text.clear();
+        record.Consume(record, &text, wide);
+        Write(record.Level, record.Time, record.ThreadId, text);
+
+        isUrgent = isUrgent || record.Level >= flushLevel;
+
+        slot.Sequence.store(mDequeuePos + Capacity, std::memory_order_release);
+        ++mDequeuePos;
+        ++count;
+    }
+
+    const auto dropped = mDropped.load(std::memory_order_relaxed);
+    if (dropped != mReported)
+    {
+        text.assign("Log queue overflow, dropped ");
+        text.append(std::to_string(dropped - mReported));
+        text.append(" messages");
+        Write(LogLevel::warn, spdlog::log_clock::now(), spdlog::details::os::thread_id(), text);
+
+        mReported = dropped;
+        ++count;
+    }
+
+    mWritten.fetch_add(count, std::memory_order_relaxed);
+
+    return count;
+}
+
+auto AsyncLogger::Write (LogLevel level, spdlog::log_clock::time_point time, size_t threadId, const std::string_view text) -> void
+{
+    auto msg = spdlog::details::log_msg(time, spdlog::source_loc(), LoggerName, level, spdlog::string_view_t(text.data(), text.size()));
+    msg.thread_id = threadId;
+
+    for (auto& sink : mSinks)
+    {
+        if (!sink->should_log(level))
+        {
+            continue;
+        }
+
+        try
+        {
+            sink->log(msg);
+        }
+        catch (const std::exception&)
+        {
+            // Nowhere to report it.
+        }
+    }
+}
+
+auto AsyncLogger::Flush () -> void
+{
+    for (auto& sink : mSinks)
+    {
+        try
+        {
+            sink->flush();
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+
+    mFlushes.fetch_add(1, std::memory_order_relaxed);
+}
+
+#pragma endregion
+
+auto InitLogger (const fs::path& logFilePath, const LogRotation& rotation) -> bool
 {
-    auto logger = spdlog::basic_logger_mt("file_logger", logFilePath.string(), true);
-    logger->set_pattern("[%Y-%m-%d %T.%e][%8l]{%5t} %v");
+    auto fileSink = std::make_shared<RotatingLogSink>(logFilePath, rotation);
+    fileSink->set_pattern("[%Y-%m-%d %T.%e][%8l]{%5t} %v");
 
-    spdlog::flush_on(spdlog::level::info);
-    spdlog::set_level(spdlog::level::level_enum::info);
+    auto sinks = std::vector<spdlog::sink_ptr>{fileSink};
+    auto level = spdlog::level::info;
 
 #if defined(_DEBUG) && defined(_WIN32)
     auto vsdbgsink = std::make_shared<spdlog::sinks::windebug_sink_mt>();
     vsdbgsink->set_pattern("[%8l]{%5t} %v");
-    logger->sinks().push_back(vsdbgsink);
+    sinks.push_back(vsdbgsink);
 
-    spdlog::flush_on(spdlog::level::debug);
-    spdlog::set_level(spdlog::level::level_enum::debug);
+    level = spdlog::level::debug;
 #endif
 
-    spdlog::set_default_logger(logger);
+    // Warnings and errors are flushed when written, everything else in
+    // batches at most one second old.
+    AsyncLogger::Get().Start(std::move(sinks), level, spdlog::level::warn, std::chrono::milliseconds(1000));
 
     return true;
 }
@@ -22,6 +22,7 @@
 
 #include "Config.hpp"
 
+#include <cstddef>
 #include <filesystem>
 #include <cstdarg>
 
@@ -32,13 +33,399 @@ namespace {
 #if defined(FEATURE_CAFFEINETAKE_LOGGER)
 
 #include <spdlog/spdlog.h>
+#include <spdlog/details/os.h>
+#include <spdlog/fmt/xchar.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Calls below this level are compiled out, define from build system to
+// override. Runtime level set in InitLogger filters on top of that.
+#if !defined(CAFFEINETAKE_LOG_LEVEL)
+#   if defined(_DEBUG)
+#       define CAFFEINETAKE_LOG_LEVEL SPDLOG_LEVEL_DEBUG
+#   else
+#       define CAFFEINETAKE_LOG_LEVEL SPDLOG_LEVEL_INFO
+#   endif
+#endif
+
+// Arguments are evaluated only when level is enabled.
+#define CAFFEINETAKE_LOG(_level, ...)                                        \
+    do {                                                                     \
+        if constexpr (static_cast<int>(_level) >= CAFFEINETAKE_LOG_LEVEL)    \
+        {                                                                    \
+            if (::CaffeineTake::AsyncLogger::Get().ShouldLog(_level))        \
+            {                                                                \
+                ::CaffeineTake::Log(_level, __VA_ARGS__);                    \
+            }                                                                \
+        }                                                                    \
+    } while (0)
+
+// At most _perMinute messages per minute from this call site, number of
+// suppressed ones is logged before next message that gets through.
+#define CAFFEINETAKE_LOG_LIMITED(_level, _perMinute, ...)                                \
+    do {                                                                                 \
+        if constexpr (static_cast<int>(_level) >= CAFFEINETAKE_LOG_LEVEL)                \
+        {                                                                                \
+            static constinit auto _limiter = ::CaffeineTake::LogRateLimiter(_perMinute); \
+            if (::CaffeineTake::AsyncLogger::Get().ShouldLog(_level))                    \
+            {                                                                            \
+                auto _suppressed = std::uint64_t{0};                                     \
+                if (_limiter.Allow(_suppressed))                                         \
+                {                                                                        \
+                    if (_suppressed > 0)                                                 \
+                    {                                                                    \
+                        ::CaffeineTake::Log(_level, "Suppressed {} similar messages",    \
+                            _suppressed);                                                \
+                    }                                                                    \
+                    ::CaffeineTake::Log(_level, __VA_ARGS__);                            \
+                }                                                                        \
+            }                                                                            \
+        }                                                                                \
+    } while (0)
 
 // Logging macros.
-#define LOG_TRACE(...)   spdlog::trace(__VA_ARGS__)
-#define LOG_DEBUG(...)   spdlog::debug(__VA_ARGS__)
-#define LOG_INFO(...)    spdlog::info(__VA_ARGS__)
-#define LOG_WARNING(...) spdlog::warn(__VA_ARGS__)
-#define LOG_ERROR(...)   spdlog::error(__VA_ARGS__)
+#define LOG_TRACE(...)   CAFFEINETAKE_LOG(spdlog::level::trace, __VA_ARGS__)
+#define LOG_DEBUG(...)   CAFFEINETAKE_LOG(spdlog::level::debug, __VA_ARGS__)
+#define LOG_INFO(...)    CAFFEINETAKE_LOG(spdlog::level::info,  __VA_ARGS__)
+#define LOG_WARNING(...) CAFFEINETAKE_LOG(spdlog::level::warn,  __VA_ARGS__)
+#define LOG_ERROR(...)   CAFFEINETAKE_LOG(spdlog::level::err,   __VA_ARGS__)
+
+// Rate limited logging macros, for call sites that can fire on every tick.
+#define LOG_TRACE_LIMITED(_perMinute, ...)   CAFFEINETAKE_LOG_LIMITED(spdlog::level::trace, _perMinute, __VA_ARGS__)
+#define LOG_DEBUG_LIMITED(_perMinute, ...)   CAFFEINETAKE_LOG_LIMITED(spdlog::level::debug, _perMinute, __VA_ARGS__)
+#define LOG_INFO_LIMITED(_perMinute, ...)    CAFFEINETAKE_LOG_LIMITED(spdlog::level::info,  _perMinute, __VA_ARGS__)
+#define LOG_WARNING_LIMITED(_perMinute, ...) CAFFEINETAKE_LOG_LIMITED(spdlog::level::warn,  _perMinute, __VA_ARGS__)
+#define LOG_ERROR_LIMITED(_perMinute, ...)   CAFFEINETAKE_LOG_LIMITED(spdlog::level::err,   _perMinute, __VA_ARGS__)
+
+namespace CaffeineTake {
+
+using LogLevel = spdlog::level::level_enum;
+
+#if defined(SPDLOG_USE_STD_FORMAT)
+template <typename... Args>
+using LogWideFormat = std::wstring_view;
+#else
+template <typename... Args>
+using LogWideFormat = fmt::wformat_string<Args...>;
+#endif
+
+struct LogStats
+{
+    std::uint64_t Enqueued = 0;
+    std::uint64_t Dropped  = 0;
+    std::uint64_t Written  = 0;
+    std::uint64_t Flushes  = 0;
+};
+
+// Log call captured on calling thread. Arguments are copied into Storage
+// (or heap if they don't fit) and formatted later on writer thread.
+struct LogRecord
+{
+    static constexpr auto InlineSize = size_t{96};
+
+    // Formats record into out (skipped if null) and destroys arguments.
+    using ConsumeFn = void (*)(LogRecord& record, std::string* out, std::wstring& wide);
+
+    LogLevel                         Level    = LogLevel::info;
+    spdlog::log_clock::time_point    Time     = spdlog::log_clock::time_point();
+    size_t                           ThreadId = 0;
+    ConsumeFn                        Consume  = nullptr;
+    alignas(std::max_align_t) std::byte Storage[InlineSize];
+};
+
+// Bounded lock-free ring of log records, many producers and one writer
+// thread. When ring is full new records are dropped and counted, logging
+// thread never waits for disk.
+class AsyncLogger final
+{
+public:
+    static constexpr auto Capacity = size_t{2048};
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> Sequence = 0;
+        LogRecord           Record;
+    };
+
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be power of two");
+
+    std::unique_ptr<Slot[]>           mSlots;
+    alignas(64) std::atomic<size_t>   mEnqueuePos = 0;
+    alignas(64) size_t                mDequeuePos = 0;   // writer thread only
+
+    std::atomic<int>                  mLevel      = LogLevel::info;
+    std::atomic<int>                  mFlushLevel = LogLevel::warn;
+    std::atomic<bool>                 mIsWaiting  = false;
+    std::atomic<std::uint64_t>        mEnqueued   = 0;
+    std::atomic<std::uint64_t>        mDropped    = 0;
+    std::atomic<std::uint64_t>        mWritten    = 0;
+    std::atomic<std::uint64_t>        mFlushes    = 0;
+    std::uint64_t                     mReported   = 0;   // drops already written to log, writer thread only
+
+    std::thread                       mThread;
+    std::mutex                        mMutex;
+    std::condition_variable           mConditionVar;
+    std::vector<spdlog::sink_ptr>     mSinks         = std::vector<spdlog::sink_ptr>();
+    std::chrono::milliseconds         mFlushInterval = std::chrono::milliseconds(1000);
+    bool                              mIsRunning     = false;
+    bool                              mIsDone        = false;
+
+    auto Service () -> void;
+    auto Drain   (std::string& text, std::wstring& wide, bool& isUrgent) -> size_t;
+    auto Write   (LogLevel level, spdlog::log_clock::time_point time, size_t threadId, const std::string_view text) -> void;
+    auto Flush   () -> void;
+
+    auto HasPending () const -> bool
+    {
+        return mSlots[mDequeuePos & (Capacity - 1)].Sequence.load(std::memory_order_acquire) == mDequeuePos + 1;
+    }
+
+    AsyncLogger ();
+
+    AsyncLogger            (const AsyncLogger& rhs) = delete;
+    AsyncLogger& operator= (const AsyncLogger& rhs) = delete;
+
+public:
+    ~AsyncLogger ();
+
+    static auto Get () -> AsyncLogger&;
+
+    // Starts writer thread. Records logged before this are kept in ring.
+    auto Start (
+        std::vector<spdlog::sink_ptr> sinks,
+        LogLevel                      level,
+        LogLevel                      flushLevel,
+        std::chrono::milliseconds     flushInterval
+    ) -> void;
+
+    // Writes what is left in ring, flushes sinks and joins writer thread.
+    auto Stop () -> void;
+
+    auto ShouldLog (LogLevel level) const -> bool
+    {
+        return level >= mLevel.load(std::memory_order_relaxed);
+    }
+
+    // Returns record to fill or nullptr if ring is full. Every reserved
+    // record must be committed.
+    auto Reserve (size_t& position) -> LogRecord*;
+    auto Commit  (size_t position) -> void;
+
+    auto Stats () const -> LogStats;
+};
+
+// Fixed one minute window per call site. Counting is approximate when
+// threads race on window reset, which is fine for logging.
+class LogRateLimiter final
+{
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr auto Window = std::chrono::duration_cast<Clock::duration>(std::chrono::minutes(1)).count();
+
+    std::uint32_t                    mLimit       = 0;
+    std::atomic<Clock::rep>          mWindowStart = 0;
+    std::atomic<std::uint32_t>       mCount       = 0;
+    std::atomic<std::uint64_t>       mSuppressed  = 0;
+
+public:
+    constexpr explicit LogRateLimiter (std::uint32_t limit)
+        : mLimit (limit)
+    {
+    }
+
+    // Returns true if message can be logged, suppressed is set to number of
+    // messages dropped since last one that went through.
+    auto Allow (std::uint64_t& suppressed) -> bool
+    {
+        const auto now   = Clock::now().time_since_epoch().count();
+        auto       start = mWindowStart.load(std::memory_order_relaxed);
+
+        if (start == 0 || now - start >= Window)
+        {
+            if (mWindowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+            {
+                mCount.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        if (mCount.fetch_add(1, std::memory_order_relaxed) < mLimit)
+        {
+            suppressed = mSuppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        mSuppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+};
+
+#pragma region "Capture"
+
+// What is kept from argument until it's formatted. Pointers and views to
+// strings are copied, they might be gone by then.
+template <typename T>
+struct LogStored
+{
+    using Type = std::decay_t<T>;
+};
+
+template <typename T>
+    requires std::is_same_v<std::decay_t<T>, char*> || std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, std::string_view>
+struct LogStored<T>
+{
+    using Type = std::string;
+};
+
+template <typename T>
+    requires std::is_same_v<std::decay_t<T>, wchar_t*> || std::is_same_v<std::decay_t<T>, const wchar_t*> || std::is_same_v<std::decay_t<T>, std::wstring_view>
+struct LogStored<T>
+{
+    using Type = std::wstring;
+};
+
+template <typename Char, typename... Args>
+struct LogPayload
+{
+    using Tuple = std::tuple<typename LogStored<Args>::Type...>;
+
+    std::basic_string_view<Char> Format;
+    Tuple                        Arguments;
+};
+
+template <typename Payload>
+constexpr auto LogPayloadIsInline = sizeof(Payload) <= LogRecord::InlineSize && alignof(Payload) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Payload>;
+
+auto LogWideToUtf8 (const std::wstring_view wide, std::string& out) -> void;
+
+template <typename Char, typename... Args>
+auto LogConsume (LogRecord& record, std::string* out, std::wstring& wide) -> void
+{
+    using Payload = LogPayload<Char, Args...>;
+
+    auto payload = static_cast<Payload*>(nullptr);
+    if constexpr (LogPayloadIsInline<Payload>)
+    {
+        payload = std::launder(reinterpret_cast<Payload*>(record.Storage));
+    }
+    else
+    {
+        payload = *std::launder(reinterpret_cast<Payload**>(record.Storage));
+    }
+
+    if (out)
+    {
+        try
+        {
+            std::apply([&](auto&... args) {
+                if constexpr (std::is_same_v<Char, wchar_t>)
+                {
+                    wide.clear();
+                    spdlog::fmt_lib::vformat_to(std::back_inserter(wide), payload->Format, spdlog::fmt_lib::make_wformat_args(args...));
+                    LogWideToUtf8(wide, *out);
+                }
+                else
+                {
+                    spdlog::fmt_lib::vformat_to(std::back_inserter(*out), payload->Format, spdlog::fmt_lib::make_format_args(args...));
+                }
+            }, payload->Arguments);
+        }
+        catch (const std::exception& e)
+        {
+            out->assign("Failed to format log message: ");
+            out->append(e.what());
+        }
+    }
+
+    if constexpr (LogPayloadIsInline<Payload>)
+    {
+        payload->~Payload();
+    }
+    else
+    {
+        delete payload;
+    }
+}
+
+template <typename Char, typename... Args>
+auto LogCapture (LogLevel level, const std::basic_string_view<Char> format, Args&&... args) -> void
+{
+    using Payload = LogPayload<Char, Args...>;
+
+    auto& logger = AsyncLogger::Get();
+    if (!logger.ShouldLog(level))
+    {
+        return;
+    }
+
+    // Payload is built before slot is reserved. Copying arguments may throw
+    // and reserved slot that is never committed stalls writer for good.
+    auto payload = Payload{format, typename Payload::Tuple(typename LogStored<Args>::Type(std::forward<Args>(args))...)};
+    auto heap    = std::unique_ptr<Payload>();
+    if constexpr (!LogPayloadIsInline<Payload>)
+    {
+        heap = std::make_unique<Payload>(std::move(payload));
+    }
+
+    auto position = size_t{0};
+    auto record   = logger.Reserve(position);
+    if (!record)
+    {
+        return;
+    }
+
+    record->Level    = level;
+    record->Time     = spdlog::log_clock::now();
+    record->ThreadId = spdlog::details::os::thread_id();
+    record->Consume  = &LogConsume<Char, Args...>;
+
+    if constexpr (LogPayloadIsInline<Payload>)
+    {
+        new (record->Storage) Payload(std::move(payload));
+    }
+    else
+    {
+        new (record->Storage) Payload*(heap.release());
+    }
+
+    logger.Commit(position);
+}
+
+#pragma endregion
+
+// Format string is checked at compile time, formatting itself happens on
+// writer thread.
+template <typename... Args>
+auto Log (LogLevel level, spdlog::format_string_t<Args...> format, Args&&... args) -> void
+{
+    const auto view = static_cast<spdlog::fmt_lib::basic_string_view<char>>(format);
+    LogCapture<char>(level, std::string_view(view.data(), view.size()), std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+auto Log (LogLevel level, LogWideFormat<Args...> format, Args&&... args) -> void
+{
+    const auto view = static_cast<spdlog::fmt_lib::basic_string_view<wchar_t>>(format);
+    LogCapture<wchar_t>(level, std::wstring_view(view.data(), view.size()), std::forward<Args>(args)...);
+}
+
+} // namespace CaffeineTake
 
 #else
 
@@ -49,10 +436,24 @@ namespace {
 #define LOG_WARNING(...) do{}while(0)
 #define LOG_ERROR(...)   do{}while(0)
 
+#define LOG_TRACE_LIMITED(...)   do{}while(0)
+#define LOG_DEBUG_LIMITED(...)   do{}while(0)
+#define LOG_INFO_LIMITED(...)    do{}while(0)
+#define LOG_WARNING_LIMITED(...) do{}while(0)
+#define LOG_ERROR_LIMITED(...)   do{}while(0)
+
 #endif // #if defined(FEATURE_CAFFEINETAKE_LOGGER)
 
 namespace CaffeineTake {
 
-auto InitLogger (const fs::path& logFilePath) -> bool;
+struct LogRotation
+{
+    size_t MaxFileSize = 4 * 1024 * 1024;   // active file is rotated before it grows past this
+    size_t MaxFiles    = 7;                 // rotated files kept besides active one
+    bool   Daily       = true;              // also rotate on first write after local midnight
+};
+
+// Disk use is bounded by about (MaxFiles + 1) * MaxFileSize.
+auto InitLogger (const fs::path& logFilePath, const LogRotation& rotation = LogRotation()) -> bool;
 
 } // namespace CaffeineTake
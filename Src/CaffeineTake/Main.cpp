@@ -23,12 +23,67 @@
 #include "AppInitInfo.hpp"
 #include "CaffeineApp.hpp"
 #include "CommandLineArgs.hpp"
+#include "Diagnostics.hpp"
 #include "InstanceGuard.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
+#include "SyntheticWorkload.hpp"
+
+#include <memory>
+#include <string>
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 
+namespace {
+    // Writes metrics of running instance to stdout, or to console we were
+    // started from if stdout isn't redirected (we are GUI app). With
+    // diagnostics metrics are turned into CPU usage report.
+    auto PrintMetrics ([[maybe_unused]] bool diagnostics) -> int
+    {
+        auto text   = std::string();
+        auto result = 0;
+        if (!CaffeineTake::ReadMetrics(text))
+        {
+            text   = "CaffeineTake is not running\n";
+            result = 1;
+        }
+#if defined(FEATURE_CAFFEINETAKE_DIAGNOSTICS)
+        else if (diagnostics)
+        {
+            text = CaffeineTake::FormatDiagnostics(text);
+        }
+#endif
+
+        auto output  = GetStdHandle(STD_OUTPUT_HANDLE);
+        auto console = HANDLE{INVALID_HANDLE_VALUE};
+        if (output == NULL || output == INVALID_HANDLE_VALUE)
+        {
+            if (AttachConsole(ATTACH_PARENT_PROCESS))
+            {
+                console = CreateFileW(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+            }
+
+            output = console;
+        }
+
+        if (output == INVALID_HANDLE_VALUE)
+        {
+            return 2;
+        }
+
+        auto written = DWORD{0};
+        WriteFile(output, text.data(), static_cast<DWORD>(text.size()), &written, NULL);
+
+        if (console != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(console);
+        }
+
+        return result;
+    }
+}
+
 auto WINAPI wWinMain (
     _In_     HINSTANCE hInstance,
     _In_opt_ HINSTANCE hPrevInstance,
@@ -55,6 +110,11 @@ auto WINAPI wWinMain (
 
     // Parse command line.
     auto args = CaffeineTake::ParseCommandLine(lpCmdLine);
+
+    if (args.Metrics || args.Diagnostics)
+    {
+        return PrintMetrics(args.Diagnostics);
+    }
     
     // Check if application is not running already.
     if (guard.IsOtherInstance())
@@ -88,6 +148,22 @@ auto WINAPI wWinMain (
     CaffeineTake::InitLogger(info.value().LogFilePath);
 #endif
 
+#if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
+    // Scanners take their sources when created, install before the app.
+    if (args.Synthetic)
+    {
+        if (const auto options = CaffeineTake::SyntheticWorkloadOptions::Parse(args.Synthetic.value()))
+        {
+            LOG_WARNING(L"Scanners run against synthetic workload '{}', seed {}", args.Synthetic.value(), options->Seed);
+            CaffeineTake::SyntheticWorkload::Install(std::make_shared<CaffeineTake::SyntheticWorkload>(options.value()));
+        }
+        else
+        {
+            LOG_ERROR(L"Invalid synthetic workload '{}', scanning system instead", args.Synthetic.value());
+        }
+    }
+#endif
+
     auto caffeineTray = CaffeineTake::CaffeineApp(info.value());
     if (!caffeineTray.Init(info.value()))
     {
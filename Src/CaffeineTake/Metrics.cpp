@@ -0,0 +1,822 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "Metrics.hpp"
+
+#include "Diagnostics.hpp"
+#include "Logger.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#   include <Psapi.h>
+#   include <TlHelp32.h>
+#elif defined(__linux__)
+#   include <sys/socket.h>
+#   include <sys/stat.h>
+#   include <sys/un.h>
+#   include <cerrno>
+#   include <ctime>
+#   include <cstdlib>
+#   include <filesystem>
+#   include <fstream>
+#   include <unistd.h>
+#endif
+
+namespace {
+    // Prometheus bucket boundaries, in seconds. Exported counts are taken
+    // from histogram buckets that lie entirely below boundary.
+    constexpr double ExportBounds[] = {
+        0.000001, 0.000005, 0.00001, 0.00005, 0.0001, 0.0005,
+        0.001,    0.005,    0.01,    0.05,    0.1,    0.5,
+        1.0,      5.0,      10.0
+    };
+
+    auto AppendNumber (std::string& out, const std::uint64_t value) -> void
+    {
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    auto AppendNumber (std::string& out, const double value) -> void
+    {
+        char buffer[32];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    auto AppendSeconds (std::string& out, const std::uint64_t ns) -> void
+    {
+        AppendNumber(out, static_cast<double>(ns) / 1e9);
+    }
+
+    // Writes name{labels} or name{labels,extra}.
+    auto AppendSeries (
+        std::string&           out,
+        const std::string_view name,
+        const std::string_view suffix,
+        const std::string_view labels,
+        const std::string_view extra = {}
+    ) -> void
+    {
+        out.append(name);
+        out.append(suffix);
+
+        if (!labels.empty() || !extra.empty())
+        {
+            out.push_back('{');
+            out.append(labels);
+            if (!labels.empty() && !extra.empty())
+            {
+                out.push_back(',');
+            }
+            out.append(extra);
+            out.push_back('}');
+        }
+
+        out.push_back(' ');
+    }
+
+#if defined(_WIN32)
+    auto PipeName () -> std::wstring
+    {
+        auto session = DWORD{0};
+        ::ProcessIdToSessionId(::GetCurrentProcessId(), &session);
+
+        return L"\\\\.\\pipe\\CaffeineTake.Metrics." + std::to_wstring(session);
+    }
+
+    // Pipe DACL granting access to current user only, the analogue of chmod
+    // 0600 on Unix socket. Attributes point into this struct, don't move it.
+    struct PipeSecurity
+    {
+        std::vector<BYTE>   user;
+        std::vector<BYTE>   acl;
+        SECURITY_DESCRIPTOR descriptor = {};
+        SECURITY_ATTRIBUTES attributes = {};
+    };
+
+    auto MakePipeSecurity (PipeSecurity& security) -> bool
+    {
+        auto token = HANDLE{NULL};
+        if (!::OpenProcessToken(::GetCurrentProcess(), TOKEN_QUERY, &token))
+        {
+            return false;
+        }
+
+        auto size = DWORD{0};
+        ::GetTokenInformation(token, TokenUser, NULL, 0, &size);
+        security.user.resize(size);
+        const auto isQueried = size != 0 && ::GetTokenInformation(token, TokenUser, security.user.data(), size, &size);
+        ::CloseHandle(token);
+        if (!isQueried)
+        {
+            return false;
+        }
+
+        const auto sid = reinterpret_cast<const TOKEN_USER*>(security.user.data())->User.Sid;
+        security.acl.resize(sizeof(ACL) + sizeof(ACCESS_ALLOWED_ACE) - sizeof(DWORD) + ::GetLengthSid(sid));
+
+        const auto acl = reinterpret_cast<PACL>(security.acl.data());
+        if (!::InitializeAcl(acl, static_cast<DWORD>(security.acl.size()), ACL_REVISION)
+         || !::AddAccessAllowedAce(acl, ACL_REVISION, GENERIC_ALL, sid)
+         || !::InitializeSecurityDescriptor(&security.descriptor, SECURITY_DESCRIPTOR_REVISION)
+         || !::SetSecurityDescriptorDacl(&security.descriptor, TRUE, acl, FALSE))
+        {
+            return false;
+        }
+
+        security.attributes.nLength              = sizeof(security.attributes);
+        security.attributes.lpSecurityDescriptor = &security.descriptor;
+        security.attributes.bInheritHandle       = FALSE;
+
+        return true;
+    }
+
+    auto ReadResidentBytes () -> double
+    {
+        auto counters = PROCESS_MEMORY_COUNTERS();
+        if (!::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return 0.0;
+        }
+
+        return static_cast<double>(counters.WorkingSetSize);
+    }
+
+    auto ReadThreadCount () -> double
+    {
+        const auto snapshot = ::CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+        if (snapshot == INVALID_HANDLE_VALUE)
+        {
+            return 0.0;
+        }
+
+        const auto pid   = ::GetCurrentProcessId();
+        auto       count = size_t{0};
+        auto       entry = THREADENTRY32();
+        entry.dwSize = sizeof(entry);
+
+        if (::Thread32First(snapshot, &entry))
+        {
+            do
+            {
+                if (entry.th32OwnerProcessID == pid)
+                {
+                    count += 1;
+                }
+            }
+            while (::Thread32Next(snapshot, &entry));
+        }
+
+        ::CloseHandle(snapshot);
+
+        return static_cast<double>(count);
+    }
+
+    auto ReadCpuSeconds () -> double
+    {
+        auto creation = FILETIME();
+        auto exit     = FILETIME();
+        auto kernel   = FILETIME();
+        auto user     = FILETIME();
+        if (!::GetProcessTimes(::GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        {
+            return 0.0;
+        }
+
+        const auto ticks = (static_cast<std::uint64_t>(kernel.dwHighDateTime) << 32 | kernel.dwLowDateTime)
+                         + (static_cast<std::uint64_t>(user.dwHighDateTime)   << 32 | user.dwLowDateTime);
+
+        return static_cast<double>(ticks) / 1e7;
+    }
+#elif defined(__linux__)
+    auto SocketPath () -> std::string
+    {
+        const auto runtime = std::getenv("XDG_RUNTIME_DIR");
+        if (runtime && *runtime)
+        {
+            return std::string(runtime) + "/caffeinetake.metrics";
+        }
+
+        return "/tmp/caffeinetake-" + std::to_string(::getuid()) + ".metrics";
+    }
+
+    auto MakeAddress (sockaddr_un& address) -> bool
+    {
+        const auto path = SocketPath();
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            return false;
+        }
+
+        address = sockaddr_un();
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, path.size());
+
+        return true;
+    }
+
+    auto ReadResidentBytes () -> double
+    {
+        auto statm = std::ifstream("/proc/self/statm");
+        auto size  = 0.0;
+        auto pages = 0.0;
+        if (!(statm >> size >> pages))
+        {
+            return 0.0;
+        }
+
+        return pages * static_cast<double>(::sysconf(_SC_PAGESIZE));
+    }
+
+    auto ReadCpuSeconds () -> double
+    {
+        auto ts = timespec();
+        if (::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+        {
+            return 0.0;
+        }
+
+        return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+    }
+
+    auto ReadThreadCount () -> double
+    {
+        auto ec    = std::error_code();
+        auto count = size_t{0};
+        for (auto it = std::filesystem::directory_iterator("/proc/self/task", ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+        {
+            count += 1;
+        }
+
+        return static_cast<double>(count);
+    }
+#endif
+}
+
+namespace CaffeineTake {
+
+#pragma region "LatencyHistogram"
+
+auto LatencyHistogram::Read (Counts& counts) const -> std::uint64_t
+{
+    auto total = std::uint64_t{0};
+    for (auto i = size_t{0}; i < BucketCount; ++i)
+    {
+        counts[i] = mCounts[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    return total;
+}
+
+auto LatencyHistogram::Quantile (const Counts& counts, const double q) -> std::uint64_t
+{
+    auto total = std::uint64_t{0};
+    for (const auto count : counts)
+    {
+        total += count;
+    }
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total))));
+
+    auto seen = std::uint64_t{0};
+    for (auto i = size_t{0}; i < BucketCount; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            return UpperBound(i);
+        }
+    }
+
+    return UINT64_MAX;
+}
+
+#pragma endregion
+
+#pragma region "MetricsRegistry"
+
+MetricsRegistry::MetricsRegistry ()
+{
+    Gauge("process_resident_memory_bytes", "Resident memory size in bytes.", ReadResidentBytes);
+    Gauge("process_threads", "Number of threads in the process.", ReadThreadCount);
+    Gauge("process_cpu_seconds_total", "User and system CPU time of the process.", ReadCpuSeconds);
+}
+
+auto MetricsRegistry::Get () -> MetricsRegistry&
+{
+    static auto instance = MetricsRegistry();
+    return instance;
+}
+
+auto MetricsRegistry::Find (std::string_view name, std::string_view labels) -> Entry*
+{
+    for (auto& entry : mEntries)
+    {
+        if (entry.Name == name && entry.Labels == labels)
+        {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+auto MetricsRegistry::Counter (std::string_view name, std::string_view help, std::string_view labels) -> MetricCounter&
+{
+    auto lock = std::lock_guard<std::mutex>(mMutex);
+
+    if (auto entry = Find(name, labels); entry && entry->Counter)
+    {
+        return *entry->Counter;
+    }
+
+    auto& counter = mCounters.emplace_back();
+    mEntries.push_back(Entry{
+        .Type    = Kind::Counter,
+        .Name    = std::string(name),
+        .Help    = std::string(help),
+        .Labels  = std::string(labels),
+        .Counter = &counter
+    });
+
+    return counter;
+}
+
+auto MetricsRegistry::Histogram (std::string_view name, std::string_view help, std::string_view labels) -> LatencyHistogram&
+{
+    auto lock = std::lock_guard<std::mutex>(mMutex);
+
+    if (auto entry = Find(name, labels); entry && entry->Histogram)
+    {
+        return *entry->Histogram;
+    }
+
+    auto& histogram = mHistograms.emplace_back();
+    mEntries.push_back(Entry{
+        .Type      = Kind::Histogram,
+        .Name      = std::string(name),
+        .Help      = std::string(help),
+        .Labels    = std::string(labels),
+        .Histogram = &histogram
+    });
+
+    return histogram;
+}
+
+auto MetricsRegistry::Gauge (std::string_view name, std::string_view help, GaugeFn fn, std::string_view labels) -> void
+{
+    auto lock = std::lock_guard<std::mutex>(mMutex);
+
+    if (auto entry = Find(name, labels); entry)
+    {
+        entry->Gauge = std::move(fn);
+        return;
+    }
+
+    mEntries.push_back(Entry{
+        .Type   = Kind::Gauge,
+        .Name   = std::string(name),
+        .Help   = std::string(help),
+        .Labels = std::string(labels),
+        .Gauge  = std::move(fn)
+    });
+}
+
+auto MetricsRegistry::WritePrometheus (std::string& out) const -> void
+{
+    auto lock = std::lock_guard<std::mutex>(mMutex);
+
+    // Group series of same name, keeping registration order otherwise.
+    auto order = std::vector<const Entry*>();
+    order.reserve(mEntries.size());
+    for (const auto& entry : mEntries)
+    {
+        order.push_back(&entry);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [](const Entry* lhs, const Entry* rhs) {
+        return lhs->Name < rhs->Name;
+    });
+
+    auto counts = LatencyHistogram::Counts();
+    auto last   = std::string_view();
+
+    for (const auto entry : order)
+    {
+        if (entry->Name != last)
+        {
+            out.append("# HELP ").append(entry->Name).append(" ").append(entry->Help).append("\n");
+            out.append("# TYPE ").append(entry->Name).append(" ");
+            switch (entry->Type)
+            {
+            case Kind::Counter:   out.append("counter\n");   break;
+            case Kind::Gauge:     out.append("gauge\n");     break;
+            case Kind::Histogram: out.append("histogram\n"); break;
+            }
+
+            last = entry->Name;
+        }
+
+        switch (entry->Type)
+        {
+        case Kind::Counter:
+            AppendSeries(out, entry->Name, "", entry->Labels);
+            AppendNumber(out, entry->Counter->Value());
+            out.push_back('\n');
+            break;
+
+        case Kind::Gauge:
+            AppendSeries(out, entry->Name, "", entry->Labels);
+            AppendNumber(out, entry->Gauge ? entry->Gauge() : 0.0);
+            out.push_back('\n');
+            break;
+
+        case Kind::Histogram:
+        {
+            const auto total  = entry->Histogram->Read(counts);
+            auto       bucket = size_t{0};
+            auto       below  = std::uint64_t{0};
+            auto       le     = std::string();
+
+            for (const auto bound : ExportBounds)
+            {
+                const auto boundNs = static_cast<std::uint64_t>(bound * 1e9);
+                while (bucket < LatencyHistogram::BucketCount && LatencyHistogram::UpperBound(bucket) <= boundNs)
+                {
+                    below += counts[bucket];
+                    bucket += 1;
+                }
+
+                le.assign("le=\"");
+                AppendNumber(le, bound);
+                le.push_back('"');
+
+                AppendSeries(out, entry->Name, "_bucket", entry->Labels, le);
+                AppendNumber(out, below);
+                out.push_back('\n');
+            }
+
+            AppendSeries(out, entry->Name, "_bucket", entry->Labels, "le=\"+Inf\"");
+            AppendNumber(out, total);
+            out.push_back('\n');
+
+            AppendSeries(out, entry->Name, "_sum", entry->Labels);
+            AppendSeconds(out, entry->Histogram->Sum());
+            out.push_back('\n');
+
+            AppendSeries(out, entry->Name, "_count", entry->Labels);
+            AppendNumber(out, total);
+            out.push_back('\n');
+
+            // Quantiles as comment, scrapers ignore it, humans don't.
+            out.append("# ");
+            AppendSeries(out, entry->Name, "", entry->Labels);
+            out.append("p50=");
+            AppendSeconds(out, LatencyHistogram::Quantile(counts, 0.50));
+            out.append(" p90=");
+            AppendSeconds(out, LatencyHistogram::Quantile(counts, 0.90));
+            out.append(" p99=");
+            AppendSeconds(out, LatencyHistogram::Quantile(counts, 0.99));
+            out.append(" max=");
+            AppendSeconds(out, LatencyHistogram::Quantile(counts, 1.0));
+            out.push_back('\n');
+            break;
+        }
+        }
+    }
+}
+
+#pragma endregion
+
+#pragma region "MetricsServer"
+
+MetricsServer::~MetricsServer ()
+{
+    Stop();
+}
+
+#if defined(_WIN32)
+
+auto MetricsServer::Start () -> bool
+{
+    if (mThread.joinable())
+    {
+        return true;
+    }
+
+    mIsDone     = false;
+    mIsFinished = false;
+    mThread     = std::thread(&MetricsServer::Service, this);
+
+    return true;
+}
+
+auto MetricsServer::Stop () -> void
+{
+    if (!mThread.joinable())
+    {
+        return;
+    }
+
+    mIsDone = true;
+
+    // Server blocks in ConnectNamedPipe or in write to slow client, wake it
+    // by connecting to it and by cancelling its I/O until it notices.
+    const auto name = PipeName();
+    while (!mIsFinished)
+    {
+        ::CancelSynchronousIo(mThread.native_handle());
+
+        const auto pipe = ::CreateFileW(name.c_str(), GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (pipe != INVALID_HANDLE_VALUE)
+        {
+            ::CloseHandle(pipe);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    mThread.join();
+}
+
+auto MetricsServer::Service () -> void
+{
+    DIAG_THREAD("Metrics");
+
+    const auto name = PipeName();
+    auto       text = std::string();
+
+    auto security = PipeSecurity();
+    if (!MakePipeSecurity(security))
+    {
+        LOG_ERROR("Failed to build metrics pipe security, error: {}", ::GetLastError());
+        mIsFinished = true;
+        return;
+    }
+
+    while (!mIsDone)
+    {
+        DIAG_SCOPE(Subsystem::Service);
+
+        const auto pipe = ::CreateNamedPipeW(
+            name.c_str(),
+            PIPE_ACCESS_OUTBOUND | FILE_FLAG_FIRST_PIPE_INSTANCE,
+            PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            1,
+            64 * 1024,
+            0,
+            0,
+            &security.attributes
+        );
+
+        if (pipe == INVALID_HANDLE_VALUE)
+        {
+            LOG_ERROR("Failed to create metrics pipe, error: {}", ::GetLastError());
+            break;
+        }
+
+        const auto isConnected = ::ConnectNamedPipe(pipe, NULL) || ::GetLastError() == ERROR_PIPE_CONNECTED;
+        if (isConnected && !mIsDone)
+        {
+            text.clear();
+            MetricsRegistry::Get().WritePrometheus(text);
+
+            auto offset = size_t{0};
+            while (offset < text.size())
+            {
+                auto written = DWORD{0};
+                const auto chunk = static_cast<DWORD>(std::min<size_t>(text.size() - offset, 64 * 1024));
+                if (!::WriteFile(pipe, text.data() + offset, chunk, &written, NULL))
+                {
+                    break;
+                }
+
+                offset += written;
+            }
+
+            ::FlushFileBuffers(pipe);
+        }
+
+        ::DisconnectNamedPipe(pipe);
+        ::CloseHandle(pipe);
+    }
+
+    mIsFinished = true;
+}
+
+auto ReadMetrics (std::string& out) -> bool
+{
+    const auto name = PipeName();
+
+    auto pipe = INVALID_HANDLE_VALUE;
+    while (true)
+    {
+        pipe = ::CreateFileW(name.c_str(), GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (pipe != INVALID_HANDLE_VALUE)
+        {
+            break;
+        }
+
+        if (::GetLastError() != ERROR_PIPE_BUSY || !::WaitNamedPipeW(name.c_str(), 2000))
+        {
+            return false;
+        }
+    }
+
+    auto buffer = std::array<char, 4096>();
+    while (true)
+    {
+        auto read = DWORD{0};
+        if (!::ReadFile(pipe, buffer.data(), static_cast<DWORD>(buffer.size()), &read, NULL) || read == 0)
+        {
+            break;
+        }
+
+        out.append(buffer.data(), read);
+    }
+
+    ::CloseHandle(pipe);
+
+    return !out.empty();
+}
+
+#elif defined(__linux__)
+
+auto MetricsServer::Start () -> bool
+{
+    if (mThread.joinable())
+    {
+        return true;
+    }
+
+    auto address = sockaddr_un();
+    if (!MakeAddress(address))
+    {
+        return false;
+    }
+
+    const auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    ::unlink(address.sun_path);
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+     || ::chmod(address.sun_path, S_IRUSR | S_IWUSR) != 0
+     || ::listen(fd, 4) != 0)
+    {
+        LOG_ERROR("Failed to listen on metrics socket '{}'", address.sun_path);
+        ::close(fd);
+        return false;
+    }
+
+    mSocket     = fd;
+    mIsDone     = false;
+    mIsFinished = false;
+    mThread     = std::thread(&MetricsServer::Service, this);
+
+    return true;
+}
+
+auto MetricsServer::Stop () -> void
+{
+    if (!mThread.joinable())
+    {
+        return;
+    }
+
+    // Wakes accept, it fails from now on.
+    mIsDone = true;
+    ::shutdown(static_cast<int>(mSocket), SHUT_RDWR);
+
+    mThread.join();
+
+    ::close(static_cast<int>(mSocket));
+    mSocket = -1;
+
+    auto address = sockaddr_un();
+    if (MakeAddress(address))
+    {
+        ::unlink(address.sun_path);
+    }
+}
+
+auto MetricsServer::Service () -> void
+{
+    DIAG_THREAD("Metrics");
+
+    auto text = std::string();
+
+    while (!mIsDone)
+    {
+        DIAG_SCOPE(Subsystem::Service);
+
+        const auto client = ::accept4(static_cast<int>(mSocket), nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+
+            break;
+        }
+
+        text.clear();
+        MetricsRegistry::Get().WritePrometheus(text);
+
+        auto offset = size_t{0};
+        while (offset < text.size())
+        {
+            const auto sent = ::send(client, text.data() + offset, text.size() - offset, MSG_NOSIGNAL);
+            if (sent <= 0)
+            {
+                break;
+            }
+
+            offset += static_cast<size_t>(sent);
+        }
+
+        ::close(client);
+    }
+
+    mIsFinished = true;
+}
+
+auto ReadMetrics (std::string& out) -> bool
+{
+    auto address = sockaddr_un();
+    if (!MakeAddress(address))
+    {
+        return false;
+    }
+
+    const auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    auto buffer = std::array<char, 4096>();
+    while (true)
+    {
+        const auto read = ::read(fd, buffer.data(), buffer.size());
+        if (read <= 0)
+        {
+            break;
+        }
+
+        out.append(buffer.data(), static_cast<size_t>(read));
+    }
+
+    ::close(fd);
+
+    return !out.empty();
+}
+
+#endif
+
+#pragma endregion
+
+} // namespace CaffeineTake
@@ -0,0 +1,227 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace CaffeineTake {
+
+// Counter that only goes up.
+class MetricCounter final
+{
+    std::atomic<std::uint64_t> mValue = 0;
+
+public:
+    auto Add (std::uint64_t n = 1) -> void
+    {
+        mValue.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    auto Value () const -> std::uint64_t
+    {
+        return mValue.load(std::memory_order_relaxed);
+    }
+};
+
+// Latency histogram in nanoseconds, HDR style. Every power of two range is
+// split into SubBucketCount linear buckets, so recorded value is known
+// within 1/SubBucketCount of itself over whole 64 bit range. Record is two
+// relaxed atomic adds, never waits or allocates.
+class LatencyHistogram final
+{
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    static constexpr auto SubBucketBits  = 4;
+    static constexpr auto SubBucketCount = size_t{1} << SubBucketBits;
+    static constexpr auto BucketCount    = (64 - SubBucketBits + 1) * SubBucketCount;
+
+    using Counts = std::array<std::uint64_t, BucketCount>;
+
+private:
+    std::array<std::atomic<std::uint64_t>, BucketCount> mCounts = {};
+    std::atomic<std::uint64_t>                          mSum    = 0;
+
+public:
+    static constexpr auto BucketOf (std::uint64_t value) -> size_t
+    {
+        if (value < SubBucketCount)
+        {
+            return static_cast<size_t>(value);
+        }
+
+        const auto shift = static_cast<size_t>(std::bit_width(value)) - 1 - SubBucketBits;
+        return (shift + 1) * SubBucketCount + static_cast<size_t>((value >> shift) & (SubBucketCount - 1));
+    }
+
+    // Smallest value that falls into bucket.
+    static constexpr auto LowerBound (size_t bucket) -> std::uint64_t
+    {
+        if (bucket < SubBucketCount)
+        {
+            return bucket;
+        }
+
+        const auto shift = bucket / SubBucketCount - 1;
+        return static_cast<std::uint64_t>(SubBucketCount + bucket % SubBucketCount) << shift;
+    }
+
+    // Largest value that falls into bucket.
+    static constexpr auto UpperBound (size_t bucket) -> std::uint64_t
+    {
+        return bucket + 1 < BucketCount ? LowerBound(bucket + 1) - 1 : UINT64_MAX;
+    }
+
+    auto Record (Duration value) -> void
+    {
+        const auto ns = static_cast<std::uint64_t>(std::max<Duration::rep>(value.count(), 0));
+
+        mCounts[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        mSum.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    auto Sum () const -> std::uint64_t
+    {
+        return mSum.load(std::memory_order_relaxed);
+    }
+
+    // Copy of counts, taken while others may still record.
+    auto Read (Counts& counts) const -> std::uint64_t;
+
+    // Value at quantile q (0..1) of counts, upper bound of its bucket.
+    static auto Quantile (const Counts& counts, double q) -> std::uint64_t;
+};
+
+// Records time from construction to end of scope.
+class ScopedLatency final
+{
+    using Clock = std::chrono::steady_clock;
+
+    LatencyHistogram& mHistogram;
+    Clock::time_point mStart = Clock::now();
+
+public:
+    explicit ScopedLatency (LatencyHistogram& histogram)
+        : mHistogram (histogram)
+    {
+    }
+
+    ~ScopedLatency ()
+    {
+        mHistogram.Record(Clock::now() - mStart);
+    }
+
+    ScopedLatency            (const ScopedLatency& rhs) = delete;
+    ScopedLatency& operator= (const ScopedLatency& rhs) = delete;
+};
+
+// Process wide set of metrics, exported as Prometheus text. Metrics are
+// registered once (usually into static references at call site) and live
+// as long as the process, recording into them doesn't touch registry.
+class MetricsRegistry final
+{
+public:
+    using GaugeFn = std::function<double ()>;
+
+private:
+    enum class Kind
+    {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    struct Entry
+    {
+        Kind              Type;
+        std::string       Name;
+        std::string       Help;
+        std::string       Labels;    // without braces, e.g. scanner="Process"
+        MetricCounter*    Counter   = nullptr;
+        LatencyHistogram* Histogram = nullptr;
+        GaugeFn           Gauge     = nullptr;
+    };
+
+    mutable std::mutex           mMutex;
+    std::deque<Entry>            mEntries    = std::deque<Entry>();
+    std::deque<MetricCounter>    mCounters   = std::deque<MetricCounter>();
+    std::deque<LatencyHistogram> mHistograms = std::deque<LatencyHistogram>();
+
+    auto Find (std::string_view name, std::string_view labels) -> Entry*;
+
+    MetricsRegistry ();
+
+    MetricsRegistry            (const MetricsRegistry& rhs) = delete;
+    MetricsRegistry& operator= (const MetricsRegistry& rhs) = delete;
+
+public:
+    static auto Get () -> MetricsRegistry&;
+
+    // Registering same name and labels again returns the same metric.
+    auto Counter   (std::string_view name, std::string_view help, std::string_view labels = {}) -> MetricCounter&;
+    auto Histogram (std::string_view name, std::string_view help, std::string_view labels = {}) -> LatencyHistogram&;
+
+    // Gauge is read by calling fn at export time, with registry locked.
+    // Registering same name and labels again replaces fn.
+    auto Gauge (std::string_view name, std::string_view help, GaugeFn fn, std::string_view labels = {}) -> void;
+
+    auto WritePrometheus (std::string& out) const -> void;
+};
+
+// Serves registry text to local clients, one connection at a time: named
+// pipe \\.\pipe\CaffeineTake.Metrics.<session> on Windows, Unix socket in
+// runtime directory elsewhere.
+class MetricsServer final
+{
+    std::thread       mThread;
+    std::atomic<bool> mIsDone     = false;
+    std::atomic<bool> mIsFinished = false;
+    std::intptr_t     mSocket     = -1;      // listening socket, Unix only
+
+    auto Service () -> void;
+
+public:
+    MetricsServer () = default;
+    ~MetricsServer ();
+
+    MetricsServer            (const MetricsServer& rhs) = delete;
+    MetricsServer& operator= (const MetricsServer& rhs) = delete;
+
+    auto Start () -> bool;
+    auto Stop  () -> void;
+};
+
+// Reads metrics text from running instance.
+auto ReadMetrics (std::string& out) -> bool;
+
+} // namespace CaffeineTake
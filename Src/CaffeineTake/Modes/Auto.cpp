@@ -22,14 +22,36 @@
 #include "Config.hpp"
 #include "../CaffeineMode.hpp"
 
+#include "Diagnostics.hpp"
 #include "Lang.hpp"
+#include "LocalClock.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
 #include "Settings.hpp"
+#include "Tracing.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <span>
 
 namespace CaffeineTake {
 
+namespace {
+    // Schedule is rechecked at least daily even without a transition.
+    constexpr auto MaxScheduleSleep = std::chrono::milliseconds(std::chrono::hours(24));
+
+    auto& ScheduleTime = CaffeineTake::MetricsRegistry::Get().Histogram(
+        "caffeinetake_schedule_check_seconds",
+        "Time of single schedule evaluation."
+    );
+}
+
 auto AutoMode::ScannerTimerProc (const StopToken& stop, const PauseToken& pause) -> bool
 {
+    DIAG_SCOPE(Subsystem::Scanner);
+
     const auto settingsPtr = mAppSO.GetSettings();
     if (!settingsPtr)
     {
@@ -45,36 +67,24 @@ auto AutoMode::ScannerTimerProc (const StopToken& stop, const PauseToken& pause)
         }
     }
 
-    auto scannerResult = false;
-    
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS)
-    if (!scannerResult && settingsPtr->Auto.TriggerProcess.Enabled)
-    {
-        scannerResult = mProcessScanner.Run(settingsPtr, stop, pause);
-    }
-#endif
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
-    if (!scannerResult && settingsPtr->Auto.TriggerWindow.Enabled)
-    {
-        scannerResult = mWindowScanner.Run(settingsPtr, stop, pause);
-    }
-#endif
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
-    if (!scannerResult && settingsPtr->Auto.TriggerUsb.Enabled)
-    {
-        scannerResult = mUsbScanner.Run(settingsPtr, stop, pause);
-    }
-#endif
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
-    if (!scannerResult && settingsPtr->Auto.TriggerBluetooth.Enabled)
+    // Round finishes on scan pool, OnScanResult gets its result.
+    StartScanners(settingsPtr, pause);
+
+    if (stop)
     {
-        scannerResult = mBluetoothScanner.Run(settingsPtr, stop, pause);
+        return false;
     }
-#endif
 
+    return true;
+}
+
+auto AutoMode::OnScanResult (bool scannerResult) -> void
+{
     // Only if there is state change.
     if (scannerResult != mScannerResult)
     {
+        TRACE_INSTANT(scannerResult ? "ScannerHit" : "ScannerMiss", "scanner");
+
         if (scannerResult)
         {
             mAppSO.EnableCaffeine();
@@ -86,17 +96,48 @@ auto AutoMode::ScannerTimerProc (const StopToken& stop, const PauseToken& pause)
 
         mScannerResult = scannerResult;
     }
+}
 
-    if (stop)
+auto AutoMode::StartScanners (SettingsPtr settingsPtr, const PauseToken& pause) -> void
+{
+    auto slots     = std::array<ScannerSlot*, 4>();
+    auto slotCount = size_t{0};
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS)
+    if (settingsPtr->Auto.TriggerProcess.Enabled)
     {
-        return false;
+        slots[slotCount++] = &mProcessSlot;
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
+    if (settingsPtr->Auto.TriggerWindow.Enabled)
+    {
+        slots[slotCount++] = &mWindowSlot;
     }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    if (settingsPtr->Auto.TriggerUsb.Enabled)
+    {
+        slots[slotCount++] = &mUsbSlot;
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    if (settingsPtr->Auto.TriggerBluetooth.Enabled)
+    {
+        slots[slotCount++] = &mBluetoothSlot;
+    }
+#endif
 
-    return true;
+    // Scanners still running when next tick begins are out of time.
+    mScanTick.Begin(std::span(slots.data(), slotCount), settingsPtr, pause);
 }
 
 auto AutoMode::ScheduleTimerProc (const StopToken& stop, const PauseToken& pause) -> bool
 {
+    const auto measure = ScopedLatency(ScheduleTime);
+    TRACE_SCOPE("Schedule", "schedule");
+    DIAG_SCOPE(Subsystem::Schedule);
+
     const auto settingsPtr = mAppSO.GetSettings();
     if (!settingsPtr)
     {
@@ -106,12 +147,30 @@ auto AutoMode::ScheduleTimerProc (const StopToken& stop, const PauseToken& pause
     auto scheduleResult = false;
 
 #if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+    // Sleep until schedule flips. Time, power and settings changes wake
+    // the timer early.
+    auto nextInterval = MaxScheduleSleep;
+
     if (settingsPtr->Auto.TriggerSchedule.Enabled)
     {
-        scheduleResult = Schedule::CheckSchedule(
-            settingsPtr->Auto.TriggerSchedule.ScheduleEntries, std::chrono::system_clock::now()
-        );
+        // Entries can only change with new settings snapshot.
+        if (settingsPtr != mScheduleSettings)
+        {
+            mScheduleSettings = settingsPtr;
+            if (mScheduleEvaluator.Update(settingsPtr->Auto.TriggerSchedule.ScheduleEntries))
+            {
+                LOG_DEBUG("Compiled schedule ({} intervals)", mScheduleEvaluator.GetIntervalCount());
+            }
+        }
+
+        const auto now = std::chrono::system_clock::now();
+
+        scheduleResult = mScheduleEvaluator.IsActive(now);
+        nextInterval   = mScheduleEvaluator.SleepTime(now, MaxScheduleSleep);
     }
+
+    LOG_DEBUG("Schedule result: {}, next check in {} ms", scheduleResult, nextInterval.count());
+    mScheduleTimer.SetNextInterval(nextInterval);
 #endif
 
     // Only if there is state change.
@@ -119,6 +178,9 @@ auto AutoMode::ScheduleTimerProc (const StopToken& stop, const PauseToken& pause
         auto lockGuard = std::lock_guard<std::mutex>(mScanMutex);
         if (scheduleResult != mScheduleResult)
         {
+            LOG_INFO("Time is {} schedule", scheduleResult ? "in" : "out of");
+            TRACE_INSTANT(scheduleResult ? "ScheduleIn" : "ScheduleOut", "schedule");
+
             if (scheduleResult)
             {
                 mAppSO.EnableCaffeine();
@@ -137,6 +199,11 @@ auto AutoMode::ScheduleTimerProc (const StopToken& stop, const PauseToken& pause
 
 AutoMode::AutoMode (CaffeineAppSO app)
     : Mode (app)
+    , mProcessSlot   ("Process",   ScannerKind::Process,   mProcessScanner)
+    , mWindowSlot    ("Window",    ScannerKind::Window,    mWindowScanner)
+    , mUsbSlot       ("Usb",       ScannerKind::Usb,       mUsbScanner)
+    , mBluetoothSlot ("Bluetooth", ScannerKind::Bluetooth, mBluetoothScanner)
+    , mScanTick      (mScanScheduler, std::bind(&AutoMode::OnScanResult, this, std::placeholders::_1))
     , mScannerTimer
         ( std::bind(&AutoMode::ScannerTimerProc, this, std::placeholders::_1, std::placeholders::_2)
         , ThreadTimer::Interval(1000)
@@ -152,6 +219,24 @@ AutoMode::AutoMode (CaffeineAppSO app)
 {
 }
 
+auto AutoMode::UpdateScannerInterval () -> void
+{
+    // Timer ticks at fastest scanner interval, scheduler skips the rest.
+    const auto settingsPtr = mAppSO.GetSettings();
+    if (!settingsPtr)
+    {
+        return;
+    }
+
+    auto interval = std::chrono::milliseconds(settingsPtr->Auto.ScanInterval);
+    for (const auto kind : { ScannerKind::Process, ScannerKind::Window, ScannerKind::Usb, ScannerKind::Bluetooth })
+    {
+        interval = std::min(interval, GetScanCadence(*settingsPtr, kind).Interval);
+    }
+
+    mScannerTimer.SetInterval(interval);
+}
+
 auto AutoMode::Start () -> bool
 {
     mAppSO.DisableCaffeine();
@@ -165,12 +250,15 @@ auto AutoMode::Start () -> bool
  || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW) \
  || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB) \
  || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
-    const auto settingsPtr = mAppSO.GetSettings();
-    if (settingsPtr)
+    UpdateScannerInterval();
+
+    for (auto slot : { &mProcessSlot, &mWindowSlot, &mUsbSlot, &mBluetoothSlot })
     {
-        mScannerTimer.SetInterval(std::chrono::milliseconds(settingsPtr->Auto.ScanInterval));
+        slot->LastResult = false;
     }
 
+    mScanScheduler.Reset();
+
     mScannerResult = false;
     mScannerTimer.Start();
 #endif
@@ -190,6 +278,13 @@ auto AutoMode::Stop () -> bool
  || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB) \
  || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
     mScannerTimer.Stop();
+    mScanTick.Cancel();
+
+    // Scan pool outlives us, wait only for our cancelled scanners to return.
+    for (auto slot : { &mProcessSlot, &mWindowSlot, &mUsbSlot, &mBluetoothSlot })
+    {
+        slot->WaitIdle();
+    }
 #endif
 
     mAppSO.DisableCaffeine();
@@ -199,6 +294,45 @@ auto AutoMode::Stop () -> bool
     return true;
 }
 
+auto AutoMode::OnTimeChange () -> void
+{
+    // Time zone may have changed along with time.
+    LocalClock::Get().Invalidate();
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+    mScheduleTimer.Wake();
+#endif
+}
+
+auto AutoMode::OnSettingsChange () -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+    mScheduleTimer.Wake();
+#endif
+
+    // Trigger lists may have changed, rescan without waiting for backoff.
+    mScanScheduler.Reset();
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    // Scan intervals may have changed too, don't wait out the old one.
+    UpdateScannerInterval();
+    mScannerTimer.Wake();
+#endif
+}
+
+auto AutoMode::OnDeviceChange () -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    mScanScheduler.Wake(ScannerKind::Usb);
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    mScanScheduler.Wake(ScannerKind::Bluetooth);
+#endif
+}
+
 auto AutoMode::GetIcon (CaffeineState state) const -> const HICON
 {
     auto icons = mAppSO.GetIcons();
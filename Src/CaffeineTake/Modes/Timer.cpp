@@ -22,6 +22,7 @@
 #include "Config.hpp"
 #include "../CaffeineMode.hpp"
 
+#include "Diagnostics.hpp"
 #include "Lang.hpp"
 #include "Logger.hpp"
 #include "Settings.hpp"
@@ -30,6 +31,8 @@ namespace CaffeineTake {
 
 auto TimerMode::TimerProc (const StopToken& stop, const PauseToken& pause) -> bool
 {
+    DIAG_SCOPE(Subsystem::TimerMode);
+
     mAppSO.DisableCaffeine();
 
     return false;
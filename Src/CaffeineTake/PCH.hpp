@@ -34,8 +34,10 @@
 
 // spdlog
 #include <spdlog/sinks/basic_file_sink.h>
-#include <spdlog/sinks/msvc_sink.h>
 #include <spdlog/spdlog.h>
+#if defined(_WIN32)
+#   include <spdlog/sinks/msvc_sink.h>
+#endif
 
 // C++ Library
 #include <array>
@@ -58,7 +60,8 @@
 #include <utility>
 #include <vector>
 
-// Windows
+// Windows, other platforms only build the core (see CaffeineTake.Benchmark).
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #define STRICT_TYPED_ITEMIDS
@@ -93,3 +96,5 @@
 
 // PlaySound
 #include <mmsystem.h>
+
+#endif // #if defined(_WIN32)
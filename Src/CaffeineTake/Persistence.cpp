@@ -0,0 +1,265 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "Persistence.hpp"
+
+#include "Diagnostics.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#elif defined(__linux__)
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+namespace CaffeineTake {
+
+#pragma region "WriteFileAtomic"
+
+auto WriteFileAtomic (const std::filesystem::path& path, const std::string_view data) -> bool
+{
+    auto tempPath = path;
+    tempPath += ".tmp";
+
+#if defined(_WIN32)
+    const auto file = ::CreateFileW(
+        tempPath.c_str(),
+        GENERIC_WRITE,
+        0,
+        NULL,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        LOG_ERROR(L"Failed to open '{}' for writing, error: {}", tempPath.wstring(), ::GetLastError());
+        return false;
+    }
+
+    auto written = DWORD{0};
+    auto ok      = ::WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written, NULL)
+                && written == data.size()
+                && ::FlushFileBuffers(file);
+
+    ::CloseHandle(file);
+
+    if (!ok)
+    {
+        LOG_ERROR(L"Failed to write '{}', error: {}", tempPath.wstring(), ::GetLastError());
+        ::DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    // Write through so rename itself is on disk when we return.
+    if (!::MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        LOG_ERROR(L"Failed to replace '{}', error: {}", path.wstring(), ::GetLastError());
+        ::DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+#elif defined(__linux__)
+    const auto fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        LOG_ERROR(L"Failed to open '{}' for writing", tempPath.wstring());
+        return false;
+    }
+
+    auto ok   = true;
+    auto left = data;
+    while (ok && !left.empty())
+    {
+        const auto n = ::write(fd, left.data(), left.size());
+        ok = n > 0;
+        if (ok)
+        {
+            left.remove_prefix(static_cast<size_t>(n));
+        }
+    }
+
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+
+    if (!ok || ::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        LOG_ERROR(L"Failed to write '{}'", path.wstring());
+        ::unlink(tempPath.c_str());
+        return false;
+    }
+
+    // Rename is durable only after directory entry is flushed.
+    auto dir = path.parent_path();
+    if (dir.empty())
+    {
+        dir = ".";
+    }
+
+    const auto dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0)
+    {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+
+    return true;
+#endif
+}
+
+#pragma endregion
+
+#pragma region "PersistQueue"
+
+PersistQueue::PersistQueue (const std::chrono::milliseconds debounce, const std::chrono::milliseconds maxDelay)
+    : mDebounce (debounce)
+    , mMaxDelay (maxDelay)
+{
+}
+
+PersistQueue::~PersistQueue ()
+{
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+        mIsDone = true;
+    }
+
+    mConditionVar.notify_one();
+
+    if (mThread.joinable())
+    {
+        mThread.join();
+    }
+}
+
+auto PersistQueue::Service () -> void
+{
+    DIAG_THREAD("Persist");
+
+    auto waitLock = std::unique_lock<std::mutex>(mMutex);
+    while (true)
+    {
+        DIAG_SCOPE(Subsystem::Service);
+
+        if (mPending.empty())
+        {
+            if (mIsDone)
+            {
+                break;
+            }
+
+            mConditionVar.wait(waitLock);
+            continue;
+        }
+
+        const auto dueOf = [](const Pending& p) { return std::min(p.Due, p.Deadline); };
+
+        const auto next = std::min_element(mPending.begin(), mPending.end(), [&dueOf](const Pending& a, const Pending& b)
+        {
+            return dueOf(a) < dueOf(b);
+        });
+
+        // On shutdown everything pending is written right away.
+        const auto due = dueOf(*next);
+        if (!mIsDone && Clock::now() < due)
+        {
+            mConditionVar.wait_until(waitLock, due);
+            continue;
+        }
+
+        auto key = std::move(next->Key);
+        auto job = std::move(next->Write);
+        mPending.erase(next);
+        mInFlight += 1;
+
+        waitLock.unlock();
+        const auto ok = job();
+        waitLock.lock();
+
+        if (!ok)
+        {
+            LOG_ERROR("Failed to persist {}", key);
+        }
+
+        mInFlight -= 1;
+        mIdleConditionVar.notify_all();
+    }
+}
+
+auto PersistQueue::Schedule (const std::string_view key, Job job) -> void
+{
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+        if (!mIsRunning)
+        {
+            mThread    = std::thread(&PersistQueue::Service, this);
+            mIsRunning = true;
+        }
+
+        const auto now = Clock::now();
+        const auto it  = std::find_if(mPending.begin(), mPending.end(), [key](const Pending& p)
+        {
+            return p.Key == key;
+        });
+
+        if (it != mPending.end())
+        {
+            it->Write = std::move(job);
+            it->Due   = now + mDebounce;
+        }
+        else
+        {
+            mPending.push_back(Pending{ std::string(key), std::move(job), now + mDebounce, now + mMaxDelay });
+        }
+    }
+
+    mConditionVar.notify_one();
+}
+
+auto PersistQueue::Flush () -> void
+{
+    auto waitLock = std::unique_lock<std::mutex>(mMutex);
+
+    const auto now = Clock::now();
+    for (auto& pending : mPending)
+    {
+        pending.Due = now;
+    }
+
+    mConditionVar.notify_one();
+    mIdleConditionVar.wait(waitLock, [this]
+    {
+        return mPending.empty() && mInFlight == 0;
+    });
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
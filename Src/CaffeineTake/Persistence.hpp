@@ -0,0 +1,90 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace CaffeineTake {
+
+// Writes data to temp file next to path, flushes it to disk and renames it
+// over path. After a crash path holds either old or new content, never a
+// mix of both.
+auto WriteFileAtomic (const std::filesystem::path& path, const std::string_view data) -> bool;
+
+// Runs writes on its own thread. Jobs are coalesced by key, job scheduled
+// while one with same key is pending replaces it and pushes it back by
+// debounce time, up to max delay since first one. Jobs should capture what
+// they write by value.
+class PersistQueue final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Job   = std::function<bool ()>;
+
+private:
+    struct Pending
+    {
+        std::string       Key;
+        Job               Write;
+        Clock::time_point Due;
+        Clock::time_point Deadline;
+    };
+
+    std::thread               mThread;
+    std::mutex                mMutex;
+    std::condition_variable   mConditionVar;
+    std::condition_variable   mIdleConditionVar;
+    std::vector<Pending>      mPending   = std::vector<Pending>();
+    size_t                    mInFlight  = 0;
+    bool                      mIsRunning = false;
+    bool                      mIsDone    = false;
+    std::chrono::milliseconds mDebounce  = std::chrono::milliseconds(500);
+    std::chrono::milliseconds mMaxDelay  = std::chrono::milliseconds(5000);
+
+    auto Service () -> void;
+
+public:
+    PersistQueue (
+        const std::chrono::milliseconds debounce = std::chrono::milliseconds(500),
+        const std::chrono::milliseconds maxDelay = std::chrono::milliseconds(5000)
+    );
+
+    PersistQueue            (const PersistQueue& rhs) = delete;
+    PersistQueue& operator= (const PersistQueue& rhs) = delete;
+
+    // Pending jobs are written before thread exits.
+    ~PersistQueue ();
+
+    auto Schedule (const std::string_view key, Job job) -> void;
+
+    // Writes all pending jobs now and waits for them.
+    auto Flush () -> void;
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,292 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "ProcProcessSource.hpp"
+
+#if defined(__linux__)
+
+#include "Logger.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace CaffeineTake {
+
+namespace {
+
+struct LinuxDirent64
+{
+    std::uint64_t  d_ino;
+    std::int64_t   d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[1];
+};
+
+// Write "<pid>/<leaf>" into buffer, returns false if it doesn't fit.
+template <size_t N>
+auto MakePidPath (std::array<char, N>& buffer, ProcessId pid, const std::string_view leaf) -> bool
+{
+    auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), pid);
+    if (ec != std::errc())
+    {
+        return false;
+    }
+
+    const auto used = static_cast<size_t>(end - buffer.data());
+    if (used + 1 + leaf.size() + 1 > buffer.size())
+    {
+        return false;
+    }
+
+    *end++ = '/';
+    end = std::copy(leaf.begin(), leaf.end(), end);
+    *end = '\0';
+
+    return true;
+}
+
+auto ParsePid (const char* name, ProcessId& pid) -> bool
+{
+    const auto view = std::string_view(name);
+    if (view.empty() || view.front() < '1' || view.front() > '9')
+    {
+        return false;
+    }
+
+    auto [ptr, ec] = std::from_chars(view.data(), view.data() + view.size(), pid);
+    return ec == std::errc() && ptr == view.data() + view.size();
+}
+
+// Decode UTF-8 into wide string (UTF-32 on Linux). Reuses string capacity.
+auto AssignUtf8 (std::wstring& out, const std::string_view in) -> void
+{
+    out.resize(in.size());
+
+    auto length = size_t{0};
+    for (auto i = size_t{0}; i < in.size(); )
+    {
+        const auto c = static_cast<unsigned char>(in[i]);
+
+        auto cp    = char32_t{0xFFFD};
+        auto extra = 0;
+
+        if      (c < 0x80)           { cp = c;        extra = 0; }
+        else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; extra = 1; }
+        else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; extra = 2; }
+        else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; extra = 3; }
+        else                         { extra = -1; }
+
+        i += 1;
+
+        if (extra < 0 || i + extra > in.size())
+        {
+            out[length++] = static_cast<wchar_t>(0xFFFD);
+            continue;
+        }
+
+        for (auto k = 0; k < extra; ++k)
+        {
+            const auto cc = static_cast<unsigned char>(in[i]);
+            if ((cc & 0xC0) != 0x80)
+            {
+                cp = 0xFFFD;
+                break;
+            }
+
+            cp = (cp << 6) | (cc & 0x3F);
+            i += 1;
+        }
+
+        out[length++] = static_cast<wchar_t>(cp);
+    }
+
+    out.resize(length);
+}
+
+} // namespace
+
+ProcProcessSource::ProcProcessSource (std::string root)
+    : mRoot (std::move(root))
+{
+}
+
+ProcProcessSource::~ProcProcessSource ()
+{
+    if (mRootFd != -1)
+    {
+        close(mRootFd);
+    }
+}
+
+auto ProcProcessSource::OpenRoot () -> bool
+{
+    if (mRootFd != -1)
+    {
+        // Rewind instead of reopening.
+        mOsCalls += 1;
+        return lseek(mRootFd, 0, SEEK_SET) == 0;
+    }
+
+    mOsCalls += 1;
+    mRootFd = open(mRoot.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mRootFd == -1)
+    {
+        LOG_ERROR("Failed to open process root '{}', errno: {}", mRoot, errno);
+        return false;
+    }
+
+    return true;
+}
+
+auto ProcProcessSource::Enumerate (std::vector<ProcessRecord>& list) -> bool
+{
+    list.clear();
+
+    if (!OpenRoot())
+    {
+        return false;
+    }
+
+    while (true)
+    {
+        mOsCalls += 1;
+        const auto bytes = syscall(SYS_getdents64, mRootFd, mDirBuffer.data(), mDirBuffer.size());
+        if (bytes < 0)
+        {
+            LOG_ERROR("getdents64() failed on '{}', errno: {}", mRoot, errno);
+            return false;
+        }
+
+        if (bytes == 0)
+        {
+            break;
+        }
+
+        for (auto offset = long{0}; offset < bytes; )
+        {
+            const auto entry = reinterpret_cast<const LinuxDirent64*>(mDirBuffer.data() + offset);
+            offset += entry->d_reclen;
+
+            auto pid = ProcessId{0};
+            if ((entry->d_type == DT_DIR || entry->d_type == DT_UNKNOWN) && ParsePid(entry->d_name, pid))
+            {
+                list.push_back(ProcessRecord{ pid, static_cast<ProcessStartKey>(entry->d_ino) });
+            }
+        }
+    }
+
+    return true;
+}
+
+auto ProcProcessSource::ReadExe (ProcessId pid, std::wstring& path) -> bool
+{
+    auto name = std::array<char, 32>();
+    if (!MakePidPath(name, pid, "exe"))
+    {
+        return false;
+    }
+
+    auto buffer = std::array<char, 4096>();
+
+    mOsCalls += 1;
+    const auto length = readlinkat(mRootFd, name.data(), buffer.data(), buffer.size());
+    if (length <= 0 || static_cast<size_t>(length) >= buffer.size())
+    {
+        return false;
+    }
+
+    auto view = std::string_view(buffer.data(), static_cast<size_t>(length));
+
+    // Executable replaced or removed while running.
+    constexpr auto deleted = std::string_view(" (deleted)");
+    if (view.ends_with(deleted))
+    {
+        view.remove_suffix(deleted.size());
+    }
+
+    AssignUtf8(path, view);
+
+    return true;
+}
+
+auto ProcProcessSource::ReadComm (ProcessId pid, std::wstring& name) -> bool
+{
+    auto file = std::array<char, 32>();
+    if (!MakePidPath(file, pid, "comm"))
+    {
+        return false;
+    }
+
+    mOsCalls += 1;
+    const auto fd = openat(mRootFd, file.data(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    auto buffer = std::array<char, 64>();
+
+    mOsCalls += 1;
+    const auto length = read(fd, buffer.data(), buffer.size());
+
+    mOsCalls += 1;
+    close(fd);
+
+    if (length <= 0)
+    {
+        return false;
+    }
+
+    auto view = std::string_view(buffer.data(), static_cast<size_t>(length));
+    if (view.ends_with('\n'))
+    {
+        view.remove_suffix(1);
+    }
+
+    AssignUtf8(name, view);
+
+    return !name.empty();
+}
+
+auto ProcProcessSource::QueryImagePath (ProcessId pid, std::wstring& path) -> bool
+{
+    if (mRootFd == -1 && !OpenRoot())
+    {
+        return false;
+    }
+
+    return ReadExe(pid, path) || ReadComm(pid, path);
+}
+
+} // namespace CaffeineTake
+
+#endif // #if defined(__linux__)
@@ -0,0 +1,65 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "ProcessSource.hpp"
+
+#if defined(__linux__)
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace CaffeineTake {
+
+// Walks procfs with getdents64. Start key is the inode number of the
+// /proc/<pid> directory, which the kernel allocates anew for every process
+// (and occasionally when the dentry is evicted, costing one extra query).
+// Root is configurable so fixture trees can stand in for /proc.
+class ProcProcessSource final : public ProcessSource
+{
+    std::string               mRoot;
+    int                       mRootFd    = -1;
+    std::array<char, 32768>   mDirBuffer = {};
+
+    auto OpenRoot () -> bool;
+
+    auto ReadExe  (ProcessId pid, std::wstring& path) -> bool;
+    auto ReadComm (ProcessId pid, std::wstring& name) -> bool;
+
+public:
+    explicit ProcProcessSource (std::string root = "/proc");
+    ~ProcProcessSource ();
+
+    ProcProcessSource            (const ProcProcessSource&) = delete;
+    ProcProcessSource& operator= (const ProcProcessSource&) = delete;
+
+    auto Enumerate (std::vector<ProcessRecord>& list) -> bool override;
+
+    // Executable path from /proc/<pid>/exe. Falls back to comm when the link
+    // can't be read (kernel threads, other users' processes), so name
+    // triggers still work, though comm is truncated to 15 characters.
+    auto QueryImagePath (ProcessId pid, std::wstring& path) -> bool override;
+};
+
+} // namespace CaffeineTake
+
+#endif // #if defined(__linux__)
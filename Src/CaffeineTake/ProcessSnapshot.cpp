@@ -0,0 +1,189 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "ProcessSnapshot.hpp"
+#include "ThreadTimer.hpp"
+
+namespace CaffeineTake {
+
+auto ProcessSnapshot::Update () -> bool
+{
+    // Scan was cancelled between Update() and Classify(), processes added
+    // then would be forgotten without verdict.
+    if (!mClassified && !mAdded.empty())
+    {
+        mStale = true;
+    }
+
+    mAdded.clear();
+    mClassified = false;
+    mStats = ProcessSnapshotStats();
+
+    if (!mSource)
+    {
+        return false;
+    }
+
+    const auto osCalls = mSource->GetOsCallCount();
+
+    if (!mSource->Enumerate(mRecords))
+    {
+        mStats.OsCalls = mSource->GetOsCallCount() - osCalls;
+        return false;
+    }
+
+    mTick += 1;
+
+    for (const auto& record : mRecords)
+    {
+        auto [it, inserted] = mEntries.try_emplace(record.Pid);
+        auto& entry = it->second;
+
+        // Known process, nothing to query.
+        if (!inserted && entry.StartKey == record.StartKey)
+        {
+            entry.LastSeen = mTick;
+            continue;
+        }
+
+        // New process or PID reused by another one.
+        if (!inserted)
+        {
+            mMatches.erase(record.Pid);
+            entry.ImagePath.clear();
+            entry.Verdict = TriggerMatch::None;
+        }
+
+        entry.StartKey = record.StartKey;
+        entry.LastSeen = mTick;
+
+        if (!mSource->QueryImagePath(record.Pid, entry.ImagePath))
+        {
+            entry.ImagePath.clear();
+        }
+
+        mAdded.push_back(record.Pid);
+    }
+
+    // Drop exited processes.
+    for (auto it = mEntries.begin(); it != mEntries.end(); )
+    {
+        if (it->second.LastSeen != mTick)
+        {
+            mMatches.erase(it->first);
+            it = mEntries.erase(it);
+            mStats.Removed += 1;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    mStats.Processes = mEntries.size();
+    mStats.Added     = mAdded.size();
+    mStats.OsCalls   = mSource->GetOsCallCount() - osCalls;
+
+    return true;
+}
+
+auto ProcessSnapshot::Classify (TriggerMatcher& matcher, bool all) -> void
+{
+    Classify(matcher, all, StopToken());
+}
+
+auto ProcessSnapshot::Classify (TriggerMatcher& matcher, bool all, const StopToken& stop) -> bool
+{
+    if (stop)
+    {
+        mStale = mStale || all || !mAdded.empty();
+        return false;
+    }
+
+    const auto classify = [&](ProcessId pid, ProcessSnapshotEntry& entry)
+    {
+        entry.Verdict = matcher.Match(entry.ImagePath);
+        if (entry.Verdict != TriggerMatch::None)
+        {
+            mMatches.insert(pid);
+        }
+        else
+        {
+            mMatches.erase(pid);
+        }
+    };
+
+    if (all || mStale)
+    {
+        for (auto& [pid, entry] : mEntries)
+        {
+            if (stop)
+            {
+                mStale = true;
+                return false;
+            }
+
+            classify(pid, entry);
+        }
+    }
+    else
+    {
+        for (const auto pid : mAdded)
+        {
+            if (stop)
+            {
+                mStale = true;
+                return false;
+            }
+
+            if (auto it = mEntries.find(pid); it != mEntries.end())
+            {
+                classify(pid, it->second);
+            }
+        }
+    }
+
+    mClassified = true;
+    mStale      = false;
+
+    return true;
+}
+
+auto ProcessSnapshot::Clear () -> void
+{
+    mEntries.clear();
+    mAdded.clear();
+    mMatches.clear();
+    mClassified = true;
+    mStale      = false;
+}
+
+auto ProcessSnapshot::Find (ProcessId pid) const -> const ProcessSnapshotEntry*
+{
+    if (auto it = mEntries.find(pid); it != mEntries.end())
+    {
+        return &it->second;
+    }
+
+    return nullptr;
+}
+
+} // namespace CaffeineTake
@@ -0,0 +1,98 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "ProcessSource.hpp"
+#include "TriggerMatcher.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace CaffeineTake {
+
+class StopToken;
+
+struct ProcessSnapshotEntry
+{
+    ProcessStartKey StartKey  = 0;
+    std::wstring    ImagePath = std::wstring(); // empty if process could not be queried
+    TriggerMatch    Verdict   = TriggerMatch::None;
+    std::uint32_t   LastSeen  = 0;
+};
+
+struct ProcessSnapshotStats
+{
+    size_t        Processes = 0;
+    size_t        Added     = 0;
+    size_t        Removed   = 0;
+    std::uint64_t OsCalls   = 0; // made by last Update()
+};
+
+// Process table kept between scans. Each Update() lists running processes
+// once and queries image path only for PIDs that are new or were reused
+// since the previous update, exited processes are dropped.
+class ProcessSnapshot final
+{
+public:
+    using EntryMap = std::unordered_map<ProcessId, ProcessSnapshotEntry>;
+
+private:
+    ProcessSourcePtr              mSource;
+    EntryMap                      mEntries    = EntryMap();
+    std::vector<ProcessRecord>    mRecords    = std::vector<ProcessRecord>();
+    std::vector<ProcessId>        mAdded      = std::vector<ProcessId>();
+    std::unordered_set<ProcessId> mMatches    = std::unordered_set<ProcessId>();
+    std::uint32_t                 mTick       = 0;
+    ProcessSnapshotStats          mStats      = ProcessSnapshotStats();
+    bool                          mClassified = true;   // mAdded got verdicts
+    bool                          mStale      = false;  // verdicts missing, classify all
+
+public:
+    ProcessSnapshot (ProcessSourcePtr source = CreateProcessSource())
+        : mSource (std::move(source))
+    {
+    }
+
+    auto Update () -> bool;
+
+    // Compute verdicts for processes added by last Update(), or for all of
+    // them when trigger list changed.
+    auto Classify (TriggerMatcher& matcher, bool all) -> void;
+
+    // Same, but gives up when stop is set and returns false. Processes left
+    // without verdict, or added by an Update() that was never classified,
+    // are picked up by next Classify().
+    auto Classify (TriggerMatcher& matcher, bool all, const StopToken& stop) -> bool;
+
+    auto Clear () -> void;
+
+    auto Find (ProcessId pid) const -> const ProcessSnapshotEntry*;
+
+    auto GetEntries () const -> const EntryMap&                      { return mEntries; }
+    auto GetAdded   () const -> const std::vector<ProcessId>&        { return mAdded; }
+    auto GetMatches () const -> const std::unordered_set<ProcessId>& { return mMatches; }
+    auto GetStats   () const -> const ProcessSnapshotStats&          { return mStats; }
+};
+
+} // namespace CaffeineTake
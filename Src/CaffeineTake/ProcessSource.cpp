@@ -0,0 +1,221 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "ProcessSource.hpp"
+
+#include "Logger.hpp"
+#include "SyntheticWorkload.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#   include <winternl.h>
+#elif defined(__linux__)
+#   include "ProcProcessSource.hpp"
+#endif
+
+namespace CaffeineTake {
+
+#if defined(_WIN32)
+
+namespace {
+
+constexpr auto SYSTEM_PROCESS_INFORMATION_CLASS = 5;
+constexpr auto STATUS_INFO_LENGTH_MISMATCH_CODE = static_cast<LONG>(0xC0000004L);
+
+// Leading part of SYSTEM_PROCESS_INFORMATION. winternl.h hides CreateTime
+// inside a reserved block, so the layout is spelled out here.
+struct ProcessInformationEntry
+{
+    ULONG          NextEntryOffset;
+    ULONG          NumberOfThreads;
+    LARGE_INTEGER  WorkingSetPrivateSize;
+    ULONG          HardFaultCount;
+    ULONG          NumberOfThreadsHighWatermark;
+    ULONGLONG      CycleTime;
+    LARGE_INTEGER  CreateTime;
+    LARGE_INTEGER  UserTime;
+    LARGE_INTEGER  KernelTime;
+    UNICODE_STRING ImageName;
+    LONG           BasePriority;
+    HANDLE         UniqueProcessId;
+};
+
+using NtQuerySystemInformationFn = LONG (WINAPI*)(ULONG, PVOID, ULONG, PULONG);
+
+} // namespace
+
+// Lists processes with a single NtQuerySystemInformation call, which
+// returns pid and creation time of every process at once. Only the image
+// path needs a handle, and that is left to the caller to request.
+class WindowsProcessSource final : public ProcessSource
+{
+    NtQuerySystemInformationFn mNtQuerySystemInformation = nullptr;
+    std::vector<std::byte>     mBuffer                   = std::vector<std::byte>();
+    std::vector<wchar_t>       mPathBuffer               = std::vector<wchar_t>(MAX_PATH);
+
+public:
+    WindowsProcessSource ()
+    {
+        if (auto ntdll = GetModuleHandleW(L"ntdll.dll"))
+        {
+            mNtQuerySystemInformation = reinterpret_cast<NtQuerySystemInformationFn>(
+                GetProcAddress(ntdll, "NtQuerySystemInformation")
+            );
+        }
+
+        if (!mNtQuerySystemInformation)
+        {
+            LOG_ERROR("Failed to find NtQuerySystemInformation()");
+        }
+    }
+
+    auto Enumerate (std::vector<ProcessRecord>& list) -> bool override
+    {
+        list.clear();
+
+        if (!mNtQuerySystemInformation)
+        {
+            return false;
+        }
+
+        if (mBuffer.empty())
+        {
+            mBuffer.resize(256 * 1024);
+        }
+
+        // Process list can grow between calls, retry with bigger buffer.
+        auto status = LONG{0};
+        for (auto attempt = 0; attempt < 4; ++attempt)
+        {
+            auto needed = ULONG{0};
+            mOsCalls += 1;
+            status = mNtQuerySystemInformation(
+                SYSTEM_PROCESS_INFORMATION_CLASS,
+                mBuffer.data(),
+                static_cast<ULONG>(mBuffer.size()),
+                &needed
+            );
+
+            if (status != STATUS_INFO_LENGTH_MISMATCH_CODE)
+            {
+                break;
+            }
+
+            mBuffer.resize(std::max<size_t>(needed, mBuffer.size()) + 64 * 1024);
+        }
+
+        if (status < 0)
+        {
+            LOG_ERROR("NtQuerySystemInformation() failed with status: {:#x}", static_cast<ULONG>(status));
+            return false;
+        }
+
+        auto offset = size_t{0};
+        while (true)
+        {
+            const auto entry = reinterpret_cast<const ProcessInformationEntry*>(mBuffer.data() + offset);
+            const auto pid   = static_cast<ProcessId>(reinterpret_cast<ULONG_PTR>(entry->UniqueProcessId));
+
+            // Skip System Idle Process.
+            if (pid != 0)
+            {
+                list.push_back(ProcessRecord{ pid, static_cast<ProcessStartKey>(entry->CreateTime.QuadPart) });
+            }
+
+            if (entry->NextEntryOffset == 0)
+            {
+                break;
+            }
+
+            offset += entry->NextEntryOffset;
+        }
+
+        return true;
+    }
+
+    auto QueryImagePath (ProcessId pid, std::wstring& path) -> bool override
+    {
+        mOsCalls += 1;
+        auto processHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        if (!processHandle)
+        {
+            return false;
+        }
+
+        auto result = false;
+        while (true)
+        {
+            auto size = static_cast<DWORD>(mPathBuffer.size());
+
+            mOsCalls += 1;
+            if (QueryFullProcessImageNameW(processHandle, 0, mPathBuffer.data(), &size))
+            {
+                path.assign(mPathBuffer.data(), size);
+                result = true;
+                break;
+            }
+
+            // Long paths, grow up to UNICODE_STRING limit.
+            if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || mPathBuffer.size() >= 32768)
+            {
+                break;
+            }
+
+            mPathBuffer.resize(mPathBuffer.size() * 2);
+        }
+
+        mOsCalls += 1;
+        CloseHandle(processHandle);
+
+        return result;
+    }
+};
+
+#endif // #if defined(_WIN32)
+
+auto CreateProcessSource () -> ProcessSourcePtr
+{
+#if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
+    if (auto workload = SyntheticWorkload::GetInstalled())
+    {
+        return workload->CreateProcessSource();
+    }
+#endif
+
+#if defined(_WIN32)
+    return std::make_unique<WindowsProcessSource>();
+#elif defined(__linux__)
+    return std::make_unique<ProcProcessSource>();
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace CaffeineTake
@@ -0,0 +1,67 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CaffeineTake {
+
+using ProcessId       = std::uint32_t;
+using ProcessStartKey = std::uint64_t; // process creation time, changes when PID is reused
+
+struct ProcessRecord
+{
+    ProcessId       Pid;
+    ProcessStartKey StartKey;
+};
+
+// Operating system side of process scanning. Implementations count every
+// system call they make, so callers can tell what a scan actually cost.
+class ProcessSource
+{
+protected:
+    std::uint64_t mOsCalls = 0;
+
+public:
+    virtual ~ProcessSource () {}
+
+    // Fill list with all running processes. List is cleared first, its
+    // capacity is kept so steady state enumeration does not allocate.
+    virtual auto Enumerate (std::vector<ProcessRecord>& list) -> bool = 0;
+
+    // Read full executable path of a process.
+    virtual auto QueryImagePath (ProcessId pid, std::wstring& path) -> bool = 0;
+
+    auto GetOsCallCount () const -> std::uint64_t
+    {
+        return mOsCalls;
+    }
+};
+
+using ProcessSourcePtr = std::unique_ptr<ProcessSource>;
+
+// Default source for the platform we are running on.
+auto CreateProcessSource () -> ProcessSourcePtr;
+
+} // namespace CaffeineTake
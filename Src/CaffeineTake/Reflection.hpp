@@ -0,0 +1,256 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace CaffeineTake {
+
+// Codec used when field doesn't name one, JSON form is then picked from
+// member type. Codecs don't affect binary form.
+struct DefaultCodec
+{
+};
+
+template <typename Owner, typename Member, typename Codec = DefaultCodec>
+struct FieldInfo
+{
+    using OwnerType  = Owner;
+    using MemberType = Member;
+    using CodecType  = Codec;
+
+    std::string_view Name;
+    Member Owner::*  Pointer;
+    bool             Required;
+};
+
+template <typename Codec = DefaultCodec, typename Owner, typename Member>
+constexpr auto Field (const std::string_view name, Member Owner::* pointer, const bool required = true)
+{
+    return FieldInfo<Owner, Member, Codec>{ name, pointer, required };
+}
+
+// Specialized with REFLECT for every serialized struct. Fields is a tuple
+// of FieldInfo in declaration order.
+template <typename T>
+struct Reflect;
+
+template <typename T>
+concept Reflected = requires { Reflect<T>::Fields; };
+
+template <typename T>
+struct IsVector : std::false_type
+{
+};
+
+template <typename T>
+struct IsVector<std::vector<T>> : std::true_type
+{
+};
+
+#pragma region "Field Table"
+
+template <Reflected T>
+constexpr auto FieldCount = std::tuple_size_v<std::remove_cvref_t<decltype(Reflect<T>::Fields)>>;
+
+template <Reflected T, size_t I>
+using FieldType = std::remove_cvref_t<decltype(std::get<I>(Reflect<T>::Fields))>;
+
+template <Reflected T, typename Fn>
+constexpr auto ForEachField (Fn&& fn) -> void
+{
+    std::apply([&fn](const auto&... field) { (fn(field), ...); }, Reflect<T>::Fields);
+}
+
+template <Reflected T>
+constexpr auto FieldNames = []
+{
+    auto names = std::array<std::string_view, FieldCount<T>>();
+    auto index = size_t{0};
+    ForEachField<T>([&names, &index](const auto& field) { names[index++] = field.Name; });
+    return names;
+}();
+
+// Field indices ordered by name, JSON objects are written in this order.
+template <Reflected T>
+constexpr auto SortedFields = []
+{
+    auto order = std::array<size_t, FieldCount<T>>();
+    for (auto i = size_t{0}; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [](size_t a, size_t b) { return FieldNames<T>[a] < FieldNames<T>[b]; });
+    return order;
+}();
+
+// Bit per required field, in declaration order.
+template <Reflected T>
+constexpr auto RequiredFields = []
+{
+    auto mask  = std::uint64_t{0};
+    auto index = size_t{0};
+    ForEachField<T>([&mask, &index](const auto& field)
+    {
+        if (field.Required)
+        {
+            mask |= std::uint64_t{1} << index;
+        }
+        index += 1;
+    });
+    return mask;
+}();
+
+template <Reflected T>
+constexpr auto CheckFields () -> bool
+{
+    constexpr auto& names = FieldNames<T>;
+    constexpr auto& order = SortedFields<T>;
+
+    static_assert(names.size() > 0 && names.size() <= 64, "Field count must be in 1..64");
+
+    for (auto i = size_t{0}; i < names.size(); ++i)
+    {
+        // Dots and brackets are path separators in error messages and diffs.
+        if (names[i].empty() || names[i].find_first_of(".[]") != std::string_view::npos)
+        {
+            return false;
+        }
+
+        if (i > 0 && names[order[i - 1]] == names[order[i]])
+        {
+            return false;
+        }
+    }
+
+    // Every field gets own member.
+    auto unique = true;
+    ForEachField<T>([&unique](const auto& a)
+    {
+        ForEachField<T>([&unique, &a](const auto& b)
+        {
+            if constexpr (std::is_same_v<decltype(a.Pointer), decltype(b.Pointer)>)
+            {
+                unique = unique && (a.Name == b.Name || a.Pointer != b.Pointer);
+            }
+        });
+    });
+
+    return unique;
+}
+
+// Use inside namespace CaffeineTake. Members are named through Self, see
+// REFLECT_FIELD.
+#define REFLECT(_type, ...)                                                        \
+    template <>                                                                    \
+    struct Reflect<_type>                                                          \
+    {                                                                              \
+        using Self = _type;                                                        \
+        static constexpr auto Fields = std::make_tuple(__VA_ARGS__);               \
+    };                                                                             \
+    static_assert(CheckFields<_type>(), "Invalid field table of " #_type)
+
+#define REFLECT_FIELD(_member)           ::CaffeineTake::Field(#_member, &Self::_member)
+#define REFLECT_OPTIONAL(_member)        ::CaffeineTake::Field(#_member, &Self::_member, false)
+#define REFLECT_CODEC(_member, _codec)   ::CaffeineTake::Field<_codec>(#_member, &Self::_member)
+
+#pragma endregion
+
+#pragma region "Compare"
+
+template <typename T>
+auto ReflectEqual (const T& a, const T& b) -> bool
+{
+    if constexpr (Reflected<T>)
+    {
+        auto equal = true;
+        ForEachField<T>([&](const auto& field)
+        {
+            equal = equal && ReflectEqual(a.*field.Pointer, b.*field.Pointer);
+        });
+        return equal;
+    }
+    else if constexpr (IsVector<T>::value)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const auto& x, const auto& y)
+        {
+            return ReflectEqual(x, y);
+        });
+    }
+    else
+    {
+        return a == b;
+    }
+}
+
+// Calls fn with path (e.g. "Auto.TriggerUsb.UsbDevices") of every leaf
+// field that differs. Vectors are compared as a whole.
+template <Reflected T, typename Fn>
+auto ReflectDiff (const T& a, const T& b, Fn&& fn, std::string& path) -> void
+{
+    const auto size = path.size();
+
+    ForEachField<T>([&](const auto& field)
+    {
+        using Member = typename std::remove_cvref_t<decltype(field)>::MemberType;
+
+        path.resize(size);
+        if (!path.empty())
+        {
+            path += '.';
+        }
+        path += field.Name;
+
+        if constexpr (Reflected<Member>)
+        {
+            ReflectDiff(a.*field.Pointer, b.*field.Pointer, fn, path);
+        }
+        else if (!ReflectEqual(a.*field.Pointer, b.*field.Pointer))
+        {
+            fn(std::string_view(path));
+        }
+    });
+
+    path.resize(size);
+}
+
+template <Reflected T>
+auto ReflectDiff (const T& a, const T& b) -> std::vector<std::string>
+{
+    auto changed = std::vector<std::string>();
+    auto path    = std::string();
+    ReflectDiff(a, b, [&changed](std::string_view p) { changed.emplace_back(p); }, path);
+    return changed;
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
@@ -0,0 +1,290 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "RotatingLogSink.hpp"
+
+#if defined(FEATURE_CAFFEINETAKE_LOGGER)
+
+#include "LocalClock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cwctype>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#   include <winioctl.h>
+#endif
+
+namespace {
+    namespace fs = std::filesystem;
+
+    auto NextMidnight (const std::chrono::system_clock::time_point time) -> std::chrono::system_clock::time_point
+    {
+        const auto zone     = CaffeineTake::LocalClock::Get().Zone(time);
+        const auto local    = zone->to_local(time);
+        const auto midnight = std::chrono::floor<std::chrono::days>(local) + std::chrono::days(1);
+
+        return zone->to_sys(midnight, std::chrono::choose::earliest);
+    }
+
+    // Rotated files are named <stem>.<yyyymmdd-hhmmss>[-n]<extension>. Returns
+    // key that sorts them oldest first or nullopt for other files.
+    auto RotatedOrder (const fs::path& path, const fs::path& active) -> std::optional<std::pair<std::wstring, int>>
+    {
+        constexpr auto StampSize = size_t{15};
+
+        const auto name   = path.filename().wstring();
+        const auto prefix = active.stem().wstring() + L".";
+        const auto suffix = active.extension().wstring();
+
+        if (name.size() < prefix.size() + StampSize + suffix.size()
+         || !name.starts_with(prefix)
+         || !name.ends_with(suffix))
+        {
+            return std::nullopt;
+        }
+
+        const auto stamp = name.substr(prefix.size(), StampSize);
+        const auto rest  = std::wstring_view(name).substr(prefix.size() + StampSize, name.size() - prefix.size() - StampSize - suffix.size());
+        if (!std::all_of(stamp.begin(), stamp.end(), [](wchar_t c) { return iswdigit(c) || c == L'-'; }))
+        {
+            return std::nullopt;
+        }
+
+        auto n = 0;
+        if (!rest.empty())
+        {
+            if (rest.size() < 2 || rest[0] != L'-' || !std::all_of(rest.begin() + 1, rest.end(), iswdigit))
+            {
+                return std::nullopt;
+            }
+
+            for (const auto c : rest.substr(1))
+            {
+                n = n * 10 + (c - L'0');
+            }
+        }
+
+        return std::make_pair(stamp, n);
+    }
+
+    // Uses NTFS compression, file stays readable as plain text. Fails
+    // quietly on file systems without it.
+    auto CompressFile (const fs::path& path) -> void
+    {
+#if defined(_WIN32)
+        auto file = ::CreateFileW(
+            path.c_str(),
+            GENERIC_READ | GENERIC_WRITE,
+            0,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr
+        );
+
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        auto format   = USHORT{COMPRESSION_FORMAT_DEFAULT};
+        auto returned = DWORD{0};
+        ::DeviceIoControl(file, FSCTL_SET_COMPRESSION, &format, sizeof(format), nullptr, 0, &returned, nullptr);
+        ::CloseHandle(file);
+#else
+        (void)path;
+#endif
+    }
+}
+
+namespace CaffeineTake {
+
+RotatingLogSink::RotatingLogSink (const std::filesystem::path& path, const LogRotation& rotation)
+    : mPath     (path)
+    , mRotation (rotation)
+{
+    Open();
+}
+
+auto RotatingLogSink::Open () -> void
+{
+    mFile.open(mPath.string(), false);
+    mSize = mFile.size();
+
+    // Files rotated by previous runs count towards the limit.
+    auto rotated = std::vector<std::pair<std::pair<std::wstring, int>, fs::path>>();
+    auto ec      = std::error_code();
+    for (const auto& entry : fs::directory_iterator(mPath.parent_path(), ec))
+    {
+        if (const auto order = RotatedOrder(entry.path(), mPath); order && entry.is_regular_file(ec))
+        {
+            rotated.emplace_back(order.value(), entry.path());
+        }
+    }
+
+    std::sort(rotated.begin(), rotated.end());
+    for (auto& [order, path] : rotated)
+    {
+        mRotated.push_back(std::move(path));
+    }
+
+    Prune();
+
+    if (!mRotation.Daily)
+    {
+        return;
+    }
+
+    // File left from earlier day is rotated on first write.
+    auto lastWrite  = spdlog::log_clock::now();
+    const auto time = fs::last_write_time(mPath, ec);
+    if (!ec && mSize > 0)
+    {
+        lastWrite = std::chrono::time_point_cast<spdlog::log_clock::duration>(
+            std::chrono::clock_cast<std::chrono::system_clock>(time)
+        );
+    }
+
+    mNextRotation = NextMidnight(lastWrite);
+}
+
+auto RotatingLogSink::RotatedPath (TimePoint now) const -> std::filesystem::path
+{
+    const auto local = LocalClock::Get().ToLocal(now);
+    const auto stamp = std::format(L"{:%Y%m%d-%H%M%S}", std::chrono::floor<std::chrono::seconds>(local));
+    const auto stem  = mPath.stem().wstring() + L"." + stamp;
+    const auto ext   = mPath.extension().wstring();
+
+    // Several rotations within one second are numbered after newest one,
+    // names of already removed files are not reused.
+    auto n = 0;
+    if (!mRotated.empty())
+    {
+        if (const auto newest = RotatedOrder(mRotated.back(), mPath); newest && newest->first == stamp)
+        {
+            n = newest->second + 1;
+        }
+    }
+
+    const auto nameOf = [&](int index)
+    {
+        return mPath.parent_path() / (index == 0 ? stem + ext : std::format(L"{}-{}{}", stem, index, ext));
+    };
+
+    auto ec     = std::error_code();
+    auto target = nameOf(n);
+    while (fs::exists(target, ec))
+    {
+        target = nameOf(++n);
+    }
+
+    return target;
+}
+
+auto RotatingLogSink::Rotate (TimePoint now) -> void
+{
+    mFile.close();
+
+    const auto target = RotatedPath(now);
+
+    auto ec = std::error_code();
+    fs::rename(mPath, target, ec);
+    if (ec)
+    {
+        // Someone holds the file open without sharing. Start over rather
+        // than grow past the bound.
+        mFile.open(mPath.string(), true);
+    }
+    else
+    {
+        mFile.open(mPath.string(), false);
+        mRotated.push_back(target);
+
+        // Removing is quick and keeps the bound exact, compressing can take
+        // a while so it goes to background.
+        Prune();
+
+        mCompressor.Schedule(target.string(), [target]
+        {
+            CompressFile(target);
+            return true;
+        });
+    }
+
+    mSize = mFile.size();
+
+    if (mRotation.Daily)
+    {
+        mNextRotation = NextMidnight(now);
+    }
+}
+
+auto RotatingLogSink::Prune () -> void
+{
+    while (mRotated.size() > mRotation.MaxFiles)
+    {
+        // File still being compressed can't be removed on Windows, it will
+        // be tried again on next rotation.
+        auto ec = std::error_code();
+        if (!fs::remove(mRotated.front(), ec) && ec)
+        {
+            break;
+        }
+
+        mRotated.pop_front();
+    }
+}
+
+auto RotatingLogSink::sink_it_ (const spdlog::details::log_msg& msg) -> void
+{
+    auto formatted = spdlog::memory_buf_t();
+    formatter_->format(msg, formatted);
+
+    const auto isTooBig = mSize > 0 && mSize + formatted.size() > mRotation.MaxFileSize;
+    if (isTooBig || msg.time >= mNextRotation)
+    {
+        Rotate(msg.time);
+    }
+
+    mFile.write(formatted);
+    mSize += formatted.size();
+}
+
+auto RotatingLogSink::flush_ () -> void
+{
+    mFile.flush();
+}
+
+} // namespace CaffeineTake
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_LOGGER)
@@ -0,0 +1,71 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Config.hpp"
+
+#if defined(FEATURE_CAFFEINETAKE_LOGGER)
+
+#include "Logger.hpp"
+#include "Persistence.hpp"
+
+#include <spdlog/details/file_helper.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+
+namespace CaffeineTake {
+
+// Appends to log file and moves it aside when it gets too big or day changes,
+// so history survives restarts and disk use stays bounded. Oldest rotated
+// files are removed right away, compression runs on a background thread and
+// writing never waits for it.
+class RotatingLogSink final : public spdlog::sinks::base_sink<std::mutex>
+{
+    using TimePoint = spdlog::log_clock::time_point;
+
+    std::filesystem::path             mPath         = std::filesystem::path();
+    LogRotation                       mRotation     = LogRotation();
+    spdlog::details::file_helper      mFile;
+    size_t                            mSize         = 0;
+    TimePoint                         mNextRotation = TimePoint::max();
+    std::deque<std::filesystem::path> mRotated      = std::deque<std::filesystem::path>();   // oldest first
+    PersistQueue                      mCompressor   = PersistQueue(std::chrono::milliseconds(0), std::chrono::milliseconds(0));
+
+    auto Open        () -> void;
+    auto Rotate      (TimePoint now) -> void;
+    auto Prune       () -> void;
+    auto RotatedPath (TimePoint now) const -> std::filesystem::path;
+
+protected:
+    auto sink_it_ (const spdlog::details::log_msg& msg) -> void override;
+    auto flush_   () -> void override;
+
+public:
+    RotatingLogSink (const std::filesystem::path& path, const LogRotation& rotation);
+};
+
+} // namespace CaffeineTake
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_LOGGER)
@@ -0,0 +1,88 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "ScanScheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+namespace CaffeineTake {
+
+auto ScanScheduler::Reset () -> void
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    mEntries.fill(Entry());
+}
+
+auto ScanScheduler::Wake (ScannerKind kind) -> void
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    auto& entry = mEntries[static_cast<size_t>(kind)];
+
+    entry.Current = Interval(0);
+    entry.NextDue = Clock::time_point();
+}
+
+auto ScanScheduler::IsDue (ScannerKind kind, Clock::time_point now) const -> bool
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    return mEntries[static_cast<size_t>(kind)].NextDue <= now;
+}
+
+auto ScanScheduler::Report (
+    ScannerKind        kind,
+    const ScanCadence& cadence,
+    bool               hit,
+    bool               cancelled,
+    Clock::time_point  now
+) -> void
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    auto& entry = mEntries[static_cast<size_t>(kind)];
+
+    // Cancelled run tells nothing, try again at current pace.
+    if (cancelled && !hit)
+    {
+        entry.NextDue = now + std::max(entry.Current, cadence.Interval);
+        return;
+    }
+
+    if (hit || entry.LastHit || entry.Current < cadence.Interval)
+    {
+        entry.Current = cadence.Interval;
+    }
+    else
+    {
+        entry.Current = std::min(entry.Current * 2, std::max(cadence.Interval, cadence.MaxInterval));
+    }
+
+    entry.LastHit = hit;
+    entry.NextDue = now + entry.Current;
+}
+
+auto ScanScheduler::GetInterval (ScannerKind kind) const -> Interval
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    return mEntries[static_cast<size_t>(kind)].Current;
+}
+
+} // namespace CaffeineTake
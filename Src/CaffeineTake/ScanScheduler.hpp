@@ -0,0 +1,86 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+namespace CaffeineTake {
+
+enum class ScannerKind : unsigned char
+{
+    Process,
+    Window,
+    Usb,
+    Bluetooth
+};
+
+constexpr auto ScannerKindCount = size_t{4};
+
+struct ScanCadence
+{
+    std::chrono::milliseconds Interval    = std::chrono::milliseconds(2000);
+    std::chrono::milliseconds MaxInterval = std::chrono::milliseconds(2000);  // backoff limit
+};
+
+// Decides which scanners are due on a tick. Each miss doubles scanner
+// interval up to its limit, a hit or first miss after a hit brings it back
+// to base interval so disappearing trigger is noticed quickly.
+class ScanScheduler final
+{
+public:
+    using Clock    = std::chrono::steady_clock;
+    using Interval = std::chrono::milliseconds;
+
+private:
+    struct Entry
+    {
+        Interval          Current = Interval(0);
+        Clock::time_point NextDue = Clock::time_point();
+        bool              LastHit = false;
+    };
+
+    mutable std::mutex                  mMutex;
+    std::array<Entry, ScannerKindCount> mEntries = {};
+
+public:
+    // Make every scanner due now and drop backoff.
+    auto Reset () -> void;
+
+    // Make scanner due on next tick, e.g. after device change.
+    auto Wake (ScannerKind kind) -> void;
+
+    auto IsDue (ScannerKind kind, Clock::time_point now) const -> bool;
+
+    auto Report (
+        ScannerKind        kind,
+        const ScanCadence& cadence,
+        bool               hit,
+        bool               cancelled,
+        Clock::time_point  now
+    ) -> void;
+
+    auto GetInterval (ScannerKind kind) const -> Interval;
+};
+
+} // namespace CaffeineTake
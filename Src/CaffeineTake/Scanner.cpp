@@ -22,44 +22,370 @@
 #include "Config.hpp"
 #include "Scanner.hpp"
 #include "Settings.hpp"
+#include "Diagnostics.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
+#include "Tracing.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <memory>
 #include <optional>
 
-#include <initguid.h>
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
-#   include <SetupAPI.h>
-#   include <usbiodef.h>
-#endif
+namespace {
+    using CaffeineTake::MetricCounter;
+    using CaffeineTake::MetricsRegistry;
 
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
-#   include <bluetoothapis.h>
-#endif
+    auto ExaminedCounter (const char* labels) -> MetricCounter&
+    {
+        return MetricsRegistry::Get().Counter(
+            "caffeinetake_scanner_examined_total",
+            "Processes, windows or devices looked at by scanners.",
+            labels
+        );
+    }
+
+    auto OsCallsCounter (const char* labels) -> MetricCounter&
+    {
+        return MetricsRegistry::Get().Counter(
+            "caffeinetake_scanner_os_calls_total",
+            "Enumeration and query calls made to system by scanners.",
+            labels
+        );
+    }
+
+    auto& ProcessesExamined  = ExaminedCounter("scanner=\"Process\"");
+    auto& ProcessOsCalls     = OsCallsCounter("scanner=\"Process\"");
+    auto& WindowsExamined    = ExaminedCounter("scanner=\"Window\"");
+    auto& WindowOsCalls      = OsCallsCounter("scanner=\"Window\"");
+    auto& UsbExamined        = ExaminedCounter("scanner=\"Usb\"");
+    auto& UsbOsCalls         = OsCallsCounter("scanner=\"Usb\"");
+    auto& BluetoothExamined  = ExaminedCounter("scanner=\"Bluetooth\"");
+    auto& BluetoothOsCalls   = OsCallsCounter("scanner=\"Bluetooth\"");
+
+    // One thread per scanner type.
+    constexpr auto ScanPoolSize = size_t{4};
+
+    auto& TickTime = MetricsRegistry::Get().Histogram(
+        "caffeinetake_scan_tick_seconds",
+        "Time from start of scan tick until first hit, all scanners finished or deadline."
+    );
+}
 
 namespace CaffeineTake {
 
-#pragma region "ProcessScanner"
+#pragma region "Scan tick"
+
+auto GetScanPool () -> WorkerPool&
+{
+    static auto pool    = WorkerPool();
+    [[maybe_unused]] static auto started = pool.Start(ScanPoolSize);
+
+    return pool;
+}
 
-auto ProcessScanner::CheckLast () -> bool
+auto GetScanCadence (const Settings& settings, ScannerKind kind) -> ScanCadence
 {
-    auto path = GetProcessPath(mLastPid);
-    if (!path.empty())
+    auto interval    = 0u;
+    auto maxInterval = 0u;
+
+    switch (kind)
     {
-        if (mLastProcessPath.empty())
+    case ScannerKind::Process:
+        interval    = settings.Auto.TriggerProcess.ScanInterval;
+        maxInterval = settings.Auto.TriggerProcess.MaxScanInterval;
+        break;
+
+    case ScannerKind::Window:
+        interval    = settings.Auto.TriggerWindow.ScanInterval;
+        maxInterval = settings.Auto.TriggerWindow.MaxScanInterval;
+        break;
+
+    case ScannerKind::Usb:
+        interval    = settings.Auto.TriggerUsb.ScanInterval;
+        maxInterval = settings.Auto.TriggerUsb.MaxScanInterval;
+        break;
+
+    // Paired device connecting raises no device change, nothing would wake
+    // the scanner from backoff, so it keeps base interval.
+    case ScannerKind::Bluetooth:
+        interval    = settings.Auto.TriggerBluetooth.ScanInterval;
+        break;
+    }
+
+    if (interval == 0)
+    {
+        interval = settings.Auto.ScanInterval;
+    }
+
+    return ScanCadence{
+        std::chrono::milliseconds(interval),
+        std::chrono::milliseconds(std::max(interval, maxInterval))
+    };
+}
+
+ScanTick::~ScanTick ()
+{
+    Cancel();
+
+    auto waitLock = std::unique_lock<std::mutex>(mMutex);
+    mIdleConditionVar.wait(
+        waitLock,
+        [&]
         {
-            return path.filename() == mLastProcessName;
+            return mInFlight == 0;
         }
-        else
+    );
+}
+
+auto ScanTick::RunSlot (ScannerSlot& slot) -> void
+{
+    const auto scanStart = Clock::now();
+    auto       result    = false;
+    {
+        TRACE_SCOPE(slot.Name, "scanner");
+        DIAG_SCOPE(Subsystem::Scanner, &slot.CpuTime);
+        result = slot.Instance.Run(slot.Settings, slot.Stop, *slot.Pause);
+    }
+    const auto cancelled = slot.Stop.Test();
+
+    slot.RunTime.Record(Clock::now() - scanStart);
+
+    // Cancelled run doesn't know the answer, keep the previous one.
+    if (result || !cancelled)
+    {
+        slot.LastResult = result;
+    }
+
+    mScheduler.Report(slot.Kind, slot.Cadence, result, cancelled, Clock::now());
+
+    LOG_DEBUG(
+        "{} scanner took {} ms, result: {}, next in {} ms",
+        slot.Name,
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - scanStart).count(),
+        result,
+        mScheduler.GetInterval(slot.Kind).count()
+    );
+
+    const auto round = slot.Round;
+    slot.Settings.reset();
+
+    // Last touch of slot, next tick may launch it again right away.
+    slot.Busy = false;
+    slot.Busy.notify_all();
+
+    Complete(round, result);
+
+    // Notify under lock, destructor may run right after we release it.
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    mInFlight -= 1;
+    mIdleConditionVar.notify_all();
+}
+
+auto ScanTick::Complete (std::uint64_t round, bool result) -> void
+{
+    auto finished = false;
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+        // Late from earlier round, its result is already in LastResult.
+        if (round != mRound || !mIsOpen)
         {
-            return path == mLastProcessPath;
+            return;
+        }
+
+        mPending -= 1;
+
+        if (result || mPending == 0)
+        {
+            result   = CloseLocked(result);
+            finished = true;
         }
     }
 
-    return false;
+    if (finished)
+    {
+        Report(round, result);
+    }
 }
 
+auto ScanTick::Report (std::uint64_t round, bool result) -> void
+{
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mDoneMutex);
+
+        // Newer round finished first, or round was cancelled.
+        if (round <= mReported)
+        {
+            return;
+        }
+
+        mReported = round;
+    }
+
+    // Called without lock, callback may wait on the thread that is just
+    // cancelling us (AutoMode sends to main thread, main thread stops mode).
+    if (mDone)
+    {
+        mDone(result);
+    }
+}
+
+auto ScanTick::CloseLocked (bool hit) -> bool
+{
+    mIsOpen = false;
+    CancelLocked();
+
+    TickTime.Record(Clock::now() - mStart);
+
+    // Scanners that were skipped or didn't finish in time contribute their
+    // last result.
+    auto result = hit;
+    auto late   = size_t{0};
+    for (auto i = size_t{0}; i < mSlotCount; ++i)
+    {
+        if (mSlots[i]->Busy)
+        {
+            late += 1;
+        }
+
+        result = result || mSlots[i]->LastResult;
+    }
+
+    LOG_DEBUG(
+        "Scan tick took {} ms, result: {}, scanners: {}, launched: {}, late: {}",
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - mStart).count(),
+        result,
+        mSlotCount,
+        mLaunchedCount,
+        late
+    );
+
+    return result;
+}
+
+auto ScanTick::CancelLocked () -> void
+{
+    for (auto i = size_t{0}; i < mLaunchedCount; ++i)
+    {
+        mLaunched[i]->Stop.Stop();
+    }
+}
+
+auto ScanTick::Begin (std::span<ScannerSlot* const> slots, SettingsPtr settings, const PauseToken& pause) -> void
+{
+    TRACE_SCOPE("ScanTick", "scanner");
+
+    // Previous round ran out of time.
+    Expire();
+
+    const auto now = Clock::now();
+
+    auto round = std::uint64_t{0};
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+        mRound        += 1;
+        mSlotCount     = std::min(slots.size(), mSlots.size());
+        mLaunchedCount = 0;
+        mPending       = 1;     // held by us until every scanner is launched
+        mIsOpen        = true;
+        mStart         = now;
+        round          = mRound;
+
+        std::copy_n(slots.begin(), mSlotCount, mSlots.begin());
+    }
+
+    for (auto i = size_t{0}; i < mSlotCount; ++i)
+    {
+        auto slot = mSlots[i];
+
+        // Not due yet or still running from previous round.
+        if (!mScheduler.IsDue(slot->Kind, now) || slot->Busy.exchange(true))
+        {
+            continue;
+        }
+
+        slot->Stop.Reset();
+        slot->Settings = settings;
+        slot->Cadence  = GetScanCadence(*settings, slot->Kind);
+        slot->Pause    = &pause;
+        slot->Round    = round;
+
+        if (!slot->Task)
+        {
+            slot->Task = [this, slot]
+            {
+                RunSlot(*slot);
+            };
+        }
+
+        // Scanner launched earlier may have hit already, rest is not needed.
+        auto isOpen = false;
+        {
+            auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+            isOpen = mIsOpen && mRound == round;
+            if (isOpen)
+            {
+                mLaunched[mLaunchedCount++] = slot;
+                mPending  += 1;
+                mInFlight += 1;
+            }
+        }
+
+        if (!isOpen)
+        {
+            slot->Settings.reset();
+            slot->Busy = false;
+            slot->Busy.notify_all();
+            break;
+        }
+
+        if (!GetScanPool().Submit(slot->Task))
+        {
+            RunSlot(*slot);
+        }
+    }
+
+    // Every scanner may have returned while we were launching the rest.
+    Complete(round, false);
+}
+
+auto ScanTick::Expire () -> void
+{
+    auto round  = std::uint64_t{0};
+    auto result = false;
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+        if (!mIsOpen)
+        {
+            return;
+        }
+
+        result = CloseLocked(false);
+        round  = mRound;
+    }
+
+    Report(round, result);
+}
+
+auto ScanTick::Cancel () -> void
+{
+    auto round = std::uint64_t{0};
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+        mIsOpen = false;
+        CancelLocked();
+        round = mRound;
+    }
+
+    auto lockGuard = std::lock_guard<std::mutex>(mDoneMutex);
+    mReported = std::max(mReported, round);
+}
+
+#pragma endregion
+
+#pragma region "ProcessScanner"
+
 auto ProcessScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
 {
 #if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS)
@@ -70,57 +396,79 @@ auto ProcessScanner::Run (SettingsPtr settings, const StopToken& stop, const Pau
         return false;
     }
 
-    // Only check last.
-    if (mLastPid != 0)
+    // Snapshots are immutable, so trigger list can only change with new
+    // one. Matcher compares lists only then, not on every tick.
+    auto rebuilt = false;
+    if (settings != mSettings)
     {
-        if (CheckLast())
+        mSettings = settings;
+        rebuilt   = mMatcher.Update(settings->Auto.TriggerProcess.Processes);
+        if (rebuilt)
         {
-            return true;
+            LOG_DEBUG("Rebuilt process trigger matcher ({} triggers)", settings->Auto.TriggerProcess.Processes.size());
         }
+    }
+
+    // Only new processes are queried, verdicts of the rest are reused
+    // unless trigger list changed.
+    if (!mSnapshot.Update())
+    {
+        return false;
+    }
 
-        const auto& last = mLastProcessPath.empty() ? mLastProcessName : mLastProcessPath;
-        LOG_INFO(L"Process: {} (PID: {}), no longer exists, scanning all processes", last, mLastPid);
+    // Result of cancelled tick is dropped anyway. Classify() checks stop
+    // before it starts and between processes, whatever it skips is done by
+    // next tick.
+    if (!mSnapshot.Classify(mMatcher, rebuilt, stop))
+    {
+        return false;
     }
 
-    mLastProcessName.clear();
-    mLastProcessPath.clear();
-    mLastPid = 0;
+    const auto& stats = mSnapshot.GetStats();
+    ProcessesExamined.Add(stats.Processes);
+    ProcessOsCalls.Add(stats.OsCalls);
 
-    return ScanProcesses(
-        [&](HANDLE handle, DWORD pid, fs::path path)
+    LOG_TRACE(
+        "Process snapshot: {} processes, {} added, {} removed, {} OS calls",
+        stats.Processes, stats.Added, stats.Removed, stats.OsCalls
+    );
+
+    const auto& matches = mSnapshot.GetMatches();
+
+    // Check last found process first.
+    if (mLastPid != 0)
+    {
+        if (matches.contains(mLastPid))
         {
-            for (const auto& proc : settings->Auto.TriggerProcess.Processes)
-            {
-                // Check path.
-                if (proc == path)
-                {
-                    mLastProcessPath = path;
-                    mLastPid         = pid;
+            return true;
+        }
 
-                    LOG_INFO(L"Found process: {} (PID: {})", mLastProcessPath, pid);
-                    return ScanResult::Success;
-                }
+        LOG_INFO(L"Process: {} (PID: {}), no longer exists", mLastProcess, mLastPid);
 
-                // Check filename.
-                const auto name = path.filename();
-                if (proc == name)
-                {
-                    mLastProcessName = name;
-                    mLastPid         = pid;
+        mLastProcess.clear();
+        mLastPid = 0;
+    }
 
-                    LOG_INFO(L"Found process: {} (PID: {})", mLastProcessName, pid);
-                    return ScanResult::Success;
-                }
-            }
+    if (matches.empty())
+    {
+        return false;
+    }
 
-            if (stop)
-            {
-                return ScanResult::Stop;
-            }
+    const auto pid   = *matches.begin();
+    const auto entry = mSnapshot.Find(pid);
+    if (!entry)
+    {
+        return false;
+    }
 
-            return ScanResult::Continue;
-        }
-    );
+    mLastPid     = pid;
+    mLastProcess = entry->Verdict == TriggerMatch::Name
+        ? std::wstring(TriggerMatcher::FileName(entry->ImagePath))
+        : entry->ImagePath;
+
+    LOG_INFO(L"Found process: {} (PID: {})", mLastProcess, pid);
+
+    return true;
 #endif
 }
 
@@ -138,17 +486,37 @@ auto WindowScanner::Run (SettingsPtr settings, const StopToken& stop, const Paus
         return false;
     }
 
-    return ScanWindows(
-        [&](HWND hWnd, DWORD pid, std::wstring_view window)
+    if (settings != mSettings)
+    {
+        mSettings = settings;
+        if (mMatcher.Update(settings->Auto.TriggerWindow.Windows))
         {
-            // Check if process is on window title list.
-            for (const auto& windowTitle : settings->Auto.TriggerWindow.Windows)
+            LOG_DEBUG("Rebuilt window trigger matcher ({} triggers)", settings->Auto.TriggerWindow.Windows.size());
+        }
+    }
+
+    if (mMatcher.IsEmpty())
+    {
+        return false;
+    }
+
+    if (!mSource)
+    {
+        return false;
+    }
+
+    const auto osCalls  = mSource->GetOsCallCount();
+    auto       examined = size_t{0};
+    auto       result   = mSource->Enumerate(
+        [&](ProcessId pid, std::wstring_view window)
+        {
+            examined += 1;
+
+            // Check if window title matches any trigger.
+            if (const auto trigger = mMatcher.Match(window))
             {
-                if (windowTitle == window)
-                {
-                    LOG_INFO(L"Found window: {} (PID: {})", windowTitle, pid);
-                    return ScanResult::Success;
-                }
+                LOG_INFO(L"Found window: {} (trigger: {}, PID: {})", window, *trigger, pid);
+                return ScanResult::Success;
             }
 
             if (stop)
@@ -159,6 +527,11 @@ auto WindowScanner::Run (SettingsPtr settings, const StopToken& stop, const Paus
             return ScanResult::Continue;
         }
     );
+
+    WindowsExamined.Add(examined);
+    WindowOsCalls.Add(mSource->GetOsCallCount() - osCalls);
+
+    return result;
 #endif
 }
 
@@ -176,114 +549,55 @@ auto UsbDeviceScanner::Run (SettingsPtr settings, const StopToken& stop, const P
         return false;
     }
 
-    // Get list of USB devices that are present in the system.
-    auto deviceInfoSet = SetupDiGetClassDevsW(&GUID_DEVINTERFACE_USB_DEVICE, NULL, NULL, DIGCF_DEVICEINTERFACE | DIGCF_PRESENT);
-    if (deviceInfoSet == INVALID_HANDLE_VALUE)
+    if (!mSource)
     {
         return false;
     }
-    
-    auto deviceIndex = DWORD{0};
-    auto deviceInfoData = SP_DEVINFO_DATA{};
-    ZeroMemory(&deviceInfoData, sizeof(SP_DEVINFO_DATA));
-    deviceInfoData.cbSize = sizeof(SP_DEVINFO_DATA);
-
-    auto found = false;
-    auto buffer = std::vector<wchar_t>();
-    buffer.resize(1024);
-
-    auto stopped = false;
-    auto error = DWORD{0};
-    while (error != ERROR_NO_MORE_ITEMS)
-    {
-        auto success = SetupDiEnumDeviceInfo(deviceInfoSet, deviceIndex, &deviceInfoData);
-        if (!success)
-        {
-            error = GetLastError();
 
-            if (error != ERROR_NO_MORE_ITEMS)
-            {
-                LOG_ERROR("SetupDiEnumDeviceInfo() failed with error: {}", error);
-                break;
-            }
-        }
-        else
+    const auto osCalls  = mSource->GetOsCallCount();
+    auto       examined = size_t{0};
+    auto       stopped  = false;
+    auto       found    = mSource->Enumerate(
+        [&](std::wstring_view instanceId)
         {
-            // Get required buffer size.
-            auto requiredSize = DWORD{0};
-            success = SetupDiGetDeviceInstanceIdW(deviceInfoSet, &deviceInfoData, NULL, 0, &requiredSize);
-            if (!success)
-            {
-                error = GetLastError();
-
-                if (error != ERROR_INSUFFICIENT_BUFFER)
-                {
-                    LOG_ERROR("SetupDiGetDeviceInstanceIdW() failed with error: {}", error);
-                    break;
-                }
-            }
-
-            // Resize buffer if needed.
-            if (requiredSize > buffer.capacity())
-            {
-                buffer.resize(requiredSize);
-            }
-
-            // Get device id.
-            success = SetupDiGetDeviceInstanceIdW(deviceInfoSet, &deviceInfoData, buffer.data(), buffer.capacity(), &requiredSize);
-            if (!success)
-            {
-                error = GetLastError();
-
-                LOG_ERROR("SetupDiGetDeviceInstanceIdW() failed with error: {}", error);
-                break;
-            }
+            examined += 1;
 
             // Check if device is in the trigger list.
             for (const auto& id : settings->Auto.TriggerUsb.UsbDevices)
             {
-                if (id == std::wstring_view(buffer.data()))
+                if (id == instanceId)
                 {
-                    found = true;
-                    break;
+                    if (mLastFoundDevice != instanceId)
+                    {
+                        mLastFoundDevice = instanceId;
+                        LOG_INFO_LIMITED(10, L"Found present USB device: '{}'", mLastFoundDevice);
+                    }
+
+                    return ScanResult::Success;
                 }
             }
 
             if (stop)
             {
                 stopped = true;
-                break;
+                return ScanResult::Stop;
             }
+
+            return ScanResult::Continue;
         }
+    );
 
-        deviceIndex++;
-    }
+    UsbExamined.Add(examined);
+    UsbOsCalls.Add(mSource->GetOsCallCount() - osCalls);
 
-    // Cleanup.
-    if (deviceInfoSet)
+    if (!found && !stopped)
     {
-        SetupDiDestroyDeviceInfoList(deviceInfoSet);
-    }
-
-    if (!stopped)
-    {
-        if (found)
+        if (!mLastFoundDevice.empty())
         {
-            if (mLastFoundDevice != std::wstring_view(buffer.data()))
-            {
-                mLastFoundDevice = buffer.data();
-                LOG_INFO(L"Found present USB device: '{}'", mLastFoundDevice);
-            }
+            LOG_INFO_LIMITED(10, L"USB Device '{}' is no longer present in system", mLastFoundDevice);
         }
-        else
-        {
-            if (!mLastFoundDevice.empty())
-            {
-                LOG_INFO(L"USB Device '{}' is no longer present in system", mLastFoundDevice);
-            }
 
-            mLastFoundDevice = L"";
-        }
+        mLastFoundDevice = L"";
     }
 
     return found;
@@ -294,32 +608,16 @@ auto UsbDeviceScanner::Run (SettingsPtr settings, const StopToken& stop, const P
 
 #pragma region "BluetoothScanner"
 
-auto BluetoothScanner::SystemTimeToChronoLocalTimePoint (const SYSTEMTIME& st)
-{
-    auto ft     = FILETIME{};
-    auto ft_utc = FILETIME{};
-
-    if (SystemTimeToFileTime(&st, &ft))
-    {
-        if (LocalFileTimeToFileTime(&ft, &ft_utc))
-        {
-            const auto tz = std::chrono::current_zone();
-            const auto stp = FILETIME_to_system_clock(ft_utc);
-
-            return tz->to_local(stp);
-        }
-    }
-
-    return std::chrono::local_time<std::chrono::system_clock::duration>();
-}
-
-auto BluetoothScanner::ShouldPerformDeviceInquiry (const LocalTime& localTime, const std::chrono::seconds deviceActiveTimeout) -> bool
+auto BluetoothScanner::ShouldPerformDeviceInquiry (
+    const SteadyTime&          steadyTime,
+    const LocalTime&           localTime,
+    const std::chrono::seconds deviceActiveTimeout
+) -> bool
 {
     auto issueInquiry = true;
 
     // If last inquiry was perfomed in less than mInquiryTimeout, skip.
-    const auto diff = localTime - mLastInquiryTime;
-    if (diff.count() > 0 && diff < mInquiryTimeout)
+    if (mLastInquiryTime != SteadyTime() && steadyTime - mLastInquiryTime < mInquiryTimeout)
     {
         issueInquiry = false;                
     }
@@ -347,78 +645,6 @@ auto BluetoothScanner::ShouldPerformDeviceInquiry (const LocalTime& localTime, c
     return issueInquiry;
 }
 
-auto BluetoothScanner::IssueDeviceInquiry () -> bool
-{
-#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
-    return false;
-#else
-    LOG_TRACE("Starting bluetooth device inquiry");
-
-    auto result = true;
-
-    auto deviceInfo = BLUETOOTH_DEVICE_INFO{};
-    ZeroMemory(&deviceInfo, sizeof(deviceInfo));
-    deviceInfo.dwSize = sizeof(deviceInfo);
-
-    auto searchParams = BLUETOOTH_DEVICE_SEARCH_PARAMS{
-        .dwSize               = sizeof(BLUETOOTH_DEVICE_SEARCH_PARAMS),
-        .fReturnAuthenticated = TRUE,
-        .fReturnRemembered    = TRUE,
-        .fReturnUnknown       = TRUE,
-        .fReturnConnected     = TRUE,
-        .fIssueInquiry        = TRUE,
-        .cTimeoutMultiplier   = 1,    // n*1.28s
-        .hRadio               = NULL  // use all radios, for inquiry
-    };
-
-    auto deviceFind = BluetoothFindFirstDevice(&searchParams, &deviceInfo);
-    if (deviceFind == NULL)
-    {
-        auto error = GetLastError();
-        if (error != ERROR_NO_MORE_ITEMS)
-        {
-            LOG_ERROR("IssueDeviceInquiry() failed with error {}", GetLastError());
-            result = false;
-        }
-        else
-        {
-            LOG_DEBUG("IssueDeviceInquiry() no more items");
-        }
-    }
-    else
-    {
-        BluetoothFindDeviceClose(deviceFind);
-    }
-
-    LOG_TRACE("Finished bluetooth device inqury");
-
-    return result;
-#endif
-}
-
-auto BluetoothScanner::CheckIfThereIsBluetoothRadio () -> bool
-{
-#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
-    return false;
-#else
-    auto params = BLUETOOTH_FIND_RADIO_PARAMS{
-        .dwSize = sizeof(BLUETOOTH_FIND_RADIO_PARAMS)
-    };
-
-    auto found = false;
-
-    auto radio = INVALID_HANDLE_VALUE;
-    auto hRadioFind = BluetoothFindFirstRadio(&params, &radio);
-    if (hRadioFind)
-    {
-        BluetoothFindRadioClose(hRadioFind);
-        found = true;
-    }
-
-    return found;
-#endif
-}
-
 auto BluetoothScanner::EnumerateBluetoothDevices (
     SettingsPtr                settings,
     const LocalTime&           localTime,
@@ -429,83 +655,54 @@ auto BluetoothScanner::EnumerateBluetoothDevices (
 #if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
     return BluetoothIdentifier();
 #else
-    auto deviceInfo = BLUETOOTH_DEVICE_INFO{};
-    ZeroMemory(&deviceInfo, sizeof(deviceInfo));
-    deviceInfo.dwSize = sizeof(deviceInfo);
-
-    auto searchParams = BLUETOOTH_DEVICE_SEARCH_PARAMS{
-        .dwSize               = sizeof(BLUETOOTH_DEVICE_SEARCH_PARAMS),
-        .fReturnAuthenticated = TRUE,
-        .fReturnRemembered    = TRUE,
-        .fReturnUnknown       = TRUE,
-        .fReturnConnected     = TRUE,
-        .fIssueInquiry        = FALSE,
-        .cTimeoutMultiplier   = 0,
-        .hRadio               = NULL  // use all radios, for inquiry
-    };
-
-    auto found = BluetoothIdentifier();
-    auto deviceFind = BluetoothFindFirstDevice(&searchParams, &deviceInfo);
-    if (deviceFind == NULL)
-    {
-        auto error = GetLastError();
-        if (error != ERROR_NO_MORE_ITEMS)
-        {
-            LOG_ERROR("BluetoothFindFirstDevice() failed with error {}", GetLastError());
-        }
-        else
-        {
-            LOG_DEBUG("BluetoothFindFirstDevice() no more items");
-        }
-    }
-    else
-    {
-        do
+    auto found    = BluetoothIdentifier();
+    auto examined = size_t{0};
+    mSource->Enumerate(
+        [&](const BluetoothDeviceRecord& device)
         {
+            examined += 1;
+
             // Check if device is in the trigger list.
             for (const auto& id : settings->Auto.TriggerBluetooth.BluetoothDevices)
             {
-                if (id == deviceInfo.Address.ullLong)
+                if (id == device.Address)
                 {
                     // If device was seen in last mTimeoutDuration we consider it connected.
                     // If device wasn't seen in last mTimeoutDuration we will issue inquiry in next run*.
                     // * unless there is other device connected or seen in last mTimeoutDuration
-                        
-                    // Update last seen. deviceInfo.stLastSeen is expected to be in local time.
-                    const auto lastSeen = SystemTimeToChronoLocalTimePoint(deviceInfo.stLastSeen);
-                    mLastSeenMap[id.ull] = lastSeen;
 
-                    const auto uniqid = id.ToWString();
+                    // Update last seen.
+                    mLastSeenMap[id.ull] = device.LastSeen;
 
-                    if (deviceInfo.fConnected)
+                    if (device.Connected)
                     {
                         found = id;
 
                         if (mLastFoundDevice != id)
                         {
-                            const auto name = std::wstring(deviceInfo.szName);
-                            LOG_INFO(L"Found connected Bluetooth device '{}' ({})", uniqid, name);
+                            LOG_INFO_LIMITED(10, L"Found connected Bluetooth device '{}' ({})", id, device.Name);
                             mLastFoundDevice = id;
                         }
-                            
+
                         // Stop iterating.
-                        break;
+                        return ScanResult::Success;
                     }
                     else
                     {
-                        const auto diff = std::chrono::duration_cast<std::chrono::seconds>(localTime - lastSeen);
+                        const auto diff = std::chrono::duration_cast<std::chrono::seconds>(localTime - device.LastSeen);
                         if (diff < deviceActiveTimeout)
                         {
                             if (found.IsInvalid())
                             {
                                 found = id;
 
-                                const auto name = std::wstring(deviceInfo.szName);
-                                const auto diffStr = std::format(L"{}", diff);
-
                                 if (found != mLastFoundDevice)
                                 {
-                                    LOG_INFO(L"Bluetooth device '{}' ({}) was last seen in {}", uniqid, name, diffStr);
+                                    LOG_INFO_LIMITED(
+                                        10,
+                                        L"Bluetooth device '{}' ({}) was last seen in {}s",
+                                        id, device.Name, diff.count()
+                                    );
                                 }
                             }
                         }
@@ -517,12 +714,14 @@ auto BluetoothScanner::EnumerateBluetoothDevices (
 
             if (stop)
             {
-                break;
+                return ScanResult::Stop;
             }
-        } while (BluetoothFindNextDevice(deviceFind, &deviceInfo));
-        
-        BluetoothFindDeviceClose(deviceFind);
-    }
+
+            return ScanResult::Continue;
+        }
+    );
+
+    BluetoothExamined.Add(examined);
 
     return found;
 #endif
@@ -538,43 +737,48 @@ auto BluetoothScanner::Run (SettingsPtr settings, const StopToken& stop, const P
         return false;
     }
 
-    // Check if there is bluetooth adapter.
-    if (!CheckIfThereIsBluetoothRadio())
+    if (!mSource)
     {
-        LOG_DEBUG("No Bluetooth adapter found");
         return false;
     }
 
-    // For some reason system keeps loading/unloading this library.
-    // Load manually to keep at least one reference.
-    if (!mLibBluetoothApis)
+    const auto osCalls = mSource->GetOsCallCount();
+
+    // Check if there is bluetooth adapter.
+    if (!mSource->HasRadio())
     {
-        mLibBluetoothApis = LoadLibraryW(L"bluetoothapis.dll");
+        BluetoothOsCalls.Add(mSource->GetOsCallCount() - osCalls);
+        LOG_DEBUG_LIMITED(5, "No Bluetooth adapter found");
+        return false;
     }
 
     const auto deviceActiveTimeout = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::milliseconds(settings->Auto.TriggerBluetooth.ActiveTimeout)
     );
 
-    const auto tz = std::chrono::current_zone();
-    const auto localTime = tz->to_local(std::chrono::system_clock::now());
+    // Last seen times come from system in local time, compare them with local
+    // wall clock. Inquiry interval is ours, measure it with steady clock.
+    const auto localTime  = LocalClock::Get().LocalNow();
+    const auto steadyTime = LocalClock::SteadyNow();
 
     // If we see didn't see at least one device in last mTimeoutDuration, issue inquiry.
-    if (ShouldPerformDeviceInquiry(localTime, deviceActiveTimeout))
+    if (ShouldPerformDeviceInquiry(steadyTime, localTime, deviceActiveTimeout))
     {
-        if (IssueDeviceInquiry())
+        LOG_TRACE("Starting bluetooth device inquiry");
+        if (mSource->Inquiry())
         {
             LOG_INFO("Finished Bluetooth device inquiry");
-            mLastInquiryTime = localTime;
+            mLastInquiryTime = steadyTime;
         }
     }
 
     // Enumerate bluetooth devices.
     auto found = EnumerateBluetoothDevices(settings, localTime, deviceActiveTimeout, stop);
+    BluetoothOsCalls.Add(mSource->GetOsCallCount() - osCalls);
 
     if (found.IsInvalid() && mLastFoundDevice.IsValid())
     {
-        LOG_INFO(L"Bluetooth device '{}' is no longer connected", mLastFoundDevice.ToWString());
+        LOG_INFO_LIMITED(10, L"Bluetooth device '{}' is no longer connected", mLastFoundDevice);
     }
 
     if (found != mLastFoundDevice)
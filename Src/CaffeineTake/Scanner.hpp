@@ -21,18 +21,33 @@
 #pragma once
 
 #include "BluetoothIdentifier.hpp"
+#include "DeviceSource.hpp"
 #include "ForwardDeclaration.hpp"
+#include "LocalClock.hpp"
+#include "Metrics.hpp"
+#include "ProcessSnapshot.hpp"
+#include "ScanScheduler.hpp"
 #include "ThreadTimer.hpp"
+#include "TitleMatcher.hpp"
+#include "TriggerMatcher.hpp"
 #include "Utility.hpp"
+#include "WindowSource.hpp"
+#include "WorkerPool.hpp"
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
 #include <string_view>
-
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <Windows.h>
+#include <utility>
 
 namespace {
     namespace fs = std::filesystem;
@@ -48,48 +63,189 @@ public:
     virtual auto Run (SettingsPtr, const StopToken&, const PauseToken&) -> bool = 0;
 };
 
-class ProcessScanner : public Scanner
+// State of one scanner across ticks. Busy is set while a run is in flight,
+// a scanner that is still busy when next tick starts is not run again and
+// its last result is used instead. Fields below Busy belong to the run in
+// flight and are written only while it is clear.
+struct ScannerSlot
+{
+    const char*        Name       = "";
+    ScannerKind        Kind       = ScannerKind::Process;
+    Scanner&           Instance;
+    std::atomic<bool>  Busy       = false;
+    std::atomic<bool>  LastResult = false;
+    LatencyHistogram&  RunTime;
+    LatencyHistogram&  CpuTime;
+
+    StopToken          Stop       = StopToken();
+    SettingsPtr        Settings   = nullptr;
+    ScanCadence        Cadence    = ScanCadence();
+    const PauseToken*  Pause      = nullptr;
+    std::uint64_t      Round      = 0;          // tick the run belongs to
+    WorkerPool::Task   Task       = nullptr;    // built on first run, submitted as is after
+
+    ScannerSlot (const char* name, ScannerKind kind, Scanner& scanner)
+        : Name     (name)
+        , Kind     (kind)
+        , Instance (scanner)
+        , RunTime  (MetricsRegistry::Get().Histogram(
+            "caffeinetake_scanner_run_seconds",
+            "Time of single scanner run.",
+            std::string("scanner=\"") + name + "\""
+          ))
+        , CpuTime  (MetricsRegistry::Get().Histogram(
+            "caffeinetake_scanner_cpu_seconds",
+            "CPU time of single scanner run.",
+            std::string("scanner=\"") + name + "\""
+          ))
+    {
+    }
+
+    // Block until run in flight returns, e.g. before mode stops.
+    auto WaitIdle () const -> void
+    {
+        Busy.wait(true);
+    }
+};
+
+// Threads scanners run on. Started on first use and kept until exit, so
+// switching modes does not create and join threads.
+auto GetScanPool () -> WorkerPool&;
+
+// Scanner interval from settings, zero falls back to auto mode interval.
+auto GetScanCadence (const Settings& settings, ScannerKind kind) -> ScanCadence;
+
+// Rounds of scanners running in parallel on scan pool. Begin() only launches
+// them, the round is finished by first hit, by last scanner returning or by
+// next Begin() (deadline), whichever comes first, and its result goes to done
+// callback on the thread that finished it. Nothing waits on a timer worker.
+// Kept for the life of its slots and reused every tick, runs carry round
+// number so scanners that outlive their round report into nothing. Steady
+// state round does not allocate.
+class ScanTick final
 {
-    std::wstring mLastProcessName = L"";
-    std::wstring mLastProcessPath = L"";
-    DWORD        mLastPid         = 0;
+public:
+    using Clock  = ScanScheduler::Clock;
+    using DoneFn = std::function<void (bool result)>;
+
+private:
+    using SlotArray = std::array<ScannerSlot*, ScannerKindCount>;
+
+    ScanScheduler&           mScheduler;
+    DoneFn                   mDone;
+    std::mutex               mMutex;
+    std::condition_variable  mIdleConditionVar;
+    SlotArray                mSlots         = {};   // taking part in current round
+    size_t                   mSlotCount     = 0;
+    SlotArray                mLaunched      = {};   // run in current round
+    size_t                   mLaunchedCount = 0;
+    size_t                   mInFlight      = 0;    // tasks pointing at us, any round
+    Clock::time_point        mStart         = Clock::time_point();
+    std::uint64_t            mRound         = 0;
+    size_t                   mPending       = 0;
+    bool                     mIsOpen        = false;
+    std::mutex               mDoneMutex;            // guards mReported
+    std::uint64_t            mReported      = 0;    // last round passed to done callback
 
-    auto CheckLast () -> bool;
+    auto RunSlot  (ScannerSlot& slot) -> void;
+    auto Complete (std::uint64_t round, bool result) -> void;
+    auto Report   (std::uint64_t round, bool result) -> void;
+
+    // Expects mMutex to be held. Returns result of the round.
+    auto CloseLocked  (bool hit) -> bool;
+    auto CancelLocked () -> void;
+
+    ScanTick            (const ScanTick& rhs) = delete;
+    ScanTick& operator= (const ScanTick& rhs) = delete;
 
 public:
+    ScanTick (ScanScheduler& scheduler, DoneFn done)
+        : mScheduler (scheduler)
+        , mDone      (std::move(done))
+    {
+    }
+
+    // Cancels runs in flight and waits for them, tasks point at us.
+    ~ScanTick ();
+
+    // Finish previous round if still open and launch scanners from slots
+    // that are due. Slots skipped or late contribute their last result.
+    auto Begin (std::span<ScannerSlot* const> slots, SettingsPtr settings, const PauseToken& pause) -> void;
+
+    // Finish current round now, scanners still running are cancelled.
+    auto Expire () -> void;
+
+    // Drop current round without reporting it, e.g. when mode stops. No
+    // callback starts after, one already running is not waited for, it may
+    // be waiting on the caller. Destructor waits for it.
+    auto Cancel () -> void;
+};
+
+// Scanners take their sources from factories by default, so an installed
+// synthetic workload or a test source can stand in for the system.
+class ProcessScanner : public Scanner
+{
+    TriggerMatcher  mMatcher     = TriggerMatcher();
+    SettingsPtr     mSettings    = nullptr;     // snapshot mMatcher was updated from
+    ProcessSnapshot mSnapshot;
+    std::wstring    mLastProcess = L"";
+    ProcessId       mLastPid     = 0;
+
+public:
+    explicit ProcessScanner (ProcessSourcePtr source = CreateProcessSource())
+        : mSnapshot (std::move(source))
+    {
+    }
+
     auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
 };
 
 class WindowScanner : public Scanner
 {
+    TitleMatcher    mMatcher  = TitleMatcher();
+    SettingsPtr     mSettings = nullptr;        // snapshot mMatcher was updated from
+    WindowSourcePtr mSource;
+
 public:
+    explicit WindowScanner (WindowSourcePtr source = CreateWindowSource())
+        : mSource (std::move(source))
+    {
+    }
+
     auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
 };
 
 class UsbDeviceScanner : public Scanner
 {
-    std::wstring mLastFoundDevice = L"";
+    UsbDeviceSourcePtr mSource;
+    std::wstring       mLastFoundDevice = L"";
 
 public:
+    explicit UsbDeviceScanner (UsbDeviceSourcePtr source = CreateUsbDeviceSource())
+        : mSource (std::move(source))
+    {
+    }
+
     auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
 };
 
 class BluetoothScanner : public Scanner
 {
-    using LocalTime   = std::chrono::local_time<std::chrono::system_clock::duration>;
+    using LocalTime   = LocalClock::LocalTimePoint;
+    using SteadyTime  = LocalClock::SteadyTimePoint;
     using LastSeenMap = std::map<unsigned long long, LocalTime>;
 
+    BluetoothSourcePtr   mSource;
     BluetoothIdentifier  mLastFoundDevice  = BluetoothIdentifier();
-    HMODULE              mLibBluetoothApis = NULL;
     LastSeenMap          mLastSeenMap      = LastSeenMap();
-    LocalTime            mLastInquiryTime  = LocalTime();
+    SteadyTime           mLastInquiryTime  = SteadyTime();
     std::chrono::seconds mInquiryTimeout   = std::chrono::seconds(60);
 
-    auto SystemTimeToChronoLocalTimePoint (const SYSTEMTIME& st);
-
-    auto ShouldPerformDeviceInquiry   (const LocalTime& localTime, const std::chrono::seconds deviceActiveTimeout) -> bool;
-    auto IssueDeviceInquiry           () -> bool;
-    auto CheckIfThereIsBluetoothRadio () -> bool;
+    auto ShouldPerformDeviceInquiry (
+        const SteadyTime&          steadyTime,
+        const LocalTime&           localTime,
+        const std::chrono::seconds deviceActiveTimeout
+    ) -> bool;
 
     auto EnumerateBluetoothDevices (
         SettingsPtr                settings,
@@ -99,12 +255,9 @@ class BluetoothScanner : public Scanner
     ) -> BluetoothIdentifier;
 
 public:
-    ~BluetoothScanner ()
+    explicit BluetoothScanner (BluetoothSourcePtr source = CreateBluetoothSource())
+        : mSource (std::move(source))
     {
-        if (mLibBluetoothApis)
-        {
-            FreeLibrary(mLibBluetoothApis);
-        }
     }
 
     auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
@@ -22,11 +22,14 @@
 #include "Config.hpp"
 #include "Schedule.hpp"
 
-#include "Logger.hpp"
+#include "LocalClock.hpp"
 #include "Utility.hpp"
 
+#include <algorithm>
 #include <chrono>
-#include <format>
+#include <cstdint>
+#include <iterator>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -35,6 +38,32 @@
 
 namespace CaffeineTake {
 
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+
+namespace {
+
+auto ToLocalSeconds (LocalClock& clock, const SystemTimePoint time) -> std::chrono::local_seconds
+{
+    return std::chrono::floor<std::chrono::seconds>(clock.ToLocal(time));
+}
+
+// Monday is 0, Sunday is 6. Same as bit index in DaysOfWeek.
+auto DayIndex (const std::chrono::local_days day) -> unsigned int
+{
+    return std::chrono::weekday(day).iso_encoding() - 1;
+}
+
+auto IsDayActive (const DaysOfWeek days, const unsigned int dayIndex) -> bool
+{
+    return (static_cast<unsigned int>(days) & (1u << dayIndex)) != 0;
+}
+
+} // namespace
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+
+#pragma region "Schedule"
+
 auto Schedule::CheckSchedule (
     const std::vector<ScheduleEntry>&                  schedule,
     std::chrono::time_point<std::chrono::system_clock> time
@@ -42,67 +71,298 @@ auto Schedule::CheckSchedule (
 #if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
     return false;
 #else
-    static auto s_IsInSchedule = false;
-        
-    const auto tz = std::chrono::current_zone();
-    const auto localTime = tz->to_local(time);
-
-    const auto hh  = std::stoul(std::format("{:%H}", localTime));
-    const auto mm  = std::stoul(std::format("{:%M}", localTime));
-    const auto ss  = std::stoul(std::format("{:%S}", localTime));
-    const auto day = std::stoul(std::format("{:%u}", localTime));
-
-    // Convert day to DaysOfWeek.
-    const auto timeDayOfWeek = [&](){
-        switch (day)
-        {
-        case 0: return DaysOfWeek::Sunday;
-        case 1: return DaysOfWeek::Monday;
-        case 2: return DaysOfWeek::Tuesday;
-        case 3: return DaysOfWeek::Wednesday;
-        case 4: return DaysOfWeek::Thursday;
-        case 5: return DaysOfWeek::Friday;
-        case 6: return DaysOfWeek::Saturday;
-        case 7: return DaysOfWeek::Sunday;
-        }
-            
-        return DaysOfWeek::Monday;
-    }();
-
-    const auto timeSeconds = (hh * 3600) + (mm * 60) + ss;
+    const auto localTime   = ToLocalSeconds(LocalClock::Get(), time);
+    const auto localDay    = std::chrono::floor<std::chrono::days>(localTime);
+    const auto timeSeconds = static_cast<unsigned int>((localTime - localDay).count());
+    const auto dayIndex    = DayIndex(localDay);
 
     for (const auto& entry : schedule)
     {
         // Check if day match.
-        if ((entry.ActiveDays & timeDayOfWeek) == timeDayOfWeek)
+        if (IsDayActive(entry.ActiveDays, dayIndex))
         {
             // Check if time match.
             for (const auto& tr : entry.ActiveHours)
             {
                 if (tr.Begin <= timeSeconds && timeSeconds <= tr.End)
                 {
-                    if (!s_IsInSchedule)
-                    {
-                        const auto fmt = std::format(
-                            "Time is in schedule, {} in {}:[{}, {}]",
-                            localTime,
-                            static_cast<unsigned int>(timeDayOfWeek),
-                            tr.Begin,
-                            tr.End
-                        );
-                        LOG_INFO("{}", fmt);
-                    }
-                    s_IsInSchedule = true;
                     return true;
                 }
             }
         }
     }
 
-    s_IsInSchedule = false;
+    return false;
+#endif
+}
+
+auto Schedule::NextTransition (
+    const std::vector<ScheduleEntry>&                  schedule,
+    std::chrono::time_point<std::chrono::system_clock> time
+) -> std::optional<std::chrono::time_point<std::chrono::system_clock>>
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+    return std::nullopt;
+#else
+    return ScheduleEvaluator(schedule).NextTransition(time);
+#endif
+}
+
+#pragma endregion
+
+#pragma region "ScheduleEvaluator"
+
+ScheduleEvaluator::ScheduleEvaluator (LocalClock& clock)
+    : mClock (&clock)
+{
+}
+
+ScheduleEvaluator::ScheduleEvaluator (const std::vector<ScheduleEntry>& schedule, LocalClock& clock)
+    : mClock    (&clock)
+    , mSchedule (schedule)
+{
+    Compile();
+}
+
+auto ScheduleEvaluator::Update (const std::vector<ScheduleEntry>& schedule) -> bool
+{
+    if (schedule == mSchedule)
+    {
+        return false;
+    }
+
+    mSchedule = schedule;
+    Compile();
 
+    return true;
+}
+
+auto ScheduleEvaluator::Compile () -> void
+{
+    mIntervals.clear();
+
+    for (const auto& entry : mSchedule)
+    {
+        for (auto day = 0u; day < 7; ++day)
+        {
+            if (!IsDayActive(entry.ActiveDays, day))
+            {
+                continue;
+            }
+
+            for (const auto& tr : entry.ActiveHours)
+            {
+                if (tr.Begin > tr.End || tr.Begin >= SecondsPerDay)
+                {
+                    continue;
+                }
+
+                // Range end is inclusive.
+                const auto end = std::min(tr.End, SecondsPerDay - 1) + 1;
+                mIntervals.push_back(WeekInterval{ day * SecondsPerDay + tr.Begin, day * SecondsPerDay + end });
+            }
+        }
+    }
+
+    std::sort(
+        mIntervals.begin(),
+        mIntervals.end(),
+        [](const WeekInterval& lhs, const WeekInterval& rhs)
+        {
+            return lhs.Begin < rhs.Begin;
+        }
+    );
+
+    // Merge overlapping and adjacent intervals.
+    auto merged = size_t{0};
+    for (const auto& interval : mIntervals)
+    {
+        if (merged > 0 && interval.Begin <= mIntervals[merged - 1].End)
+        {
+            mIntervals[merged - 1].End = std::max(mIntervals[merged - 1].End, interval.End);
+        }
+        else
+        {
+            mIntervals[merged++] = interval;
+        }
+    }
+
+    mIntervals.resize(merged);
+}
+
+auto ScheduleEvaluator::IsActive (std::uint32_t secondOfWeek) const -> bool
+{
+    // Last interval beginning at or before given second.
+    auto it = std::upper_bound(
+        mIntervals.begin(),
+        mIntervals.end(),
+        secondOfWeek,
+        [](const std::uint32_t second, const WeekInterval& interval)
+        {
+            return second < interval.Begin;
+        }
+    );
+
+    if (it == mIntervals.begin())
+    {
+        return false;
+    }
+
+    return secondOfWeek < std::prev(it)->End;
+}
+
+auto ScheduleEvaluator::IsActive (SystemTimePoint time) const -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
     return false;
+#else
+    if (mIntervals.empty())
+    {
+        return false;
+    }
+
+    return IsActive(SecondOfWeek(ToLocalSeconds(*mClock, time)));
+#endif
+}
+
+auto ScheduleEvaluator::NextBoundary (std::uint64_t second) const -> std::optional<std::uint64_t>
+{
+    if (mIntervals.empty())
+    {
+        return std::nullopt;
+    }
+
+    const auto week   = second / SecondsPerWeek;
+    const auto offset = static_cast<std::uint32_t>(second % SecondsPerWeek);
+
+    // First interval ending after offset, ends are sorted too as intervals don't overlap.
+    auto it = std::upper_bound(
+        mIntervals.begin(),
+        mIntervals.end(),
+        offset,
+        [](const std::uint32_t second, const WeekInterval& interval)
+        {
+            return second < interval.End;
+        }
+    );
+
+    if (it == mIntervals.end())
+    {
+        return (week + 1) * SecondsPerWeek + mIntervals.front().Begin;
+    }
+
+    return week * SecondsPerWeek + (it->Begin > offset ? it->Begin : it->End);
+}
+
+auto ScheduleEvaluator::NextTransition (SystemTimePoint time) const -> std::optional<SystemTimePoint>
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+    return std::nullopt;
+#else
+    using namespace std::chrono;
+
+    if (mIntervals.empty())
+    {
+        return std::nullopt;
+    }
+
+    const auto tz        = mClock->Zone(time);
+    const auto localTime = ToLocalSeconds(*mClock, time);
+    const auto start     = SecondOfWeek(localTime);
+    const auto current   = IsActive(start);
+
+    // Result changes only at a boundary, at any occurrence of it when local
+    // time repeats, or at a clock shift. Earliest of those at which it
+    // differs is the transition. Edges may lie past the offset cached by
+    // LocalClock, so they go through zone directly.
+    auto next = std::optional<SystemTimePoint>();
+
+    const auto consider = [&](const SystemTimePoint edge)
+    {
+        if (edge > time
+         && (!next || edge < next.value())
+         && IsActive(SecondOfWeek(floor<seconds>(tz->to_local(edge)))) != current)
+        {
+            next = edge;
+        }
+    };
+
+    // Look a bit over a week ahead. In seconds, zone without DST ends its
+    // last period at sys_seconds::max().
+    const auto horizon = floor<seconds>(time) + seconds(SecondsPerWeek + SecondsPerDay);
+
+    for (auto info = tz->get_info(time); info.end <= horizon; info = tz->get_info(info.end))
+    {
+        consider(info.end);
+    }
+
+    // Walk starts a day back, local time runs backwards when clocks fall
+    // back and boundaries just passed come again. Seconds are counted from
+    // week before the current one to stay unsigned.
+    const auto base  = localTime - seconds(start) - seconds(SecondsPerWeek);
+    const auto first = std::uint64_t{start} + SecondsPerWeek - SecondsPerDay;
+    const auto limit = std::uint64_t{start} + 2 * SecondsPerWeek + SecondsPerDay;
+
+    auto second = NextBoundary(first);
+    while (second && second.value() <= limit)
+    {
+        // Local time skipped by DST maps to the shift itself, repeated
+        // local time to both of its occurrences.
+        const auto local = base + seconds(second.value());
+        const auto info  = tz->get_info(local);
+
+        if (info.result == local_info::nonexistent)
+        {
+            consider(info.first.end);
+        }
+        else
+        {
+            const auto earliest = sys_seconds((local - info.first.offset).time_since_epoch());
+
+            // Later boundaries map later still.
+            if (next && earliest >= next.value())
+            {
+                break;
+            }
+
+            consider(earliest);
+
+            if (info.result == local_info::ambiguous)
+            {
+                consider(sys_seconds((local - info.second.offset).time_since_epoch()));
+            }
+        }
+
+        second = NextBoundary(second.value());
+    }
+
+    return next;
 #endif
 }
 
+auto ScheduleEvaluator::SleepTime (SystemTimePoint time, std::chrono::milliseconds max) const -> std::chrono::milliseconds
+{
+    const auto next = NextTransition(time);
+    if (!next)
+    {
+        return max;
+    }
+
+    return std::clamp(
+        std::chrono::ceil<std::chrono::milliseconds>(next.value() - time),
+        std::chrono::milliseconds(1),
+        max
+    );
+}
+
+auto ScheduleEvaluator::SecondOfWeek (std::chrono::local_seconds localTime) -> std::uint32_t
+{
+    const auto localDay = std::chrono::floor<std::chrono::days>(localTime);
+    const auto dayIndex = std::chrono::weekday(localDay).iso_encoding() - 1;
+
+    return dayIndex * SecondsPerDay + static_cast<std::uint32_t>((localTime - localDay).count());
+}
+
+#pragma endregion
+
 } // namespace CaffeineTake
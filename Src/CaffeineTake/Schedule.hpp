@@ -20,7 +20,11 @@
 
 #pragma once
 
+#include "LocalClock.hpp"
+
 #include <chrono>
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -46,6 +50,8 @@ struct TimeRange
 {
     unsigned int Begin;
     unsigned int End;
+
+    auto operator== (const TimeRange& rhs) const -> bool = default;
 };
 
 using TimeRangeList = std::vector<TimeRange>;
@@ -55,15 +61,77 @@ struct ScheduleEntry
     std::wstring  Name;         // optional
     DaysOfWeek    ActiveDays;
     TimeRangeList ActiveHours;
+
+    auto operator== (const ScheduleEntry& rhs) const -> bool = default;
 };
 
 class Schedule
 {
 public:
+    // Linear scan over entries, prefer ScheduleEvaluator for repeated checks.
     static auto CheckSchedule (
         const std::vector<ScheduleEntry>&                  schedule,
         std::chrono::time_point<std::chrono::system_clock> time
     ) -> bool;
+
+    // First point after time at which CheckSchedule result changes,
+    // nullopt if it doesn't change within a week. Edges are placed using
+    // time zone rules in effect at the edge, so DST shifts are accounted for.
+    static auto NextTransition (
+        const std::vector<ScheduleEntry>&                  schedule,
+        std::chrono::time_point<std::chrono::system_clock> time
+    ) -> std::optional<std::chrono::time_point<std::chrono::system_clock>>;
+};
+
+// Schedule compiled into sorted, merged, half-open intervals over a week
+// in local seconds, Monday 0:00:00 is 0. Lookups are binary searches.
+// Local time comes from given clock, LocalClock::Get() by default.
+// Const methods don't modify anything and can be called concurrently.
+class ScheduleEvaluator final
+{
+    using SystemTimePoint = std::chrono::time_point<std::chrono::system_clock>;
+
+    struct WeekInterval
+    {
+        std::uint32_t Begin;
+        std::uint32_t End;    // exclusive
+    };
+
+    LocalClock*                mClock     = &LocalClock::Get();
+    std::vector<ScheduleEntry> mSchedule  = std::vector<ScheduleEntry>();
+    std::vector<WeekInterval>  mIntervals = std::vector<WeekInterval>();
+
+    auto Compile () -> void;
+
+    // Next interval boundary strictly after second, may be past week end.
+    auto NextBoundary (std::uint64_t second) const -> std::optional<std::uint64_t>;
+
+public:
+    static constexpr auto SecondsPerDay  = std::uint32_t{86400};
+    static constexpr auto SecondsPerWeek = std::uint32_t{7 * 86400};
+
+    ScheduleEvaluator () = default;
+    explicit ScheduleEvaluator (LocalClock& clock);
+    explicit ScheduleEvaluator (const std::vector<ScheduleEntry>& schedule, LocalClock& clock = LocalClock::Get());
+
+    // Returns true if schedule changed and was recompiled. Compares entries,
+    // call it only when settings snapshot changes.
+    auto Update (const std::vector<ScheduleEntry>& schedule) -> bool;
+
+    auto IsActive       (std::uint32_t secondOfWeek) const -> bool;
+    auto IsActive       (SystemTimePoint time) const -> bool;
+    auto NextTransition (SystemTimePoint time) const -> std::optional<SystemTimePoint>;
+
+    // How long to sleep before checking again, until next transition but
+    // no longer than max. Timer is re-armed with it after every check.
+    auto SleepTime (SystemTimePoint time, std::chrono::milliseconds max) const -> std::chrono::milliseconds;
+
+    auto GetIntervalCount () const -> size_t
+    {
+        return mIntervals.size();
+    }
+
+    static auto SecondOfWeek (std::chrono::local_seconds localTime) -> std::uint32_t;
 };
 
 } // namespace CaffeineTake
@@ -26,82 +26,21 @@
 
 #include "BluetoothIdentifier.hpp"
 #include "CaffeineIcons.hpp"
+#include "JsonCodec.hpp"
+#include "Reflection.hpp"
 #include "Schedule.hpp"
 #include "Utility.hpp"
 
-#include <nlohmann/json.hpp>
-
+#include <climits>
+#include <exception>
 #include <string>
-
-// std::wstring serializer/deserializer.
-namespace nlohmann {
-
-template <>
-struct adl_serializer<std::wstring>
-{
-    static void to_json(json& j, const std::wstring& opt)
-    {
-        auto utf8 = CaffeineTake::UTF16ToUTF8(opt.c_str());
-        j = utf8 ? utf8.value() : "";
-    }
-
-    static void from_json(const json& j, std::wstring& opt)
-    {
-        auto utf16 = CaffeineTake::UTF8ToUTF16(j.get<std::string>());
-        opt = utf16 ? utf16.value() : L"";
-    }
-};
-
-} // namespace nlohmann
+#include <string_view>
 
 namespace CaffeineTake {
 
-// TimeRange serializer.
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(TimeRange, Begin, End)
-
-// ScheduleEntry serializer.
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ScheduleEntry, Name, ActiveDays, ActiveHours)
-
-// IconColors serializer.
-//NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(CaffeineIcons::IconColors, CupBorder, CupFill, Steam, ModeIndicator)
-inline auto to_json (nlohmann::json& j, const CaffeineIcons::IconColors& ic) -> void
-{
-    j["CupBorder"]     = nlohmann::json(std::format("0x{:08x}", ic.CupBorder));
-    j["CupFill"]       = nlohmann::json(std::format("0x{:08x}", ic.CupFill));
-    j["Steam"]         = nlohmann::json(std::format("0x{:08x}", ic.Steam));
-    j["ModeIndicator"] = nlohmann::json(std::format("0x{:08x}", ic.ModeIndicator));
-}
-
-inline auto from_json (const nlohmann::json& j, CaffeineIcons::IconColors& ic) -> void
-{
-    const auto border  = j.at("CupBorder").get<std::string>();
-    const auto fill    = j.at("CupFill").get<std::string>();
-    const auto steam   = j.at("Steam").get<std::string>();
-    const auto mode    = j.at("ModeIndicator").get<std::string>();
-
-    ic.CupBorder     = std::stoul(border, nullptr, 16);
-    ic.CupFill       = std::stoul(fill, nullptr, 16);
-    ic.Steam         = std::stoul(steam, nullptr, 16);
-    ic.ModeIndicator = std::stoul(mode, nullptr, 16);
-}
-
-// BluetoothIdentifier serialzier.
-inline auto to_json (nlohmann::json& j, const BluetoothIdentifier& bi) -> void
-{
-    j = nlohmann::json(
-        std::format(
-            "{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}",
-            bi.bytes[5], bi.bytes[4], bi.bytes[3],
-            bi.bytes[2], bi.bytes[1], bi.bytes[0]
-        )
-    );
-}
-
-inline auto from_json (const nlohmann::json& j, BluetoothIdentifier& bi) -> void
+// Example id: 00:00:00:00:00:00, malformed id gives 0.
+inline auto BluetoothIdentifierFromString (const std::string_view s) -> unsigned long long
 {
-    const auto s = j.get<std::string>();
-
-    // Example id: 00:00:00:00:00:00
     auto ull = 0ull;
     if (s.length() == 17)
     {
@@ -134,9 +73,96 @@ inline auto from_json (const nlohmann::json& j, BluetoothIdentifier& bi) -> void
         }
     }
 
-    bi.ull = ull;
+    return ull;
 }
 
+// BluetoothIdentifier as "xx:xx:xx:xx:xx:xx".
+template <>
+struct JsonCodec<BluetoothIdentifier>
+{
+    static constexpr auto Type = JsonFieldType::String;
+
+    static auto Write (JsonWriter& writer, const BluetoothIdentifier& bi) -> void
+    {
+        constexpr auto hex = std::string_view("0123456789abcdef");
+
+        char text[17];
+        for (auto i = 0; i < 6; ++i)
+        {
+            const auto byte = bi.bytes[5 - i];
+            text[i * 3]     = hex[byte >> 4];
+            text[i * 3 + 1] = hex[byte & 0x0F];
+            if (i < 5)
+            {
+                text[i * 3 + 2] = ':';
+            }
+        }
+
+        writer.String(std::string_view(text, sizeof(text)));
+    }
+
+    static auto Read (const JsonValue& json, BluetoothIdentifier& bi) -> bool
+    {
+        bi.ull = BluetoothIdentifierFromString(json.String);
+        return true;
+    }
+};
+
+// Icon color as "0xAARRGGBB".
+struct HexColorCodec
+{
+    using Color = CaffeineIcons::Color;
+
+    static constexpr auto Type = JsonFieldType::String;
+
+    static auto Write (JsonWriter& writer, const Color color) -> void
+    {
+        constexpr auto hex = std::string_view("0123456789abcdef");
+
+        char text[10] = { '0', 'x' };
+        for (auto i = 0; i < 8; ++i)
+        {
+            text[2 + i] = hex[(color >> (28 - i * 4)) & 0x0F];
+        }
+
+        writer.String(std::string_view(text, sizeof(text)));
+    }
+
+    static auto Read (const JsonValue& json, Color& color) -> bool
+    {
+        try
+        {
+            color = static_cast<Color>(std::stoul(std::string(json.String), nullptr, 16));
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+};
+
+REFLECT(
+    TimeRange,
+    REFLECT_FIELD(Begin),
+    REFLECT_FIELD(End)
+);
+
+REFLECT(
+    ScheduleEntry,
+    REFLECT_FIELD(Name),
+    REFLECT_FIELD(ActiveDays),
+    REFLECT_FIELD(ActiveHours)
+);
+
+REFLECT(
+    CaffeineIcons::IconColors,
+    REFLECT_CODEC(CupBorder,     HexColorCodec),
+    REFLECT_CODEC(CupFill,       HexColorCodec),
+    REFLECT_CODEC(Steam,         HexColorCodec),
+    REFLECT_CODEC(ModeIndicator, HexColorCodec)
+);
+
 } // namespace CaffeineTake
 
 #endif
@@ -23,101 +23,201 @@
 #include "Settings.hpp"
 
 #if defined(FEATURE_CAFFEINETAKE_SETTINGS)
+#   include "BinaryCache.hpp"
+#   include "JsonCodec.hpp"
+#   include "JsonSaxLoader.hpp"
 #   include "Logger.hpp"
+#   include "Persistence.hpp"
+#   include "Reflection.hpp"
 #   include "Serializers.hpp"
+#   include <cstdint>
 #   include <filesystem>
-#   include <fstream>
 #   include <string>
-#   include <nlohmann/json.hpp>
+#   include <string_view>
+#   include <vector>
 #endif
 namespace CaffeineTake {
 
 #if defined(FEATURE_CAFFEINETAKE_SETTINGS)
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+// One table per struct drives JSON, binary cache and diffs.
+REFLECT(
     struct Settings::General::IconColorList,
-    StandardMode_Inactive,
-    StandardMode_Active,
-    AutoMode_Inactive,
-    AutoMode_Active,
-    TimerMode_Inactive,
-    TimerMode_Active
-)
-
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+    REFLECT_FIELD(StandardMode_Inactive),
+    REFLECT_FIELD(StandardMode_Active),
+    REFLECT_FIELD(AutoMode_Inactive),
+    REFLECT_FIELD(AutoMode_Active),
+    REFLECT_FIELD(TimerMode_Inactive),
+    REFLECT_FIELD(TimerMode_Active)
+);
+
+REFLECT(
     struct Settings::General,
-    LangId,
-    IconPack,
-    IconTheme,
-    UseNotifyIcon,
-    UseJumpLists,
-    UseDockMode,
-    AutoStart,
-    ShowNotifications,
-    PlayNotificationSound,
-    SoundPack,
-    IconColors,
-    PrepareIconColors
-)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Standard, Enabled, KeepScreenOn, WhenSessionLocked)
-
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerProcess, Enabled, Processes)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerWindow, Enabled, Windows)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerUsb, Enabled, UsbDevices)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerBluetooth, Enabled, BluetoothDevices, ActiveTimeout)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerSchedule, Enabled, ScheduleEntries)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+    REFLECT_FIELD(LangId),
+    REFLECT_FIELD(IconPack),
+    REFLECT_FIELD(IconTheme),
+    REFLECT_FIELD(UseNotifyIcon),
+    REFLECT_FIELD(UseJumpLists),
+    REFLECT_FIELD(UseDockMode),
+    REFLECT_FIELD(AutoStart),
+    REFLECT_FIELD(ShowNotifications),
+    REFLECT_FIELD(PlayNotificationSound),
+    REFLECT_FIELD(SoundPack),
+    REFLECT_FIELD(IconColors),
+    REFLECT_FIELD(PrepareIconColors)
+);
+
+REFLECT(
+    struct Settings::Standard,
+    REFLECT_FIELD(Enabled),
+    REFLECT_FIELD(KeepScreenOn),
+    REFLECT_FIELD(WhenSessionLocked)
+);
+
+// Scan cadence is optional, settings from older versions don't have it.
+REFLECT(
+    struct Settings::Auto::TriggerProcess,
+    REFLECT_FIELD(Enabled),
+    REFLECT_FIELD(Processes),
+    REFLECT_OPTIONAL(ScanInterval),
+    REFLECT_OPTIONAL(MaxScanInterval)
+);
+
+REFLECT(
+    struct Settings::Auto::TriggerWindow,
+    REFLECT_FIELD(Enabled),
+    REFLECT_FIELD(Windows),
+    REFLECT_OPTIONAL(ScanInterval),
+    REFLECT_OPTIONAL(MaxScanInterval)
+);
+
+REFLECT(
+    struct Settings::Auto::TriggerUsb,
+    REFLECT_FIELD(Enabled),
+    REFLECT_FIELD(UsbDevices),
+    REFLECT_OPTIONAL(ScanInterval),
+    REFLECT_OPTIONAL(MaxScanInterval)
+);
+
+REFLECT(
+    struct Settings::Auto::TriggerBluetooth,
+    REFLECT_FIELD(Enabled),
+    REFLECT_FIELD(BluetoothDevices),
+    REFLECT_FIELD(ActiveTimeout),
+    REFLECT_OPTIONAL(ScanInterval)
+);
+
+REFLECT(
+    struct Settings::Auto::TriggerSchedule,
+    REFLECT_FIELD(Enabled),
+    REFLECT_FIELD(ScheduleEntries)
+);
+
+REFLECT(
     struct Settings::Auto,
-    Enabled,
-    KeepScreenOn,
-    WhenSessionLocked,
-    ScanInterval,
-    TriggerProcess,
-    TriggerWindow,
-    TriggerUsb,
-    TriggerBluetooth,
-    TriggerSchedule
-)
-
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Timer, Enabled, KeepScreenOn, WhenSessionLocked, Interval)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Settings, General, Standard, Auto, Timer)
+    REFLECT_FIELD(Enabled),
+    REFLECT_FIELD(KeepScreenOn),
+    REFLECT_FIELD(WhenSessionLocked),
+    REFLECT_FIELD(ScanInterval),
+    REFLECT_FIELD(TriggerProcess),
+    REFLECT_FIELD(TriggerWindow),
+    REFLECT_FIELD(TriggerUsb),
+    REFLECT_FIELD(TriggerBluetooth),
+    REFLECT_FIELD(TriggerSchedule)
+);
+
+REFLECT(
+    struct Settings::Timer,
+    REFLECT_FIELD(Enabled),
+    REFLECT_FIELD(KeepScreenOn),
+    REFLECT_FIELD(WhenSessionLocked),
+    REFLECT_FIELD(Interval)
+);
+
+REFLECT(
+    Settings,
+    REFLECT_FIELD(General),
+    REFLECT_FIELD(Standard),
+    REFLECT_FIELD(Auto),
+    REFLECT_FIELD(Timer)
+);
+
+// Derived from tables above, any change to them invalidates old caches.
+constexpr auto SettingsCacheSchema = BinarySchema<Settings>;
 
 #endif
 
-auto Settings::Load (const fs::path& path) -> bool
+auto Settings::Load (const fs::path& path, const fs::path& cachePath, bool* cacheStale) -> bool
 {
 #if defined(FEATURE_CAFFEINETAKE_SETTINGS)
+    if (cacheStale)
+    {
+        *cacheStale = false;
+    }
+
+    // Use cache if it was made from this very file.
+    if (!cachePath.empty())
+    {
+        auto cached = Settings();
+        const auto loaded = BinaryCache::Load(cachePath, path, SettingsCacheSchema, [&cached](BinaryReader& reader)
+        {
+            return ReadBinary(reader, cached);
+        });
+
+        if (loaded)
+        {
+            *this = std::move(cached);
+            LOG_INFO(L"Loaded settings '{}' from cache", path.wstring());
+            return true;
+        }
+    }
+
     // NOTE: Settings should be in UTF-8
     // Open settings file for read.
-    auto file = std::ifstream(path);
-    if (!file)
+    auto file = MappedFile();
+    if (!file.Open(path))
     {
         LOG_ERROR(L"Failed to open settings file '{}' for reading", path.wstring());
         return false;
     }
 
-    // Parse.
-    auto json = nlohmann::json::parse(file, nullptr, false, true);
-    if (json.is_discarded())
+    const auto input = std::string_view(reinterpret_cast<const char*>(file.Data()), file.Size());
+    if (!FromJson(input))
     {
-        LOG_ERROR(L"Failed to parse settings '{}'", path.wstring());
+        LOG_ERROR(L"Failed to load settings '{}'", path.wstring());
         return false;
     }
-    
-    // Deserialize.
-    try
+
+    LOG_INFO(L"Loaded settings '{}'", path.wstring());
+
+    if (cacheStale)
     {
-        json.get_to<Settings>(*this);
+        *cacheStale = !cachePath.empty();
     }
-    catch (nlohmann::json::exception& e)
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto Settings::Save (const fs::path& path, const fs::path& cachePath) const -> bool
+{
+#if defined(FEATURE_CAFFEINETAKE_SETTINGS)
+    // Serialize, then swap whole file so crash never leaves half of it.
+    if (!WriteFileAtomic(path, ToJson()))
     {
-        LOG_ERROR(L"Failed to deserialize settings '{}'", path.wstring());
-        LOG_DEBUG("what() {}", e.what());
+        LOG_ERROR(L"Failed to write settings file '{}'", path.wstring());
         return false;
     }
 
-    LOG_DEBUG("{}", json.dump(4));
-    LOG_INFO(L"Loaded settings '{}'", path.wstring());
+    LOG_INFO(L"Saved settings '{}'", path.wstring());
+
+    // File is closed here, cache is keyed by its final size and time.
+    if (!cachePath.empty())
+    {
+        StoreCache(path, cachePath);
+    }
 
     return true;
 #else
@@ -125,22 +225,45 @@ auto Settings::Load (const fs::path& path) -> bool
 #endif
 }
 
-auto Settings::Save (const fs::path& path) -> bool
+auto Settings::StoreCache (const fs::path& path, const fs::path& cachePath) const -> bool
 {
 #if defined(FEATURE_CAFFEINETAKE_SETTINGS)
-    // Open Settings file for write.
-    auto file = std::ofstream(path);
-    if (!file)
+    auto writer = BinaryWriter();
+    WriteBinary(writer, *this);
+
+    if (!BinaryCache::Store(cachePath, path, SettingsCacheSchema, writer))
     {
-        LOG_ERROR(L"Failed to open settings file '{}' for writing", path.wstring());
+        LOG_WARNING(L"Failed to store settings cache '{}'", cachePath.wstring());
         return false;
     }
 
-    // Serialize.
-    auto json = nlohmann::json(*this);
-    file << std::setw(4) << json;
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto Settings::FromJson (const std::string_view text, JsonLoadError* error) -> bool
+{
+#if defined(FEATURE_CAFFEINETAKE_SETTINGS)
+    // Parse straight into settings, no DOM is built.
+    auto loaded = Settings();
+    auto loader = JsonSaxLoader();
+
+    if (!loader.Load(text, loaded))
+    {
+        const auto& failure = loader.Error();
+        LOG_ERROR("{} (line {}, column {})", failure.Message, failure.Line, failure.Column);
+
+        if (error)
+        {
+            *error = failure;
+        }
 
-    LOG_INFO(L"Saved settings '{}'", path.wstring());
+        return false;
+    }
+
+    *this = std::move(loaded);
 
     return true;
 #else
@@ -148,4 +271,25 @@ auto Settings::Save (const fs::path& path) -> bool
 #endif
 }
 
+auto Settings::ToJson () const -> std::string
+{
+#if defined(FEATURE_CAFFEINETAKE_SETTINGS)
+    auto writer = JsonWriter();
+    WriteJson(writer, *this);
+
+    return writer.Text();
+#else
+    return std::string();
+#endif
+}
+
+auto Settings::Diff (const Settings& other) const -> std::vector<std::string>
+{
+#if defined(FEATURE_CAFFEINETAKE_SETTINGS)
+    return ReflectDiff(*this, other);
+#else
+    return std::vector<std::string>();
+#endif
+}
+
 } // namespace CaffeineTake
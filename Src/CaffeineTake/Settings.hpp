@@ -28,6 +28,7 @@
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace {
@@ -36,6 +37,8 @@ namespace {
 
 namespace CaffeineTake {
 
+struct JsonLoadError;
+
 class Settings final
 {
 public:
@@ -87,18 +90,24 @@ public:
         {
             bool                             Enabled          = true; 
             std::vector<std::wstring>        Processes        = std::vector<std::wstring>();
+            unsigned int                     ScanInterval     = 0;         // in ms, 0 uses Auto.ScanInterval
+            unsigned int                     MaxScanInterval  = 0;         // in ms, backoff limit while missing
         } TriggerProcess;
 
         struct TriggerWindow
         {
             bool                             Enabled          = true; 
             std::vector<std::wstring>        Windows          = std::vector<std::wstring>();
+            unsigned int                     ScanInterval     = 0;         // in ms, 0 uses Auto.ScanInterval
+            unsigned int                     MaxScanInterval  = 0;         // in ms, backoff limit while missing
         } TriggerWindow;
         
         struct TriggerUsb
         {
             bool                             Enabled          = true;
             std::vector<std::wstring>        UsbDevices       = std::vector<std::wstring>();
+            unsigned int                     ScanInterval     = 0;         // in ms, 0 uses Auto.ScanInterval
+            unsigned int                     MaxScanInterval  = 16*1000;   // in ms, backoff limit while missing
         } TriggerUsb;
         
         struct TriggerBluetooth
@@ -106,6 +115,7 @@ public:
             bool                             Enabled          = true;
             std::vector<BluetoothIdentifier> BluetoothDevices = std::vector<BluetoothIdentifier>({});
             unsigned int                     ActiveTimeout    = 60*1000;   // in ms
+            unsigned int                     ScanInterval     = 0;         // in ms, 0 uses Auto.ScanInterval, no backoff
         } TriggerBluetooth;
 
         struct TriggerSchedule
@@ -129,8 +139,22 @@ public:
 
     Settings () = default;
 
-    auto Load (const fs::path& path) -> bool;
-    auto Save (const fs::path& path) -> bool;
+    // With cachePath, binary cache is used instead of parsing when it
+    // matches the file. Parsing doesn't touch the cache, cacheStale is set
+    // then and StoreCache should follow. Save refreshes cache itself.
+    auto Load (const fs::path& path, const fs::path& cachePath = fs::path(), bool* cacheStale = nullptr) -> bool;
+    auto Save (const fs::path& path, const fs::path& cachePath = fs::path()) const -> bool;
+
+    // Cache of these settings keyed by path as it is on disk now.
+    auto StoreCache (const fs::path& path, const fs::path& cachePath) const -> bool;
+
+    // Settings file text, what Load reads and Save writes. On failure
+    // settings are left as they were and error tells where parsing stopped.
+    auto FromJson (const std::string_view text, JsonLoadError* error = nullptr) -> bool;
+    auto ToJson   () const -> std::string;
+
+    // Paths of fields that differ, e.g. "Auto.TriggerUsb.UsbDevices".
+    auto Diff (const Settings& other) const -> std::vector<std::string>;
 };
 
 } // namespace CaffeineTake
@@ -0,0 +1,800 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "SyntheticWorkload.hpp"
+
+#if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
+
+#include "LocalClock.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cwchar>
+#include <format>
+#include <utility>
+
+namespace CaffeineTake {
+
+namespace {
+
+auto& SyntheticEvents = MetricsRegistry::Get().Counter(
+    "caffeinetake_synthetic_events_total",
+    "Churn events and trigger switches applied by synthetic workload."
+);
+
+std::mutex                         gInstalledMutex;
+std::shared_ptr<SyntheticWorkload> gInstalled = nullptr;
+
+#pragma region "Sources"
+
+// Call accounting follows the Windows sources, so counters stay comparable.
+class SyntheticProcessSource final : public ProcessSource
+{
+    std::shared_ptr<SyntheticWorkload> mWorkload;
+
+public:
+    explicit SyntheticProcessSource (std::shared_ptr<SyntheticWorkload> workload)
+        : mWorkload (std::move(workload))
+    {
+    }
+
+    auto Enumerate (std::vector<ProcessRecord>& list) -> bool override
+    {
+        mOsCalls += 1;
+        return mWorkload->EnumerateProcesses(list);
+    }
+
+    auto QueryImagePath (ProcessId pid, std::wstring& path) -> bool override
+    {
+        mOsCalls += 3; // open, query, close
+        return mWorkload->QueryImagePath(pid, path);
+    }
+};
+
+class SyntheticWindowSource final : public WindowSource
+{
+    std::shared_ptr<SyntheticWorkload> mWorkload;
+
+public:
+    explicit SyntheticWindowSource (std::shared_ptr<SyntheticWorkload> workload)
+        : mWorkload (std::move(workload))
+    {
+    }
+
+    auto Enumerate (const Visitor& visitor) -> bool override
+    {
+        mOsCalls += 1;
+        return mWorkload->EnumerateWindows(
+            [&] (ProcessId pid, std::wstring_view title)
+            {
+                mOsCalls += 3;
+                return visitor(pid, title);
+            }
+        );
+    }
+};
+
+class SyntheticUsbDeviceSource final : public UsbDeviceSource
+{
+    std::shared_ptr<SyntheticWorkload> mWorkload;
+
+public:
+    explicit SyntheticUsbDeviceSource (std::shared_ptr<SyntheticWorkload> workload)
+        : mWorkload (std::move(workload))
+    {
+    }
+
+    auto Enumerate (const Visitor& visitor) -> bool override
+    {
+        mOsCalls += 2;
+        return mWorkload->EnumerateUsb(
+            [&] (std::wstring_view instanceId)
+            {
+                mOsCalls += 2;
+                return visitor(instanceId);
+            }
+        );
+    }
+};
+
+class SyntheticBluetoothSource final : public BluetoothSource
+{
+    std::shared_ptr<SyntheticWorkload> mWorkload;
+
+public:
+    explicit SyntheticBluetoothSource (std::shared_ptr<SyntheticWorkload> workload)
+        : mWorkload (std::move(workload))
+    {
+    }
+
+    auto HasRadio () -> bool override
+    {
+        mOsCalls += 2;
+        return true;
+    }
+
+    // Connected devices are always reported as seen now, nothing to refresh.
+    // Real inquiry blocks for over a second, it is not simulated.
+    auto Inquiry () -> bool override
+    {
+        mOsCalls += 2;
+        return true;
+    }
+
+    auto Enumerate (const Visitor& visitor) -> bool override
+    {
+        mOsCalls += 2;
+        return mWorkload->EnumerateBluetooth(
+            [&] (const BluetoothDeviceRecord& device)
+            {
+                mOsCalls += 1;
+                return visitor(device);
+            }
+        );
+    }
+};
+
+#pragma endregion
+
+} // namespace
+
+#pragma region "SyntheticWorkloadOptions"
+
+auto SyntheticWorkloadOptions::Parse (std::wstring_view spec) -> std::optional<SyntheticWorkloadOptions>
+{
+    auto options = SyntheticWorkloadOptions();
+
+    auto parseCount = [] (const std::wstring& value, auto& out) -> bool
+    {
+        auto end = static_cast<wchar_t*>(nullptr);
+        const auto n = std::wcstoull(value.c_str(), &end, 10);
+        if (value.empty() || *end != L'\0')
+        {
+            return false;
+        }
+
+        out = static_cast<std::remove_reference_t<decltype(out)>>(n);
+        return true;
+    };
+
+    auto parseRate = [] (const std::wstring& value, double& out) -> bool
+    {
+        auto end = static_cast<wchar_t*>(nullptr);
+        const auto d = std::wcstod(value.c_str(), &end);
+        if (value.empty() || *end != L'\0' || !std::isfinite(d) || d < 0.0)
+        {
+            return false;
+        }
+
+        out = d;
+        return true;
+    };
+
+    while (!spec.empty())
+    {
+        const auto comma = spec.find(L',');
+        const auto item  = spec.substr(0, comma);
+        spec = comma == std::wstring_view::npos ? std::wstring_view() : spec.substr(comma + 1);
+
+        if (item.empty())
+        {
+            continue;
+        }
+
+        const auto equals = item.find(L'=');
+        if (equals == std::wstring_view::npos)
+        {
+            return std::nullopt;
+        }
+
+        const auto key   = item.substr(0, equals);
+        const auto value = std::wstring(item.substr(equals + 1));
+
+        auto valid = false;
+        if      (key == L"seed")           valid = parseCount(value, options.Seed);
+        else if (key == L"processes")      valid = parseCount(value, options.Processes);
+        else if (key == L"windows")        valid = parseCount(value, options.Windows);
+        else if (key == L"usb")            valid = parseCount(value, options.UsbDevices);
+        else if (key == L"bluetooth")      valid = parseCount(value, options.BluetoothDevices);
+        else if (key == L"process-churn")  valid = parseRate(value, options.ProcessChurn);
+        else if (key == L"title-churn")    valid = parseRate(value, options.TitleChurn);
+        else if (key == L"device-flaps")   valid = parseRate(value, options.DeviceFlaps);
+        else if (key == L"trigger-period") valid = parseRate(value, options.TriggerPeriod);
+
+        if (!valid)
+        {
+            return std::nullopt;
+        }
+    }
+
+    return options;
+}
+
+#pragma endregion
+
+#pragma region "SyntheticWorkload"
+
+SyntheticWorkload::SyntheticWorkload (SyntheticWorkloadOptions options)
+    : mOptions (std::move(options))
+    , mRandom  (mOptions.Seed)
+    , mNow     (Clock::now())
+{
+    // Executables, a third of processes are svchost like on a real system.
+    constexpr const wchar_t* Vendors[] = {
+        L"Adobe", L"Google", L"JetBrains", L"Microsoft", L"Mozilla",
+        L"Oracle", L"Slack", L"Valve", L"VideoLAN", L"Zoom"
+    };
+
+    mPaths.emplace_back(L"C:\\Windows\\System32\\svchost.exe");
+    for (const auto vendor : Vendors)
+    {
+        for (auto i = 0; i < 40; ++i)
+        {
+            mPaths.push_back(std::format(L"C:\\Program Files\\{}\\App{}\\app{}.exe", vendor, i, i));
+        }
+    }
+
+    mTriggerPath = static_cast<std::uint32_t>(mPaths.size());
+    mPaths.push_back(mOptions.TriggerProcess);
+
+    mProcesses.reserve(mOptions.Processes + 1);
+    mProcessIndex.reserve(mOptions.Processes + 1);
+    for (auto i = size_t{0}; i < mOptions.Processes; ++i)
+    {
+        SpawnProcess(Chance(0.3) ? 0 : static_cast<std::uint32_t>(1 + Uniform(mPaths.size() - 2)));
+    }
+
+    // Windows belong to random processes, most of them visible.
+    mWindows.reserve(mOptions.Windows + 1);
+    for (auto i = size_t{0}; i < mOptions.Windows && !mProcesses.empty(); ++i)
+    {
+        mWindows.push_back(Window{ mProcesses[Uniform(mProcesses.size())].Pid, MakeTitle(), Chance(0.7), false });
+    }
+
+    mUsbDevices.reserve(mOptions.UsbDevices + 1);
+    for (auto i = size_t{0}; i < mOptions.UsbDevices; ++i)
+    {
+        const auto vid = static_cast<unsigned>(mRandom() & 0xFFFF);
+        const auto pid = static_cast<unsigned>(mRandom() & 0xFFFF);
+        const auto sn  = static_cast<unsigned>(mRandom() & 0xFFFFFFFF);
+        mUsbDevices.push_back(UsbDevice{ std::format(L"USB\\VID_{:04X}&PID_{:04X}\\{:08X}", vid, pid, sn), Chance(0.8), false });
+    }
+
+    // Trigger device is remembered but long gone, others seen sometime within last two hours.
+    constexpr const wchar_t* Kinds[] = { L"Headset", L"Keyboard", L"Mouse", L"Phone", L"Speaker" };
+
+    auto trigger = BluetoothDevice();
+    trigger.Address.ull = mOptions.TriggerBluetooth;
+    trigger.Name        = L"Synthetic Trigger";
+    trigger.Connected   = false;
+    trigger.LastSeen    = mNow - std::chrono::hours(24);
+    mBtDevices.push_back(std::move(trigger));
+
+    for (auto i = size_t{0}; i < mOptions.BluetoothDevices; ++i)
+    {
+        auto device = BluetoothDevice();
+        device.Address.ull = 0x001A7D000000ull | (mRandom() & 0xFFFFFF);
+        device.Name        = std::format(L"{} {}", Kinds[Uniform(std::size(Kinds))], i);
+        device.Connected   = Chance(0.3);
+        device.LastSeen    = device.Connected ? mNow : mNow - std::chrono::minutes(Uniform(120));
+        mBtDevices.push_back(std::move(device));
+    }
+
+    // Schedule first events.
+    mNextEvent[static_cast<size_t>(Stream::Process)] = mNow + NextInterval(mOptions.ProcessChurn);
+    mNextEvent[static_cast<size_t>(Stream::Title)]   = mNow + NextInterval(mOptions.TitleChurn);
+    mNextEvent[static_cast<size_t>(Stream::Device)]  = mNow + NextInterval(mOptions.DeviceFlaps);
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(mOptions.TriggerPeriod));
+    for (auto k = size_t{0}; k < ScannerKindCount; ++k)
+    {
+        mTriggers[k].Next = period > Clock::duration::zero() ? mNow + period * static_cast<int>(k + 1) / 4 : Clock::time_point::max();
+    }
+}
+
+auto SyntheticWorkload::Uniform (size_t count) -> size_t
+{
+    // Modulo bias is negligible for counts this workload uses.
+    return count > 0 ? static_cast<size_t>(mRandom() % count) : 0;
+}
+
+auto SyntheticWorkload::Chance (double probability) -> bool
+{
+    return static_cast<double>(mRandom() >> 11) * 0x1.0p-53 < probability;
+}
+
+auto SyntheticWorkload::NextInterval (double perSecond) -> Clock::duration
+{
+    if (perSecond <= 0.0)
+    {
+        return Clock::duration::max() / 2;
+    }
+
+    // Exponential distribution, events form a Poisson process.
+    const auto u = static_cast<double>(mRandom() >> 11) * 0x1.0p-53;
+    const auto seconds = -std::log(1.0 - u) / perSecond;
+
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+auto SyntheticWorkload::MakeTitle () -> std::wstring
+{
+    const auto n = ++mTitleSerial;
+    switch (Uniform(6))
+    {
+    case 0:  return std::format(L"Document{}.txt - Notepad", n);
+    case 1:  return std::format(L"({}) Inbox - Mail", n % 50);
+    case 2:  return std::format(L"Search results {} - Browser", n);
+    case 3:  return std::format(L"Build #{} - Pipeline", n);
+    case 4:  return std::format(L"Project{} - Visual Studio Code", n % 20);
+    default: return std::format(L"Untitled {} - Paint", n);
+    }
+}
+
+auto SyntheticWorkload::SpawnProcess (std::uint32_t path) -> ProcessId
+{
+    // Once enough PIDs are free, system starts reusing them.
+    auto pid = ProcessId{0};
+    if (mFreePids.size() > 64 && Chance(0.5))
+    {
+        const auto i = Uniform(mFreePids.size());
+        pid = mFreePids[i];
+        mFreePids[i] = mFreePids.back();
+        mFreePids.pop_back();
+    }
+    else
+    {
+        pid = mNextPid;
+        mNextPid += 4;
+    }
+
+    mProcessIndex[pid] = mProcesses.size();
+    mProcesses.push_back(Process{ pid, mNextStartKey++, path, !Chance(0.03) });
+
+    return pid;
+}
+
+auto SyntheticWorkload::RemoveProcess (size_t index) -> void
+{
+    const auto pid = mProcesses[index].Pid;
+
+    mProcesses[index] = mProcesses.back();
+    mProcessIndex[mProcesses[index].Pid] = index;
+    mProcesses.pop_back();
+    mProcessIndex.erase(pid);
+    mFreePids.push_back(pid);
+}
+
+auto SyntheticWorkload::ApplyEvent (Stream stream) -> void
+{
+    switch (stream)
+    {
+    case Stream::Process:
+    {
+        // One starts, one exits. Windows of exited process go to the new one.
+        const auto spawned = SpawnProcess(Chance(0.3) ? 0 : static_cast<std::uint32_t>(1 + Uniform(mPaths.size() - 2)));
+        auto index = Uniform(mProcesses.size() - 1);
+        if (mProcesses[index].Pid == mTriggerPid)
+        {
+            // Trigger process lives until switched off.
+            if (mProcesses.size() < 3)
+            {
+                break;
+            }
+
+            index = (index + 1) % (mProcesses.size() - 1);
+        }
+
+        const auto exited = mProcesses[index].Pid;
+
+        RemoveProcess(index);
+        for (auto& window : mWindows)
+        {
+            if (window.Pid == exited)
+            {
+                window.Pid   = spawned;
+                window.Title = MakeTitle();
+            }
+        }
+        break;
+    }
+
+    case Stream::Title:
+    {
+        if (mWindows.empty())
+        {
+            break;
+        }
+
+        auto& window = mWindows[Uniform(mWindows.size())];
+        if (!window.IsTrigger)
+        {
+            window.Title = MakeTitle();
+            if (Chance(0.1))
+            {
+                window.Visible = !window.Visible;
+            }
+        }
+        break;
+    }
+
+    case Stream::Device:
+    {
+        if (Chance(0.5) && !mUsbDevices.empty())
+        {
+            auto& device = mUsbDevices[Uniform(mUsbDevices.size())];
+            if (!device.IsTrigger)
+            {
+                device.Present = !device.Present;
+            }
+        }
+        else if (mBtDevices.size() > 1)
+        {
+            auto& device = mBtDevices[1 + Uniform(mBtDevices.size() - 1)];
+            device.Connected = !device.Connected;
+            device.LastSeen  = mNow;
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+auto SyntheticWorkload::SwitchTrigger (ScannerKind kind) -> void
+{
+    auto& trigger = mTriggers[static_cast<size_t>(kind)];
+
+    trigger.Present = !trigger.Present;
+    trigger.Seen    = false;
+    trigger.Since   = mNow;
+
+    // Trigger items are put at random position, scanners stopping at first
+    // hit see anything from one to all entries.
+    switch (kind)
+    {
+    case ScannerKind::Process:
+        if (trigger.Present)
+        {
+            mTriggerPid = SpawnProcess(mTriggerPath);
+            mProcesses.back().Queryable = true;
+
+            const auto index = Uniform(mProcesses.size());
+            std::swap(mProcesses[index], mProcesses.back());
+            mProcessIndex[mProcesses[index].Pid]      = index;
+            mProcessIndex[mProcesses.back().Pid]      = mProcesses.size() - 1;
+        }
+        else if (mTriggerPid != 0)
+        {
+            RemoveProcess(mProcessIndex[mTriggerPid]);
+            mTriggerPid = 0;
+        }
+        break;
+
+    case ScannerKind::Window:
+        if (trigger.Present)
+        {
+            const auto pid = mProcesses.empty() ? ProcessId{0} : mProcesses[Uniform(mProcesses.size())].Pid;
+            const auto at  = mWindows.begin() + static_cast<std::ptrdiff_t>(Uniform(mWindows.size() + 1));
+            mWindows.insert(at, Window{ pid, mOptions.TriggerWindow, true, true });
+        }
+        else
+        {
+            std::erase_if(mWindows, [] (const Window& w) { return w.IsTrigger; });
+        }
+        break;
+
+    case ScannerKind::Usb:
+        if (trigger.Present)
+        {
+            const auto at = mUsbDevices.begin() + static_cast<std::ptrdiff_t>(Uniform(mUsbDevices.size() + 1));
+            mUsbDevices.insert(at, UsbDevice{ mOptions.TriggerUsbDevice, true, true });
+        }
+        else
+        {
+            std::erase_if(mUsbDevices, [] (const UsbDevice& d) { return d.IsTrigger; });
+        }
+        break;
+
+    case ScannerKind::Bluetooth:
+        mBtDevices.front().Connected = trigger.Present;
+        mBtDevices.front().LastSeen  = mNow;
+        break;
+    }
+}
+
+auto SyntheticWorkload::SyncLocked () -> void
+{
+    if (!mOptions.ManualClock)
+    {
+        AdvanceLocked(std::max(mNow, Clock::now()));
+    }
+}
+
+auto SyntheticWorkload::AdvanceLocked (Clock::time_point to) -> void
+{
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(mOptions.TriggerPeriod));
+
+    // Replay everything that happened up to given point, in order.
+    while (true)
+    {
+        auto next   = Clock::time_point::max();
+        auto stream = Stream::Count;
+        auto kind   = ScannerKindCount;
+
+        for (auto s = size_t{0}; s < StreamCount; ++s)
+        {
+            if (mNextEvent[s] <= to && mNextEvent[s] < next)
+            {
+                next   = mNextEvent[s];
+                stream = static_cast<Stream>(s);
+            }
+        }
+
+        for (auto k = size_t{0}; k < ScannerKindCount; ++k)
+        {
+            if (mTriggers[k].Next <= to && mTriggers[k].Next < next)
+            {
+                next   = mTriggers[k].Next;
+                stream = Stream::Count;
+                kind   = k;
+            }
+        }
+
+        if (next == Clock::time_point::max())
+        {
+            break;
+        }
+
+        mNow = next;
+        SyntheticEvents.Add();
+
+        if (kind < ScannerKindCount)
+        {
+            SwitchTrigger(static_cast<ScannerKind>(kind));
+            mTriggers[kind].Next += period;
+            continue;
+        }
+
+        ApplyEvent(stream);
+
+        auto& nextEvent = mNextEvent[static_cast<size_t>(stream)];
+        switch (stream)
+        {
+        case Stream::Process: nextEvent += NextInterval(mOptions.ProcessChurn); break;
+        case Stream::Title:   nextEvent += NextInterval(mOptions.TitleChurn);   break;
+        default:              nextEvent += NextInterval(mOptions.DeviceFlaps);  break;
+        }
+    }
+
+    mNow = to;
+}
+
+auto SyntheticWorkload::ObserveLocked (ScannerKind kind) -> void
+{
+    auto& trigger = mTriggers[static_cast<size_t>(kind)];
+    if (trigger.Present && !trigger.Seen)
+    {
+        trigger.Seen = true;
+        GetDetectionHistogram(kind).Record(std::chrono::duration_cast<LatencyHistogram::Duration>(mNow - trigger.Since));
+    }
+}
+
+auto SyntheticWorkload::Advance (Clock::duration duration) -> void
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    if (mOptions.ManualClock)
+    {
+        AdvanceLocked(mNow + duration);
+    }
+}
+
+auto SyntheticWorkload::IsTriggerPresent (ScannerKind kind) const -> bool
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    return mTriggers[static_cast<size_t>(kind)].Present;
+}
+
+auto SyntheticWorkload::CreateProcessSource () -> ProcessSourcePtr
+{
+    return std::make_unique<SyntheticProcessSource>(shared_from_this());
+}
+
+auto SyntheticWorkload::CreateWindowSource () -> WindowSourcePtr
+{
+    return std::make_unique<SyntheticWindowSource>(shared_from_this());
+}
+
+auto SyntheticWorkload::CreateUsbDeviceSource () -> UsbDeviceSourcePtr
+{
+    return std::make_unique<SyntheticUsbDeviceSource>(shared_from_this());
+}
+
+auto SyntheticWorkload::CreateBluetoothSource () -> BluetoothSourcePtr
+{
+    return std::make_unique<SyntheticBluetoothSource>(shared_from_this());
+}
+
+auto SyntheticWorkload::EnumerateProcesses (std::vector<ProcessRecord>& list) -> bool
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    SyncLocked();
+
+    list.clear();
+    for (const auto& process : mProcesses)
+    {
+        list.push_back(ProcessRecord{ process.Pid, process.StartKey });
+    }
+
+    return true;
+}
+
+// Doesn't move time, path queries belong to enumeration that came before.
+auto SyntheticWorkload::QueryImagePath (ProcessId pid, std::wstring& path) -> bool
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+    const auto it = mProcessIndex.find(pid);
+    if (it == mProcessIndex.end())
+    {
+        return false;
+    }
+
+    const auto& process = mProcesses[it->second];
+    if (!process.Queryable)
+    {
+        return false;
+    }
+
+    path.assign(mPaths[process.Path]);
+    if (process.Path == mTriggerPath)
+    {
+        ObserveLocked(ScannerKind::Process);
+    }
+
+    return true;
+}
+
+// Visitors run under workload lock, they must not call back into workload.
+auto SyntheticWorkload::EnumerateWindows (const WindowSource::Visitor& visitor) -> bool
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    SyncLocked();
+
+    for (const auto& window : mWindows)
+    {
+        if (!window.Visible)
+        {
+            continue;
+        }
+
+        if (window.IsTrigger)
+        {
+            ObserveLocked(ScannerKind::Window);
+        }
+
+        const auto result = visitor(window.Pid, window.Title);
+        if (result != ScanResult::Continue)
+        {
+            return result == ScanResult::Success;
+        }
+    }
+
+    return false;
+}
+
+auto SyntheticWorkload::EnumerateUsb (const UsbDeviceSource::Visitor& visitor) -> bool
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    SyncLocked();
+
+    for (const auto& device : mUsbDevices)
+    {
+        if (!device.Present)
+        {
+            continue;
+        }
+
+        if (device.IsTrigger)
+        {
+            ObserveLocked(ScannerKind::Usb);
+        }
+
+        const auto result = visitor(device.InstanceId);
+        if (result != ScanResult::Continue)
+        {
+            return result == ScanResult::Success;
+        }
+    }
+
+    return false;
+}
+
+auto SyntheticWorkload::EnumerateBluetooth (const BluetoothSource::Visitor& visitor) -> bool
+{
+    // Devices report last seen in local time, map workload time onto it.
+    const auto localNow = LocalClock::Get().LocalNow();
+
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    SyncLocked();
+
+    for (auto i = size_t{0}; i < mBtDevices.size(); ++i)
+    {
+        const auto& device = mBtDevices[i];
+
+        auto record = BluetoothDeviceRecord();
+        record.Address   = device.Address;
+        record.Connected = device.Connected;
+        record.LastSeen  = device.Connected
+            ? localNow
+            : localNow - std::chrono::duration_cast<std::chrono::system_clock::duration>(mNow - device.LastSeen);
+        record.Name      = device.Name;
+
+        if (i == 0 && device.Connected)
+        {
+            ObserveLocked(ScannerKind::Bluetooth);
+        }
+
+        const auto result = visitor(record);
+        if (result != ScanResult::Continue)
+        {
+            return result == ScanResult::Success;
+        }
+    }
+
+    return false;
+}
+
+auto SyntheticWorkload::GetDetectionHistogram (ScannerKind kind) -> LatencyHistogram&
+{
+    static constexpr const char* Labels[ScannerKindCount] = {
+        "kind=\"Process\"",
+        "kind=\"Window\"",
+        "kind=\"Usb\"",
+        "kind=\"Bluetooth\"",
+    };
+
+    return MetricsRegistry::Get().Histogram(
+        "caffeinetake_synthetic_detection_seconds",
+        "Time from synthetic trigger appearing until a scanner was handed it.",
+        Labels[static_cast<size_t>(kind)]
+    );
+}
+
+auto SyntheticWorkload::Install (std::shared_ptr<SyntheticWorkload> workload) -> void
+{
+    auto lockGuard = std::lock_guard<std::mutex>(gInstalledMutex);
+    gInstalled = std::move(workload);
+}
+
+auto SyntheticWorkload::GetInstalled () -> std::shared_ptr<SyntheticWorkload>
+{
+    auto lockGuard = std::lock_guard<std::mutex>(gInstalledMutex);
+    return gInstalled;
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
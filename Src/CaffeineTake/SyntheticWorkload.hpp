@@ -0,0 +1,215 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Config.hpp"
+
+#if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
+
+#include "BluetoothIdentifier.hpp"
+#include "DeviceSource.hpp"
+#include "Metrics.hpp"
+#include "ProcessSource.hpp"
+#include "ScanScheduler.hpp"
+#include "WindowSource.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace CaffeineTake {
+
+struct SyntheticWorkloadOptions
+{
+    std::uint64_t      Seed             = 1;
+    size_t             Processes        = 10000;
+    size_t             Windows          = 300;
+    size_t             UsbDevices       = 40;
+    size_t             BluetoothDevices = 30;
+    double             ProcessChurn     = 20.0;   // processes started per second, as many exit
+    double             TitleChurn       = 10.0;   // window title changes per second
+    double             DeviceFlaps      = 0.5;    // USB or Bluetooth arrivals and removals per second
+    double             TriggerPeriod    = 30.0;   // seconds trigger items are present, then as long absent, 0 never
+    bool               ManualClock      = false;  // time moves only by Advance()
+
+    // Present only while trigger is on, add them to settings to get hits.
+    std::wstring       TriggerProcess   = L"C:\\Synthetic\\SyntheticTrigger.exe";
+    std::wstring       TriggerWindow    = L"Synthetic Trigger";
+    std::wstring       TriggerUsbDevice = L"USB\\VID_F00D&PID_0001\\SYNTHETIC";
+    unsigned long long TriggerBluetooth = 0xF00D00000001ull;   // f0:0d:00:00:00:01
+
+    // Comma separated key=value list, e.g. "seed=7,processes=20000,title-churn=50".
+    // Keys: seed, processes, windows, usb, bluetooth, process-churn,
+    // title-churn, device-flaps, trigger-period.
+    static auto Parse (std::wstring_view spec) -> std::optional<SyntheticWorkloadOptions>;
+};
+
+// Seeded stand-in for the system, behind every enumeration scanners do.
+// Churn events arrive as Poisson processes in workload time, so a seed
+// gives the same sequence of starts, exits, title changes and device
+// flaps on every run, only the points where scanners look at it differ.
+//
+// Trigger items of each kind are switched on and off every TriggerPeriod,
+// kinds shifted by a quarter period. Time from switching on until the item
+// is first handed to a scanner goes to caffeinetake_synthetic_detection_seconds.
+class SyntheticWorkload final : public std::enable_shared_from_this<SyntheticWorkload>
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Process
+    {
+        ProcessId       Pid;
+        ProcessStartKey StartKey;
+        std::uint32_t   Path;        // index to mPaths
+        bool            Queryable;   // protected processes can't be opened
+    };
+
+    struct Window
+    {
+        ProcessId    Pid;
+        std::wstring Title;
+        bool         Visible;
+        bool         IsTrigger;
+    };
+
+    struct UsbDevice
+    {
+        std::wstring InstanceId;
+        bool         Present;
+        bool         IsTrigger;
+    };
+
+    struct BluetoothDevice
+    {
+        BluetoothIdentifier Address;
+        std::wstring        Name;
+        bool                Connected;
+        Clock::time_point   LastSeen;
+    };
+
+    enum class Stream : unsigned char
+    {
+        Process,
+        Title,
+        Device,
+        Count
+    };
+
+    static constexpr auto StreamCount = static_cast<size_t>(Stream::Count);
+
+    struct Trigger
+    {
+        bool              Present = false;
+        bool              Seen    = false;
+        Clock::time_point Since   = Clock::time_point();
+        Clock::time_point Next    = Clock::time_point();   // next switch
+    };
+
+    mutable std::mutex                               mMutex;
+    SyntheticWorkloadOptions                         mOptions;
+    std::mt19937_64                                  mRandom;
+    Clock::time_point                                mNow;
+    std::array<Clock::time_point, StreamCount>       mNextEvent    = {};
+    std::array<Trigger, ScannerKindCount>            mTriggers     = {};
+
+    std::vector<std::wstring>                        mPaths        = std::vector<std::wstring>();
+    std::vector<Process>                             mProcesses    = std::vector<Process>();
+    std::unordered_map<ProcessId, size_t>            mProcessIndex = std::unordered_map<ProcessId, size_t>();
+    std::vector<ProcessId>                           mFreePids     = std::vector<ProcessId>();   // exited, may be reused
+    ProcessId                                        mNextPid      = 8;
+    ProcessStartKey                                  mNextStartKey = 1;
+    std::uint32_t                                    mTriggerPath  = 0;
+    ProcessId                                        mTriggerPid   = 0;
+    std::vector<Window>                              mWindows      = std::vector<Window>();
+    std::vector<UsbDevice>                           mUsbDevices   = std::vector<UsbDevice>();
+    std::vector<BluetoothDevice>                     mBtDevices    = std::vector<BluetoothDevice>();   // trigger device is first
+    std::uint64_t                                    mTitleSerial  = 0;
+
+    // Own distributions on top of mt19937_64, standard ones differ between
+    // library implementations and seed must give same workload everywhere.
+    auto Uniform      (size_t count) -> size_t;
+    auto Chance       (double probability) -> bool;
+    auto NextInterval (double perSecond) -> Clock::duration;
+
+    auto MakeTitle     () -> std::wstring;
+    auto SpawnProcess  (std::uint32_t path) -> ProcessId;
+    auto RemoveProcess (size_t index) -> void;
+
+    auto ApplyEvent    (Stream stream) -> void;
+    auto SwitchTrigger (ScannerKind kind) -> void;
+
+    // Expects mMutex to be held.
+    auto SyncLocked    () -> void;
+    auto AdvanceLocked (Clock::time_point to) -> void;
+    auto ObserveLocked (ScannerKind kind) -> void;
+
+public:
+    explicit SyntheticWorkload (SyntheticWorkloadOptions options);
+
+    SyntheticWorkload            (const SyntheticWorkload& rhs) = delete;
+    SyntheticWorkload& operator= (const SyntheticWorkload& rhs) = delete;
+
+    // Only with ManualClock, otherwise workload follows steady clock.
+    auto Advance (Clock::duration duration) -> void;
+
+    auto GetOptions () const -> const SyntheticWorkloadOptions&
+    {
+        return mOptions;
+    }
+
+    auto IsTriggerPresent (ScannerKind kind) const -> bool;
+
+    // Sources share workload, any number of them can be used from any thread.
+    auto CreateProcessSource   () -> ProcessSourcePtr;
+    auto CreateWindowSource    () -> WindowSourcePtr;
+    auto CreateUsbDeviceSource () -> UsbDeviceSourcePtr;
+    auto CreateBluetoothSource () -> BluetoothSourcePtr;
+
+    // Used by sources.
+    auto EnumerateProcesses (std::vector<ProcessRecord>& list) -> bool;
+    auto QueryImagePath     (ProcessId pid, std::wstring& path) -> bool;
+    auto EnumerateWindows   (const WindowSource::Visitor& visitor) -> bool;
+    auto EnumerateUsb       (const UsbDeviceSource::Visitor& visitor) -> bool;
+    auto EnumerateBluetooth (const BluetoothSource::Visitor& visitor) -> bool;
+
+    // Time from trigger switching on until a scanner was first handed it.
+    static auto GetDetectionHistogram (ScannerKind kind) -> LatencyHistogram&;
+
+    // Once installed, Create*Source() factories hand out synthetic sources.
+    // Install before scanners are created.
+    static auto Install      (std::shared_ptr<SyntheticWorkload> workload) -> void;
+    static auto GetInstalled () -> std::shared_ptr<SyntheticWorkload>;
+};
+
+} // namespace CaffeineTake
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
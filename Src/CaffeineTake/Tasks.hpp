@@ -51,5 +51,6 @@ static constexpr auto TASK_ENABLE_TIMER_MODE    = Task(L"/task:EnableTimerMode",
 static constexpr auto TASK_SHOW_SETTINGS_DIALOG = Task(L"/task:Settings",           5);
 static constexpr auto TASK_SHOW_ABOUT_DIALOG    = Task(L"/task:About",              6);
 static constexpr auto TASK_EXIT                 = Task(L"/task:Exit",               7);
+static constexpr auto TASK_TOGGLE_TRACE         = Task(L"/task:Trace",              8);
 
 } // namespace CaffeineTake
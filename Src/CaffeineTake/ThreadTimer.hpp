@@ -20,19 +20,27 @@
 
 #pragma once
 
+#include "TimerService.hpp"
+#include "Tracing.hpp"
+
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <mutex>
 #include <thread>
 
 namespace CaffeineTake {
 
 class ThreadTimer;
+class ScanTick;
 
 class StopToken final
 {
     friend class ThreadTimer;
+    friend class ScanTick;
 
     std::atomic<bool> mStopAtomic;
 
@@ -106,6 +114,9 @@ public:
     }
 };
 
+// Periodic callback driven by TimerService. Callback runs on service worker
+// pool, next run is scheduled interval after previous one returns, so runs
+// of one timer never overlap.
 class ThreadTimer
 {
 public:
@@ -113,110 +124,115 @@ public:
     using Interval   = std::chrono::milliseconds;
 
 private:
+    using Clock = TimerService::Clock;
+
     CallbackFn                mTimerCallback          = nullptr;         // return false to stop
     Interval                  mInterval               = Interval(0);
-    std::thread               mWorkerThread;
-    std::mutex                mWorkerMutex;
-    std::condition_variable   mWorkerConditionVar;
-    std::atomic<bool>         mWorkerRunning          = false;
-    std::atomic<bool>         mIsDone                 = true;
-    std::atomic<bool>         mIsPaused               = false;
-    std::atomic<bool>         mIsWaiting              = false;
-    std::atomic<bool>         mInCallback             = false;
-    const bool                mRunCallbackImmediately = false;           // run callback immediately after worker start
+    Interval                  mNextInterval           = Interval(0);    // one-off override for next run
+    std::mutex                mTimerMutex;
+    std::condition_variable   mTimerConditionVar;
+    TimerService::TaskId      mTaskId                 = 0;
+    size_t                    mOutstanding            = 0;               // scheduled or running Fire() calls
+    std::uint64_t             mGeneration             = 0;               // bumped to invalidate scheduled Fire()
+    std::thread::id           mCallbackThread         = std::thread::id();
+    bool                      mIsDone                 = true;
+    bool                      mIsPaused               = false;
+    bool                      mInCallback             = false;
+    bool                      mWakeRequested          = false;
+    const bool                mRunCallbackImmediately = false;           // run callback immediately after start
     StopToken                 mStopToken              = StopToken();
     PauseToken                mPauseToken             = PauseToken();
 
-    auto Worker () -> void
+    // Expects mTimerMutex to be held.
+    auto ScheduleLocked (Clock::time_point due) -> void
+    {
+        const auto generation = mGeneration;
+
+        mOutstanding += 1;
+        mTaskId = TimerService::Get().Schedule(
+            due,
+            [this, generation]
+            {
+                Fire(generation);
+            }
+        );
+    }
+
+    // Expects mTimerMutex to be held.
+    auto CancelLocked () -> void
     {
+        if (mTaskId != 0 && TimerService::Get().Cancel(mTaskId))
         {
-            auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
-            mWorkerRunning = true;
+            mOutstanding -= 1;
         }
 
-        auto result = true;
-        if (mRunCallbackImmediately)
+        mTaskId = 0;
+    }
+
+    auto Fire (std::uint64_t generation) -> void
+    {
         {
+            auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
+
+            if (generation != mGeneration || mIsDone || mIsPaused)
             {
-                auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
-                mInCallback = true;
+                mOutstanding -= 1;
+                mTimerConditionVar.notify_all();
+                return;
             }
+
+            mTaskId         = 0;
+            mInCallback     = true;
+            mCallbackThread = std::this_thread::get_id();
+        }
+
+        auto result = false;
+        {
+            TRACE_SCOPE("ThreadTimer", "timer");
             result = mTimerCallback(mStopToken, mPauseToken);
-            {
-                auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
-                mInCallback = false;
-            }
         }
 
-        if (result)
+        // Notify under lock, Stop() may destroy us right after we release it.
+        auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
+
+        mInCallback     = false;
+        mCallbackThread = std::thread::id();
+        mOutstanding   -= 1;
+
+        if (!result)
         {
-            while (true)
-            {
-                // Wait for specific interval.
-                {
-                    auto waitLock  = std::unique_lock<std::mutex>(mWorkerMutex);
-                    mIsWaiting = true;
-                    mWorkerConditionVar.wait_for(
-                        waitLock,
-                        mInterval,
-                        [&]
-                        {
-                            return mIsPaused || mIsDone; // return false to continue wait
-                        }
-                    );
-                    mIsWaiting = false;
-                }
-
-                // Check if we finished.
-                mWorkerMutex.lock();
-                if (mIsDone)
-                {
-                    mWorkerMutex.unlock();
-                    break;
-                }
-
-                if (mIsPaused)
-                {
-                    mWorkerMutex.unlock();
-                    {
-                        auto waitLock  = std::unique_lock<std::mutex>(mWorkerMutex);
-                        mWorkerConditionVar.wait(
-                            waitLock,
-                            [&]
-                            {
-                                return !mIsPaused || mIsDone; // return false to continue wait
-                            }
-                        );
-                    }
-                    mWorkerMutex.lock();
-                }
-                else
-                {
-                    mInCallback = true;
-                    mWorkerMutex.unlock();
-                    if (!mTimerCallback(mStopToken, mPauseToken))
-                    {
-                        break;
-                    }
-                    mWorkerMutex.lock();
-                    mInCallback = false;
-                }
-                
-                // Check if we finished.
-                if (mIsDone)
-                {
-                    mWorkerMutex.unlock();
-                    break;
-                }
-
-                mWorkerMutex.unlock();
-            }
+            mIsDone = true;
+        }
+        else if (generation == mGeneration && !mIsDone && !mIsPaused)
+        {
+            const auto delay = mWakeRequested
+                ? Interval(0)
+                : mNextInterval > Interval(0) ? mNextInterval : mInterval;
+
+            ScheduleLocked(Clock::now() + delay);
         }
 
+        mNextInterval  = Interval(0);
+        mWakeRequested = false;
+
+        mTimerConditionVar.notify_all();
+    }
+
+    // Expects lock on mTimerMutex. Don't wait on ourself when called from callback.
+    auto WaitForCallbacks (std::unique_lock<std::mutex>& lock) -> void
+    {
+        if (mCallbackThread == std::this_thread::get_id())
         {
-            auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
-            mWorkerRunning = false;
+            return;
         }
+
+        mTimerConditionVar.wait(
+            lock,
+            [&]
+            {
+                return mOutstanding == 0;
+            }
+        );
     }
 
     ThreadTimer            (const ThreadTimer& rhs) = delete;
@@ -248,104 +264,89 @@ public:
 
     auto Start () -> bool
     {
-        auto result = true;
+        auto waitLock = std::unique_lock<std::mutex>(mTimerMutex);
 
-        if (mInterval <= Interval(0))
+        if (mInterval <= Interval(0) || mTimerCallback == nullptr)
         {
-            result = false;
+            return false;
         }
-        else if (mTimerCallback == nullptr)
+
+        if (mIsDone)
         {
-            result = false;
+            // Callback from previous run may still be finishing.
+            WaitForCallbacks(waitLock);
+
+            mStopToken.Reset();
+            mPauseToken.Reset();
+
+            mIsDone        = false;
+            mIsPaused      = false;
+            mNextInterval  = Interval(0);
+            mWakeRequested = false;
+            mGeneration   += 1;
+
+            ScheduleLocked(mRunCallbackImmediately ? Clock::now() : Clock::now() + mInterval);
         }
-        else
+
+        if (mIsPaused)
         {
-            auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+            mIsPaused = false;
+            mPauseToken.Reset();
 
-            if (mIsDone)
+            if (mInCallback)
             {
-                // If worker quit from callback, we need to join.
-                if (mWorkerThread.joinable())
-                {
-                    mWorkerThread.join();
-                }
-
-                mStopToken.Reset();
-                mPauseToken.Reset();
-
-                mIsDone       = false;
-                mIsPaused     = false;
-                mWorkerThread = std::thread(&ThreadTimer::Worker, this);
+                // Callback reschedules itself when it returns.
+                mPauseToken.Notify();
             }
-
-            if (mIsPaused)
+            else
             {
-                mIsPaused = false;
-                mPauseToken.Reset();
-
-                if (mInCallback)
-                {
-                    mPauseToken.Notify();
-                }
-                else
-                {
-                    mWorkerConditionVar.notify_one();
-                }
+                mGeneration += 1;
+                CancelLocked();
+                ScheduleLocked(Clock::now() + mInterval);
             }
         }
 
-        return result;
+        return true;
     }
 
     auto Stop () -> void
     {
-        {
-            auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
-        
-            mIsDone = true;
-            mStopToken.Stop();
+        auto waitLock = std::unique_lock<std::mutex>(mTimerMutex);
 
-            if (mIsPaused)
-            {
-                mIsPaused = false;
-                mPauseToken.Reset();
-            
-                if (mInCallback)
-                {
-                    mPauseToken.Notify();
-                }
-                else
-                {
-                    mWorkerConditionVar.notify_one();
-                }
-            }
+        mIsDone      = true;
+        mGeneration += 1;
+        mStopToken.Stop();
 
-            if (mIsWaiting)
+        if (mIsPaused)
+        {
+            mIsPaused = false;
+            mPauseToken.Reset();
+
+            if (mInCallback)
             {
-                mWorkerConditionVar.notify_one();
+                mPauseToken.Notify();
             }
         }
 
-        if (mWorkerThread.joinable())
-        {
-            mWorkerThread.join();
-        }
+        CancelLocked();
+        WaitForCallbacks(waitLock);
     }
 
     auto Pause () -> void
     {
-        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+        auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
 
         if (!mIsDone && !mIsPaused)
         {
             mIsPaused = true;
             mPauseToken.Pause();
+            CancelLocked();
         }
     }
 
     auto SetCallback (CallbackFn callback) -> bool
     {
-        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+        auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
 
         if (mIsDone)
         {
@@ -355,16 +356,47 @@ public:
         return mIsDone;
     }
 
+    // Running timer uses new interval from next scheduled run on, Wake()
+    // applies it right away.
     auto SetInterval (Interval interval) -> bool
     {
-        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+        auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
 
-        if (mIsDone)
+        if (interval <= Interval(0))
         {
-            mInterval = interval;
+            return false;
         }
 
-        return mIsDone;
+        mInterval = interval;
+        return true;
+    }
+
+    // Delay before next run only, call from callback. Interval is used again afterwards.
+    auto SetNextInterval (Interval interval) -> void
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
+        mNextInterval = interval;
+    }
+
+    // Run callback as soon as possible, or right after current one returns.
+    auto Wake () -> void
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
+
+        if (mIsDone || mIsPaused)
+        {
+            return;
+        }
+
+        if (mInCallback)
+        {
+            mWakeRequested = true;
+            return;
+        }
+
+        mGeneration += 1;
+        CancelLocked();
+        ScheduleLocked(Clock::now());
     }
 
     auto GetInterval () const -> Interval
@@ -374,19 +406,19 @@ public:
 
     auto IsRunning () -> bool
     {
-        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+        auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
         return !mIsDone;
     }
 
     auto IsPaused () -> bool
     {
-        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+        auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
         return !mIsDone && mIsPaused;
     }
 
     auto IsStopped () -> bool
     {
-        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+        auto lockGuard = std::lock_guard<std::mutex>(mTimerMutex);
         return mIsDone;
     }
 };
@@ -0,0 +1,164 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "TimerService.hpp"
+
+#include "Diagnostics.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace CaffeineTake {
+
+TimerService::~TimerService ()
+{
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mServiceMutex);
+        mIsDone = true;
+    }
+
+    mServiceConditionVar.notify_one();
+
+    if (mServiceThread.joinable())
+    {
+        mServiceThread.join();
+    }
+
+    mPool.Stop();
+}
+
+auto TimerService::Get () -> TimerService&
+{
+    static auto instance = TimerService();
+    return instance;
+}
+
+auto TimerService::Service () -> void
+{
+    DIAG_THREAD("TimerService");
+
+    auto waitLock = std::unique_lock<std::mutex>(mServiceMutex);
+    while (!mIsDone)
+    {
+        DIAG_SCOPE(Subsystem::Service);
+
+        if (mDeadlines.empty())
+        {
+            mServiceConditionVar.wait(waitLock);
+            continue;
+        }
+
+        const auto next = mDeadlines.front();
+        if (Clock::now() < next.Due)
+        {
+            // Woken up early by new deadline or shutdown.
+            mServiceConditionVar.wait_until(waitLock, next.Due);
+            continue;
+        }
+
+        std::pop_heap(mDeadlines.begin(), mDeadlines.end(), std::greater<Deadline>());
+        mDeadlines.pop_back();
+
+        auto it = mTasks.find(next.Id);
+        if (it == mTasks.end())
+        {
+            mCancelled -= 1;
+            continue;
+        }
+
+        auto task = std::move(it->second);
+        mTasks.erase(it);
+
+        waitLock.unlock();
+        mPool.Submit(std::move(task));
+        waitLock.lock();
+    }
+}
+
+auto TimerService::Schedule (Clock::time_point due, Task task) -> TaskId
+{
+    auto id = TaskId{0};
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mServiceMutex);
+
+        if (!mIsRunning)
+        {
+            mPool.Start(PoolSize);
+            mServiceThread = std::thread(&TimerService::Service, this);
+            mIsRunning     = true;
+        }
+
+        id = mNextId++;
+        mTasks.emplace(id, std::move(task));
+        mDeadlines.push_back(Deadline{ due, id });
+        std::push_heap(mDeadlines.begin(), mDeadlines.end(), std::greater<Deadline>());
+    }
+
+    mServiceConditionVar.notify_one();
+
+    return id;
+}
+
+auto TimerService::CompactLocked () -> void
+{
+    if (mCancelled <= mDeadlines.size() - mCancelled)
+    {
+        return;
+    }
+
+    std::erase_if(
+        mDeadlines,
+        [this] (const Deadline& deadline)
+        {
+            return !mTasks.contains(deadline.Id);
+        }
+    );
+    std::make_heap(mDeadlines.begin(), mDeadlines.end(), std::greater<Deadline>());
+
+    mCancelled = 0;
+}
+
+auto TimerService::Cancel (TaskId id) -> bool
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mServiceMutex);
+    if (mTasks.erase(id) == 0)
+    {
+        return false;
+    }
+
+    // Deadline stays in heap until due, timers rescheduling far ahead would
+    // pile them up.
+    mCancelled += 1;
+    CompactLocked();
+
+    return true;
+}
+
+auto TimerService::GetDeadlineCount () -> size_t
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mServiceMutex);
+    return mDeadlines.size();
+}
+
+} // namespace CaffeineTake
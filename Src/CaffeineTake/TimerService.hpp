@@ -0,0 +1,103 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "WorkerPool.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace CaffeineTake {
+
+// One thread keeping a min-heap of deadlines for every timer in the process.
+// Due tasks never run on that thread, they are handed to a small worker
+// pool so long callbacks don't delay other timers.
+class TimerService final
+{
+public:
+    using Clock  = std::chrono::steady_clock;
+    using Task   = std::function<void ()>;
+    using TaskId = std::uint64_t;
+
+private:
+    struct Deadline
+    {
+        Clock::time_point Due;
+        TaskId            Id;
+
+        auto operator> (const Deadline& rhs) const -> bool
+        {
+            return Due > rhs.Due;
+        }
+    };
+
+    // Min-heap kept with std::push_heap/pop_heap, so it can be compacted.
+    using DeadlineHeap = std::vector<Deadline>;
+
+    // Callbacks must not block, long work goes to its own executor (scanners
+    // run on scan pool). Two workers keep one slow callback from delaying
+    // the rest.
+    static constexpr auto PoolSize = size_t{2};
+
+    std::thread                        mServiceThread;
+    std::mutex                         mServiceMutex;
+    std::condition_variable            mServiceConditionVar;
+    DeadlineHeap                       mDeadlines    = DeadlineHeap();
+    std::unordered_map<TaskId, Task>   mTasks        = std::unordered_map<TaskId, Task>();   // cancelled tasks are removed only from here
+    size_t                             mCancelled    = 0;    // dead entries in mDeadlines
+    TaskId                             mNextId       = 1;
+    bool                               mIsRunning    = false;
+    bool                               mIsDone       = false;
+    WorkerPool                         mPool;
+
+    auto Service () -> void;
+
+    // Expects mServiceMutex to be held. Drops deadlines of cancelled tasks
+    // once they outnumber live ones.
+    auto CompactLocked () -> void;
+
+    TimerService () = default;
+
+    TimerService            (const TimerService& rhs) = delete;
+    TimerService& operator= (const TimerService& rhs) = delete;
+
+public:
+    ~TimerService ();
+
+    static auto Get () -> TimerService&;
+
+    // Run task on worker pool at due time. Returns id for Cancel.
+    auto Schedule (Clock::time_point due, Task task) -> TaskId;
+
+    // Returns false if task already went to the pool (or never existed).
+    auto Cancel (TaskId id) -> bool;
+
+    // Deadlines held including cancelled ones not yet dropped.
+    auto GetDeadlineCount () -> size_t;
+};
+
+} // namespace CaffeineTake
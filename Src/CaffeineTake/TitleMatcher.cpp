@@ -0,0 +1,337 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "TitleMatcher.hpp"
+
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CaffeineTake {
+
+#pragma region "GlobSet"
+
+auto GlobSet::AddClosure (StateSet& set, std::uint32_t state) const -> void
+{
+    set.push_back(state);
+
+    // Star can match nothing.
+    if (mTokens[state].Type == TokenType::Star)
+    {
+        AddClosure(set, state + 1);
+    }
+}
+
+auto GlobSet::AddState (StateSet&& set) -> std::uint32_t
+{
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+
+    auto it = mStateIndex.find(set);
+    if (it != mStateIndex.end())
+    {
+        return it->second;
+    }
+
+    const auto id = static_cast<std::uint32_t>(mStateSets.size());
+
+    // Lowest pattern index wins.
+    auto accept = Unknown;
+    for (const auto state : set)
+    {
+        if (mTokens[state].Type == TokenType::Accept)
+        {
+            accept = std::min(accept, mTokens[state].Pattern);
+        }
+    }
+
+    mAcceptOf.push_back(accept);
+    mTransitions.resize(mTransitions.size() + mClassCount, Unknown);
+    mStateIndex.emplace(set, id);
+    mStateSets.push_back(std::move(set));
+
+    return id;
+}
+
+auto GlobSet::Step (std::uint32_t state, std::uint32_t klass) -> std::uint32_t
+{
+    auto next = StateSet();
+    for (const auto nfaState : mStateSets[state])
+    {
+        const auto& token = mTokens[nfaState];
+        switch (token.Type)
+        {
+        case TokenType::Char:
+            if (token.Class == klass)
+            {
+                AddClosure(next, nfaState + 1);
+            }
+            break;
+
+        case TokenType::Any:
+            AddClosure(next, nfaState + 1);
+            break;
+
+        case TokenType::Star:
+            AddClosure(next, nfaState);
+            break;
+
+        case TokenType::Accept:
+            break;
+        }
+    }
+
+    // Out of room, start over. Transition is not cached then.
+    if (mStateSets.size() >= MaxStates)
+    {
+        Flush();
+        return AddState(std::move(next));
+    }
+
+    const auto id = AddState(std::move(next));
+    mTransitions[static_cast<size_t>(state) * mClassCount + klass] = id;
+
+    return id;
+}
+
+auto GlobSet::Flush () -> void
+{
+    mStateSets.clear();
+    mStateIndex.clear();
+    mTransitions.clear();
+    mAcceptOf.clear();
+
+    mStart   = AddState(StateSet(mStartSet));
+    mDead    = AddState(StateSet());
+    mIsStale = false;
+}
+
+auto GlobSet::Clear () -> void
+{
+    mTokens.clear();
+    mClassOf.clear();
+    mClassCount = 1;
+    mStartSet.clear();
+    mPatterns   = 0;
+
+    Flush();
+}
+
+auto GlobSet::Add (const std::wstring_view pattern) -> void
+{
+    const auto index = static_cast<std::uint32_t>(mPatterns);
+    const auto first = static_cast<std::uint32_t>(mTokens.size());
+
+    auto escaped = false;
+    for (const auto c : pattern)
+    {
+        if (!escaped && c == L'\\')
+        {
+            escaped = true;
+            continue;
+        }
+
+        auto token = Token{ TokenType::Char, 0, index };
+        if (!escaped && c == L'*')
+        {
+            // Consecutive stars are the same as one.
+            if (mTokens.size() > first && mTokens.back().Type == TokenType::Star)
+            {
+                continue;
+            }
+
+            token.Type = TokenType::Star;
+        }
+        else if (!escaped && c == L'?')
+        {
+            token.Type = TokenType::Any;
+        }
+        else
+        {
+            auto [it, inserted] = mClassOf.try_emplace(c, mClassCount);
+            if (inserted)
+            {
+                mClassCount += 1;
+            }
+
+            token.Class = it->second;
+        }
+
+        mTokens.push_back(token);
+        escaped = false;
+    }
+
+    mTokens.push_back(Token{ TokenType::Accept, 0, index });
+
+    AddClosure(mStartSet, first);
+    mPatterns += 1;
+
+    // Alphabet may have grown, cached states are stale.
+    mIsStale = true;
+}
+
+auto GlobSet::Match (const std::wstring_view input) -> std::optional<size_t>
+{
+    if (mPatterns == 0)
+    {
+        return std::nullopt;
+    }
+
+    if (mIsStale)
+    {
+        Flush();
+    }
+
+    auto state = mStart;
+    for (const auto c : input)
+    {
+        const auto it    = mClassOf.find(c);
+        const auto klass = it != mClassOf.end() ? it->second : 0;
+
+        auto next = mTransitions[static_cast<size_t>(state) * mClassCount + klass];
+        if (next == Unknown)
+        {
+            next = Step(state, klass);
+        }
+
+        state = next;
+
+        if (state == mDead)
+        {
+            return std::nullopt;
+        }
+    }
+
+    if (mAcceptOf[state] == Unknown)
+    {
+        return std::nullopt;
+    }
+
+    return mAcceptOf[state];
+}
+
+#pragma endregion
+
+#pragma region "TitleMatcher"
+
+auto TitleMatcher::Rebuild () -> void
+{
+    mExact.clear();
+    mGlobs.Clear();
+    mGlobTrigger.clear();
+    mRegexes.clear();
+
+    for (auto i = size_t{0}; i < mTriggers.size(); ++i)
+    {
+        const auto trigger = std::wstring_view(mTriggers[i]);
+        if (trigger.empty())
+        {
+            continue;
+        }
+
+        if (trigger.starts_with(GlobPrefix))
+        {
+            mGlobs.Add(trigger.substr(GlobPrefix.size()));
+            mGlobTrigger.push_back(i);
+        }
+        else if (trigger.starts_with(RegexPrefix))
+        {
+            try
+            {
+                mRegexes.push_back(
+                    Regex{
+                        i,
+                        std::wregex(
+                            std::wstring(trigger.substr(RegexPrefix.size())),
+                            std::regex_constants::ECMAScript | std::regex_constants::optimize
+                        )
+                    }
+                );
+            }
+            catch (const std::regex_error& e)
+            {
+                LOG_WARNING(L"Invalid window trigger regex '{}', ignored", trigger);
+                LOG_DEBUG("what() {}", e.what());
+            }
+        }
+        else
+        {
+            mExact.try_emplace(mTriggers[i], i);
+        }
+    }
+}
+
+auto TitleMatcher::Update (const std::vector<std::wstring>& triggers) -> bool
+{
+    if (triggers == mTriggers)
+    {
+        return false;
+    }
+
+    mTriggers = triggers;
+    Rebuild();
+
+    return true;
+}
+
+auto TitleMatcher::Match (const std::wstring_view title) -> const std::wstring*
+{
+    if (title.empty())
+    {
+        return nullptr;
+    }
+
+    if (!mExact.empty())
+    {
+        const auto it = mExact.find(title);
+        if (it != mExact.end())
+        {
+            return &mTriggers[it->second];
+        }
+    }
+
+    if (!mGlobs.IsEmpty())
+    {
+        const auto index = mGlobs.Match(title);
+        if (index)
+        {
+            return &mTriggers[mGlobTrigger[index.value()]];
+        }
+    }
+
+    for (const auto& regex : mRegexes)
+    {
+        if (std::regex_search(title.begin(), title.end(), regex.Expression))
+        {
+            return &mTriggers[regex.Trigger];
+        }
+    }
+
+    return nullptr;
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
@@ -0,0 +1,151 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace CaffeineTake {
+
+// Set of wildcard patterns ('*' any run, '?' any character, '\' escapes)
+// matched in one pass over the input. Patterns form a single NFA, DFA states
+// are built lazily from it and cached, so cost per character doesn't grow
+// with number of patterns once the cache is warm.
+class GlobSet final
+{
+    enum class TokenType : unsigned char
+    {
+        Char,
+        Any,
+        Star,
+        Accept
+    };
+
+    struct Token
+    {
+        TokenType     Type    = TokenType::Accept;
+        std::uint32_t Class   = 0;  // character class for Char
+        std::uint32_t Pattern = 0;
+    };
+
+    using StateSet = std::vector<std::uint32_t>;
+
+    static constexpr auto Unknown   = UINT32_MAX;
+    static constexpr auto MaxStates = size_t{4096};   // cache is flushed when full
+
+    // NFA.
+    std::vector<Token>                           mTokens      = std::vector<Token>();
+    std::unordered_map<wchar_t, std::uint32_t>   mClassOf     = std::unordered_map<wchar_t, std::uint32_t>();
+    std::uint32_t                                mClassCount  = 1;   // class 0 is every other character
+    StateSet                                     mStartSet    = StateSet();
+    size_t                                       mPatterns    = 0;
+
+    // Lazy DFA.
+    std::vector<StateSet>                        mStateSets   = std::vector<StateSet>();
+    std::map<StateSet, std::uint32_t>            mStateIndex  = std::map<StateSet, std::uint32_t>();
+    std::vector<std::uint32_t>                   mTransitions = std::vector<std::uint32_t>();
+    std::vector<std::uint32_t>                   mAcceptOf    = std::vector<std::uint32_t>();
+    std::uint32_t                                mStart       = 0;
+    std::uint32_t                                mDead        = 0;
+    bool                                         mIsStale     = false;
+
+    auto AddClosure (StateSet& set, std::uint32_t state) const -> void;
+    auto AddState   (StateSet&& set) -> std::uint32_t;
+    auto Step       (std::uint32_t state, std::uint32_t klass) -> std::uint32_t;
+    auto Flush      () -> void;
+
+public:
+    auto Clear () -> void;
+    auto Add   (const std::wstring_view pattern) -> void;
+
+    // Index (in order of Add) of a pattern matching whole input.
+    auto Match (const std::wstring_view input) -> std::optional<size_t>;
+
+    auto GetCachedStates () const -> size_t
+    {
+        return mStateSets.size();
+    }
+
+    auto IsEmpty () const -> bool
+    {
+        return mPatterns == 0;
+    }
+};
+
+// Precompiled form of Settings::Auto::TriggerWindow::Windows.
+// Plain entries are matched exactly through a hashed set, entries prefixed
+// with "glob:" go to GlobSet and match whole title, entries prefixed with
+// "regex:" are ECMAScript expressions searched anywhere in the title.
+// Regular expressions are tried one by one, keep them few.
+class TitleMatcher final
+{
+    struct KeyHash
+    {
+        using is_transparent = void;
+
+        auto operator() (const std::wstring_view key) const noexcept -> std::size_t
+        {
+            return std::hash<std::wstring_view>()(key);
+        }
+    };
+
+    using ExactMap = std::unordered_map<std::wstring, size_t, KeyHash, std::equal_to<>>;
+
+    struct Regex
+    {
+        size_t      Trigger;
+        std::wregex Expression;
+    };
+
+    std::vector<std::wstring> mTriggers    = std::vector<std::wstring>();
+    ExactMap                  mExact       = ExactMap();
+    GlobSet                   mGlobs       = GlobSet();
+    std::vector<size_t>       mGlobTrigger = std::vector<size_t>();   // glob index -> trigger index
+    std::vector<Regex>        mRegexes     = std::vector<Regex>();
+
+    auto Rebuild () -> void;
+
+public:
+    static constexpr auto GlobPrefix  = std::wstring_view(L"glob:");
+    static constexpr auto RegexPrefix = std::wstring_view(L"regex:");
+
+    // Returns true if matcher was rebuilt. Compares lists, call it only
+    // when settings snapshot changes.
+    auto Update (const std::vector<std::wstring>& triggers) -> bool;
+
+    // Returns matching trigger or nullptr.
+    auto Match (const std::wstring_view title) -> const std::wstring*;
+
+    auto IsEmpty () const -> bool
+    {
+        return mExact.empty() && mGlobs.IsEmpty() && mRegexes.empty();
+    }
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,265 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "Tracing.hpp"
+
+#if defined(FEATURE_CAFFEINETAKE_TRACING)
+
+#include "Logger.hpp"
+#include "Persistence.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#elif defined(__linux__)
+#   include <unistd.h>
+#endif
+
+namespace {
+    auto CurrentThreadId () -> std::uint64_t
+    {
+#if defined(_WIN32)
+        return ::GetCurrentThreadId();
+#else
+        return static_cast<std::uint64_t>(::gettid());
+#endif
+    }
+
+    auto CurrentProcessId () -> std::uint64_t
+    {
+#if defined(_WIN32)
+        return ::GetCurrentProcessId();
+#else
+        return static_cast<std::uint64_t>(::getpid());
+#endif
+    }
+
+    auto AppendString (std::string& out, const std::string_view text) -> void
+    {
+        out.push_back('"');
+        for (const auto c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out.push_back('\\');
+                out.push_back(c);
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out.push_back(' ');
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+        out.push_back('"');
+    }
+
+    // Chrome wants microseconds, keep ns precision as fraction.
+    auto AppendMicroseconds (std::string& out, const std::int64_t ns) -> void
+    {
+        out.append(std::to_string(ns / 1000));
+
+        const auto fraction = ns % 1000;
+        if (fraction != 0)
+        {
+            const auto digits = std::to_string(1000 + fraction);
+            out.push_back('.');
+            out.append(digits, 1, 3);
+        }
+    }
+}
+
+namespace CaffeineTake {
+
+auto Tracer::Get () -> Tracer&
+{
+    static auto instance = Tracer();
+    return instance;
+}
+
+auto Tracer::LocalBuffer () -> ThreadBuffer&
+{
+    // Registry keeps buffer alive after thread exits, so its events still
+    // make it into the trace.
+    thread_local auto buffer = [this]
+    {
+        auto ptr = std::make_shared<ThreadBuffer>();
+        ptr->ThreadId = CurrentThreadId();
+
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+        mBuffers.push_back(ptr);
+
+        return ptr;
+    }();
+
+    return *buffer;
+}
+
+auto Tracer::Start () -> void
+{
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+        // Buffers only we hold belong to threads that are gone.
+        std::erase_if(mBuffers, [](const ThreadBufferPtr& buffer) { return buffer.use_count() == 1; });
+
+        for (const auto& buffer : mBuffers)
+        {
+            auto bufferLock = std::lock_guard<std::mutex>(buffer->Mutex);
+            buffer->Events.clear();
+            buffer->Dropped = 0;
+        }
+    }
+
+    mIsRecording.store(true, std::memory_order_relaxed);
+    LOG_INFO("Trace recording started");
+}
+
+auto Tracer::Stop () -> void
+{
+    mIsRecording.store(false, std::memory_order_relaxed);
+    LOG_INFO("Trace recording stopped");
+}
+
+auto Tracer::Record (const TraceEvent& event) -> void
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+
+    auto& buffer    = LocalBuffer();
+    auto  lockGuard = std::lock_guard<std::mutex>(buffer.Mutex);
+
+    if (buffer.Events.size() >= MaxEventsPerThread)
+    {
+        buffer.Dropped += 1;
+        return;
+    }
+
+    buffer.Events.push_back(event);
+}
+
+auto Tracer::SetThreadName (const char* name) -> void
+{
+    auto& buffer    = LocalBuffer();
+    auto  lockGuard = std::lock_guard<std::mutex>(buffer.Mutex);
+
+    buffer.Name = name;
+}
+
+auto Tracer::WriteChromeJson (std::string& out) -> void
+{
+    const auto pid = std::to_string(CurrentProcessId());
+
+    auto first  = true;
+    auto append = [&](const TraceEvent& event, const std::uint64_t tid)
+    {
+        out.append(first ? "\n" : ",\n");
+        first = false;
+
+        out.append("{\"name\":");
+        AppendString(out, event.Name);
+        out.append(",\"cat\":");
+        AppendString(out, event.Category);
+
+        if (event.Duration >= 0)
+        {
+            out.append(",\"ph\":\"X\",\"ts\":");
+            AppendMicroseconds(out, event.Start);
+            out.append(",\"dur\":");
+            AppendMicroseconds(out, event.Duration);
+        }
+        else
+        {
+            out.append(",\"ph\":\"i\",\"s\":\"t\",\"ts\":");
+            AppendMicroseconds(out, event.Start);
+        }
+
+        out.append(",\"pid\":").append(pid);
+        out.append(",\"tid\":").append(std::to_string(tid));
+
+        if (event.Arg)
+        {
+            out.append(",\"args\":{\"detail\":");
+            AppendString(out, event.Arg);
+            out.push_back('}');
+        }
+
+        out.push_back('}');
+    };
+
+    out.append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    for (const auto& buffer : mBuffers)
+    {
+        auto bufferLock = std::lock_guard<std::mutex>(buffer->Mutex);
+
+        if (buffer->Name)
+        {
+            out.append(first ? "\n" : ",\n");
+            first = false;
+
+            out.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":").append(pid);
+            out.append(",\"tid\":").append(std::to_string(buffer->ThreadId));
+            out.append(",\"args\":{\"name\":");
+            AppendString(out, buffer->Name);
+            out.append("}}");
+        }
+
+        for (const auto& event : buffer->Events)
+        {
+            append(event, buffer->ThreadId);
+        }
+
+        if (buffer->Dropped > 0)
+        {
+            LOG_WARNING("Trace buffer of thread {} was full, dropped {} events", buffer->ThreadId, buffer->Dropped);
+        }
+    }
+
+    out.append("\n]}\n");
+}
+
+auto Tracer::Save (const std::filesystem::path& path) -> bool
+{
+    auto json = std::string();
+    WriteChromeJson(json);
+
+    if (!WriteFileAtomic(path, json))
+    {
+        return false;
+    }
+
+    LOG_INFO(L"Trace written to '{}'", path.wstring());
+    return true;
+}
+
+} // namespace CaffeineTake
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_TRACING)
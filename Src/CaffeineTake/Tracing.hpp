@@ -0,0 +1,167 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Config.hpp"
+
+#if defined(FEATURE_CAFFEINETAKE_TRACING)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace CaffeineTake {
+
+// Names, categories and args must have static storage duration, only
+// pointers are kept.
+struct TraceEvent
+{
+    const char*  Name     = "";
+    const char*  Category = "";
+    const char*  Arg      = nullptr;   // shown as args.detail
+    std::int64_t Start    = 0;         // ns since tracer creation
+    std::int64_t Duration = -1;        // ns, -1 for instant event
+};
+
+// Collects events into per thread buffers while recording. When not
+// recording span costs one relaxed load. Events are exported as Chrome
+// trace JSON, which both chrome://tracing and ui.perfetto.dev open.
+class Tracer final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Events past this are dropped until next Start.
+    static constexpr auto MaxEventsPerThread = size_t{1} << 16;
+
+private:
+    struct ThreadBuffer
+    {
+        std::mutex              Mutex;
+        std::vector<TraceEvent> Events   = std::vector<TraceEvent>();
+        std::uint64_t           Dropped  = 0;
+        std::uint64_t           ThreadId = 0;
+        const char*             Name     = nullptr;
+    };
+
+    using ThreadBufferPtr = std::shared_ptr<ThreadBuffer>;
+
+    std::atomic<bool>            mIsRecording = false;
+    const Clock::time_point      mEpoch       = Clock::now();
+    std::mutex                   mMutex;
+    std::vector<ThreadBufferPtr> mBuffers     = std::vector<ThreadBufferPtr>();
+
+    auto LocalBuffer () -> ThreadBuffer&;
+
+    Tracer () = default;
+
+    Tracer            (const Tracer& rhs) = delete;
+    Tracer& operator= (const Tracer& rhs) = delete;
+
+public:
+    static auto Get () -> Tracer&;
+
+    auto IsRecording () const -> bool
+    {
+        return mIsRecording.load(std::memory_order_relaxed);
+    }
+
+    auto Now () const -> std::int64_t
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - mEpoch).count();
+    }
+
+    // Drops events of previous recording.
+    auto Start () -> void;
+    auto Stop  () -> void;
+
+    auto Record        (const TraceEvent& event) -> void;
+    auto SetThreadName (const char* name) -> void;
+
+    auto WriteChromeJson (std::string& out) -> void;
+    auto Save            (const std::filesystem::path& path) -> bool;
+};
+
+// Records time from construction to end of scope as complete event.
+class TraceSpan final
+{
+    const char*  mName;
+    const char*  mCategory;
+    const char*  mArg;
+    std::int64_t mStart = -1;
+
+public:
+    explicit TraceSpan (const char* name, const char* category = "app", const char* arg = nullptr)
+        : mName     (name)
+        , mCategory (category)
+        , mArg      (arg)
+    {
+        if (Tracer::Get().IsRecording())
+        {
+            mStart = Tracer::Get().Now();
+        }
+    }
+
+    ~TraceSpan ()
+    {
+        if (mStart >= 0)
+        {
+            auto& tracer = Tracer::Get();
+            tracer.Record(TraceEvent{ mName, mCategory, mArg, mStart, tracer.Now() - mStart });
+        }
+    }
+
+    TraceSpan            (const TraceSpan& rhs) = delete;
+    TraceSpan& operator= (const TraceSpan& rhs) = delete;
+};
+
+inline auto TraceInstant (const char* name, const char* category = "app", const char* arg = nullptr) -> void
+{
+    auto& tracer = Tracer::Get();
+    if (tracer.IsRecording())
+    {
+        tracer.Record(TraceEvent{ name, category, arg, tracer.Now(), -1 });
+    }
+}
+
+} // namespace CaffeineTake
+
+#define CAFFEINETAKE_TRACE_CONCAT_(a, b) a##b
+#define CAFFEINETAKE_TRACE_CONCAT(a, b)  CAFFEINETAKE_TRACE_CONCAT_(a, b)
+
+// Tracing macros.
+#define TRACE_SCOPE(...)       const auto CAFFEINETAKE_TRACE_CONCAT(_traceSpan, __LINE__) = ::CaffeineTake::TraceSpan(__VA_ARGS__)
+#define TRACE_INSTANT(...)     ::CaffeineTake::TraceInstant(__VA_ARGS__)
+#define TRACE_THREAD_NAME(...) ::CaffeineTake::Tracer::Get().SetThreadName(__VA_ARGS__)
+
+#else
+
+// Tracing macros.
+#define TRACE_SCOPE(...)       do{}while(0)
+#define TRACE_INSTANT(...)     do{}while(0)
+#define TRACE_THREAD_NAME(...) do{}while(0)
+
+#endif // #if defined(FEATURE_CAFFEINETAKE_TRACING)
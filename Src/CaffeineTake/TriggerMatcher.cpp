@@ -0,0 +1,123 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "TriggerMatcher.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#endif
+
+namespace CaffeineTake {
+
+auto TriggerMatcher::Rebuild () -> void
+{
+    mPaths.clear();
+    mNames.clear();
+
+    for (const auto& trigger : mTriggers)
+    {
+        if (trigger.empty())
+        {
+            continue;
+        }
+
+        auto key = trigger;
+        FoldCase(key);
+
+        // Anything with a separator can only ever be equal to a full path.
+        if (FileName(key).size() != key.size())
+        {
+            mPaths.insert(std::move(key));
+        }
+        else
+        {
+            mNames.insert(std::move(key));
+        }
+    }
+}
+
+auto TriggerMatcher::Update (const std::vector<std::wstring>& triggers) -> bool
+{
+    if (triggers == mTriggers)
+    {
+        return false;
+    }
+
+    mTriggers = triggers;
+    Rebuild();
+
+    return true;
+}
+
+auto TriggerMatcher::Match (const std::wstring_view path) -> TriggerMatch
+{
+    if (path.empty() || IsEmpty())
+    {
+        return TriggerMatch::None;
+    }
+
+    mScratch.assign(path);
+    FoldCase(mScratch);
+
+    const auto key = std::wstring_view(mScratch);
+
+    if (!mPaths.empty() && mPaths.find(key) != mPaths.end())
+    {
+        return TriggerMatch::Path;
+    }
+
+    if (!mNames.empty() && mNames.find(FileName(key)) != mNames.end())
+    {
+        return TriggerMatch::Name;
+    }
+
+    return TriggerMatch::None;
+}
+
+auto TriggerMatcher::FileName (const std::wstring_view path) -> std::wstring_view
+{
+    const auto pos = path.find_last_of(L"\\/");
+    if (pos == std::wstring_view::npos)
+    {
+        return path;
+    }
+
+    return path.substr(pos + 1);
+}
+
+auto TriggerMatcher::FoldCase (std::wstring& str) -> void
+{
+#if defined(_WIN32)
+    // Same simple uppercase mapping NTFS uses for file name comparison.
+    if (!str.empty())
+    {
+        CharUpperBuffW(str.data(), static_cast<DWORD>(str.size()));
+    }
+#endif
+}
+
+} // namespace CaffeineTake
@@ -0,0 +1,79 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace CaffeineTake {
+
+enum class TriggerMatch : unsigned char
+{
+    None, // process is not on the trigger list
+    Path, // full executable path matched
+    Name  // executable name matched
+};
+
+// Precompiled form of Settings::Auto::TriggerProcess::Processes.
+// Entries are split into full paths and executable names, case-folded and
+// stored in hashed sets, so each process costs one probe per set instead of
+// a loop over every trigger. Sets are rebuilt only when the trigger list changes.
+class TriggerMatcher final
+{
+    struct KeyHash
+    {
+        using is_transparent = void;
+
+        auto operator() (const std::wstring_view key) const noexcept -> std::size_t
+        {
+            return std::hash<std::wstring_view>()(key);
+        }
+    };
+
+    using KeySet = std::unordered_set<std::wstring, KeyHash, std::equal_to<>>;
+
+    std::vector<std::wstring> mTriggers = std::vector<std::wstring>();
+    KeySet                    mPaths    = KeySet();
+    KeySet                    mNames    = KeySet();
+    std::wstring              mScratch  = std::wstring(); // folded probe key, reused between calls
+
+    auto Rebuild () -> void;
+
+public:
+    // Returns true if sets were rebuilt. Compares lists, call it only when
+    // settings snapshot changes.
+    auto Update (const std::vector<std::wstring>& triggers) -> bool;
+    auto Match  (const std::wstring_view path) -> TriggerMatch;
+
+    auto IsEmpty () const -> bool
+    {
+        return mPaths.empty() && mNames.empty();
+    }
+
+    static auto FileName (const std::wstring_view path) -> std::wstring_view;
+    static auto FoldCase (std::wstring& str) -> void;
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,68 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "UiUpdateCoalescer.hpp"
+
+#include <utility>
+
+namespace CaffeineTake {
+
+UiUpdateCoalescer::UiUpdateCoalescer (Apply apply, Clock::duration window)
+    : mApply  (std::move(apply))
+    , mWindow (window)
+{
+}
+
+auto UiUpdateCoalescer::Request (Clock::time_point now) -> bool
+{
+    mRequests += 1;
+
+    if (mIsPending)
+    {
+        return false;
+    }
+
+    mIsPending = true;
+    mDue       = now + mWindow;
+
+    return true;
+}
+
+auto UiUpdateCoalescer::Flush (Clock::time_point now) -> bool
+{
+    if (!mIsPending || now < mDue)
+    {
+        return false;
+    }
+
+    // Cleared first, apply may request again and that opens next window.
+    mIsPending = false;
+    mApplied  += 1;
+
+    if (mApply)
+    {
+        mApply();
+    }
+
+    return true;
+}
+
+} // namespace CaffeineTake
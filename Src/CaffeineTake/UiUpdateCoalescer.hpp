@@ -0,0 +1,106 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+namespace CaffeineTake {
+
+// Collapses bursts of UI refresh requests into one refresh per frame window.
+// First request after a quiet period opens a window, requests arriving until
+// it ends are merged into it, and apply runs once when owner calls Flush at
+// the end of window. Not thread safe, meant to be used on UI thread only.
+class UiUpdateCoalescer final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Apply = std::function<void ()>;
+
+    static constexpr auto DefaultWindow = std::chrono::milliseconds(16);
+
+private:
+    Apply             mApply;
+    Clock::duration   mWindow;
+    Clock::time_point mDue       = Clock::time_point();
+    bool              mIsPending = false;
+    std::uint64_t     mRequests  = 0;
+    std::uint64_t     mApplied   = 0;
+
+public:
+    explicit UiUpdateCoalescer (Apply apply, Clock::duration window = DefaultWindow);
+
+    UiUpdateCoalescer            (const UiUpdateCoalescer& rhs) = delete;
+    UiUpdateCoalescer& operator= (const UiUpdateCoalescer& rhs) = delete;
+
+    // Returns true when request opened a window, owner should arrange
+    // Flush to be called at GetDue().
+    auto Request (Clock::time_point now = Clock::now()) -> bool;
+
+    // Runs apply if window has ended. Returns false if nothing was applied,
+    // when IsPending() still holds Flush must be called again at GetDue().
+    auto Flush (Clock::time_point now = Clock::now()) -> bool;
+
+    auto IsPending () const -> bool
+    {
+        return mIsPending;
+    }
+
+    auto GetDue () const -> Clock::time_point
+    {
+        return mDue;
+    }
+
+    auto GetRequests () const -> std::uint64_t
+    {
+        return mRequests;
+    }
+
+    auto GetApplied () const -> std::uint64_t
+    {
+        return mApplied;
+    }
+};
+
+// Last state user was notified about. Notify returns true and remembers
+// state only when it differs, so a burst of changes that ends where it
+// started is not announced again.
+template <typename State>
+class UiNotifyFilter final
+{
+    std::optional<State> mShown = std::nullopt;
+
+public:
+    auto Notify (const State& state) -> bool
+    {
+        if (mShown == state)
+        {
+            return false;
+        }
+
+        mShown = state;
+        return true;
+    }
+};
+
+} // namespace CaffeineTake
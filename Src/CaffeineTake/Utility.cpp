@@ -23,24 +23,142 @@
 #include "Utility.hpp"
 
 #include <array>
+#include <climits>
 #include <filesystem>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#   include <ObjBase.h>
+#   include <ObjIdl.h>
+#   include <Psapi.h>
+#   include <ShlGuid.h>
+#   include <ShlObj.h>
+#   include <ShObjIdl.h>
+#   include <shlwapi.h>
+#   include <VersionHelpers.h>
+#   include <WinNls.h>
+
+#   if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION)
+#       include <wtsapi32.h>
+#   endif
+#else
+namespace {
+    // Malformed input decodes as U+FFFD, same as Windows conversions do.
+    constexpr auto Replacement = char32_t{0xFFFD};
+
+    auto DecodeUtf8 (const std::string_view str, size_t& i) -> char32_t
+    {
+        const auto lead = static_cast<unsigned char>(str[i++]);
+        if (lead < 0x80)
+        {
+            return lead;
+        }
 
-#include <ObjBase.h>
-#include <ObjIdl.h>
-#include <Psapi.h>
-#include <ShlGuid.h>
-#include <ShlObj.h>
-#include <ShObjIdl.h>
-#include <shlwapi.h>
-#include <VersionHelpers.h>
-#include <WinNls.h>
+        auto length   = size_t{0};
+        auto cp       = char32_t{0};
+        auto smallest = char32_t{0};
 
-#if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION)
-    #include <wtsapi32.h>
+        if      ((lead & 0xE0) == 0xC0) { length = 1; cp = lead & 0x1F; smallest = 0x80; }
+        else if ((lead & 0xF0) == 0xE0) { length = 2; cp = lead & 0x0F; smallest = 0x800; }
+        else if ((lead & 0xF8) == 0xF0) { length = 3; cp = lead & 0x07; smallest = 0x10000; }
+        else
+        {
+            return Replacement;
+        }
+
+        for (auto n = size_t{0}; n < length; ++n)
+        {
+            if (i >= str.size() || (static_cast<unsigned char>(str[i]) & 0xC0) != 0x80)
+            {
+                return Replacement;
+            }
+
+            cp = (cp << 6) | (static_cast<unsigned char>(str[i++]) & 0x3F);
+        }
+
+        if (cp < smallest || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        {
+            return Replacement;
+        }
+
+        return cp;
+    }
+
+    // wchar_t is UTF-16 on Windows but UTF-32 almost everywhere else.
+    auto DecodeWide (const std::wstring_view str, size_t& i) -> char32_t
+    {
+        const auto unit = static_cast<char32_t>(str[i++]);
+
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            if (unit >= 0xD800 && unit <= 0xDBFF && i < str.size())
+            {
+                const auto low = static_cast<char32_t>(str[i]);
+                if (low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    i += 1;
+                    return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                }
+            }
+        }
+
+        if (unit > 0x10FFFF || (unit >= 0xD800 && unit <= 0xDFFF))
+        {
+            return Replacement;
+        }
+
+        return unit;
+    }
+
+    auto AppendWide (std::wstring& out, char32_t cp) -> void
+    {
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            if (cp >= 0x10000)
+            {
+                cp -= 0x10000;
+                out.push_back(static_cast<wchar_t>(0xD800 + (cp >> 10)));
+                out.push_back(static_cast<wchar_t>(0xDC00 + (cp & 0x3FF)));
+                return;
+            }
+        }
+
+        out.push_back(static_cast<wchar_t>(cp));
+    }
+
+    auto AppendUtf8 (std::string& out, const char32_t cp) -> void
+    {
+        if (cp < 0x80)
+        {
+            out.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+}
 #endif
 
 namespace CaffeineTake {
 
+#if defined(_WIN32)
+
 auto UTF8ToUTF16 (const std::string_view str) -> std::optional<std::wstring>
 {
     // Get size.
@@ -77,6 +195,31 @@ auto UTF8ToUTF16 (const std::string_view str) -> std::optional<std::wstring>
     return utf16;
 }
 
+auto UTF8ToUTF16 (const std::string_view str, std::wstring& out) -> bool
+{
+    // UTF-16 never has more code units than UTF-8 has bytes, convert in one call.
+    out.resize(str.size());
+
+    const auto size = str.empty() ? 0 : ::MultiByteToWideChar(
+        CP_UTF8,
+        0,
+        str.data(),
+        static_cast<int>(str.size()),
+        out.data(),
+        static_cast<int>(out.size())
+    );
+
+    if (size <= 0)
+    {
+        out.clear();
+        return false;
+    }
+
+    out.resize(size);
+
+    return true;
+}
+
 auto UTF16ToUTF8 (const std::wstring_view str) -> std::optional<std::string>
 {
     // Get size.
@@ -117,6 +260,95 @@ auto UTF16ToUTF8 (const std::wstring_view str) -> std::optional<std::string>
     return utf8;
 }
 
+auto UTF16ToUTF8 (const std::wstring_view str, std::string& out) -> bool
+{
+    // One UTF-16 code unit never takes more than three bytes, convert in one call.
+    out.resize(str.size() * 3);
+
+    const auto size = str.empty() ? 0 : ::WideCharToMultiByte(
+        CP_UTF8,
+        0,
+        str.data(),
+        static_cast<int>(str.size()),
+        out.data(),
+        static_cast<int>(out.size()),
+        nullptr,
+        nullptr
+    );
+
+    if (size <= 0)
+    {
+        out.clear();
+        return false;
+    }
+
+    out.resize(size);
+
+    return true;
+}
+
+#else
+
+auto UTF8ToUTF16 (const std::string_view str) -> std::optional<std::wstring>
+{
+    auto out = std::wstring();
+    if (!UTF8ToUTF16(str, out))
+    {
+        return std::nullopt;
+    }
+
+    return out;
+}
+
+auto UTF8ToUTF16 (const std::string_view str, std::wstring& out) -> bool
+{
+    out.clear();
+    if (str.empty())
+    {
+        return false;
+    }
+
+    out.reserve(str.size());
+    for (auto i = size_t{0}; i < str.size(); )
+    {
+        AppendWide(out, DecodeUtf8(str, i));
+    }
+
+    return true;
+}
+
+auto UTF16ToUTF8 (const std::wstring_view str) -> std::optional<std::string>
+{
+    auto out = std::string();
+    if (!UTF16ToUTF8(str, out))
+    {
+        return std::nullopt;
+    }
+
+    return out;
+}
+
+auto UTF16ToUTF8 (const std::wstring_view str, std::string& out) -> bool
+{
+    out.clear();
+    if (str.empty())
+    {
+        return false;
+    }
+
+    out.reserve(str.size());
+    for (auto i = size_t{0}; i < str.size(); )
+    {
+        AppendUtf8(out, DecodeWide(str, i));
+    }
+
+    return true;
+}
+
+#endif // #if defined(_WIN32)
+
+#if defined(_WIN32)
+
 auto GetAppDataPath () -> std::filesystem::path
 {
     auto appDataPath = std::array<wchar_t, MAX_PATH>();
@@ -339,148 +571,15 @@ auto AddShortcutToStartup (const std::wstring& lnk, const std::filesystem::path&
     return hr == S_OK;
 }
 
-auto ScanProcesses (std::function<ScanResult (HANDLE, DWORD, const std::wstring_view)> checkFn) -> bool
-{
-    // Get the list of process identifiers (PID's).
-    const auto PROCESS_LIST_MAX_SIZE = 2048;
+#endif // #if defined(_WIN32)
 
-    auto processList   = std::vector<DWORD>(PROCESS_LIST_MAX_SIZE);
-    auto bytesReturned = DWORD{ 0 };
-    if (!EnumProcesses(processList.data(), static_cast<DWORD>(processList.size()), &bytesReturned))
-    {
-        //Log("EnumProcesses() failed");
-        return false;
-    }
-    auto numberOfProccesses = bytesReturned / sizeof(DWORD);
-
-    // Loop through running processes.
-    for (auto i = unsigned long{ 0 }; i < numberOfProccesses; ++i)
-    {
-        auto pid = processList[i];
-        if (pid != 0)
-        {
-            auto processHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-            if (!processHandle)
-            {
-                continue;
-            }
-
-            // Read process executable path.
-            auto imageName = std::array<wchar_t, MAX_PATH>{ 0 };
-            auto size      = DWORD{ MAX_PATH };
-            if (QueryFullProcessImageNameW(processHandle, 0, imageName.data(), &size))
-            {
-                // Execute callback.
-                const auto result = checkFn(processHandle, pid, imageName.data());
-                switch (result)
-                {
-                default:
-                case ScanResult::Continue:
-                    break;
-
-                case ScanResult::Success:
-                    CloseHandle(processHandle);
-                    return true;
-
-                case ScanResult::Stop:
-                case ScanResult::Failure:
-                    CloseHandle(processHandle);
-                    return false;
-                }
-            }
-            
-            CloseHandle(processHandle);
-        }
-    }
-
-    return false;
-}
-
-auto ScanWindows (std::function<ScanResult (HWND, DWORD, const std::wstring_view)> checkFn, bool onlyVisible) -> bool
+auto GetScanScratch () -> ScanScratch&
 {
-    #define ERROR_USER_CALLBACK_SUCCESS (1 << 29) // bit 29 for user errors
-
-    struct EnumWindowsProcData
-    {
-        decltype(onlyVisible) onlyVisible;
-        decltype(checkFn)     checkFn;
-    };
-
-    auto enumWindowsProcData = EnumWindowsProcData {onlyVisible, checkFn};
-    auto enumWindowsProc = [](HWND hWnd, LPARAM lParam) -> BOOL {
-        auto payload     = reinterpret_cast<EnumWindowsProcData*>(lParam);
-        auto onlyVisible = payload->onlyVisible;
-        auto callbackFn  = payload->checkFn;
-
-        if (onlyVisible && (!IsWindowVisible(hWnd) && !IsIconic(hWnd)))
-        {
-            return TRUE;
-        }
-
-        auto length = GetWindowTextLength(hWnd);
-        if (length > 0)
-        {
-            const auto size = static_cast<size_t>(length) + 1;
-
-            auto title = std::wstring(size, L'\0');
-            GetWindowTextW(hWnd, title.data(), size);
-
-            auto pid = DWORD{0};
-            GetWindowThreadProcessId(hWnd, &pid);
-
-            // Execute callback.            
-            const auto result = callbackFn(hWnd, pid, title.data());
-            switch (result)
-            {
-            default:
-            case ScanResult::Continue:
-                break;
-
-            case ScanResult::Success:
-                SetLastError(ERROR_USER_CALLBACK_SUCCESS);
-                return FALSE;
-
-            case ScanResult::Stop:
-            case ScanResult::Failure:
-                break;
-            }
-        }
-
-        return TRUE;
-    };
-
-    if (!EnumWindows(enumWindowsProc, reinterpret_cast<LPARAM>(&enumWindowsProcData)))
-    {
-        // Check if callback returned true.
-        const auto error = GetLastError();
-        if (error == ERROR_USER_CALLBACK_SUCCESS)
-        {
-            return true;
-        }
-    }
-
-    return false;
+    thread_local auto scratch = ScanScratch();
+    return scratch;
 }
 
-auto GetProcessPath (DWORD pid) -> std::filesystem::path
-{
-    auto processHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-    if (processHandle)
-    {
-        // Read process executable path.
-        auto imageName = std::array<wchar_t, MAX_PATH>{ 0 };
-        auto size      = DWORD{ MAX_PATH };
-        if (QueryFullProcessImageNameW(processHandle, 0, imageName.data(), &size))
-        {
-            CloseHandle(processHandle);
-            return std::filesystem::path(imageName.data());
-        }
-            
-        CloseHandle(processHandle);
-    }
-
-    return std::filesystem::path();
-}
+#if defined(_WIN32)
 
 auto GetDpi (HWND hWnd) -> int
 {
@@ -502,6 +601,8 @@ auto GetDpi (HWND hWnd) -> int
     return dpi;
 }
 
+#endif // #if defined(_WIN32)
+
 auto HexCharToInt (const char c) -> unsigned char
 {
     if ('a' <= c && c <= 'f')
@@ -21,10 +21,11 @@
 #pragma once
 
 #include <filesystem>
-#include <functional>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
 
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -49,7 +50,42 @@ enum class ScanResult : unsigned char
 };
 
 auto UTF8ToUTF16 (const std::string_view str) -> std::optional<std::wstring>;
+auto UTF8ToUTF16 (const std::string_view str, std::wstring& out) -> bool; // reuses out's buffer
 auto UTF16ToUTF8 (const std::wstring_view str) -> std::optional<std::string>;
+auto UTF16ToUTF8 (const std::wstring_view str, std::string& out) -> bool; // reuses out's buffer
+
+template <typename Signature>
+class FunctionRef;
+
+// Non-owning reference to a callable, for visitors passed through virtual
+// calls. Unlike std::function it never allocates, referenced callable must
+// outlive the call it's passed to.
+template <typename R, typename... Args>
+class FunctionRef<R (Args...)>
+{
+    void* mCallable                = nullptr;
+    R   (*mThunk) (void*, Args...) = nullptr;
+
+public:
+    template <typename Callable>
+        requires (!std::is_same_v<std::remove_cvref_t<Callable>, FunctionRef> &&
+                  std::is_invocable_r_v<R, Callable&, Args...>)
+    FunctionRef (Callable&& callable) noexcept
+        : mCallable (const_cast<void*>(static_cast<const void*>(std::addressof(callable))))
+        , mThunk    (
+            [](void* callable, Args... args) -> R
+            {
+                return (*static_cast<std::remove_reference_t<Callable>*>(callable))(std::forward<Args>(args)...);
+            }
+        )
+    {
+    }
+
+    auto operator() (Args... args) const -> R
+    {
+        return mThunk(mCallable, std::forward<Args>(args)...);
+    }
+};
 
 auto GetAppDataPath  () -> std::filesystem::path;
 auto IsSessionLocked () -> SessionState;
@@ -59,9 +95,68 @@ auto EnableShortcutAutoStart  (const std::wstring& lnk) -> bool;
 auto DisableShortcutAutoStart (const std::wstring& lnk) -> bool;
 auto AddShortcutToStartup     (const std::wstring& lnk, const std::filesystem::path& target) -> bool;
 
-auto ScanProcesses  (std::function<ScanResult (HANDLE, DWORD, const std::wstring_view)> checkFn) -> bool;
-auto ScanWindows    (std::function<ScanResult (HWND, DWORD, const std::wstring_view)> checkFn, bool onlyVisible = true) -> bool;
-auto GetProcessPath (DWORD pid) -> std::filesystem::path;
+// Buffers reused by ScanWindows, one set per thread.
+struct ScanScratch
+{
+    std::wstring Title = std::wstring();
+};
+
+auto GetScanScratch () -> ScanScratch&;
+
+// Callback is called as ScanResult(HWND hWnd, DWORD pid, std::wstring_view title).
+// View points into scratch buffer, copy it if you need to keep it.
+template <typename CheckFn>
+auto ScanWindows (CheckFn&& checkFn, bool onlyVisible = true) -> bool
+{
+    struct EnumWindowsProcData
+    {
+        CheckFn&      Check;
+        std::wstring& Title;
+        bool          OnlyVisible;
+        ScanResult    Result;
+    };
+
+    auto enumWindowsProcData = EnumWindowsProcData{ checkFn, GetScanScratch().Title, onlyVisible, ScanResult::Continue };
+    auto enumWindowsProc = [](HWND hWnd, LPARAM lParam) -> BOOL {
+        auto payload = reinterpret_cast<EnumWindowsProcData*>(lParam);
+
+        if (payload->OnlyVisible && (!IsWindowVisible(hWnd) && !IsIconic(hWnd)))
+        {
+            return TRUE;
+        }
+
+        const auto length = GetWindowTextLengthW(hWnd);
+        if (length <= 0)
+        {
+            return TRUE;
+        }
+
+        // Grow only, steady state reuses the buffer.
+        auto& title = payload->Title;
+        if (title.size() < static_cast<size_t>(length) + 1)
+        {
+            title.resize(static_cast<size_t>(length) + 1);
+        }
+
+        const auto copied = GetWindowTextW(hWnd, title.data(), static_cast<int>(title.size()));
+        if (copied <= 0)
+        {
+            return TRUE;
+        }
+
+        auto pid = DWORD{0};
+        GetWindowThreadProcessId(hWnd, &pid);
+
+        // Execute callback.
+        payload->Result = payload->Check(hWnd, pid, std::wstring_view(title.data(), static_cast<size_t>(copied)));
+
+        return payload->Result == ScanResult::Continue ? TRUE : FALSE;
+    };
+
+    EnumWindows(enumWindowsProc, reinterpret_cast<LPARAM>(&enumWindowsProcData));
+
+    return enumWindowsProcData.Result == ScanResult::Success;
+}
 
 auto GetDpi (HWND hWnd) -> int;
 
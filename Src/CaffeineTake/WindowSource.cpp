@@ -0,0 +1,77 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "WindowSource.hpp"
+
+#include "SyntheticWorkload.hpp"
+
+#include <memory>
+#include <string_view>
+
+namespace CaffeineTake {
+
+#if defined(_WIN32)
+
+namespace {
+
+class WindowsWindowSource final : public WindowSource
+{
+public:
+    auto Enumerate (const Visitor& visitor) -> bool override
+    {
+        auto visited = std::uint64_t{0};
+        auto result  = ScanWindows(
+            [&](HWND hWnd, DWORD pid, std::wstring_view title)
+            {
+                visited += 1;
+                return visitor(static_cast<ProcessId>(pid), title);
+            }
+        );
+
+        // EnumWindows, then title and owner of every window passed on.
+        mOsCalls += 1 + visited * 3;
+
+        return result;
+    }
+};
+
+} // namespace
+
+#endif // #if defined(_WIN32)
+
+auto CreateWindowSource () -> WindowSourcePtr
+{
+#if defined(FEATURE_CAFFEINETAKE_SYNTHETIC_WORKLOAD)
+    if (auto workload = SyntheticWorkload::GetInstalled())
+    {
+        return workload->CreateWindowSource();
+    }
+#endif
+
+#if defined(_WIN32)
+    return std::make_unique<WindowsWindowSource>();
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace CaffeineTake
@@ -0,0 +1,59 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "ProcessSource.hpp"
+#include "Utility.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace CaffeineTake {
+
+// Top level windows with a title, as WindowScanner sees them.
+class WindowSource
+{
+protected:
+    std::uint64_t mOsCalls = 0;
+
+public:
+    // Title view is valid only during the call.
+    using Visitor = FunctionRef<ScanResult (ProcessId pid, std::wstring_view title)>;
+
+    virtual ~WindowSource () {}
+
+    // Visit visible (or minimized) windows until visitor returns other than
+    // Continue. Returns true if it returned Success.
+    virtual auto Enumerate (const Visitor& visitor) -> bool = 0;
+
+    auto GetOsCallCount () const -> std::uint64_t
+    {
+        return mOsCalls;
+    }
+};
+
+using WindowSourcePtr = std::unique_ptr<WindowSource>;
+
+// Synthetic workload when one is installed, nullptr where there are no windows to list.
+auto CreateWindowSource () -> WindowSourcePtr;
+
+} // namespace CaffeineTake
@@ -0,0 +1,203 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Diagnostics.hpp"
+#include "Tracing.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CaffeineTake {
+
+class WorkerPool
+{
+public:
+    using Task = std::function<void ()>;
+
+private:
+    std::vector<std::thread>  mThreads          = std::vector<std::thread>();
+    std::vector<Task>         mTasks            = std::vector<Task>();   // ring, grows only when full
+    size_t                    mHead             = 0;
+    size_t                    mCount            = 0;
+    std::mutex                mWorkerMutex;
+    std::condition_variable   mTaskConditionVar;
+    std::condition_variable   mIdleConditionVar;
+    size_t                    mActiveTasks      = 0;
+    bool                      mIsDone           = true;
+
+    auto Worker () -> void
+    {
+        TRACE_THREAD_NAME("Worker");
+        DIAG_THREAD("Worker");
+
+        while (true)
+        {
+            auto task = Task();
+            {
+                auto waitLock = std::unique_lock<std::mutex>(mWorkerMutex);
+                mTaskConditionVar.wait(
+                    waitLock,
+                    [&]
+                    {
+                        return mIsDone || mCount > 0; // return false to continue wait
+                    }
+                );
+
+                // Queue is drained before quitting.
+                if (mCount == 0)
+                {
+                    break;
+                }
+
+                // Slot is cleared so captures die with the task.
+                task          = std::move(mTasks[mHead]);
+                mTasks[mHead] = nullptr;
+                mHead         = (mHead + 1) % mTasks.size();
+                mCount       -= 1;
+                mActiveTasks += 1;
+            }
+
+            task();
+
+            {
+                auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+                mActiveTasks -= 1;
+                if (mActiveTasks == 0 && mCount == 0)
+                {
+                    mIdleConditionVar.notify_all();
+                }
+            }
+        }
+    }
+
+    // Expects mWorkerMutex to be held.
+    auto Grow () -> void
+    {
+        auto tasks = std::vector<Task>(std::max(size_t{8}, mTasks.size() * 2));
+        for (auto i = size_t{0}; i < mCount; ++i)
+        {
+            tasks[i] = std::move(mTasks[(mHead + i) % mTasks.size()]);
+        }
+
+        mTasks = std::move(tasks);
+        mHead  = 0;
+    }
+
+    WorkerPool            (const WorkerPool& rhs) = delete;
+    WorkerPool& operator= (const WorkerPool& rhs) = delete;
+
+public:
+    WorkerPool () = default;
+
+    ~WorkerPool ()
+    {
+        Stop();
+    }
+
+    auto Start (size_t threadCount) -> bool
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+
+        if (!mIsDone || threadCount == 0)
+        {
+            return false;
+        }
+
+        mIsDone = false;
+        mThreads.reserve(threadCount);
+        for (auto i = size_t{0}; i < threadCount; ++i)
+        {
+            mThreads.emplace_back(&WorkerPool::Worker, this);
+        }
+
+        return true;
+    }
+
+    // Finishes queued tasks and joins workers.
+    auto Stop () -> void
+    {
+        {
+            auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+            mIsDone = true;
+            mTaskConditionVar.notify_all();
+        }
+
+        for (auto& thread : mThreads)
+        {
+            if (thread.joinable())
+            {
+                thread.join();
+            }
+        }
+
+        mThreads.clear();
+    }
+
+    // Returns false if pool is not running, task is not queued then.
+    auto Submit (Task task) -> bool
+    {
+        {
+            auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+            if (mIsDone)
+            {
+                return false;
+            }
+
+            if (mCount == mTasks.size())
+            {
+                Grow();
+            }
+
+            mTasks[(mHead + mCount) % mTasks.size()] = std::move(task);
+            mCount += 1;
+        }
+
+        mTaskConditionVar.notify_one();
+
+        return true;
+    }
+
+    auto WaitIdle () -> void
+    {
+        auto waitLock = std::unique_lock<std::mutex>(mWorkerMutex);
+        mIdleConditionVar.wait(
+            waitLock,
+            [&]
+            {
+                return mActiveTasks == 0 && mCount == 0;
+            }
+        );
+    }
+
+    auto IsRunning () -> bool
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+        return !mIsDone;
+    }
+};
+
+} // namespace CaffeineTake